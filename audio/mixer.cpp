@@ -26,6 +26,7 @@
 #include "common/textconsole.h"
 
 #include "audio/mixer_intern.h"
+#include "audio/mixer_bus.h"
 #include "audio/rate.h"
 #include "audio/audiostream.h"
 #include "audio/timestamp.h"
@@ -47,20 +48,22 @@ public:
 	~Channel();
 
 	/**
-	 * Mixes the channel's samples into the given buffer.
+	 * Mixes the channel's samples into the given mixing bus.
 	 *
-	 * @param data buffer where to mix the data
-	 * @param len  number of sample *pairs*. So a value of
-	 *             10 means that the buffer contains twice 10 sample, each
-	 *             16 bits, for a total of 40 bytes.
+	 * @param bus     32 bit buffer where to mix the data
+	 * @param scratch buffer of at least the same size, used to hold the
+	 *                channel's samples before they are scaled and mixed
+	 * @param len     number of sample *pairs*. So a value of
+	 *                10 means that the buffers contain twice 10 samples.
 	 * @return number of sample pairs processed (which can still be silence!)
 	 */
-	int mix(int16 *data, uint len);
+	int mix(int32 *bus, int16 *scratch, uint len);
 
 	/**
-	 * Queries whether the channel is still playing or not.
+	 * Queries whether the channel is still playing or not. Once the stream
+	 * has ended, the channel plays on until the converter is drained.
 	 */
-	bool isFinished() const { return _stream->endOfStream(); }
+	bool isFinished() const { return _stream->endOfStream() && (_drained || isPaused()); }
 
 	/**
 	 * Queries whether the channel is a permanent channel.
@@ -165,6 +168,7 @@ private:
 	uint32 _pauseTime;
 
 	RateConverter *_converter;
+	bool _drained;
 	Common::DisposablePtr<AudioStream> _stream;
 };
 
@@ -173,15 +177,24 @@ private:
 #pragma mark -
 
 MixerImpl::MixerImpl(uint sampleRate)
-	: _mutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _soundTypeSettings() {
+	: _mutex(), _controlMutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _soundTypeSettings() {
 
 	assert(sampleRate > 0);
 
-	for (int i = 0; i != NUM_CHANNELS; i++)
+	// The converters may be created from several threads once mixing starts
+	initPolyphaseRateConverters();
+
+	for (int i = 0; i != NUM_CHANNELS; i++) {
 		_channels[i] = 0;
+		_status[i].handle = SoundHandle()._val;
+		_retired[i] = SoundHandle()._val;
+	}
 }
 
 MixerImpl::~MixerImpl() {
+	// Channels which never made it to the audio thread are still queued
+	processCommands();
+
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		delete _channels[i];
 }
@@ -194,29 +207,89 @@ uint MixerImpl::getOutputRate() const {
 	return _sampleRate;
 }
 
-void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
-	int index = -1;
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] == 0) {
-			index = i;
+bool MixerImpl::isSlotActive(int index) const {
+	const uint32 handle = _status[index].handle;
+	return handle != SoundHandle()._val && handle != _retired[index];
+}
+
+int MixerImpl::findActiveSlot(SoundHandle handle) const {
+	const int index = handle._val % NUM_CHANNELS;
+	if (_status[index].handle != handle._val || !isSlotActive(index))
+		return -1;
+	return index;
+}
+
+bool MixerImpl::queueCommand(const Command &cmd) {
+	Common::StackLock lock(_controlMutex);
+
+	if (cmd.type != Command::kSoundTypeChanged) {
+		SoundHandle handle;
+		handle._val = cmd.handle;
+		const int index = findActiveSlot(handle);
+		if (index == -1)
+			return true;
+
+		if (!_commands.push(cmd))
+			return false;
+
+		if (cmd.type == Command::kSetVolume)
+			_status[index].volume = cmd.value;
+		else if (cmd.type == Command::kSetBalance)
+			_status[index].balance = cmd.value;
+		return true;
+	}
+
+	return _commands.push(cmd);
+}
+
+void MixerImpl::flushCommands() {
+	// The queue is full: the audio thread is either not running or
+	// cannot keep up, so apply the commands ourselves
+	Common::StackLock lock(_mutex);
+	processCommands();
+}
+
+void MixerImpl::processCommands() {
+	Command cmd;
+	while (_commands.pop(cmd)) {
+		Channel *chan;
+
+		switch (cmd.type) {
+		case Command::kPlay:
+			assert(!_channels[cmd.handle % NUM_CHANNELS]);
+			_channels[cmd.handle % NUM_CHANNELS] = cmd.channel;
+			break;
+		case Command::kSetVolume:
+			if ((chan = findChannel(cmd.handle)) != 0)
+				chan->setVolume(cmd.value);
+			break;
+		case Command::kSetBalance:
+			if ((chan = findChannel(cmd.handle)) != 0)
+				chan->setBalance(cmd.value);
+			break;
+		case Command::kSoundTypeChanged:
+			for (int i = 0; i != NUM_CHANNELS; ++i) {
+				if (_channels[i] && _channels[i]->getType() == cmd.value)
+					_channels[i]->notifyGlobalVolChange();
+			}
 			break;
 		}
 	}
-	if (index == -1) {
-		warning("MixerImpl::out of mixer slots");
-		delete chan;
-		return;
-	}
-
-	_channels[index] = chan;
+}
 
-	SoundHandle chanHandle;
-	chanHandle._val = index + (_handleSeed * NUM_CHANNELS);
+Channel *MixerImpl::findChannel(uint32 handle) {
+	Channel *chan = _channels[handle % NUM_CHANNELS];
+	if (!chan || chan->getHandle()._val != handle)
+		return 0;
+	return chan;
+}
 
-	chan->setHandle(chanHandle);
-	_handleSeed++;
-	if (handle)
-		*handle = chanHandle;
+void MixerImpl::retireChannel(int index) {
+	// Queries look at _retired without locking, so this makes the
+	// channel inactive for everybody at once
+	_retired[index] = _channels[index]->getHandle()._val;
+	_channels[index] = 0;
+	mixerMemoryBarrier();
 }
 
 void MixerImpl::playStream(
@@ -227,7 +300,6 @@ void MixerImpl::playStream(
 			DisposeAfterUse::Flag autofreeStream,
 			bool permanent,
 			bool reverseStereo) {
-	Common::StackLock lock(_mutex);
 
 	if (stream == 0) {
 		warning("stream is 0");
@@ -237,31 +309,86 @@ void MixerImpl::playStream(
 
 	assert(_mixerReady);
 
-	// Prevent duplicate sounds
-	if (id != -1) {
-		for (int i = 0; i != NUM_CHANNELS; i++)
-			if (_channels[i] != 0 && _channels[i]->getId() == id) {
-				// Delete the stream if were asked to auto-dispose it.
-				// Note: This could cause trouble if the client code does not
-				// yet expect the stream to be gone. The primary example to
-				// keep in mind here is QueuingAudioStream.
-				// Thus, as a quick rule of thumb, you should never, ever,
-				// try to play QueuingAudioStreams with a sound id.
-				if (autofreeStream == DisposeAfterUse::YES)
+#ifdef AUDIO_REVERSE_STEREO
+	reverseStereo = !reverseStereo;
+#endif
+
+	Channel *chan = 0;
+
+	for (;;) {
+		{
+			Common::StackLock lock(_controlMutex);
+
+			// Prevent duplicate sounds
+			if (id != -1) {
+				for (int i = 0; i != NUM_CHANNELS; i++)
+					if (isSlotActive(i) && _status[i].id == id) {
+						// Delete the stream if were asked to auto-dispose it.
+						// Note: This could cause trouble if the client code does not
+						// yet expect the stream to be gone. The primary example to
+						// keep in mind here is QueuingAudioStream.
+						// Thus, as a quick rule of thumb, you should never, ever,
+						// try to play QueuingAudioStreams with a sound id.
+						if (chan)
+							delete chan;
+						else if (autofreeStream == DisposeAfterUse::YES)
+							delete stream;
+						return;
+					}
+			}
+
+			int index = -1;
+			for (int i = 0; i != NUM_CHANNELS; i++) {
+				if (!isSlotActive(i)) {
+					index = i;
+					break;
+				}
+			}
+			if (index == -1) {
+				warning("MixerImpl::out of mixer slots");
+				if (chan)
+					delete chan;
+				else if (autofreeStream == DisposeAfterUse::YES)
 					delete stream;
 				return;
 			}
-	}
 
-#ifdef AUDIO_REVERSE_STEREO
-	reverseStereo = !reverseStereo;
-#endif
+			// Create the channel
+			if (!chan) {
+				chan = new Channel(this, type, stream, autofreeStream, reverseStereo, id, permanent);
+				chan->setVolume(volume);
+				chan->setBalance(balance);
+			}
+
+			SoundHandle chanHandle;
+			chanHandle._val = index + (_handleSeed * NUM_CHANNELS);
+			chan->setHandle(chanHandle);
+
+			Command cmd;
+			cmd.type = Command::kPlay;
+			cmd.handle = chanHandle._val;
+			cmd.value = 0;
+			cmd.channel = chan;
+
+			if (_commands.push(cmd)) {
+				ChannelStatus &status = _status[index];
+				status.id = id;
+				status.type = type;
+				status.permanent = permanent;
+				status.volume = volume;
+				status.balance = balance;
+				mixerMemoryBarrier();
+				status.handle = chanHandle._val;
+
+				_handleSeed++;
+				if (handle)
+					*handle = chanHandle;
+				return;
+			}
+		}
 
-	// Create the channel
-	Channel *chan = new Channel(this, type, stream, autofreeStream, reverseStereo, id, permanent);
-	chan->setVolume(volume);
-	chan->setBalance(balance);
-	insertChannel(handle, chan);
+		flushCommands();
+	}
 }
 
 int MixerImpl::mixCallback(byte *samples, uint len) {
@@ -277,67 +404,110 @@ int MixerImpl::mixCallback(byte *samples, uint len) {
 	// Since the mixer callback has been called, the mixer must be ready...
 	_mixerReady = true;
 
-	//  zero the buf
-	memset(buf, 0, 2 * len * sizeof(int16));
+	processCommands();
+
+	// The channels are mixed into a 32 bit bus, which is only clamped
+	// once all of them have been added up
+	if (_mixBus.size() < 2 * len) {
+		_mixBus.resize(2 * len);
+		_mixScratch.resize(2 * len);
+	}
+	int32 *bus = _mixBus.begin();
+	memset(bus, 0, 2 * len * sizeof(int32));
 
 	// mix all channels
 	int res = 0, tmp;
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		if (_channels[i]) {
 			if (_channels[i]->isFinished()) {
-				delete _channels[i];
-				_channels[i] = 0;
+				Channel *chan = _channels[i];
+				retireChannel(i);
+				delete chan;
 			} else if (!_channels[i]->isPaused()) {
-				tmp = _channels[i]->mix(buf, len);
+				tmp = _channels[i]->mix(bus, _mixScratch.begin(), len);
 
 				if (tmp > res)
 					res = tmp;
 			}
 		}
 
+	mixBusResolve(buf, bus, len);
+
 	return res;
 }
 
 void MixerImpl::stopAll() {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
-			delete _channels[i];
-			_channels[i] = 0;
+	Channel *stopped[NUM_CHANNELS];
+	int count = 0;
+
+	{
+		Common::StackLock lock(_mutex);
+		processCommands();
+		for (int i = 0; i != NUM_CHANNELS; i++) {
+			if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
+				stopped[count++] = _channels[i];
+				retireChannel(i);
+			}
 		}
 	}
+
+	// The streams may take a while to clean up, don't keep the mixer waiting
+	for (int i = 0; i < count; i++)
+		delete stopped[i];
 }
 
 void MixerImpl::stopID(int id) {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			delete _channels[i];
-			_channels[i] = 0;
+	Channel *stopped[NUM_CHANNELS];
+	int count = 0;
+
+	{
+		Common::StackLock lock(_mutex);
+		processCommands();
+		for (int i = 0; i != NUM_CHANNELS; i++) {
+			if (_channels[i] != 0 && _channels[i]->getId() == id) {
+				stopped[count++] = _channels[i];
+				retireChannel(i);
+			}
 		}
 	}
+
+	for (int i = 0; i < count; i++)
+		delete stopped[i];
 }
 
 void MixerImpl::stopHandle(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
-
 	// Simply ignore stop requests for handles of sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	if (findActiveSlot(handle) == -1)
 		return;
 
-	delete _channels[index];
-	_channels[index] = 0;
+	Channel *chan;
+
+	{
+		Common::StackLock lock(_mutex);
+		processCommands();
+
+		chan = findChannel(handle._val);
+		if (!chan)
+			return;
+
+		retireChannel(handle._val % NUM_CHANNELS);
+	}
+
+	delete chan;
 }
 
 void MixerImpl::muteSoundType(SoundType type, bool mute) {
 	assert(0 <= (int)type && (int)type < ARRAYSIZE(_soundTypeSettings));
 	_soundTypeSettings[type].mute = mute;
 
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
-	}
+	Command cmd;
+	cmd.type = Command::kSoundTypeChanged;
+	cmd.handle = 0;
+	cmd.value = type;
+	cmd.channel = 0;
+
+	while (!queueCommand(cmd))
+		flushCommands();
 }
 
 bool MixerImpl::isSoundTypeMuted(SoundType type) const {
@@ -346,39 +516,41 @@ bool MixerImpl::isSoundTypeMuted(SoundType type) const {
 }
 
 void MixerImpl::setChannelVolume(SoundHandle handle, byte volume) {
-	Common::StackLock lock(_mutex);
+	Command cmd;
+	cmd.type = Command::kSetVolume;
+	cmd.handle = handle._val;
+	cmd.value = volume;
+	cmd.channel = 0;
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
-		return;
-
-	_channels[index]->setVolume(volume);
+	while (!queueCommand(cmd))
+		flushCommands();
 }
 
 byte MixerImpl::getChannelVolume(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findActiveSlot(handle);
+	if (index == -1)
 		return 0;
 
-	return _channels[index]->getVolume();
+	return _status[index].volume;
 }
 
 void MixerImpl::setChannelBalance(SoundHandle handle, int8 balance) {
-	Common::StackLock lock(_mutex);
-
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
-		return;
+	Command cmd;
+	cmd.type = Command::kSetBalance;
+	cmd.handle = handle._val;
+	cmd.value = balance;
+	cmd.channel = 0;
 
-	_channels[index]->setBalance(balance);
+	while (!queueCommand(cmd))
+		flushCommands();
 }
 
 int8 MixerImpl::getChannelBalance(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findActiveSlot(handle);
+	if (index == -1)
 		return 0;
 
-	return _channels[index]->getBalance();
+	return _status[index].balance;
 }
 
 uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
@@ -387,16 +559,18 @@ uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
 
 Timestamp MixerImpl::getElapsedTime(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
+	processCommands();
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Channel *chan = findChannel(handle._val);
+	if (!chan)
 		return Timestamp(0, _sampleRate);
 
-	return _channels[index]->getElapsedTime();
+	return chan->getElapsedTime();
 }
 
 void MixerImpl::pauseAll(bool paused) {
 	Common::StackLock lock(_mutex);
+	processCommands();
 	for (int i = 0; i != NUM_CHANNELS; i++) {
 		if (_channels[i] != 0) {
 			_channels[i]->pause(paused);
@@ -406,6 +580,7 @@ void MixerImpl::pauseAll(bool paused) {
 
 void MixerImpl::pauseID(int id, bool paused) {
 	Common::StackLock lock(_mutex);
+	processCommands();
 	for (int i = 0; i != NUM_CHANNELS; i++) {
 		if (_channels[i] != 0 && _channels[i]->getId() == id) {
 			_channels[i]->pause(paused);
@@ -416,51 +591,45 @@ void MixerImpl::pauseID(int id, bool paused) {
 
 void MixerImpl::pauseHandle(SoundHandle handle, bool paused) {
 	Common::StackLock lock(_mutex);
+	processCommands();
 
 	// Simply ignore (un)pause requests for sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Channel *chan = findChannel(handle._val);
+	if (!chan)
 		return;
 
-	_channels[index]->pause(paused);
+	chan->pause(paused);
 }
 
 bool MixerImpl::isSoundIDActive(int id) {
-	Common::StackLock lock(_mutex);
-
 #ifdef ENABLE_EVENTRECORDER
 	g_eventRec.updateSubsystems();
 #endif
 
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getId() == id)
+		if (isSlotActive(i) && _status[i].id == id)
 			return true;
 	return false;
 }
 
 int MixerImpl::getSoundID(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
-	const int index = handle._val % NUM_CHANNELS;
-	if (_channels[index] && _channels[index]->getHandle()._val == handle._val)
-		return _channels[index]->getId();
-	return 0;
+	const int index = findActiveSlot(handle);
+	if (index == -1)
+		return 0;
+	return _status[index].id;
 }
 
 bool MixerImpl::isSoundHandleActive(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
-
 #ifdef ENABLE_EVENTRECORDER
 	g_eventRec.updateSubsystems();
 #endif
 
-	const int index = handle._val % NUM_CHANNELS;
-	return _channels[index] && _channels[index]->getHandle()._val == handle._val;
+	return findActiveSlot(handle) != -1;
 }
 
 bool MixerImpl::hasActiveChannelOfType(SoundType type) {
-	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getType() == type)
+		if (isSlotActive(i) && _status[i].type == type)
 			return true;
 	return false;
 }
@@ -474,13 +643,16 @@ void MixerImpl::setVolumeForSoundType(SoundType type, int volume) {
 	// TODO: Maybe we should do logarithmic (not linear) volume
 	// scaling? See also Player_V2::setMasterVolume
 
-	Common::StackLock lock(_mutex);
 	_soundTypeSettings[type].volume = volume;
 
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
-	}
+	Command cmd;
+	cmd.type = Command::kSoundTypeChanged;
+	cmd.handle = 0;
+	cmd.value = type;
+	cmd.channel = 0;
+
+	while (!queueCommand(cmd))
+		flushCommands();
 }
 
 int MixerImpl::getVolumeForSoundType(SoundType type) const {
@@ -498,7 +670,7 @@ Channel::Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream,
                  DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent)
     : _type(type), _mixer(mixer), _id(id), _permanent(permanent), _volume(Mixer::kMaxChannelVolume),
       _balance(0), _pauseLevel(0), _samplesConsumed(0), _samplesDecoded(0), _mixerTimeStamp(0),
-      _pauseStartTime(0), _pauseTime(0), _converter(0), _volL(0), _volR(0),
+      _pauseStartTime(0), _pauseTime(0), _converter(0), _drained(false), _volL(0), _volR(0),
       _stream(stream, autofreeStream) {
 	assert(mixer);
 	assert(stream);
@@ -602,21 +774,45 @@ Timestamp Channel::getElapsedTime() {
 	return ts;
 }
 
-int Channel::mix(int16 *data, uint len) {
+int Channel::mix(int32 *bus, int16 *scratch, uint len) {
 	assert(_stream);
 
-	int res = 0;
-	if (_stream->endOfData()) {
-		// TODO: call drain method
-	} else {
-		assert(_converter);
+	// After the end of the stream, the converter may still hold samples,
+	// like the tail of a filter. A stream which merely ran out of data for
+	// now is left alone.
+	const bool draining = _stream->endOfData();
+	if (draining && (_drained || !_stream->endOfStream()))
+		return 0;
+
+	assert(_converter);
+	if (!draining) {
 		_samplesConsumed = _samplesDecoded;
 		_mixerTimeStamp = g_system->getMillis(true);
 		_pauseTime = 0;
-		res = _converter->flow(*_stream, data, len, _volL, _volR);
-		_samplesDecoded += res;
 	}
 
+	// Convert at full volume, the channel volume is applied while
+	// accumulating into the bus
+#ifdef OUTPUT_UNSIGNED_AUDIO
+	for (uint i = 0; i < 2 * len; ++i)
+		scratch[i] = (int16)0x8000;
+#else
+	memset(scratch, 0, 2 * len * sizeof(int16));
+#endif
+
+	int res;
+	if (draining) {
+		res = _converter->drain(scratch, len, Mixer::kMaxMixerVolume);
+		if (res <= 0) {
+			_drained = true;
+			return 0;
+		}
+	} else {
+		res = _converter->flow(*_stream, scratch, len, Mixer::kMaxMixerVolume, Mixer::kMaxMixerVolume);
+	}
+
+	mixBusAccumulate(bus, scratch, res, _volL, _volR);
+	_samplesDecoded += res;
 	return res;
 }
 
@@ -0,0 +1,162 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "audio/mixer_bus.h"
+#include "audio/mixer.h"
+
+#include "common/util.h"
+
+// Unsigned output needs the sign flipped on the way in and out, which only
+// the scalar versions handle
+#if defined(OUTPUT_UNSIGNED_AUDIO)
+// Scalar only
+#elif defined(__SSE2__)
+#define MIXER_BUS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define MIXER_BUS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Audio {
+
+/**
+ * Scale a sample by a volume. This rounds towards zero, exactly like the
+ * per-channel code in the rate converters always did, which is what the
+ * vector versions have to reproduce.
+ */
+static inline int32 scaleSample(st_sample_t sample, st_volume_t vol) {
+#ifdef OUTPUT_UNSIGNED_AUDIO
+	sample ^= 0x8000;
+#endif
+	return (sample * (int32)vol) / Mixer::kMaxMixerVolume;
+}
+
+void mixBusAccumulateScalar(int32 *bus, const st_sample_t *src, uint len, st_volume_t volL, st_volume_t volR) {
+	for (; len > 0; --len) {
+		bus[0] += scaleSample(src[0], volL);
+		bus[1] += scaleSample(src[1], volR);
+		bus += 2;
+		src += 2;
+	}
+}
+
+void mixBusResolveScalar(st_sample_t *dst, const int32 *bus, uint len) {
+	for (len *= 2; len > 0; --len) {
+		*dst = (st_sample_t)CLIP<int32>(*bus++, ST_SAMPLE_MIN, ST_SAMPLE_MAX);
+#ifdef OUTPUT_UNSIGNED_AUDIO
+		*dst ^= 0x8000;
+#endif
+		++dst;
+	}
+}
+
+#if defined(MIXER_BUS_SSE2)
+
+// Truncating division of 32 bit products by kMaxMixerVolume (256)
+static inline __m128i scaleProducts(__m128i p) {
+	const __m128i bias = _mm_and_si128(_mm_srai_epi32(p, 31), _mm_set1_epi32(Mixer::kMaxMixerVolume - 1));
+	return _mm_srai_epi32(_mm_add_epi32(p, bias), 8);
+}
+
+void mixBusAccumulate(int32 *bus, const st_sample_t *src, uint len, st_volume_t volL, st_volume_t volR) {
+	// Volumes are at most 256, so they fit a signed 16 bit lane
+	const __m128i vol = _mm_set_epi16(volR, volL, volR, volL, volR, volL, volR, volL);
+
+	for (; len >= 4; len -= 4) {
+		const __m128i s = _mm_loadu_si128((const __m128i *)src);
+		const __m128i lo = _mm_mullo_epi16(s, vol);
+		const __m128i hi = _mm_mulhi_epi16(s, vol);
+
+		__m128i *out = (__m128i *)bus;
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), scaleProducts(_mm_unpacklo_epi16(lo, hi))));
+		_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), scaleProducts(_mm_unpackhi_epi16(lo, hi))));
+
+		bus += 8;
+		src += 8;
+	}
+
+	mixBusAccumulateScalar(bus, src, len, volL, volR);
+}
+
+void mixBusResolve(st_sample_t *dst, const int32 *bus, uint len) {
+	for (; len >= 4; len -= 4) {
+		const __m128i a = _mm_loadu_si128((const __m128i *)bus);
+		const __m128i b = _mm_loadu_si128((const __m128i *)bus + 1);
+		_mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(a, b));
+
+		bus += 8;
+		dst += 8;
+	}
+
+	mixBusResolveScalar(dst, bus, len);
+}
+
+#elif defined(MIXER_BUS_NEON)
+
+// Truncating division of 32 bit products by kMaxMixerVolume (256)
+static inline int32x4_t scaleProducts(int32x4_t p) {
+	const int32x4_t bias = vandq_s32(vshrq_n_s32(p, 31), vdupq_n_s32(Mixer::kMaxMixerVolume - 1));
+	return vshrq_n_s32(vaddq_s32(p, bias), 8);
+}
+
+void mixBusAccumulate(int32 *bus, const st_sample_t *src, uint len, st_volume_t volL, st_volume_t volR) {
+	const int16 volumes[4] = { (int16)volL, (int16)volR, (int16)volL, (int16)volR };
+	const int16x4_t vol = vld1_s16(volumes);
+
+	for (; len >= 4; len -= 4) {
+		const int16x8_t s = vld1q_s16(src);
+
+		vst1q_s32(bus, vaddq_s32(vld1q_s32(bus), scaleProducts(vmull_s16(vget_low_s16(s), vol))));
+		vst1q_s32(bus + 4, vaddq_s32(vld1q_s32(bus + 4), scaleProducts(vmull_s16(vget_high_s16(s), vol))));
+
+		bus += 8;
+		src += 8;
+	}
+
+	mixBusAccumulateScalar(bus, src, len, volL, volR);
+}
+
+void mixBusResolve(st_sample_t *dst, const int32 *bus, uint len) {
+	for (; len >= 4; len -= 4) {
+		vst1q_s16(dst, vcombine_s16(vqmovn_s32(vld1q_s32(bus)), vqmovn_s32(vld1q_s32(bus + 4))));
+
+		bus += 8;
+		dst += 8;
+	}
+
+	mixBusResolveScalar(dst, bus, len);
+}
+
+#else
+
+void mixBusAccumulate(int32 *bus, const st_sample_t *src, uint len, st_volume_t volL, st_volume_t volR) {
+	mixBusAccumulateScalar(bus, src, len, volL, volR);
+}
+
+void mixBusResolve(st_sample_t *dst, const int32 *bus, uint len) {
+	mixBusResolveScalar(dst, bus, len);
+}
+
+#endif
+
+} // End of namespace Audio
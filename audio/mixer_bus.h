@@ -0,0 +1,63 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef AUDIO_MIXER_BUS_H
+#define AUDIO_MIXER_BUS_H
+
+#include "common/scummsys.h"
+#include "audio/rate.h"
+
+namespace Audio {
+
+/**
+ * @name Mixing bus kernels
+ *
+ * The mixer accumulates all channels into a 32 bit bus and only clamps the
+ * result back to 16 bit once, instead of clamping after each channel.
+ *
+ * All lengths are given in sample *pairs*. SSE2 and NEON versions are used
+ * where available; they produce bit-identical output to the scalar versions.
+ * @{
+ */
+
+/**
+ * Scale the stereo samples in src by the given channel volumes (0 -
+ * Mixer::kMaxMixerVolume) and add them to bus.
+ */
+void mixBusAccumulate(int32 *bus, const st_sample_t *src, uint len, st_volume_t volL, st_volume_t volR);
+
+/**
+ * Clamp the bus to 16 bit and store it in dst.
+ */
+void mixBusResolve(st_sample_t *dst, const int32 *bus, uint len);
+
+/**
+ * Plain C versions of the above, always available for reference.
+ */
+void mixBusAccumulateScalar(int32 *bus, const st_sample_t *src, uint len, st_volume_t volL, st_volume_t volR);
+void mixBusResolveScalar(st_sample_t *dst, const int32 *bus, uint len);
+
+/** @} */
+
+} // End of namespace Audio
+
+#endif
@@ -24,8 +24,10 @@
 #define AUDIO_MIXER_INTERN_H
 
 #include "common/scummsys.h"
+#include "common/array.h"
 #include "common/mutex.h"
 #include "audio/mixer.h"
+#include "audio/mixer_queue.h"
 
 namespace Audio {
 
@@ -54,12 +56,68 @@ private:
 		NUM_CHANNELS = 16
 	};
 
+	enum {
+		COMMAND_QUEUE_SIZE = 64
+	};
+
+	/**
+	 * A channel change requested by an engine thread, which is applied
+	 * by the audio thread before it mixes the next buffer.
+	 */
+	struct Command {
+		enum Type {
+			kPlay,
+			kSetVolume,
+			kSetBalance,
+			kSoundTypeChanged
+		};
+
+		Type type;
+		uint32 handle;    ///< target channel, unused for kSoundTypeChanged
+		int value;        ///< volume, balance or sound type
+		Channel *channel; ///< the new channel for kPlay
+	};
+
+	/**
+	 * What the engine side knows about a channel slot. This is published
+	 * without taking _mutex, so that queries never wait for the mixer.
+	 */
+	struct ChannelStatus {
+		volatile uint32 handle;
+		volatile int id;
+		volatile SoundType type;
+		volatile bool permanent;
+		volatile byte volume;
+		volatile int8 balance;
+	};
+
+	/**
+	 * Held by the audio thread while mixing, and by any thread that needs
+	 * _channels to stay put (stopping, pausing, ...). Whoever holds it is
+	 * the only consumer of _commands.
+	 */
 	Common::Mutex _mutex;
 
+	/**
+	 * Serialises the engine threads, making them the only producer of
+	 * _commands. Never held together with _mutex.
+	 */
+	Common::Mutex _controlMutex;
+
 	const uint _sampleRate;
 	bool _mixerReady;
 	uint32 _handleSeed;
 
+	MixerQueue<Command, COMMAND_QUEUE_SIZE> _commands;
+	ChannelStatus _status[NUM_CHANNELS];
+
+	/**
+	 * Handle of the channel that was last removed from each slot,
+	 * written while holding _mutex. A slot is in use as long as its
+	 * status handle has not been retired.
+	 */
+	volatile uint32 _retired[NUM_CHANNELS];
+
 	struct SoundTypeSettings {
 		SoundTypeSettings() : mute(false), volume(kMaxMixerVolume) {}
 
@@ -70,6 +128,8 @@ private:
 	SoundTypeSettings _soundTypeSettings[4];
 	Channel *_channels[NUM_CHANNELS];
 
+	Common::Array<int32> _mixBus;
+	Common::Array<int16> _mixScratch;
 
 public:
 
@@ -118,8 +178,14 @@ public:
 
 	virtual uint getOutputRate() const;
 
-protected:
-	void insertChannel(SoundHandle *handle, Channel *chan);
+private:
+	int findActiveSlot(SoundHandle handle) const;
+	bool isSlotActive(int index) const;
+	bool queueCommand(const Command &cmd);
+	void processCommands();
+	void flushCommands();
+	Channel *findChannel(uint32 handle);
+	void retireChannel(int index);
 
 public:
 	/**
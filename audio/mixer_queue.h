@@ -0,0 +1,117 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef AUDIO_MIXER_QUEUE_H
+#define AUDIO_MIXER_QUEUE_H
+
+#include "common/scummsys.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Audio {
+
+/**
+ * Full memory barrier, used to publish data between the engine threads
+ * and the audio thread without taking a lock.
+ */
+static inline void mixerMemoryBarrier() {
+#if defined(__GNUC__)
+	__sync_synchronize();
+#elif defined(_MSC_VER)
+	// These are what MemoryBarrier() expands to, without pulling in windows.h
+#if defined(_M_ARM64)
+	__dmb(_ARM64_BARRIER_ISH);
+#elif defined(_M_ARM)
+	__dmb(_ARM_BARRIER_ISH);
+#else
+	_mm_mfence();
+#endif
+#endif
+}
+
+/**
+ * Fixed size single-producer/single-consumer ring buffer.
+ *
+ * push() may only be called by one thread at a time, and pop() may only
+ * be called by one (possibly different) thread at a time. Neither of them
+ * ever blocks, so the audio thread can drain commands queued by an engine
+ * thread without waiting on it.
+ *
+ * SIZE must be a power of two. The queue holds at most SIZE items.
+ */
+template<class T, uint SIZE>
+class MixerQueue {
+public:
+	MixerQueue() : _items(), _head(0), _tail(0) {
+		STATIC_ASSERT((SIZE & (SIZE - 1)) == 0, SIZE_must_be_a_power_of_two);
+	}
+
+	/**
+	 * Append an item to the queue.
+	 *
+	 * @return false if the queue is full
+	 */
+	bool push(const T &item) {
+		const uint32 head = _head;
+		if (head - _tail == SIZE)
+			return false;
+
+		_items[head & (SIZE - 1)] = item;
+		// The item has to be visible before the consumer sees the new head
+		mixerMemoryBarrier();
+		_head = head + 1;
+		return true;
+	}
+
+	/**
+	 * Remove the oldest item from the queue.
+	 *
+	 * @return false if the queue is empty
+	 */
+	bool pop(T &item) {
+		const uint32 tail = _tail;
+		if (tail == _head)
+			return false;
+
+		// Don't read the item before having seen the head that published it
+		mixerMemoryBarrier();
+		item = _items[tail & (SIZE - 1)];
+		// Don't let the producer overwrite the slot before we are done with it
+		mixerMemoryBarrier();
+		_tail = tail + 1;
+		return true;
+	}
+
+	bool empty() const { return _head == _tail; }
+
+private:
+	T _items[SIZE];
+
+	volatile uint32 _head; ///< Only written by the producer
+	volatile uint32 _tail; ///< Only written by the consumer
+};
+
+} // End of namespace Audio
+
+#endif
@@ -13,9 +13,11 @@ MODULE_OBJS := \
 	miles_adlib.o \
 	miles_mt32.o \
 	mixer.o \
+	mixer_bus.o \
 	mpu401.o \
 	musicplugin.o \
 	null.o \
+	rate_polyphase.o \
 	timestamp.o \
 	decoders/3do.o \
 	decoders/aac.o \
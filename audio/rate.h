@@ -78,8 +78,30 @@ public:
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) = 0;
 };
 
+/**
+ * Create a rate converter for the given rates. The "audio_resampler" config
+ * setting picks the quality: "linear" (the default) uses linear interpolation,
+ * "sinc" uses makePolyphaseRateConverter where possible.
+ */
 RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false);
 
+/**
+ * Create a windowed-sinc rate converter. It is considerably more expensive
+ * than linear interpolation, but doesn't alias low rate samples.
+ *
+ * @return the converter, or 0 if the two rates are equal or their ratio
+ *         can't be expressed with a reasonable number of filter phases
+ */
+RateConverter *makePolyphaseRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false);
+
+/**
+ * Set up the lock guarding the coefficient tables the windowed-sinc
+ * converters share. This has to be called once OSystem exists and before
+ * converters are created on more than one thread. The mixer does this when
+ * it is constructed.
+ */
+void initPolyphaseRateConverters();
+
 } // End of namespace Audio
 
 #endif
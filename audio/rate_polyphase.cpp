@@ -0,0 +1,421 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "audio/audiostream.h"
+#include "audio/rate.h"
+#include "audio/mixer.h"
+#include "common/algorithm.h"
+#include "common/array.h"
+#include "common/mutex.h"
+#include "common/system.h"
+#include "common/util.h"
+
+#include <math.h>
+
+namespace Audio {
+
+/**
+ * The size of the intermediate input cache, see rate.cpp.
+ */
+#define INTERMEDIATE_BUFFER_SIZE 512
+
+enum {
+	/** Filter taps per phase when upsampling */
+	POLYPHASE_TAPS = 32,
+	/** Upper limit of the filter length, reached when downsampling */
+	POLYPHASE_MAX_TAPS = 128,
+	/** Upper limit of the number of phases (the reduced output rate) */
+	POLYPHASE_MAX_PHASES = 1024,
+	/** Fractional bits of the filter coefficients */
+	POLYPHASE_COEF_BITS = 14
+};
+
+/** Kaiser window shape, giving about 75dB stopband attenuation */
+static const double kPolyphaseKaiserBeta = 7.5;
+
+/** Passband edge relative to the lower of the two Nyquist frequencies */
+static const double kPolyphaseCutoff = 0.9;
+
+/** Zeroth order modified Bessel function of the first kind */
+static double besselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	const double q = x * x / 4.0;
+	for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+		term *= q / ((double)k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+/**
+ * The filter coefficients for one up/down ratio and filter length, one
+ * row of taps coefficients per phase. They only depend on the ratio, so
+ * all converters for it share the same table.
+ */
+struct PolyphaseCoefTable {
+	uint upFactor;
+	uint downFactor;
+	uint taps;
+	/** Number of converters using the table */
+	uint refCount;
+	Common::Array<int16> coefs;
+};
+
+/** The tables which are currently used by at least one converter */
+static Common::Array<PolyphaseCoefTable *> s_polyphaseTables;
+
+/**
+ * The mutex guarding s_polyphaseTables. Converters are created on the
+ * engine threads and destroyed on the audio thread.
+ *
+ * It is created by initPolyphaseRateConverters(), since there is no
+ * OSystem yet when static objects are constructed, and it is never
+ * deleted, since converters may still be destroyed while shutting down.
+ * Without it, as in the unit tests, there is no locking.
+ */
+static Common::Mutex *s_polyphaseTableMutex = 0;
+
+void initPolyphaseRateConverters() {
+	if (!s_polyphaseTableMutex && g_system)
+		s_polyphaseTableMutex = new Common::Mutex();
+}
+
+static PolyphaseCoefTable *findPolyphaseCoefTable(uint up, uint down, uint taps) {
+	for (uint i = 0; i < s_polyphaseTables.size(); ++i) {
+		PolyphaseCoefTable *table = s_polyphaseTables[i];
+		if (table->upFactor == up && table->downFactor == down && table->taps == taps)
+			return table;
+	}
+	return 0;
+}
+
+static void computePolyphaseCoefs(PolyphaseCoefTable &table) {
+	const uint up = table.upFactor;
+	const uint taps = table.taps;
+
+	// When downsampling, the cutoff has to move down to the output Nyquist
+	// frequency (and the filter gets longer to keep the same steepness).
+	const double cutoff = kPolyphaseCutoff * MIN<double>(1.0, (double)up / table.downFactor);
+	const double windowScale = 1.0 / besselI0(kPolyphaseKaiserBeta);
+	const double one = (double)(1 << POLYPHASE_COEF_BITS);
+
+	table.coefs.resize(up * taps);
+
+	Common::Array<double> row(taps);
+	for (uint p = 0; p < up; ++p) {
+		double sum = 0.0;
+		for (uint j = 0; j < taps; ++j) {
+			// Distance between history entry j (0 being the oldest) and
+			// the output position, which is taps/2 samples in the past.
+			const double t = taps / 2.0 - 1 - j + (double)p / up;
+			const double x = 2.0 * t / taps;
+
+			double window = 0.0;
+			if (x > -1.0 && x < 1.0)
+				window = besselI0(kPolyphaseKaiserBeta * sqrt(1.0 - x * x)) * windowScale;
+
+			const double arg = M_PI * cutoff * t;
+			const double sinc = (t == 0.0) ? 1.0 : sin(arg) / arg;
+
+			row[j] = cutoff * sinc * window;
+			sum += row[j];
+		}
+
+		// Normalise every phase to unity gain, so that there is no ripple
+		// at DC, and put the rounding error into the largest tap.
+		int total = 0;
+		uint peak = 0;
+		int16 *out = &table.coefs[p * taps];
+		for (uint j = 0; j < taps; ++j) {
+			out[j] = (int16)floor(row[j] / sum * one + 0.5);
+			total += out[j];
+			if (ABS(out[j]) > ABS(out[peak]))
+				peak = j;
+		}
+		out[peak] += (int16)((1 << POLYPHASE_COEF_BITS) - total);
+	}
+}
+
+/**
+ * Returns the coefficient table for the given ratio and filter length,
+ * computing it if no converter uses it yet.
+ */
+static const PolyphaseCoefTable *acquirePolyphaseCoefTable(uint up, uint down, uint taps) {
+	Common::Mutex *mutex = s_polyphaseTableMutex;
+
+	if (mutex)
+		mutex->lock();
+	PolyphaseCoefTable *table = findPolyphaseCoefTable(up, down, taps);
+	if (table)
+		++table->refCount;
+	if (mutex)
+		mutex->unlock();
+
+	if (table)
+		return table;
+
+	// Compute the table without holding the lock, so that the audio thread
+	// is not blocked while releasing another table meanwhile
+	PolyphaseCoefTable *newTable = new PolyphaseCoefTable();
+	newTable->upFactor = up;
+	newTable->downFactor = down;
+	newTable->taps = taps;
+	newTable->refCount = 1;
+	computePolyphaseCoefs(*newTable);
+
+	if (mutex)
+		mutex->lock();
+	// Another thread may have added the same table in the meantime
+	table = findPolyphaseCoefTable(up, down, taps);
+	if (table) {
+		++table->refCount;
+	} else {
+		s_polyphaseTables.push_back(newTable);
+		table = newTable;
+		newTable = 0;
+	}
+	if (mutex)
+		mutex->unlock();
+
+	delete newTable;
+	return table;
+}
+
+static void releasePolyphaseCoefTable(const PolyphaseCoefTable *table) {
+	Common::Mutex *mutex = s_polyphaseTableMutex;
+
+	if (mutex)
+		mutex->lock();
+	PolyphaseCoefTable *unused = 0;
+	for (uint i = 0; i < s_polyphaseTables.size(); ++i) {
+		if (s_polyphaseTables[i] == table) {
+			if (--s_polyphaseTables[i]->refCount == 0) {
+				unused = s_polyphaseTables[i];
+				s_polyphaseTables.remove_at(i);
+			}
+			break;
+		}
+	}
+	if (mutex)
+		mutex->unlock();
+
+	delete unused;
+}
+
+/**
+ * Audio rate converter using a windowed-sinc filter, split into one set
+ * of coefficients per output phase. Since the rates are reduced to
+ * outrate/inrate = L/M, every output sample lands exactly on one of L
+ * phases between two input samples, so no interpolation between
+ * coefficients is needed.
+ */
+template<bool stereo, bool reverseStereo>
+class PolyphaseRateConverter : public RateConverter {
+protected:
+	st_sample_t inBuf[INTERMEDIATE_BUFFER_SIZE];
+	const st_sample_t *inPtr;
+	int inLen;
+
+	/** Number of phases, i.e. the reduced output rate */
+	uint upFactor;
+	/** Phase increment per output sample, i.e. the reduced input rate */
+	uint downFactor;
+	/** Current phase, input samples are consumed whenever it exceeds upFactor */
+	uint phase;
+
+	/** Filter length */
+	uint taps;
+	/** The shared coefficient table for this ratio */
+	const PolyphaseCoefTable *coefTable;
+	/** upFactor * taps coefficients, one row per phase */
+	const int16 *coefs;
+
+	/**
+	 * Last input samples of both channels, stored twice so that the
+	 * newest taps samples are always contiguous at histPos.
+	 */
+	st_sample_t history0[2 * POLYPHASE_MAX_TAPS];
+	st_sample_t history1[2 * POLYPHASE_MAX_TAPS];
+	uint histPos;
+
+	/**
+	 * Silent input samples still to be pushed through the filter after the
+	 * end of the stream. The output lags taps/2 samples behind the input,
+	 * so the last samples only come out after that many more.
+	 */
+	uint tailLeft;
+
+	void pushSample(st_sample_t sample0, st_sample_t sample1);
+	int convert(AudioStream *input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+
+public:
+	PolyphaseRateConverter(uint up, uint down, uint filterTaps);
+	~PolyphaseRateConverter();
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+		return convert(&input, obuf, osamp, vol_l, vol_r);
+	}
+	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
+		return convert(0, obuf, osamp, vol, vol);
+	}
+};
+
+template<bool stereo, bool reverseStereo>
+PolyphaseRateConverter<stereo, reverseStereo>::PolyphaseRateConverter(uint up, uint down, uint filterTaps)
+	: inPtr(0), inLen(0), upFactor(up), downFactor(down), phase(0), taps(filterTaps), histPos(0), tailLeft(filterTaps / 2) {
+
+	memset(history0, 0, sizeof(history0));
+	memset(history1, 0, sizeof(history1));
+
+	coefTable = acquirePolyphaseCoefTable(up, down, taps);
+	coefs = &coefTable->coefs[0];
+}
+
+template<bool stereo, bool reverseStereo>
+PolyphaseRateConverter<stereo, reverseStereo>::~PolyphaseRateConverter() {
+	releasePolyphaseCoefTable(coefTable);
+}
+
+template<bool stereo, bool reverseStereo>
+void PolyphaseRateConverter<stereo, reverseStereo>::pushSample(st_sample_t sample0, st_sample_t sample1) {
+	// Replace the oldest sample, and its copy
+	history0[histPos] = history0[histPos + taps] = sample0;
+	if (stereo)
+		history1[histPos] = history1[histPos + taps] = sample1;
+
+	if (++histPos == taps)
+		histPos = 0;
+}
+
+/*
+ * Processed signed long samples from ibuf to obuf, or the tail of the
+ * filter when there is no input stream any more.
+ * Return number of sample pairs processed.
+ */
+template<bool stereo, bool reverseStereo>
+int PolyphaseRateConverter<stereo, reverseStereo>::convert(AudioStream *input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	st_sample_t *ostart, *oend;
+
+	ostart = obuf;
+	oend = obuf + osamp * 2;
+
+	while (obuf < oend) {
+
+		// read enough input samples so that the phase lies between the
+		// two newest samples
+		while (phase >= upFactor) {
+			if (!input) {
+				if (tailLeft == 0)
+					return (obuf - ostart) / 2;
+				--tailLeft;
+				pushSample(0, 0);
+				phase -= upFactor;
+				continue;
+			}
+
+			// Check if we have to refill the buffer
+			if (inLen == 0) {
+				inPtr = inBuf;
+				inLen = input->readBuffer(inBuf, ARRAYSIZE(inBuf));
+				if (inLen <= 0)
+					return (obuf - ostart) / 2;
+			}
+			inLen -= (stereo ? 2 : 1);
+			const st_sample_t in0 = *inPtr++;
+			pushSample(in0, stereo ? *inPtr++ : in0);
+			phase -= upFactor;
+		}
+
+		// Loop as long as the phase stays within the current input
+		// samples, and as long as there is still space in the output buffer.
+		const st_sample_t *h0 = history0 + histPos;
+		const st_sample_t *h1 = history1 + histPos;
+
+		while (phase < upFactor && obuf < oend) {
+			const int16 *c = coefs + phase * taps;
+
+			// Plain multiply-accumulate loops, which compilers turn into
+			// SIMD code on their own
+			int32 acc0 = 1 << (POLYPHASE_COEF_BITS - 1);
+			int32 acc1 = acc0;
+			if (stereo) {
+				for (uint j = 0; j < taps; ++j) {
+					acc0 += h0[j] * c[j];
+					acc1 += h1[j] * c[j];
+				}
+			} else {
+				for (uint j = 0; j < taps; ++j)
+					acc0 += h0[j] * c[j];
+			}
+
+			st_sample_t out0, out1;
+			out0 = (st_sample_t)CLIP<int32>(acc0 >> POLYPHASE_COEF_BITS, ST_SAMPLE_MIN, ST_SAMPLE_MAX);
+			out1 = (stereo ?
+				(st_sample_t)CLIP<int32>(acc1 >> POLYPHASE_COEF_BITS, ST_SAMPLE_MIN, ST_SAMPLE_MAX) :
+				out0);
+
+			// output left channel
+			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+
+			// output right channel
+			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+
+			obuf += 2;
+
+			phase += downFactor;
+		}
+	}
+	return (obuf - ostart) / 2;
+}
+
+template<bool stereo, bool reverseStereo>
+RateConverter *makePolyphaseRateConverter(uint up, uint down, uint taps) {
+	return new PolyphaseRateConverter<stereo, reverseStereo>(up, down, taps);
+}
+
+RateConverter *makePolyphaseRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo) {
+	if (inrate == 0 || outrate == 0 || inrate == outrate)
+		return 0;
+
+	const st_rate_t divisor = Common::gcd(inrate, outrate);
+	const uint up = outrate / divisor;
+	const uint down = inrate / divisor;
+	if (up > POLYPHASE_MAX_PHASES)
+		return 0;
+
+	// Keep the filter as steep (relative to the output rate) when
+	// downsampling, rounded up to a multiple of 4 to help vectorisation
+	uint taps = POLYPHASE_TAPS;
+	if (down > up)
+		taps = ((POLYPHASE_TAPS * down / up) + 3) & ~3;
+	if (taps > POLYPHASE_MAX_TAPS)
+		return 0;
+
+	if (stereo) {
+		if (reverseStereo)
+			return makePolyphaseRateConverter<true, true>(up, down, taps);
+		else
+			return makePolyphaseRateConverter<true, false>(up, down, taps);
+	} else
+		return makePolyphaseRateConverter<false, false>(up, down, taps);
+}
+
+} // End of namespace Audio
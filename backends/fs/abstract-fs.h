@@ -173,6 +173,15 @@ public:
 	 */
 	virtual bool isWritable() const = 0;
 
+	/**
+	 * Returns the time the object referred by this path was last modified,
+	 * in seconds since an arbitrary, backend specific epoch.
+	 *
+	 * Backends which cannot tell return 0, which is also the default.
+	 *
+	 * @return the modification time, or 0 if it is unknown
+	 */
+	virtual uint32 getModificationTime() const { return 0; }
 
 	/**
 	 * Creates a SeekableReadStream instance corresponding to the file
@@ -55,11 +55,115 @@ static bool analog_response_is_quadratic = false;
 static float mouse_speed = 1.0f;
 static float gamepad_acceleration_time = 0.2f;
 
-static bool speed_hack_is_enabled = false;
+static bool video_32bit_is_enabled = false;
+static bool can_dupe = false;
 
 char cmd_params[20][200];
 char cmd_params_num;
 
+/* Audio pacing
+ *
+ * The mixer is pulled in fixed size chunks into a ring buffer, and every
+ * frame the frontend is handed as many samples as the frame time it reports
+ * covers. When the frontend reports its buffer occupancy, that amount is
+ * nudged up or down slightly to keep the buffer half full.
+ */
+#define AUDIO_FPS 60.0
+#define AUDIO_MIX_CHUNK 512
+#define AUDIO_RING_SIZE 8192
+#define AUDIO_MAX_FRAME_TIME (4.0 / AUDIO_FPS)
+#define AUDIO_RATE_CONTROL_DELTA 0.005
+#define AUDIO_STATS_INTERVAL 600
+
+static uint32 audio_ring[AUDIO_RING_SIZE];
+static unsigned audio_ring_read = 0;
+static unsigned audio_ring_write = 0;
+static double audio_sample_carry = 0.0;
+static retro_usec_t audio_frame_usec = 0;
+
+static bool audio_status_active = false;
+static unsigned audio_status_occupancy = 50;
+static unsigned audio_underruns = 0;
+static unsigned audio_stats_frames = 0;
+
+static void audio_frame_time_cb(retro_usec_t usec)
+{
+   audio_frame_usec = usec;
+}
+
+static void audio_buffer_status_cb(bool active, unsigned occupancy, bool underrun_likely)
+{
+   audio_status_active = active;
+   audio_status_occupancy = occupancy;
+   if (active && underrun_likely)
+      audio_underruns++;
+}
+
+static void audio_reset(void)
+{
+   audio_ring_read = 0;
+   audio_ring_write = 0;
+   audio_sample_carry = 0.0;
+   audio_frame_usec = 0;
+   audio_status_active = false;
+   audio_status_occupancy = 50;
+   audio_underruns = 0;
+   audio_stats_frames = 0;
+}
+
+static unsigned audio_ring_fill(void)
+{
+   return audio_ring_write - audio_ring_read;
+}
+
+/* Mix until at least 'frames' stereo samples are queued. The ring size is a
+ * multiple of the chunk size, so a chunk never wraps around. */
+static void audio_mix(Audio::MixerImpl *mixer, unsigned frames)
+{
+   while (audio_ring_fill() < frames)
+   {
+      const unsigned pos = audio_ring_write & (AUDIO_RING_SIZE - 1);
+
+      /* The mixer zeroes the whole chunk, so silence is queued as well */
+      mixer->mixCallback((byte*)&audio_ring[pos], AUDIO_MIX_CHUNK * 4);
+      audio_ring_write += AUDIO_MIX_CHUNK;
+   }
+}
+
+static void audio_upload(Audio::MixerImpl *mixer)
+{
+   double frame_time = (audio_frame_usec > 0) ? audio_frame_usec / 1000000.0 : 1.0 / AUDIO_FPS;
+   if (frame_time > AUDIO_MAX_FRAME_TIME)
+      frame_time = AUDIO_MAX_FRAME_TIME;
+
+   double wanted = frame_time * RETRO_AUDIO_SAMPLE_RATE;
+   if (audio_status_active)
+      wanted *= 1.0 + AUDIO_RATE_CONTROL_DELTA * (1.0 - audio_status_occupancy / 50.0);
+   wanted += audio_sample_carry;
+
+   unsigned frames = (unsigned)wanted;
+   audio_sample_carry = wanted - frames;
+
+   audio_mix(mixer, frames);
+
+   while (frames)
+   {
+      const unsigned pos = audio_ring_read & (AUDIO_RING_SIZE - 1);
+      const unsigned count = MIN(frames, AUDIO_RING_SIZE - pos);
+
+      audio_batch_cb((int16_t*)&audio_ring[pos], count);
+      audio_ring_read += count;
+      frames -= count;
+   }
+
+   if (log_cb && ++audio_stats_frames >= AUDIO_STATS_INTERVAL)
+   {
+      log_cb(RETRO_LOG_DEBUG, "[scummvm] Audio: ring %u/%u, frontend buffer %u%%, underruns %u\n",
+             audio_ring_fill(), AUDIO_RING_SIZE, audio_status_active ? audio_status_occupancy : 0, audio_underruns);
+      audio_stats_frames = 0;
+   }
+}
+
 void retro_set_environment(retro_environment_t cb)
 {
    environ_cb = cb;
@@ -83,7 +187,7 @@ void retro_leave_thread(void)
 
 static void retro_wrap_emulator(void)
 {
-   g_system = retroBuildOS(speed_hack_is_enabled);
+   g_system = retroBuildOS();
 
    static const char* argv[20];
    for(int i=0; i<cmd_params_num; i++)
@@ -129,8 +233,8 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
    info->geometry.max_width   = RES_W;
    info->geometry.max_height  = RES_H;
    info->geometry.aspect_ratio = 4.0f / 3.0f;
-   info->timing.fps = 60.0;
-   info->timing.sample_rate = 44100.0;
+   info->timing.fps = AUDIO_FPS;
+   info->timing.sample_rate = RETRO_AUDIO_SAMPLE_RATE;
 }
 
 void retro_init (void)
@@ -259,14 +363,14 @@ static void update_variables(void)
       mouse_speed = (float)atof(var.value);
    }
 
-	var.key = "scummvm_speed_hack";
-	var.value = NULL;
-	speed_hack_is_enabled = false;
-	if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
-	{
-		if (strcmp(var.value, "enabled") == 0)
-			speed_hack_is_enabled = true;
-	}
+   var.key = "scummvm_video_32bit";
+   var.value = NULL;
+   video_32bit_is_enabled = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0)
+         video_32bit_is_enabled = true;
+   }
 }
 
 static int retro_device = RETRO_DEVICE_JOYPAD;
@@ -377,11 +481,36 @@ bool retro_load_game(const struct retro_game_info *game)
    }
 #endif
 
+   /* Hi-color games matching this format are presented without conversion */
+   enum retro_pixel_format pixel_format = RETRO_PIXEL_FORMAT_0RGB1555;
+   enum retro_pixel_format xrgb8888 = RETRO_PIXEL_FORMAT_XRGB8888;
+   if (video_32bit_is_enabled && environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &xrgb8888))
+      pixel_format = xrgb8888;
 #ifdef FRONTEND_SUPPORTS_RGB565
-   enum retro_pixel_format rgb565 = RETRO_PIXEL_FORMAT_RGB565;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &rgb565) && log_cb)
-      log_cb(RETRO_LOG_INFO, "Frontend supports RGB565 -will use that instead of XRGB1555.\n");
+   else
+   {
+      enum retro_pixel_format rgb565 = RETRO_PIXEL_FORMAT_RGB565;
+      if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &rgb565))
+         pixel_format = rgb565;
+      else if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Frontend does not support RGB565 - will use XRGB1555 instead.\n");
+   }
 #endif
+   retroSetScreenFormat(pixel_format);
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      can_dupe = false;
+
+   audio_reset();
+
+   struct retro_frame_time_callback frame_time_cb;
+   frame_time_cb.callback = audio_frame_time_cb;
+   frame_time_cb.reference = (retro_usec_t)(1000000.0 / AUDIO_FPS);
+   environ_cb(RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK, &frame_time_cb);
+
+   struct retro_audio_buffer_status_callback buffer_status_cb;
+   buffer_status_cb.callback = audio_buffer_status_cb;
+   environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &buffer_status_cb);
 
    retro_keyboard_callback cb = {retroKeyEvent};
    environ_cb(RETRO_ENVIRONMENT_SET_KEYBOARD_CALLBACK, &cb);
@@ -411,7 +540,7 @@ bool retro_load_game(const struct retro_game_info *game)
       emuThread = co_create(65536*sizeof(void*), retro_wrap_emulator);
    }
 #else
-   g_system = retroBuildOS(speed_hack_is_enabled);
+   g_system = retroBuildOS();
    if (!g_system)
    {
       if (log_cb)
@@ -431,6 +560,25 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info *i
    return false;
 }
 
+static bool emu_is_running(void)
+{
+#if defined(USE_LIBCO)
+   return emuThread && !EMULATORexited;
+#else
+   return retro_is_emu_thread_initialized() && !retro_emu_thread_exited();
+#endif
+}
+
+/* Lets the emulator thread run until it yields back */
+static void run_emu_slice(void)
+{
+#if defined(USE_LIBCO)
+   co_switch(emuThread);
+#else
+   retro_switch_thread();
+#endif
+}
+
 void retro_run (void)
 {
 #if defined(USE_LIBCO)
@@ -459,37 +607,21 @@ void retro_run (void)
    }
 
    /* Run emu */
-#if defined(USE_LIBCO)
-   co_switch(emuThread);
-#else
-   retro_switch_thread();
-#endif
+   run_emu_slice();
 
    if(g_system)
    {
-      /* Upload video: TODO: Check the CANDUPE env value */
+      /* Upload video, letting the frontend repeat unchanged frames */
       const Graphics::Surface& screen = getScreen();
-      video_cb(screen.pixels, screen.w, screen.h, screen.pitch);
+      if (!retroScreenUpdated() && can_dupe)
+         video_cb(NULL, screen.w, screen.h, screen.pitch);
+      else
+         video_cb(screen.pixels, screen.w, screen.h, screen.pitch);
 
       /* Upload audio */
-      const int SAMPLES_PER_FRAME = 44100u / 50u; // HACK: This locks the framerate to a max of 50, but stops crackling audio in most games
-
-      static uint32 buf[SAMPLES_PER_FRAME];
-      int count = ((Audio::MixerImpl*)g_system->getMixer())->mixCallback((byte*)buf, SAMPLES_PER_FRAME*4);
-#if defined(_3DS)
-      /* Hack: 3DS will produce static noise
-       * unless we manually send a zeroed
-       * audio buffer when no samples are
-       * available (i.e. when the overlay
-       * is shown) */
-      if (count == 0)
-      {
-         memset(buf, 0, 735 * sizeof(uint32));
-         audio_batch_cb((int16_t*)buf, 735);
-      }
-      else
-#endif
-         audio_batch_cb((int16_t*)buf, count);
+      Audio::MixerImpl *mixer = (Audio::MixerImpl*)g_system->getMixer();
+      if (mixer)
+         audio_upload(mixer);
    }
 
 #if defined(USE_LIBCO)
@@ -534,9 +666,48 @@ void retro_unload_game (void)
 void *retro_get_memory_data(unsigned type) { return 0; }
 size_t retro_get_memory_size(unsigned type) { return 0; }
 void retro_reset (void) { }
-size_t retro_serialize_size (void) { return 0; }
-bool retro_serialize(void *data, size_t size) { return false; }
-bool retro_unserialize(const void * data, size_t size) { return false; }
+
+/* Save states
+ *
+ * The engine saves or loads through its usual code path on the emulator
+ * thread. Most engines do that synchronously, others only at the next
+ * iteration of their main loop, so the emulator thread is given a few
+ * slices to get there.
+ */
+#define STATE_MAX_SLICES 8
+
+static void wait_for_state_request(void)
+{
+   for (unsigned i = 0; i < STATE_MAX_SLICES && emu_is_running() && retroStateRequestPending(); i++)
+      run_emu_slice();
+}
+
+/* The size is a fixed bound, so asking for it does not save anything. */
+size_t retro_serialize_size (void)
+{
+   if (!g_system || !emu_is_running())
+      return 0;
+
+   return retroStateSize();
+}
+
+bool retro_serialize(void *data, size_t size)
+{
+   if (!g_system || !emu_is_running() || !retroRequestSaveState(data, size))
+      return false;
+
+   wait_for_state_request();
+   return retroFinishSaveState(data);
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+   if (!g_system || !emu_is_running() || !retroRequestLoadState(data, size))
+      return false;
+
+   wait_for_state_request();
+   return retroFinishLoadState();
+}
 void retro_cheat_reset(void) { }
 void retro_cheat_set(unsigned unused, bool unused1, const char* unused2) { }
 
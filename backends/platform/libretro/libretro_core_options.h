@@ -144,19 +144,15 @@ struct retro_core_option_definition option_defs_us[] = {
       "1.0"
    },
    {
-      "scummvm_speed_hack",
-      "Speed Hack (Restart)",
-      "Enables a speed hack that significantly reduces CPU requirements by allowing subtle timing inaccuracies. This hack is considered 'safe' - it should cause no errors, and most timing deviations are imperceptible. It remains a hack, though, and users of desktop-class machines are advised to keep it disabled. On low power hardware (weak Android devices, single board computers), this hack is essential for full speed operation of the core.",
+      "scummvm_video_32bit",
+      "32-bit Video Output (Restart)",
+      "Outputs video in XRGB8888 format instead of RGB565. Hi-color games (e.g. Wintermute, Broken Sword 2.5, Blade Runner) can then be displayed without any colour conversion. Most other games look identical in either mode, and 16-bit output is faster on low power hardware.",
       {
          { "disabled", NULL },
          { "enabled",  NULL },
          { NULL, NULL },
       },
-#if defined(ANDROID) || defined(DINGUX) || defined(_3DS)
-      "enabled"
-#else
       "disabled"
-#endif
    },
    { NULL, NULL, NULL, {{0}}, NULL },
 };
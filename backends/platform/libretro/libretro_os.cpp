@@ -32,6 +32,12 @@
 #include "graphics/surface.libretro.h"
 #include "backends/base-backend.h"
 #include "common/events.h"
+#include "common/array.h"
+#include "common/rect.h"
+#include "common/config-manager.h"
+#include "common/memstream.h"
+#include "common/util.h"
+#include "engines/engine.h"
 #include "audio/mixer_intern.h"
 
 #if defined(_WIN32)
@@ -45,6 +51,7 @@
 #include "backends/timer/default/default-timer.h"
 #include "graphics/colormasks.h"
 #include "graphics/palette.h"
+#include "graphics/thumbnail.h"
 #include "backends/saves/default/default-saves.h"
 #if defined(_WIN32)
 #include <direct.h>
@@ -63,21 +70,54 @@
 
 #include "libretro.h"
 #include "retro_emu_thread.h"
+#include "os.h"
 
 extern retro_log_printf_t log_cb;
 
+#ifdef FRONTEND_SUPPORTS_RGB565
+static Graphics::PixelFormat s_screenFormat(2, 5, 6, 5, 0, 11, 5, 0, 0);
+#else
+static Graphics::PixelFormat s_screenFormat(2, 5, 5, 5, 1, 10, 5, 0, 15);
+#endif
+
+static INLINE Graphics::PixelFormat retroScreenFormat()
+{
+   return s_screenFormat;
+}
+
+// The frontend ignores the unused bits of XRGB8888 and 0RGB1555, so a game
+// surface with alpha in those bits can still be handed over as it is
+static INLINE bool isScreenCompatible(const Graphics::PixelFormat& aFormat)
+{
+   const Graphics::PixelFormat& screen = s_screenFormat;
+
+   return aFormat.bytesPerPixel == screen.bytesPerPixel &&
+          aFormat.rLoss == screen.rLoss && aFormat.gLoss == screen.gLoss && aFormat.bLoss == screen.bLoss &&
+          aFormat.rShift == screen.rShift && aFormat.gShift == screen.gShift && aFormat.bShift == screen.bShift;
+}
+
 struct RetroPalette
 {
    unsigned char _colors[256 * 3];
+   // Precomputed screen format colors, rebuilt whenever the palette changes
+   uint32 _lut[256];
 
    RetroPalette()
    {
       memset(_colors, 0, sizeof(_colors));
+      memset(_lut, 0, sizeof(_lut));
    }
 
    void set(const byte *colors, uint start, uint num)
    {
       memcpy(_colors + start * 3, colors, num * 3);
+
+      const Graphics::PixelFormat format = retroScreenFormat();
+      for(uint i = start; i < start + num; i ++)
+      {
+         const unsigned char *col = &_colors[i * 3];
+         _lut[i] = format.RGBToColor(col[0], col[1], col[2]);
+      }
    }
 
    void get(byte* colors, uint start, uint num) const
@@ -89,137 +129,94 @@ struct RetroPalette
    {
       return (unsigned char*)&_colors[aIndex * 3];
    }
-};
 
-static INLINE void blit_uint8_uint16_fast(Graphics::Surface& aOut, const Graphics::Surface& aIn, const RetroPalette& aColors)
-{
-   for(int i = 0; i < aIn.h; i ++)
+   const uint32 *getLUT() const
    {
-      if(i >= aOut.h)
-         continue;
-
-      uint8_t * const in  = (uint8_t*)aIn.pixels + (i * aIn.w);
-      uint16_t* const out = (uint16_t*)aOut.pixels + (i * aOut.w);
+      return _lut;
+   }
+};
 
-      for(int j = 0; j < aIn.w; j ++)
-      {
-         if (j >= aOut.w)
-            continue;
+// All of the full screen converters below only touch the area inside aRect,
+// which must already be clipped against both surfaces. OutPixel is uint16 or
+// uint32 depending on the negotiated frontend format.
 
-         uint8 r, g, b;
+template<typename OutPixel>
+static INLINE void blit_uint8_fast(Graphics::Surface& aOut, const Graphics::Surface& aIn, const RetroPalette& aColors, const Common::Rect& aRect)
+{
+   const uint32 *lut = aColors.getLUT();
+   const int w = aRect.width();
 
-         const uint8_t val = in[j];
-         if(val != 0xFFFFFFFF)
-         {
-            if(aIn.format.bytesPerPixel == 1)
-            {
-               unsigned char *col = aColors.getColor(val);
-               r = *col++;
-               g = *col++;
-               b = *col++;
-            }
-            else
-               aIn.format.colorToRGB(in[j], r, g, b);
+   for(int i = aRect.top; i < aRect.bottom; i ++)
+   {
+      const uint8_t *in = (const uint8_t*)aIn.getBasePtr(aRect.left, i);
+      OutPixel *out = (OutPixel*)aOut.getBasePtr(aRect.left, i);
 
-            out[j] = aOut.format.RGBToColor(r, g, b);
-         }
-      }
+      for(int j = 0; j < w; j ++)
+         out[j] = (OutPixel)lut[in[j]];
    }
 }
 
-static INLINE void blit_uint32_uint16(Graphics::Surface& aOut, const Graphics::Surface& aIn, const RetroPalette& aColors)
+template<typename InPixel, typename OutPixel>
+static INLINE void blit_rgb_fast(Graphics::Surface& aOut, const Graphics::Surface& aIn, const Common::Rect& aRect)
 {
-   for(int i = 0; i < aIn.h; i ++)
-   {
-      if(i >= aOut.h)
-         continue;
+   const int w = aRect.width();
 
-      uint32_t* const in = (uint32_t*)aIn.pixels + (i * aIn.w);
-      uint16_t* const out = (uint16_t*)aOut.pixels + (i * aOut.w);
+   for(int i = aRect.top; i < aRect.bottom; i ++)
+   {
+      const InPixel *in = (const InPixel*)aIn.getBasePtr(aRect.left, i);
+      OutPixel *out = (OutPixel*)aOut.getBasePtr(aRect.left, i);
 
-      for(int j = 0; j < aIn.w; j ++)
+      // The overlay and games using the frontend format need no conversion
+      if(aIn.format == aOut.format)
       {
-         if(j >= aOut.w)
-            continue;
-
-         uint8 r, g, b;
-
-         const uint32_t val = in[j];
-         if(val != 0xFFFFFFFF)
-         {
-            aIn.format.colorToRGB(in[j], r, g, b);
-            out[j] = aOut.format.RGBToColor(r, g, b);
-         }
-      }
-   }
-}
-
-static INLINE void blit_uint16_uint16(Graphics::Surface& aOut, const Graphics::Surface& aIn, const RetroPalette& aColors)
-{
-   for(int i = 0; i < aIn.h; i ++)
-   {
-      if(i >= aOut.h)
+         memcpy(out, in, w * sizeof(OutPixel));
          continue;
+      }
 
-      uint16_t* const in = (uint16_t*)aIn.pixels + (i * aIn.w);
-      uint16_t* const out = (uint16_t*)aOut.pixels + (i * aOut.w);
-
-      for(int j = 0; j < aIn.w; j ++)
+      for(int j = 0; j < w; j ++)
       {
-         if(j >= aOut.w)
-            continue;
-
          uint8 r, g, b;
-
-         const uint16_t val = in[j];
-         if(val != 0xFFFFFFFF)
-         {
-            aIn.format.colorToRGB(in[j], r, g, b);
-            out[j] = aOut.format.RGBToColor(r, g, b);
-         }
+         aIn.format.colorToRGB(in[j], r, g, b);
+         out[j] = (OutPixel)aOut.format.RGBToColor(r, g, b);
       }
    }
 }
 
-static void blit_uint8_uint16(Graphics::Surface& aOut, const Graphics::Surface& aIn, int aX, int aY, const RetroPalette& aColors, uint32 aKeyColor)
+template<typename OutPixel>
+static void blit_uint8_cursor(Graphics::Surface& aOut, const Graphics::Surface& aIn, int aX, int aY, const RetroPalette& aColors, uint32 aKeyColor)
 {
+   const uint32 *lut = aColors.getLUT();
+
    for(int i = 0; i < aIn.h; i ++)
    {
       if((i + aY) < 0 || (i + aY) >= aOut.h)
          continue;
 
-      uint8_t* const in = (uint8_t*)aIn.pixels + (i * aIn.w);
-      uint16_t* const out = (uint16_t*)aOut.pixels + ((i + aY) * aOut.w);
+      uint8_t* const in = (uint8_t*)aIn.getBasePtr(0, i);
+      OutPixel* const out = (OutPixel*)aOut.getBasePtr(0, i + aY);
 
       for(int j = 0; j < aIn.w; j ++)
       {
          if((j + aX) < 0 || (j + aX) >= aOut.w)
             continue;
 
-         uint8 r, g, b;
-
          const uint8_t val = in[j];
          if(val != aKeyColor)
-         {
-            unsigned char *col = aColors.getColor(val);
-            r = *col++;
-            g = *col++;
-            b = *col++;
-            out[j + aX] = aOut.format.RGBToColor(r, g, b);
-         }
+            out[j + aX] = (OutPixel)lut[val];
       }
    }
 }
 
-static void blit_uint16_uint16(Graphics::Surface& aOut, const Graphics::Surface& aIn, int aX, int aY, const RetroPalette& aColors, uint32 aKeyColor)
+template<typename OutPixel>
+static void blit_uint16_cursor(Graphics::Surface& aOut, const Graphics::Surface& aIn, int aX, int aY, uint32 aKeyColor)
 {
    for(int i = 0; i < aIn.h; i ++)
    {
       if((i + aY) < 0 || (i + aY) >= aOut.h)
          continue;
 
-      uint16_t* const in = (uint16_t*)aIn.pixels + (i * aIn.w);
-      uint16_t* const out = (uint16_t*)aOut.pixels + ((i + aY) * aOut.w);
+      uint16_t* const in = (uint16_t*)aIn.getBasePtr(0, i);
+      OutPixel* const out = (OutPixel*)aOut.getBasePtr(0, i + aY);
 
       for(int j = 0; j < aIn.w; j ++)
       {
@@ -232,7 +229,7 @@ static void blit_uint16_uint16(Graphics::Surface& aOut, const Graphics::Surface&
          if(val != aKeyColor)
          {
             aIn.format.colorToRGB(in[j], r, g, b);
-            out[j + aX] = aOut.format.RGBToColor(r, g, b);
+            out[j + aX] = (OutPixel)aOut.format.RGBToColor(r, g, b);
          }
       }
    }
@@ -283,8 +280,250 @@ static Common::String s_saveDir;
 #define SURF_ASHIFT 15
 #endif
 
+// Frontend save states reuse the engine's own save and load code, with the
+// save file of one slot redirected into memory. Engines name their save
+// files differently, but nearly all of them build the name from the target
+// and end it with the slot number, which is what is matched here. The slot
+// is beyond the ones engines offer to the user or autosave to, so the files
+// redirected are never real saves. Saves are written straight into the
+// frontend's buffer, and the next load of the slot reads the frontend's
+// state, for a limited time, as some engines pick up a request a few frames
+// later.
+
+#define RETRO_STATE_SLOT 9999
+#define RETRO_STATE_MAGIC MKTAG('S', 'V', 'M', 'S')
+#define RETRO_STATE_VERSION 1
+#define RETRO_STATE_HEADER_SIZE 12
+// The size reported to the frontend, without saving. States of the engines
+// supported are far smaller, as they save no screen thumbnails.
+#define RETRO_STATE_SIZE (4 * 1024 * 1024)
+#define RETRO_STATE_TIMEOUT 3000
+
+class RetroSaveFileManager;
+
+class RetroStateWriteStream : public Common::WriteStream {
+   RetroSaveFileManager *_manager;
+   uint32 _pos;
+   bool _err;
+   bool _finished;
+
+public:
+   RetroStateWriteStream(RetroSaveFileManager *aManager) :
+      _manager(aManager), _pos(0), _err(false), _finished(false) {}
+
+   virtual ~RetroStateWriteStream() { finalize(); }
+
+   virtual uint32 write(const void *dataPtr, uint32 dataSize);
+   virtual int32 pos() const { return _pos; }
+   virtual bool err() const { return _err; }
+   virtual void clearErr() { _err = false; }
+   virtual void finalize();
+};
+
+class RetroSaveFileManager : public DefaultSaveFileManager {
+   public:
+      enum State {
+         kStateIdle,
+         kStateArmed,
+         kStateWriting,
+         kStateDone
+      };
+
+   private:
+      State _saveState;
+      byte *_saveBuffer;
+      uint32 _saveBufferSize;
+      uint32 _saveSize;
+      // The stream writing into the frontend's buffer, others are discarded
+      const RetroStateWriteStream *_saveStream;
+      uint _stateStreams;
+
+      State _loadState;
+      Common::Array<byte> _loadData;
+      uint32 _loadDeadline;
+
+      bool isStateFile(const Common::String &filename) const
+      {
+         const Common::String &target = ConfMan.getActiveDomainName();
+         if(target.empty() || !filename.hasPrefixIgnoreCase(target))
+            return false;
+
+         uint start = filename.size();
+         while(start > target.size() && Common::isDigit(filename[start - 1]))
+            start--;
+
+         return start < filename.size() && atoi(filename.c_str() + start) == RETRO_STATE_SLOT;
+      }
+
+      void expireStates()
+      {
+         if(_loadState == kStateArmed && (int32)(g_system->getMillis() - _loadDeadline) >= 0)
+            _loadState = kStateIdle;
+      }
+
+      // Nobody sees the thumbnails of states, so they are not grabbed from
+      // the screen while a state may be saved
+      void updateThumbnails()
+      {
+         Graphics::setScreenThumbnailsEnabled(_saveState != kStateArmed && _saveState != kStateWriting && !_stateStreams);
+      }
+
+   public:
+      RetroSaveFileManager(const Common::String &aPath) :
+         DefaultSaveFileManager(aPath),
+         _saveState(kStateIdle), _saveBuffer(0), _saveBufferSize(0), _saveSize(0), _saveStream(0), _stateStreams(0),
+         _loadState(kStateIdle), _loadDeadline(0) {}
+
+      // The state is written to aBuffer, which must stay valid until
+      // finishSave is called
+      void armSave(byte *aBuffer, uint32 aSize)
+      {
+         _saveBuffer = aBuffer;
+         _saveBufferSize = aSize;
+         _saveSize = 0;
+         _saveStream = 0;
+         _saveState = kStateArmed;
+         updateThumbnails();
+      }
+
+      // The engine refused to save, nothing is going to be written
+      void cancelSave()
+      {
+         _saveState = kStateIdle;
+         updateThumbnails();
+      }
+
+      // Returns whether a state was captured, and its size. The buffer is
+      // given up, so what the engine writes later is thrown away.
+      bool finishSave(uint32 &aSize)
+      {
+         const bool captured = (_saveState == kStateDone);
+         aSize = _saveSize;
+
+         _saveBuffer = 0;
+         _saveBufferSize = 0;
+         _saveStream = 0;
+         _saveState = kStateIdle;
+         updateThumbnails();
+         return captured;
+      }
+
+      // Returns how much of the data was taken
+      uint32 writeState(const RetroStateWriteStream *aStream, uint32 aPos, const void *aData, uint32 aSize)
+      {
+         if(aStream != _saveStream)
+            return aSize;
+
+         if(aPos >= _saveBufferSize)
+            return 0;
+
+         aSize = MIN(aSize, _saveBufferSize - aPos);
+         memcpy(_saveBuffer + aPos, aData, aSize);
+         return aSize;
+      }
+
+      void saveFinished(const RetroStateWriteStream *aStream, uint32 aSize, bool aError)
+      {
+         _stateStreams--;
+
+         if(aStream == _saveStream)
+         {
+            _saveStream = 0;
+            _saveSize = aSize;
+            _saveState = aError ? kStateIdle : kStateDone;
+         }
+
+         updateThumbnails();
+      }
+
+      bool armLoad(const byte *aData, uint32 aSize)
+      {
+         if(!aSize)
+            return false;
+
+         _loadData.resize(aSize);
+         memcpy(_loadData.begin(), aData, aSize);
+         _loadState = kStateArmed;
+         _loadDeadline = g_system->getMillis() + RETRO_STATE_TIMEOUT;
+         return true;
+      }
+
+      void cancelLoad()
+      {
+         _loadState = kStateIdle;
+      }
+
+      // Returns whether the state was loaded or is still waiting for the engine
+      bool finishLoad()
+      {
+         expireStates();
+
+         const bool accepted = (_loadState != kStateIdle);
+         if(_loadState == kStateDone)
+            _loadState = kStateIdle;
+         return accepted;
+      }
+
+      State getSaveState() const { return _saveState; }
+      State getLoadState() const { return _loadState; }
+
+      virtual Common::InSaveFile *openForLoading(const Common::String &filename)
+      {
+         expireStates();
+
+         if(_loadState == kStateArmed && isStateFile(filename))
+         {
+            _loadState = kStateDone;
+            return new Common::MemoryReadStream(_loadData.begin(), _loadData.size(), DisposeAfterUse::NO);
+         }
+
+         return DefaultSaveFileManager::openForLoading(filename);
+      }
+
+      // Saves of the state slot never reach the disk, they are either the
+      // state asked for or arrive too late for it
+      virtual Common::OutSaveFile *openForSaving(const Common::String &filename, bool compress = true)
+      {
+         if(!isStateFile(filename))
+            return DefaultSaveFileManager::openForSaving(filename, compress);
+
+         RetroStateWriteStream *stream = new RetroStateWriteStream(this);
+         if(_saveState == kStateArmed)
+         {
+            _saveStream = stream;
+            _saveState = kStateWriting;
+         }
+
+         _stateStreams++;
+         updateThumbnails();
+         return new Common::OutSaveFile(stream);
+      }
+};
+
+uint32 RetroStateWriteStream::write(const void *dataPtr, uint32 dataSize)
+{
+   const uint32 written = _finished ? 0 : _manager->writeState(this, _pos, dataPtr, dataSize);
+   if(written < dataSize)
+      _err = true;
+
+   _pos += written;
+   return written;
+}
+
+void RetroStateWriteStream::finalize()
+{
+   if(_finished)
+      return;
+
+   _finished = true;
+   _manager->saveFinished(this, _pos, _err);
+}
+
 std::list<Common::Event> _events;
 
+// Once more rects than this are pending, the whole screen is converted instead
+#define MAX_DIRTY_RECTS 16
+
 class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
    public:
       Graphics::Surface _screen;
@@ -295,6 +534,13 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       Graphics::Surface _overlay;
       bool _overlayVisible;
 
+      Common::Array<Common::Rect> _dirtyRects;
+      bool _fullRedraw;
+      Common::Rect _lastMouseRect;
+      bool _mouseChanged;
+      bool _presentDirect;
+      bool _screenUpdated;
+
       Graphics::Surface _mouseImage;
       RetroPalette _mousePalette;
       bool _mousePaletteEnabled;
@@ -320,21 +566,26 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 
       uint32 _startTime;
       uint32 _threadExitTime;
-      
-      bool _speed_hack_enabled;
+
+      enum StateRequest {
+         kStateRequestNone,
+         kStateRequestSave,
+         kStateRequestLoad
+      };
+      StateRequest _stateRequest;
 
 
       Audio::MixerImpl* _mixer;
 
 
-      OSystem_RETRO(bool aEnableSpeedHack) :
+      OSystem_RETRO() :
+         _overlayVisible(false), _fullRedraw(true), _mouseChanged(true), _presentDirect(false), _screenUpdated(true),
          _mousePaletteEnabled(false), _mouseVisible(false),
          _mouseX(0), _mouseY(0), _mouseXAcc(0.0), _mouseYAcc(0.0), _mouseHotspotX(0), _mouseHotspotY(0),
          _dpadXAcc(0.0), _dpadYAcc(0.0), _dpadXVel(0.0f), _dpadYVel(0.0f),
          _mouseKeyColor(0), _mouseDontScale(false),
          _joypadnumpadLast(8), _joypadnumpadActive(false),
-         _mixer(0), _startTime(0), _threadExitTime(10),
-         _speed_hack_enabled(aEnableSpeedHack)
+         _mixer(0), _startTime(0), _threadExitTime(10), _stateRequest(kStateRequestNone)
    {
       _fsFactory = new FS_SYSTEM_FACTORY();
       memset(_mouseButtons, 0, sizeof(_mouseButtons));
@@ -362,13 +613,13 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 
       virtual void initBackend()
       {
-         _savefileManager = new DefaultSaveFileManager(s_saveDir);
+         _savefileManager = new RetroSaveFileManager(s_saveDir);
 #ifdef FRONTEND_SUPPORTS_RGB565
          _overlay.create(RES_W_OVERLAY, RES_H_OVERLAY, Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
 #else
          _overlay.create(RES_W_OVERLAY, RES_H_OVERLAY, Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15));
 #endif
-         _mixer = new Audio::MixerImpl(44100);
+         _mixer = new Audio::MixerImpl(RETRO_AUDIO_SAMPLE_RATE);
          _timerManager = new DefaultTimerManager();
 
          _mixer->setReady(true);
@@ -384,7 +635,10 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       virtual void setFeatureState(Feature f, bool enable)
       {
          if (f == kFeatureCursorPalette)
+         {
             _mousePaletteEnabled = enable;
+            _mouseChanged = true;
+         }
       }
 
       virtual bool getFeatureState(Feature f)
@@ -416,6 +670,7 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       virtual void initSize(uint width, uint height, const Graphics::PixelFormat *format)
       {
          _gameScreen.create(width, height, format ? *format : Graphics::PixelFormat::createFormatCLUT8());
+         _fullRedraw = true;
       }
 
       virtual int16 getHeight()
@@ -437,15 +692,21 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       {
          Common::List<Graphics::PixelFormat> result;
 
+         /* Frontend format - presented without conversion */
+         const Graphics::PixelFormat screenFormat = retroScreenFormat();
+         result.push_back(screenFormat);
+
          /* RGBA8888 */
          result.push_back(Graphics::PixelFormat(4, 8, 8, 8, 8, 24, 16, 8, 0));
 
 #ifdef FRONTEND_SUPPORTS_RGB565
          /* RGB565 - overlay */
-         result.push_back(Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
+         if(screenFormat != Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0))
+            result.push_back(Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
 #endif
          /* RGB555 - fmtowns */
-         result.push_back(Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15));
+         if(screenFormat != Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15))
+            result.push_back(Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15));
 
          /* Palette - most games */
          result.push_back(Graphics::PixelFormat::createFormatCLUT8());
@@ -460,6 +721,12 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       virtual void setPalette(const byte *colors, uint start, uint num)
       {
          _gamePalette.set(colors, start, num);
+
+         if(_gameScreen.format.bytesPerPixel == 1 && !_overlayVisible)
+            _fullRedraw = true;
+
+         if(!_mousePaletteEnabled)
+            _mouseChanged = true;
       }
 
       virtual void grabPalette(byte *colors, uint start, uint num) const
@@ -474,39 +741,157 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
          const uint8_t *src = (const uint8_t*)buf;
          uint8_t *pix = (uint8_t*)_gameScreen.pixels;
          copyRectToSurface(pix, _gameScreen.pitch, src, pitch, x, y, w, h, _gameScreen.format.bytesPerPixel);
+
+         if(!_overlayVisible)
+            addDirtyRect(Common::Rect(x, y, x + w, y + h));
+      }
+
+      void addDirtyRect(const Common::Rect &aRect)
+      {
+         if(_fullRedraw || aRect.isEmpty())
+            return;
+
+         // Merge with an overlapping rect, engines tend to update the same
+         // area several times per frame
+         for(uint i = 0; i < _dirtyRects.size(); i ++)
+         {
+            if(_dirtyRects[i].intersects(aRect) || _dirtyRects[i].contains(aRect))
+            {
+               _dirtyRects[i].extend(aRect);
+               return;
+            }
+         }
+
+         if(_dirtyRects.size() >= MAX_DIRTY_RECTS)
+            _fullRedraw = true;
+         else
+            _dirtyRects.push_back(aRect);
+      }
+
+      void convertRect(const Graphics::Surface& aSrc, Common::Rect aRect)
+      {
+         aRect.clip(MIN<int16>(aSrc.w, _screen.w), MIN<int16>(aSrc.h, _screen.h));
+         if(aRect.isEmpty())
+            return;
+
+         if(_screen.format.bytesPerPixel == 4)
+            convertRect<uint32>(aSrc, aRect);
+         else
+            convertRect<uint16>(aSrc, aRect);
+      }
+
+      template<typename OutPixel>
+      void convertRect(const Graphics::Surface& aSrc, const Common::Rect& aRect)
+      {
+         switch(aSrc.format.bytesPerPixel)
+         {
+            case 1:
+            case 3:
+               blit_uint8_fast<OutPixel>(_screen, aSrc, _gamePalette, aRect);
+               break;
+            case 2:
+               blit_rgb_fast<uint16, OutPixel>(_screen, aSrc, aRect);
+               break;
+            case 4:
+               blit_rgb_fast<uint32, OutPixel>(_screen, aSrc, aRect);
+               break;
+         }
+      }
+
+      template<typename OutPixel>
+      void drawMouse(int aX, int aY)
+      {
+         if(_mouseImage.format.bytesPerPixel == 1)
+            blit_uint8_cursor<OutPixel>(_screen, _mouseImage, aX, aY, _mousePaletteEnabled ? _mousePalette : _gamePalette, _mouseKeyColor);
+         else
+            blit_uint16_cursor<OutPixel>(_screen, _mouseImage, aX, aY, _mouseKeyColor);
+      }
+
+      // The game screen can be handed to the frontend untouched when it is
+      // already in the frontend format and nothing has to be composited on top
+      bool canPresentDirect() const
+      {
+         if(_overlayVisible || !_gameScreen.pixels)
+            return false;
+
+         if(_mouseVisible && _mouseImage.w && _mouseImage.h)
+            return false;
+
+         return isScreenCompatible(_gameScreen.format);
       }
 
       virtual void updateScreen()
       {
+         const bool direct = canPresentDirect();
+
+         if(direct)
+         {
+            if(_fullRedraw || !_dirtyRects.empty())
+               _screenUpdated = true;
+
+            _fullRedraw = false;
+            _dirtyRects.clear();
+            _lastMouseRect = Common::Rect();
+            _presentDirect = true;
+            return;
+         }
+
+         // _screen was not kept up to date while the game screen was presented
+         if(_presentDirect)
+         {
+            _fullRedraw = true;
+            _presentDirect = false;
+         }
+
          const Graphics::Surface& srcSurface = (_overlayVisible) ? _overlay : _gameScreen;
-         if(srcSurface.w && srcSurface.h)
+
+         // The cursor is composited into _screen, so the area it covered last
+         // frame and the area it covers now have to be refreshed from the source
+         Common::Rect mouseRect;
+         if(_mouseVisible && _mouseImage.w && _mouseImage.h)
          {
-            switch(srcSurface.format.bytesPerPixel)
+            const int x = _mouseX - _mouseHotspotX;
+            const int y = _mouseY - _mouseHotspotY;
+            mouseRect = Common::Rect(x, y, x + _mouseImage.w, y + _mouseImage.h);
+            mouseRect.clip(_screen.w, _screen.h);
+         }
+         if(_mouseChanged || mouseRect != _lastMouseRect)
+         {
+            addDirtyRect(_lastMouseRect);
+            addDirtyRect(mouseRect);
+            _mouseChanged = false;
+         }
+
+         if(!_fullRedraw && _dirtyRects.empty())
+            return;
+
+         if(srcSurface.w && srcSurface.h && _screen.w && _screen.h)
+         {
+            if(_fullRedraw)
+               convertRect(srcSurface, Common::Rect(srcSurface.w, srcSurface.h));
+            else
             {
-               case 1:
-               case 3:
-                  blit_uint8_uint16_fast(_screen, srcSurface, _gamePalette);
-                  break;
-               case 2:
-                  blit_uint16_uint16(_screen, srcSurface, _gamePalette);
-                  break;
-               case 4:
-                  blit_uint32_uint16(_screen, srcSurface, _gamePalette);
-                  break;
+               for(uint i = 0; i < _dirtyRects.size(); i ++)
+                  convertRect(srcSurface, _dirtyRects[i]);
             }
+
+            _fullRedraw = false;
+            _dirtyRects.clear();
          }
 
          // Draw Mouse
-         if(_mouseVisible && _mouseImage.w && _mouseImage.h)
+         if(!mouseRect.isEmpty())
          {
             const int x = _mouseX - _mouseHotspotX;
             const int y = _mouseY - _mouseHotspotY;
 
-            if(_mouseImage.format.bytesPerPixel == 1)
-               blit_uint8_uint16(_screen, _mouseImage, x, y, _mousePaletteEnabled ? _mousePalette : _gamePalette, _mouseKeyColor);
+            if(_screen.format.bytesPerPixel == 4)
+               drawMouse<uint32>(x, y);
             else
-               blit_uint16_uint16(_screen, _mouseImage, x, y, _mousePaletteEnabled ? _mousePalette : _gamePalette, _mouseKeyColor);
+               drawMouse<uint16>(x, y);
          }
+         _lastMouseRect = mouseRect;
+         _screenUpdated = true;
       }
 
       virtual Graphics::Surface *lockScreen()
@@ -516,7 +901,9 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 
       virtual void unlockScreen()
       {
-         /* EMPTY */
+         // The engine may have touched any pixel (this also covers fillScreen)
+         if(!_overlayVisible)
+            _fullRedraw = true;
       }
 
       virtual void setShakePos(int shakeXOffset, int shakeYOffset)
@@ -526,17 +913,24 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 
       virtual void showOverlay()
       {
+         if(!_overlayVisible)
+            _fullRedraw = true;
          _overlayVisible = true;
       }
 
       virtual void hideOverlay()
       {
+         if(_overlayVisible)
+            _fullRedraw = true;
          _overlayVisible = false;
       }
 
       virtual void clearOverlay()
       {
          _overlay.fillRect(Common::Rect(_overlay.w, _overlay.h), 0);
+
+         if(_overlayVisible)
+            _fullRedraw = true;
       }
 
       virtual void grabOverlay(void *buf, int pitch)
@@ -557,6 +951,9 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
          const uint8_t *src = (const uint8_t*)buf;
          uint8_t *pix = (uint8_t*)_overlay.pixels;
          copyRectToSurface(pix, _overlay.pitch, src, pitch, x, y, w, h, _overlay.format.bytesPerPixel);
+
+         if(_overlayVisible)
+            addDirtyRect(Common::Rect(x, y, x + w, y + h));
       }
 
       virtual int16 getOverlayHeight()
@@ -578,6 +975,8 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       {
          const bool wasVisible = _mouseVisible;
          _mouseVisible = visible;
+         if(wasVisible != visible)
+            _mouseChanged = true;
          return wasVisible;
       }
 
@@ -602,17 +1001,25 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
          _mouseHotspotY = hotspotY;
          _mouseKeyColor = keycolor;
          _mouseDontScale = dontScale;
+         _mouseChanged = true;
       }
 
       virtual void setCursorPalette(const byte *colors, uint start, uint num)
       {
          _mousePalette.set(colors, start, num);
          _mousePaletteEnabled = true;
+         _mouseChanged = true;
       }
       
-		void retroCheckThread(uint32 offset = 0)
+      void retroCheckThread()
       {
-         if(_threadExitTime <= (getMillis() + offset))
+         if(_threadExitTime <= getMillis())
+            retroYieldThread();
+      }
+
+      void retroYieldThread()
+      {
+         do
          {
 #if defined(USE_LIBCO)
             extern void retro_leave_thread();
@@ -620,10 +1027,116 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 #else
             retro_switch_thread();
 #endif
-            _threadExitTime = getMillis() + 10;
+         } while(serviceStateRequest());
+
+         _threadExitTime = getMillis() + 10;
+      }
+
+      RetroSaveFileManager *getRetroSaveFileManager()
+      {
+         return (RetroSaveFileManager*)_savefileManager;
+      }
+
+      // Called on the emulator thread when the frontend asked for a save
+      // state. Returns true if control should go straight back to the
+      // frontend, false if the engine deferred the request to its main loop.
+      bool serviceStateRequest()
+      {
+         if(_stateRequest == kStateRequestNone)
+            return false;
+
+         RetroSaveFileManager *saves = getRetroSaveFileManager();
+         const StateRequest request = _stateRequest;
+         _stateRequest = kStateRequestNone;
+
+         if(request == kStateRequestSave)
+         {
+            if(!g_engine || !g_engine->canSaveGameStateCurrently() ||
+               g_engine->saveGameState(RETRO_STATE_SLOT, "libretro").getCode() != Common::kNoError)
+               saves->cancelSave();
+
+            return saves->getSaveState() != RetroSaveFileManager::kStateArmed;
+         }
+         else
+         {
+            if(!g_engine || !g_engine->canLoadGameStateCurrently() ||
+               g_engine->loadGameState(RETRO_STATE_SLOT).getCode() != Common::kNoError)
+               saves->cancelLoad();
+
+            return saves->getLoadState() != RetroSaveFileManager::kStateArmed;
          }
       }
 
+      // The state is saved into aData, which is only used until
+      // finishSaveState is called
+      bool requestSaveState(void *aData, size_t aSize)
+      {
+         if(aSize < RETRO_STATE_HEADER_SIZE)
+            return false;
+
+         aSize = MIN<size_t>(aSize, RETRO_STATE_SIZE);
+         getRetroSaveFileManager()->armSave((byte*)aData + RETRO_STATE_HEADER_SIZE, aSize - RETRO_STATE_HEADER_SIZE);
+         _stateRequest = kStateRequestSave;
+         return true;
+      }
+
+      bool requestLoadState(const void *aData, size_t aSize)
+      {
+         if(aSize < RETRO_STATE_HEADER_SIZE)
+            return false;
+
+         const byte *data = (const byte*)aData;
+         const uint32 size = READ_LE_UINT32(data + 8);
+         if(READ_BE_UINT32(data) != RETRO_STATE_MAGIC || READ_LE_UINT32(data + 4) != RETRO_STATE_VERSION ||
+            size > aSize - RETRO_STATE_HEADER_SIZE)
+            return false;
+
+         if(!getRetroSaveFileManager()->armLoad(data + RETRO_STATE_HEADER_SIZE, size))
+            return false;
+
+         _stateRequest = kStateRequestLoad;
+         return true;
+      }
+
+      bool isStateRequestPending()
+      {
+         RetroSaveFileManager *saves = getRetroSaveFileManager();
+
+         return _stateRequest != kStateRequestNone ||
+                saves->getSaveState() == RetroSaveFileManager::kStateArmed ||
+                saves->getSaveState() == RetroSaveFileManager::kStateWriting ||
+                saves->getLoadState() == RetroSaveFileManager::kStateArmed;
+      }
+
+      // Writes the header in front of the state, if one was captured
+      bool finishSaveState(void *aData)
+      {
+         _stateRequest = kStateRequestNone;
+
+         uint32 size;
+         if(!getRetroSaveFileManager()->finishSave(size))
+            return false;
+
+         byte *data = (byte*)aData;
+         WRITE_BE_UINT32(data, RETRO_STATE_MAGIC);
+         WRITE_LE_UINT32(data + 4, RETRO_STATE_VERSION);
+         WRITE_LE_UINT32(data + 8, size);
+         return true;
+      }
+
+      // A load the engine accepted but has not picked up yet stays armed for
+      // a while, the data was copied so it can still be applied
+      bool finishLoadState()
+      {
+         if(_stateRequest != kStateRequestNone)
+         {
+            _stateRequest = kStateRequestNone;
+            getRetroSaveFileManager()->cancelLoad();
+         }
+
+         return getRetroSaveFileManager()->finishLoad();
+      }
+
       virtual bool pollEvent(Common::Event &event)
       {
          retroCheckThread();
@@ -659,50 +1172,31 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 
       virtual void delayMillis(uint msecs)
       {
-			// Implement 'non-blocking' sleep...
-			uint32 start_time = getMillis();
-			if (_speed_hack_enabled)
-			{
-				// Use janky inaccurate method...
-				uint32 elapsed_time = 0;
-				uint32 time_remaining = msecs;
-				while(time_remaining > 0)
-				{
-					// If delay would take us past the next
-					// thread exit time, exit the thread immediately
-					// (i.e. start burning delay time in the main RetroArch
-					// thread as soon as possible...)
-					retroCheckThread(time_remaining);
-					// Check how much delay time remains...
-					elapsed_time = getMillis() - start_time;
-					if (time_remaining > elapsed_time)
-					{
-						time_remaining = time_remaining - elapsed_time;
-						usleep(1000);
-					}
-					else
-					{
-						time_remaining = 0;
-					}
-					// Have to handle the timer manager here, since some engines
-					// (e.g. dreamweb) sit in a delayMillis() loop waiting for a
-					// timer callback...
-					((DefaultTimerManager*)_timerManager)->handler();
-				}
-			}
-			else
-			{
-				// Use accurate method...
-				while(getMillis() < start_time + msecs)
-				{
-					usleep(1000);
-					retroCheckThread();
-					// Have to handle the timer manager here, since some engines
-					// (e.g. dreamweb) sit in a delayMillis() loop waiting for a
-					// timer callback...
-					((DefaultTimerManager*)_timerManager)->handler();
-				}
-			}
+         DefaultTimerManager *timerManager = (DefaultTimerManager*)_timerManager;
+         const uint32 endTime = getMillis() + msecs;
+
+         // Sleep until whatever comes first: the end of the delay or the next
+         // timer proc (some engines, e.g. dreamweb, sit in a delayMillis() loop
+         // waiting for a timer callback). If the current frame is over before
+         // then, hand the rest of the wait to the frontend thread right away.
+         while(true)
+         {
+            timerManager->handler();
+
+            const uint32 now = getMillis();
+            if(now >= endTime)
+               break;
+
+            uint32 deadline = endTime;
+            uint32 nextFireTime;
+            if(timerManager->getNextFireTime(nextFireTime) && nextFireTime < deadline)
+               deadline = MAX(nextFireTime, now + 1);
+
+            if(deadline >= _threadExitTime)
+               retroYieldThread();
+            else
+               usleep((deadline - now) * 1000);
+         }
       }
 
       virtual MutexRef createMutex(void)
@@ -793,15 +1287,19 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
 
          if(srcSurface.w != _screen.w || srcSurface.h != _screen.h)
          {
-#ifdef FRONTEND_SUPPORTS_RGB565
-            _screen.create(srcSurface.w, srcSurface.h, Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
-#else
-            _screen.create(srcSurface.w, srcSurface.h, Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15));
-#endif
+            _screen.create(srcSurface.w, srcSurface.h, retroScreenFormat());
+            _fullRedraw = true;
+            _lastMouseRect = Common::Rect();
          }
 
+         return _presentDirect ? _gameScreen : _screen;
+      }
 
-         return _screen;
+      bool checkScreenUpdated()
+      {
+         const bool updated = _screenUpdated;
+         _screenUpdated = false;
+         return updated;
       }
 
 #define ANALOG_RANGE 0x8000
@@ -1294,9 +1792,9 @@ class OSystem_RETRO : public EventsBaseBackend, public PaletteManager {
       }
 };
 
-OSystem* retroBuildOS(bool aEnableSpeedHack)
+OSystem* retroBuildOS()
 {
-   return new OSystem_RETRO(aEnableSpeedHack);
+   return new OSystem_RETRO();
 }
 
 const Graphics::Surface& getScreen()
@@ -1304,6 +1802,57 @@ const Graphics::Surface& getScreen()
    return ((OSystem_RETRO*)g_system)->getScreen();
 }
 
+bool retroScreenUpdated()
+{
+   return ((OSystem_RETRO*)g_system)->checkScreenUpdated();
+}
+
+size_t retroStateSize()
+{
+   return RETRO_STATE_SIZE;
+}
+
+bool retroRequestSaveState(void *aData, size_t aSize)
+{
+   return ((OSystem_RETRO*)g_system)->requestSaveState(aData, aSize);
+}
+
+bool retroRequestLoadState(const void *aData, size_t aSize)
+{
+   return ((OSystem_RETRO*)g_system)->requestLoadState(aData, aSize);
+}
+
+bool retroStateRequestPending()
+{
+   return ((OSystem_RETRO*)g_system)->isStateRequestPending();
+}
+
+bool retroFinishSaveState(void *aData)
+{
+   return ((OSystem_RETRO*)g_system)->finishSaveState(aData);
+}
+
+bool retroFinishLoadState()
+{
+   return ((OSystem_RETRO*)g_system)->finishLoadState();
+}
+
+void retroSetScreenFormat(enum retro_pixel_format aFormat)
+{
+   switch(aFormat)
+   {
+      case RETRO_PIXEL_FORMAT_XRGB8888:
+         s_screenFormat = Graphics::PixelFormat(4, 8, 8, 8, 0, 16, 8, 0, 0);
+         break;
+      case RETRO_PIXEL_FORMAT_RGB565:
+         s_screenFormat = Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0);
+         break;
+      default:
+         s_screenFormat = Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15);
+         break;
+   }
+}
+
 void retroProcessMouse(retro_input_state_t aCallback, int device, float gamepad_cursor_speed, float gamepad_acceleration_time, bool analog_response_is_quadratic, int analog_deadzone, float mouse_speed)
 {
    ((OSystem_RETRO*)g_system)->processMouse(aCallback, device, gamepad_cursor_speed, gamepad_acceleration_time, analog_response_is_quadratic, analog_deadzone, mouse_speed);
@@ -42,6 +42,8 @@
 #define R_OK 4
 #endif
 
+#define RETRO_AUDIO_SAMPLE_RATE 44100
+
 extern char cmd_params[20][200];
 extern char cmd_params_num;
 
@@ -49,12 +51,21 @@ extern char cmd_params_num;
 extern int access(const char *path, int amode);
 #endif
 
-OSystem* retroBuildOS(bool aEnableSpeedHack);
+OSystem* retroBuildOS();
 const Graphics::Surface& getScreen();
+bool retroScreenUpdated();
+void retroSetScreenFormat(enum retro_pixel_format aFormat);
 
 void retroProcessMouse(retro_input_state_t aCallback, int device, float gamepad_cursor_speed, float gamepad_acceleration_time, bool analog_response_is_quadratic, int analog_deadzone, float mouse_speed);
 void retroPostQuit();
 
+size_t retroStateSize();
+bool retroRequestSaveState(void *aData, size_t aSize);
+bool retroRequestLoadState(const void *aData, size_t aSize);
+bool retroStateRequestPending();
+bool retroFinishSaveState(void *aData);
+bool retroFinishLoadState();
+
 void retroSetSystemDir(const char* aPath);
 void retroSetSaveDir(const char* aPath);
 
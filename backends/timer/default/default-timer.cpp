@@ -110,6 +110,18 @@ void DefaultTimerManager::handler() {
 	}
 }
 
+bool DefaultTimerManager::getNextFireTime(uint32 &nextFireTime) {
+	Common::StackLock lock(_mutex);
+
+	const TimerSlot *slot = _head->next;
+	if (!slot)
+		return false;
+
+	// handler() only fires slots whose time has strictly passed
+	nextFireTime = slot->nextFireTime + 1;
+	return true;
+}
+
 bool DefaultTimerManager::installTimerProc(TimerProc callback, int32 interval, void *refCon, const Common::String &id) {
 	assert(interval > 0);
 	Common::StackLock lock(_mutex);
@@ -48,6 +48,16 @@ public:
 	 * Timer callback, to be invoked at regular time intervals by the backend.
 	 */
 	void handler();
+
+	/**
+	 * Get the time at which the next timer is due, so that backends can sleep
+	 * until then instead of polling handler().
+	 *
+	 * @param nextFireTime	set to the due time in milliseconds (as returned by
+	 *                      OSystem::getMillis) if a timer is installed
+	 * @return true if a timer is installed, false otherwise
+	 */
+	bool getNextFireTime(uint32 &nextFireTime);
 };
 
 #endif
@@ -26,6 +26,9 @@
 #include "common/func.h"
 #include "common/debug.h"
 #include "common/config-manager.h"
+#include "common/system.h"
+
+#include "engines/fingerprintcache.h"
 
 #ifdef DYNAMIC_MODULES
 #include "common/fs.h"
@@ -541,6 +544,8 @@ DetectionResults EngineManager::detectGames(const Common::FSList &fslist) const
 	DetectedGames candidates;
 	PluginList plugins;
 	PluginList::const_iterator iter;
+	uint32 startTime = g_system->getMillis();
+	FingerprintMan.resetStats();
 	PluginManager::instance().loadFirstPlugin();
 	do {
 		plugins = getPlugins();
@@ -548,7 +553,9 @@ DetectionResults EngineManager::detectGames(const Common::FSList &fslist) const
 		// the game in the presented directory.
 		for (iter = plugins.begin(); iter != plugins.end(); ++iter) {
 			const MetaEngine &metaEngine = (*iter)->get<MetaEngine>();
+			uint32 engineStartTime = g_system->getMillis();
 			DetectedGames engineCandidates = metaEngine.detectGames(fslist);
+			debug(4, "Detection with %s took %d ms", metaEngine.getName(), g_system->getMillis() - engineStartTime);
 
 			for (uint i = 0; i < engineCandidates.size(); i++) {
 				engineCandidates[i].engineName = metaEngine.getName();
@@ -560,6 +567,15 @@ DetectionResults EngineManager::detectGames(const Common::FSList &fslist) const
 		}
 	} while (PluginManager::instance().loadNextPlugin());
 
+	// Keep the checksums computed by this run for the next one
+	FingerprintMan.flush();
+
+	if (!fslist.empty()) {
+		debug(2, "Detection in '%s' took %d ms, %d checksums cached, %d computed",
+		      fslist.begin()->getParent().getPath().c_str(), g_system->getMillis() - startTime,
+		      FingerprintMan.getHits(), FingerprintMan.getMisses());
+	}
+
 	return DetectionResults(candidates);
 }
 
@@ -213,6 +213,15 @@ public:
 	 */
 	bool isWritable() const;
 
+	/**
+	 * Returns the time the object referred by this node was last modified.
+	 * The value is only meant to be compared to earlier values for the same
+	 * node, to tell whether it has changed.
+	 *
+	 * @return the modification time, or 0 if the backend cannot tell
+	 */
+	uint32 getModificationTime() const;
+
 	/**
 	 * Creates a SeekableReadStream instance corresponding to the file
 	 * referred by this node. This assumes that the node actually refers
@@ -31,6 +31,7 @@
 #include "common/translation.h"
 #include "gui/EventRecorder.h"
 #include "engines/advancedDetector.h"
+#include "engines/fingerprintcache.h"
 #include "engines/obsolete.h"
 
 static Common::String sanitizeName(const char *name) {
@@ -365,11 +366,18 @@ bool AdvancedMetaEngine::getFileProperties(const Common::FSNode &parent, const F
 		if (!macResMan.open(parent, fname))
 			return false;
 
-		fileProps.md5 = macResMan.computeResForkMD5AsString(_md5Bytes);
 		fileProps.size = macResMan.getResForkDataSize();
 
-		if (fileProps.size != 0)
+		if (fileProps.size != 0) {
+			const Common::FSNode file = parent.getChild(fname);
+
+			if (!FingerprintMan.lookup(file, true, fileProps.size, _md5Bytes, fileProps.md5)) {
+				fileProps.md5 = macResMan.computeResForkMD5AsString(_md5Bytes);
+				FingerprintMan.store(file, true, fileProps.size, _md5Bytes, fileProps.md5);
+			}
+
 			return true;
+		}
 	}
 
 	if (!allFiles.contains(fname))
@@ -381,7 +389,13 @@ bool AdvancedMetaEngine::getFileProperties(const Common::FSNode &parent, const F
 		return false;
 
 	fileProps.size = (int32)testFile.size();
-	fileProps.md5 = Common::computeStreamMD5AsString(testFile, _md5Bytes);
+
+	// Only read the file if its checksum isn't known yet
+	if (!FingerprintMan.lookup(allFiles[fname], false, fileProps.size, _md5Bytes, fileProps.md5)) {
+		fileProps.md5 = Common::computeStreamMD5AsString(testFile, _md5Bytes);
+		FingerprintMan.store(allFiles[fname], false, fileProps.size, _md5Bytes, fileProps.md5);
+	}
+
 	return true;
 }
 
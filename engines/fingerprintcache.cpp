@@ -0,0 +1,253 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/debug.h"
+#include "common/endian.h"
+#include "common/savefile.h"
+#include "common/system.h"
+
+#include "engines/fingerprintcache.h"
+
+namespace Common {
+DECLARE_SINGLETON(FingerprintCache);
+}
+
+static const char *const kFingerprintCacheName = ".scummvm-detection.cache";
+/** The name used by earlier versions, which was not hidden from the saves */
+static const char *const kOldFingerprintCacheName = "scummvm-detection.cache";
+static const uint32 kFingerprintCacheTag = MKTAG('D', 'M', 'D', '5');
+static const uint32 kFingerprintCacheVersion = 2;
+/** Entries not used in this many detection sessions are dropped */
+static const uint32 kFingerprintCacheMaxUnusedSessions = 32;
+
+FingerprintCache::FingerprintCache() : _session(0), _loaded(false), _dirty(false), _hits(0), _misses(0) {
+}
+
+static Common::String readCacheString(Common::ReadStream &stream) {
+	Common::String str;
+	uint16 length = stream.readUint16LE();
+
+	for (uint16 i = 0; i < length; i++)
+		str += (char)stream.readByte();
+
+	return str;
+}
+
+static void writeCacheString(Common::WriteStream &stream, const Common::String &str) {
+	stream.writeUint16LE(str.size());
+	stream.write(str.c_str(), str.size());
+}
+
+Common::String FingerprintCache::getKey(const Common::String &path, bool resourceFork) {
+	return resourceFork ? path + " (resource fork)" : path;
+}
+
+Common::String FingerprintCache::getDirectory(const Common::String &path) {
+	for (int i = (int)path.size() - 1; i >= 0; i--) {
+		if (path[i] == '/' || path[i] == '\\')
+			return Common::String(path.c_str(), i);
+	}
+
+	return Common::String();
+}
+
+void FingerprintCache::load() {
+	_loaded = true;
+
+	Common::SaveFileManager *saveFileMan = g_system->getSavefileManager();
+	if (!saveFileMan)
+		return;
+
+	Common::InSaveFile *in = saveFileMan->openForLoading(kFingerprintCacheName);
+	if (!in) {
+		saveFileMan->removeSavefile(kOldFingerprintCacheName);
+		_session = 1;
+		return;
+	}
+
+	if (in->readUint32BE() != kFingerprintCacheTag || in->readUint32LE() != kFingerprintCacheVersion) {
+		warning("FingerprintCache: Ignoring invalid detection cache");
+		delete in;
+		_session = 1;
+		return;
+	}
+
+	_session = in->readUint32LE() + 1;
+
+	uint32 count = in->readUint32LE();
+	for (uint32 i = 0; i < count && !in->eos() && !in->err(); i++) {
+		Entry entry;
+		entry.path = readCacheString(*in);
+		entry.resourceFork = in->readByte() != 0;
+		entry.size = in->readSint32LE();
+		entry.modificationTime = in->readUint32LE();
+		entry.lastSession = in->readUint32LE();
+
+		uint16 checksums = in->readUint16LE();
+		for (uint16 j = 0; j < checksums; j++) {
+			Checksum checksum;
+			checksum.bytes = in->readUint32LE();
+			checksum.md5 = readCacheString(*in);
+			entry.checksums.push_back(checksum);
+		}
+
+		if (in->eos() || in->err())
+			break;
+
+		_entries[getKey(entry.path, entry.resourceFork)] = entry;
+	}
+
+	debug(2, "FingerprintCache: Loaded %d files", _entries.size());
+
+	delete in;
+}
+
+void FingerprintCache::prune() {
+	// Only the unused entries in the directories which were scanned in this
+	// session are checked for deleted files. Checking every file ever
+	// detected would take as long as what the cache saves, so the entries
+	// in other directories are only dropped once they get too old.
+	Common::HashMap<Common::String, bool> scannedDirectories;
+	for (EntryMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		if (it->_value.used)
+			scannedDirectories[getDirectory(it->_value.path)] = true;
+	}
+
+	Common::Array<Common::String> removed;
+	for (EntryMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		const Entry &entry = it->_value;
+		if (entry.used)
+			continue;
+
+		if (_session - entry.lastSession > kFingerprintCacheMaxUnusedSessions ||
+		    (scannedDirectories.contains(getDirectory(entry.path)) && !Common::FSNode(entry.path).exists()))
+			removed.push_back(it->_key);
+	}
+
+	for (uint i = 0; i < removed.size(); i++)
+		_entries.erase(removed[i]);
+
+	if (!removed.empty()) {
+		debug(2, "FingerprintCache: Dropped %d files", removed.size());
+		_dirty = true;
+	}
+}
+
+void FingerprintCache::flush() {
+	if (!_loaded)
+		return;
+
+	prune();
+
+	if (!_dirty)
+		return;
+
+	Common::SaveFileManager *saveFileMan = g_system->getSavefileManager();
+	if (!saveFileMan)
+		return;
+
+	Common::OutSaveFile *out = saveFileMan->openForSaving(kFingerprintCacheName, false);
+	if (!out) {
+		warning("FingerprintCache: Could not write detection cache");
+		return;
+	}
+
+	out->writeUint32BE(kFingerprintCacheTag);
+	out->writeUint32LE(kFingerprintCacheVersion);
+	out->writeUint32LE(_session);
+	out->writeUint32LE(_entries.size());
+
+	for (EntryMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		const Entry &entry = it->_value;
+
+		writeCacheString(*out, entry.path);
+		out->writeByte(entry.resourceFork ? 1 : 0);
+		out->writeSint32LE(entry.size);
+		out->writeUint32LE(entry.modificationTime);
+		out->writeUint32LE(entry.lastSession);
+		out->writeUint16LE(entry.checksums.size());
+		for (uint i = 0; i < entry.checksums.size(); i++) {
+			out->writeUint32LE(entry.checksums[i].bytes);
+			writeCacheString(*out, entry.checksums[i].md5);
+		}
+	}
+
+	out->finalize();
+	if (out->err())
+		warning("FingerprintCache: Could not write detection cache");
+	else
+		_dirty = false;
+
+	delete out;
+}
+
+bool FingerprintCache::lookup(const Common::FSNode &file, bool resourceFork, int32 size, uint32 md5Bytes, Common::String &md5) {
+	if (!_loaded)
+		load();
+
+	EntryMap::iterator it = _entries.find(getKey(file.getPath(), resourceFork));
+	if (it != _entries.end() && it->_value.size == size && it->_value.modificationTime == file.getModificationTime()) {
+		Entry &entry = it->_value;
+
+		for (uint i = 0; i < entry.checksums.size(); i++) {
+			if (entry.checksums[i].bytes == md5Bytes) {
+				md5 = entry.checksums[i].md5;
+				entry.used = true;
+				if (entry.lastSession != _session) {
+					// Remember that the entry is still in use
+					entry.lastSession = _session;
+					_dirty = true;
+				}
+				_hits++;
+				return true;
+			}
+		}
+	}
+
+	_misses++;
+	return false;
+}
+
+void FingerprintCache::store(const Common::FSNode &file, bool resourceFork, int32 size, uint32 md5Bytes, const Common::String &md5) {
+	if (!_loaded)
+		load();
+
+	const uint32 modificationTime = file.getModificationTime();
+
+	Entry &entry = _entries[getKey(file.getPath(), resourceFork)];
+	if (entry.size != size || entry.modificationTime != modificationTime) {
+		entry.path = file.getPath();
+		entry.resourceFork = resourceFork;
+		entry.size = size;
+		entry.modificationTime = modificationTime;
+		entry.checksums.clear();
+	}
+	entry.lastSession = _session;
+	entry.used = true;
+
+	Checksum checksum;
+	checksum.bytes = md5Bytes;
+	checksum.md5 = md5;
+	entry.checksums.push_back(checksum);
+
+	_dirty = true;
+}
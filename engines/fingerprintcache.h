@@ -0,0 +1,121 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef ENGINES_FINGERPRINTCACHE_H
+#define ENGINES_FINGERPRINTCACHE_H
+
+#include "common/array.h"
+#include "common/fs.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/singleton.h"
+#include "common/str.h"
+
+/**
+ * Persistent cache of the MD5 checksums computed by the game detection.
+ *
+ * Detection computes the checksum of the first bytes of every candidate
+ * file, for every engine, which is slow on devices with slow storage. The
+ * checksums are stored per file path, size and modification time, and for
+ * each number of bytes checked, so unchanged files only need to be read
+ * once. On backends which cannot tell the modification time, a file is
+ * only assumed to have changed when its size changes.
+ *
+ * The cache is shared by all engines and kept in the savefile area, under
+ * a name starting with a dot so that it is neither listed with the saves
+ * nor synced to the cloud. Entries of files which were deleted from a
+ * scanned directory, and entries not used for a while, are dropped.
+ */
+class FingerprintCache : public Common::Singleton<FingerprintCache> {
+public:
+	/**
+	 * Looks up the checksum of the start of a file.
+	 * @param file		the file
+	 * @param resourceFork	whether the checksum is of the Mac resource fork of the file
+	 * @param size		the size of the file, or of its resource fork
+	 * @param md5Bytes	the number of bytes checksummed, 0 for the whole file
+	 * @param md5		set to the checksum if it is found
+	 * @return true if the checksum is found
+	 */
+	bool lookup(const Common::FSNode &file, bool resourceFork, int32 size, uint32 md5Bytes, Common::String &md5);
+
+	/**
+	 * Stores the checksum of the start of a file. A file stored with a
+	 * different size or modification time is assumed to have changed and
+	 * loses its checksums.
+	 */
+	void store(const Common::FSNode &file, bool resourceFork, int32 size, uint32 md5Bytes, const Common::String &md5);
+
+	/**
+	 * Drops outdated entries and writes the cache back to disk, if it has
+	 * changed since it was loaded.
+	 */
+	void flush();
+
+	uint getHits() const { return _hits; }
+	uint getMisses() const { return _misses; }
+	void resetStats() { _hits = _misses = 0; }
+
+private:
+	friend class Common::Singleton<SingletonBaseType>;
+	FingerprintCache();
+
+	struct Checksum {
+		uint32 bytes;
+		Common::String md5;
+	};
+
+	struct Entry {
+		Entry() : resourceFork(false), size(-1), modificationTime(0), lastSession(0), used(false) {}
+
+		Common::String path;
+		bool resourceFork;
+		int32 size;
+		uint32 modificationTime;
+		/** The last detection session in which the entry was used */
+		uint32 lastSession;
+		/** Whether the entry was used since the cache was loaded */
+		bool used;
+		Common::Array<Checksum> checksums;
+	};
+
+	typedef Common::HashMap<Common::String, Entry> EntryMap;
+
+	static Common::String getKey(const Common::String &path, bool resourceFork);
+	static Common::String getDirectory(const Common::String &path);
+
+	void load();
+	void prune();
+
+	EntryMap _entries;
+	/** Counts the sessions in which the detection used the cache */
+	uint32 _session;
+	bool _loaded;
+	bool _dirty;
+	uint _hits;
+	uint _misses;
+};
+
+/** Shortcut for accessing the detection fingerprint cache. */
+#define FingerprintMan FingerprintCache::instance()
+
+#endif
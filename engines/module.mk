@@ -4,6 +4,7 @@ MODULE_OBJS := \
 	advancedDetector.o \
 	dialogs.o \
 	engine.o \
+	fingerprintcache.o \
 	game.o \
 	obsolete.o \
 	savestate.o
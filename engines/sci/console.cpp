@@ -117,6 +117,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	registerCmd("resource_types",		WRAP_METHOD(Console, cmdResourceTypes));
 	registerCmd("list",				WRAP_METHOD(Console, cmdList));
 	registerCmd("alloc_list",				WRAP_METHOD(Console, cmdAllocList));
+	registerCmd("resource_cache",		WRAP_METHOD(Console, cmdResourceCache));
 	registerCmd("hexgrep",			WRAP_METHOD(Console, cmdHexgrep));
 	registerCmd("verify_scripts",		WRAP_METHOD(Console, cmdVerifyScripts));
 	registerCmd("integrity_dump",	WRAP_METHOD(Console, cmdResourceIntegrityDump));
@@ -163,6 +164,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	registerCmd("gc_reachable",		WRAP_METHOD(Console, cmdGCShowReachable));
 	registerCmd("gc_freeable",		WRAP_METHOD(Console, cmdGCShowFreeable));
 	registerCmd("gc_normalize",		WRAP_METHOD(Console, cmdGCNormalize));
+	registerCmd("gc_stats",			WRAP_METHOD(Console, cmdGCStats));
 	// Music/SFX
 	registerCmd("songlib",			WRAP_METHOD(Console, cmdSongLib));
 	registerCmd("songinfo",			WRAP_METHOD(Console, cmdSongInfo));
@@ -338,6 +340,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	debugPrintf(" resource_types - Shows the valid resource types\n");
 	debugPrintf(" list - Lists all the resources of a given type\n");
 	debugPrintf(" alloc_list - Lists all allocated resources\n");
+	debugPrintf(" resource_cache - Shows resource cache usage and hit/miss counters\n");
 	debugPrintf(" hexgrep - Searches some resources for a particular sequence of bytes, represented as hexadecimal numbers\n");
 	debugPrintf(" verify_scripts - Performs sanity checks on SCI1.1-SCI2.1 game scripts (e.g. if they're up to 64KB in total)\n");
 	debugPrintf(" integrity_dump - Dumps integrity data about resources in the current game to disk\n");
@@ -379,6 +382,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	debugPrintf(" gc_reachable - Lists all addresses directly reachable from a given memory object\n");
 	debugPrintf(" gc_freeable - Lists all addresses freeable in a given segment\n");
 	debugPrintf(" gc_normalize - Prints the \"normal\" address of a given address\n");
+	debugPrintf(" gc_stats - Shows pause times and reclaimed memory of the garbage collector\n");
 	debugPrintf("\n");
 	debugPrintf("Music/SFX:\n");
 	debugPrintf(" songlib - Shows the song library\n");
@@ -1028,6 +1032,30 @@ bool Console::cmdAllocList(int argc, const char **argv) {
 	return true;
 }
 
+bool Console::cmdResourceCache(int argc, const char **argv) {
+	ResourceManager *resMan = _engine->getResMan();
+
+	if (argc == 2 && !scumm_stricmp(argv[1], "reset")) {
+		resMan->resetCacheStats();
+		debugPrintf("Resource cache counters reset\n");
+		return true;
+	} else if (argc != 1) {
+		debugPrintf("Shows resource cache usage and hit/miss counters\n");
+		debugPrintf("Usage: %s [reset]\n", argv[0]);
+		return true;
+	}
+
+	const ResourceManager::CacheStats &stats = resMan->getCacheStats();
+	const uint32 requests = stats.hits + stats.misses;
+
+	debugPrintf("LRU memory: %d of %d bytes, locked: %d bytes\n", resMan->getMemoryLRU(), resMan->getMaxMemoryLRU(), resMan->getMemoryLocked());
+	debugPrintf("Requests: %u, hits: %u (%u%%), misses: %u\n", requests, stats.hits, requests ? stats.hits * 100 / requests : 0, stats.misses);
+	debugPrintf("Evictions: %u\n", stats.evictions);
+	debugPrintf("Prefetched: %u, used: %u\n", stats.prefetched, stats.prefetchHits);
+
+	return true;
+}
+
 bool Console::cmdDissectScript(int argc, const char **argv) {
 	if (argc != 2) {
 		debugPrintf("Examines a script\n");
@@ -2829,6 +2857,32 @@ bool Console::cmdGCNormalize(int argc, const char **argv) {
 	return true;
 }
 
+bool Console::cmdGCStats(int argc, const char **argv) {
+	GarbageCollector *gc = _engine->_gamestate->_gc;
+
+	if (argc == 2 && !scumm_stricmp(argv[1], "reset")) {
+		gc->resetStats();
+		debugPrintf("Garbage collector counters reset\n");
+		return true;
+	} else if (argc != 1) {
+		debugPrintf("Shows pause times and reclaimed memory of the garbage collector\n");
+		debugPrintf("Usage: %s [reset]\n", argv[0]);
+		return true;
+	}
+
+	const GarbageCollector::Stats &stats = gc->getStats();
+
+	debugPrintf("Cycles: %u, finished before marking was done: %u\n", stats.cycles, stats.forcedCycles);
+	debugPrintf("Pauses: last %u ms, longest %u ms, total %u ms\n", stats.lastPause, stats.maxPause, stats.totalPause);
+	debugPrintf("Incremental marking: %u ms total\n", stats.totalStepTime);
+	debugPrintf("Last cycle: %u objects marked incrementally, %u during the pause\n", stats.lastMarkedInSteps, stats.lastMarkedInPause);
+	debugPrintf("Reclaimed: last cycle %u objects (%u bytes), total %u objects (%u bytes)\n",
+		stats.lastFreed, stats.lastReclaimed, stats.totalFreed, stats.totalReclaimed);
+	debugPrintf("Current cycle: %s\n", gc->isMarkingDone() ? "marked, waiting to be finished" : (gc->isMarking() ? "marking" : "none"));
+
+	return true;
+}
+
 bool Console::cmdVMVarlist(int argc, const char **argv) {
 	EngineState *s = _engine->_gamestate;
 	const char *varnames[] = {"global", "local", "temp", "param"};
@@ -22,6 +22,7 @@
 
 #include "sci/engine/gc.h"
 #include "common/array.h"
+#include "common/system.h"
 #include "sci/graphics/ports.h"
 
 #ifdef ENABLE_SCI32
@@ -68,42 +69,48 @@ void WorklistManager::pushArray(const Common::Array<reg_t> &tmp) {
 		push(*it);
 }
 
-static AddrSet *normalizeAddresses(SegManager *segMan, const AddrSet &nonnormal_map) {
-	AddrSet *normal_map = new AddrSet();
-
+static void normalizeAddresses(SegManager *segMan, const AddrSet &nonnormal_map, AddrSet &normal_map) {
 	for (AddrSet::const_iterator i = nonnormal_map.begin(); i != nonnormal_map.end(); ++i) {
 		reg_t reg = i->_key;
 		SegmentObj *mobj = segMan->getSegmentObj(reg.getSegment());
 
 		if (mobj) {
 			reg = mobj->findCanonicAddress(segMan, reg);
-			normal_map->setVal(reg, true);
+			normal_map.setVal(reg, true);
 		}
 	}
+}
 
-	return normal_map;
+static void scanReference(WorklistManager &wm, const Common::Array<SegmentObj *> &heap, SegmentId stackSegment, reg_t reg) {
+	if (reg.getSegment() == stackSegment) // No need to repeat this one
+		return;
+
+	debugC(kDebugLevelGC, "[GC] Checking %04x:%04x", PRINT_REG(reg));
+	if (reg.getSegment() < heap.size() && heap[reg.getSegment()]) {
+		SegmentObj *mobj = heap[reg.getSegment()];
+
+		// Valid heap object? Find its outgoing references! Scripts may free
+		// objects in between two marking steps, so check this first.
+		if (mobj->isValidOffset(reg.getOffset()))
+			wm.pushArray(mobj->listAllOutgoingReferences(reg));
+	}
 }
 
-static void processWorkList(SegManager *segMan, WorklistManager &wm, const Common::Array<SegmentObj *> &heap) {
+static uint32 processWorkList(SegManager *segMan, WorklistManager &wm, const Common::Array<SegmentObj *> &heap) {
 	SegmentId stackSegment = segMan->findSegmentByType(SEG_TYPE_STACK);
+	uint32 scanned = 0;
 	while (!wm._worklist.empty()) {
 		reg_t reg = wm._worklist.back();
 		wm._worklist.pop_back();
-		if (reg.getSegment() != stackSegment) { // No need to repeat this one
-			debugC(kDebugLevelGC, "[GC] Checking %04x:%04x", PRINT_REG(reg));
-			if (reg.getSegment() < heap.size() && heap[reg.getSegment()]) {
-				// Valid heap object? Find its outgoing references!
-				wm.pushArray(heap[reg.getSegment()]->listAllOutgoingReferences(reg));
-			}
-		}
+		scanReference(wm, heap, stackSegment, reg);
+		scanned++;
 	}
+	return scanned;
 }
 
-AddrSet *findAllActiveReferences(EngineState *s) {
+static void pushRootSet(EngineState *s, WorklistManager &wm) {
 	assert(!s->_executionStack.empty());
 
-	WorklistManager wm;
-
 	// Initialize registers
 	wm.push(s->r_acc);
 	wm.push(s->r_prev);
@@ -171,19 +178,173 @@ AddrSet *findAllActiveReferences(EngineState *s) {
 
 	debugC(kDebugLevelGC, "[GC] -- Finished explicitly loaded scripts, done with root set");
 
-	processWorkList(s->_segMan, wm, heap);
-
 	if (g_sci->_gfxPorts)
 		g_sci->_gfxPorts->processEngineHunkList(wm);
+}
 
-	return normalizeAddresses(s->_segMan, wm._map);
+AddrSet *findAllActiveReferences(EngineState *s) {
+	WorklistManager wm;
+
+	pushRootSet(s, wm);
+	processWorkList(s->_segMan, wm, s->_segMan->getSegments());
+
+	AddrSet *normal_map = new AddrSet();
+	normalizeAddresses(s->_segMan, wm._map, *normal_map);
+	return normal_map;
 }
 
-void run_gc(EngineState *s) {
+/**
+ * Returns the number of bytes released by freeing the object at the given
+ * address, or 0 if freeing it does not release anything.
+ */
+static uint32 getAllocationSize(SegmentObj *mobj, reg_t addr) {
+	switch (mobj->getType()) {
+	case SEG_TYPE_SCRIPT: {
+		const Script *script = static_cast<Script *>(mobj);
+		return script->isMarkedAsDeleted() ? script->getBufSize() : 0;
+	}
+	case SEG_TYPE_CLONES:
+		return sizeof(Clone) + static_cast<CloneTable *>(mobj)->at(addr.getOffset()).getVarCount() * sizeof(reg_t);
+	case SEG_TYPE_LISTS:
+		return sizeof(List);
+	case SEG_TYPE_NODES:
+		return sizeof(Node);
+	case SEG_TYPE_HUNK:
+		return sizeof(Hunk) + static_cast<HunkTable *>(mobj)->at(addr.getOffset()).size;
+	default:
+		return 0;
+	}
+}
+
+GarbageCollector::GarbageCollector() :
+	_marking(false),
+	_markingDone(false),
+	_markedInSteps(0) {
+	resetStats();
+}
+
+void GarbageCollector::resetStats() {
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+void GarbageCollector::startCycle(EngineState *s) {
 	SegManager *segMan = s->_segMan;
+	const uint32 startTime = g_system->getMillis();
 
-	// Some debug stuff
-	debugC(kDebugLevelGC, "[GC] Running...");
+	debugC(kDebugLevelGC, "[GC] Starting cycle");
+
+	// The work list and the mark set keep their storage from the last cycle
+	abortCycle(segMan);
+	segMan->_gcMarking = true;
+	_marking = true;
+
+	pushRootSet(s, _wm);
+
+	recordPause(startTime);
+}
+
+void GarbageCollector::takeBarrierRefs(SegManager *segMan) {
+	// References stored while marking only need to be marked. If they
+	// already are, they have been scanned or are in the work list.
+	Common::Array<reg_t> &refs = segMan->_gcBarrierRefs;
+	for (Common::Array<reg_t>::const_iterator it = refs.begin(); it != refs.end(); ++it)
+		_wm.push(*it);
+	refs.resize(0);
+
+	// Fresh objects may reuse the address of an object which was freed
+	// after being marked, so scan them in any case
+	Common::Array<reg_t> &allocations = segMan->_gcAllocations;
+	for (Common::Array<reg_t>::const_iterator it = allocations.begin(); it != allocations.end(); ++it) {
+		_wm._map.setVal(*it, true);
+		_wm._worklist.push_back(*it);
+	}
+	allocations.resize(0);
+}
+
+void GarbageCollector::step(EngineState *s, uint32 deadline) {
+	if (!_marking)
+		return;
+
+	SegManager *segMan = s->_segMan;
+	const uint32 startTime = g_system->getMillis();
+
+	takeBarrierRefs(segMan);
+
+	const Common::Array<SegmentObj *> &heap = segMan->getSegments();
+	const SegmentId stackSegment = segMan->findSegmentByType(SEG_TYPE_STACK);
+	uint32 scanned = 0;
+
+	while (!_wm._worklist.empty()) {
+		// Only check the clock every few objects
+		if ((scanned & 63) == 63 && (int32)(deadline - g_system->getMillis()) <= 0)
+			break;
+
+		reg_t reg = _wm._worklist.back();
+		_wm._worklist.pop_back();
+		scanReference(_wm, heap, stackSegment, reg);
+		scanned++;
+	}
+
+	_markingDone = _wm._worklist.empty();
+	_markedInSteps += scanned;
+	_stats.totalStepTime += g_system->getMillis() - startTime;
+}
+
+void GarbageCollector::finishCycle(EngineState *s) {
+	if (!_marking)
+		return;
+
+	if (!_markingDone)
+		_stats.forcedCycles++;
+
+	finish(s);
+}
+
+void GarbageCollector::collect(EngineState *s) {
+	// Objects which became unreachable after the current cycle had been
+	// started would survive it, so do a complete cycle instead
+	startCycle(s);
+	finish(s);
+}
+
+void GarbageCollector::abortCycle(SegManager *segMan) {
+	segMan->_gcMarking = false;
+	segMan->_gcBarrierRefs.resize(0);
+	segMan->_gcAllocations.resize(0);
+
+	_wm._worklist.resize(0);
+	_wm._map.clear();
+	_marking = false;
+	_markingDone = false;
+	_markedInSteps = 0;
+}
+
+void GarbageCollector::finish(EngineState *s) {
+	SegManager *segMan = s->_segMan;
+	const uint32 startTime = g_system->getMillis();
+
+	// Whatever became reachable from an already scanned object since the
+	// last step is in the barrier lists, everything else can be found from
+	// the roots
+	takeBarrierRefs(segMan);
+	pushRootSet(s, _wm);
+	_stats.lastMarkedInPause = processWorkList(segMan, _wm, segMan->getSegments());
+	_stats.lastMarkedInSteps = _markedInSteps;
+
+	segMan->_gcMarking = false;
+	_marking = false;
+	_markingDone = false;
+
+	sweep(segMan);
+
+	_stats.cycles++;
+	recordPause(startTime);
+
+	debugC(kDebugLevelGC, "[GC] Cycle finished: %u objects freed, %u bytes, paused for %u ms",
+		_stats.lastFreed, _stats.lastReclaimed, _stats.lastPause);
+}
+
+void GarbageCollector::sweep(SegManager *segMan) {
 #ifdef GC_DEBUG_CODE
 	const char *segnames[SEG_TYPE_MAX + 1];
 	int segcount[SEG_TYPE_MAX + 1];
@@ -192,7 +353,11 @@ void run_gc(EngineState *s) {
 #endif
 
 	// Compute the set of all segments references currently in use.
-	AddrSet *activeRefs = findAllActiveReferences(s);
+	_liveSet.clear();
+	normalizeAddresses(segMan, _wm._map, _liveSet);
+
+	uint32 freed = 0;
+	uint32 reclaimed = 0;
 
 	// Iterate over all segments, and check for each whether it
 	// contains stuff that can be collected.
@@ -211,8 +376,14 @@ void run_gc(EngineState *s) {
 			const Common::Array<reg_t> tmp = mobj->listAllDeallocatable(seg);
 			for (Common::Array<reg_t>::const_iterator it = tmp.begin(); it != tmp.end(); ++it) {
 				const reg_t addr = *it;
-				if (!activeRefs->contains(addr)) {
+				if (!_liveSet.contains(addr)) {
 					// Not found -> we can free it
+					const uint32 size = getAllocationSize(mobj, addr);
+					if (size) {
+						freed++;
+						reclaimed += size;
+					}
+
 					mobj->freeAtAddress(segMan, addr);
 					debugC(kDebugLevelGC, "[GC] Deallocating %04x:%04x", PRINT_REG(addr));
 #ifdef GC_DEBUG_CODE
@@ -224,7 +395,10 @@ void run_gc(EngineState *s) {
 		}
 	}
 
-	delete activeRefs;
+	_stats.lastFreed = freed;
+	_stats.lastReclaimed = reclaimed;
+	_stats.totalFreed += freed;
+	_stats.totalReclaimed += reclaimed;
 
 #ifdef GC_DEBUG_CODE
 	// Output debug summary of garbage collection
@@ -235,4 +409,17 @@ void run_gc(EngineState *s) {
 #endif
 }
 
+void GarbageCollector::recordPause(uint32 startTime) {
+	const uint32 pause = g_system->getMillis() - startTime;
+
+	_stats.lastPause = pause;
+	_stats.maxPause = MAX(_stats.maxPause, pause);
+	_stats.totalPause += pause;
+}
+
+void run_gc(EngineState *s) {
+	debugC(kDebugLevelGC, "[GC] Running...");
+	s->_gc->collect(s);
+}
+
 } // End of namespace Sci
@@ -50,7 +50,7 @@ typedef Common::HashMap<reg_t, bool, reg_t_Hash> AddrSet;
 AddrSet *findAllActiveReferences(EngineState *s);
 
 /**
- * Runs garbage collection on the current system state
+ * Runs a complete garbage collection on the current system state
  * @param s The state in which we should gc
  */
 void run_gc(EngineState *s);
@@ -63,6 +63,92 @@ struct WorklistManager {
 	void pushArray(const Common::Array<reg_t> &tmp);
 };
 
+/**
+ * Incremental mark & sweep garbage collector.
+ *
+ * A cycle starts by greying the root set. The marking is then done in
+ * slices by step(), in the time the engine would otherwise spend sleeping
+ * between frames. While a cycle is marking, the segment manager records
+ * every reference stored into a heap object (see SegManager::writeBarrier())
+ * and every newly allocated object, and these are greyed by the next slice.
+ *
+ * Finishing a cycle scans the roots again, marks whatever is still grey and
+ * frees everything unmarked. Since references held by a running kernel
+ * function are invisible to the collector, this must only be done in
+ * between kernel calls.
+ */
+class GarbageCollector {
+public:
+	struct Stats {
+		uint32 cycles;          ///< Number of completed cycles
+		uint32 forcedCycles;    ///< Cycles which had to be finished before their marking was done
+		uint32 lastPause;       ///< Duration of the last pause, in ms
+		uint32 maxPause;        ///< Longest pause, in ms
+		uint32 totalPause;      ///< Time spent in pauses, in ms
+		uint32 totalStepTime;   ///< Time spent in incremental marking, in ms
+		uint32 lastMarkedInSteps;  ///< Objects scanned incrementally in the last cycle
+		uint32 lastMarkedInPause;  ///< Objects scanned during the pause of the last cycle
+		uint32 lastFreed;       ///< Objects freed by the last cycle
+		uint32 lastReclaimed;   ///< Bytes freed by the last cycle
+		uint32 totalFreed;
+		uint32 totalReclaimed;
+	};
+
+	GarbageCollector();
+
+	/**
+	 * Starts a new cycle by greying the root set.
+	 */
+	void startCycle(EngineState *s);
+
+	/**
+	 * Performs marking work of the current cycle until the given time has
+	 * passed or there is no more work to do. May be called at any time.
+	 * @param deadline	value of getMillis() at which to return
+	 */
+	void step(EngineState *s, uint32 deadline);
+
+	/**
+	 * Completes the marking of the current cycle and frees all unreachable
+	 * objects. Must only be called in between kernel calls.
+	 */
+	void finishCycle(EngineState *s);
+
+	/**
+	 * Runs a complete cycle, finishing the current one first if necessary.
+	 * Must only be called in between kernel calls.
+	 */
+	void collect(EngineState *s);
+
+	/**
+	 * Drops the current cycle without freeing anything, e.g. when the heap
+	 * is about to be replaced by a restored game.
+	 */
+	void abortCycle(SegManager *segMan);
+
+	/** Returns true if a cycle has been started and not finished yet. */
+	bool isMarking() const { return _marking; }
+
+	/** Returns true if the current cycle only waits to be finished. */
+	bool isMarkingDone() const { return _marking && _markingDone; }
+
+	const Stats &getStats() const { return _stats; }
+	void resetStats();
+
+private:
+	void takeBarrierRefs(SegManager *segMan);
+	void finish(EngineState *s);
+	void sweep(SegManager *segMan);
+	void recordPause(uint32 startTime);
+
+	WorklistManager _wm; ///< Grey objects and the mark set, kept between cycles
+	AddrSet _liveSet;    ///< Normalised mark set, kept between cycles
+	bool _marking;
+	bool _markingDone;
+	uint32 _markedInSteps;
+	Stats _stats;
+};
+
 
 } // End of namespace Sci
 
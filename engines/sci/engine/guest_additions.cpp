@@ -272,6 +272,9 @@ void GuestAdditions::instantiateScriptHook(Script &script, const bool ignoreDela
 			patchGameSaveRestoreSCI32(script);
 		}
 	}
+
+	// The patches rewrite code, which may already have been executed
+	script.invalidateInstructions();
 }
 
 void GuestAdditions::segManSaveLoadScriptHook(Script &script) const {
@@ -910,6 +913,7 @@ void GuestAdditions::syncMessageTypeFromScummVMUsingLSL6HiresStrategy() const {
 	// game scripts store a flag that restores the window when a game is
 	// restored
 	_state->variables[VAR_GLOBAL][kGlobalVarLSL6HiresRestoreTextWindow] = restore;
+	_segMan->writeBarrier(restore);
 	invokeSelector(_state->variables[VAR_GLOBAL][kGlobalVarLSL6HiresGameFlags], selector, 1, params);
 }
 #endif
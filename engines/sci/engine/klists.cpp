@@ -210,6 +210,7 @@ static void addToFront(EngineState *s, reg_t listRef, reg_t nodeRef) {
 
 	newNode->pred = NULL_REG;
 	newNode->succ = list->first;
+	s->_segMan->writeBarrier(list->first);
 
 	// Set node to be the first and last node if it's the only node of the list
 	if (list->first.isNull())
@@ -219,6 +220,7 @@ static void addToFront(EngineState *s, reg_t listRef, reg_t nodeRef) {
 		oldNode->pred = nodeRef;
 	}
 	list->first = nodeRef;
+	s->_segMan->writeBarrier(nodeRef);
 }
 
 static void addToEnd(EngineState *s, reg_t listRef, reg_t nodeRef) {
@@ -236,6 +238,7 @@ static void addToEnd(EngineState *s, reg_t listRef, reg_t nodeRef) {
 
 	newNode->pred = list->last;
 	newNode->succ = NULL_REG;
+	s->_segMan->writeBarrier(list->last);
 
 	// Set node to be the first and last node if it's the only node of the list
 	if (list->last.isNull())
@@ -245,6 +248,7 @@ static void addToEnd(EngineState *s, reg_t listRef, reg_t nodeRef) {
 		old_n->succ = nodeRef;
 	}
 	list->last = nodeRef;
+	s->_segMan->writeBarrier(nodeRef);
 }
 
 reg_t kNextNode(EngineState *s, int argc, reg_t *argv) {
@@ -285,8 +289,10 @@ reg_t kNodeValue(EngineState *s, int argc, reg_t *argv) {
 reg_t kAddToFront(EngineState *s, int argc, reg_t *argv) {
 	addToFront(s, argv[0], argv[1]);
 
-	if (argc == 3)
+	if (argc == 3) {
 		s->_segMan->lookupNode(argv[1])->key = argv[2];
+		s->_segMan->writeBarrier(argv[2]);
+	}
 
 	return s->r_acc;
 }
@@ -294,8 +300,10 @@ reg_t kAddToFront(EngineState *s, int argc, reg_t *argv) {
 reg_t kAddToEnd(EngineState *s, int argc, reg_t *argv) {
 	addToEnd(s, argv[0], argv[1]);
 
-	if (argc == 3)
+	if (argc == 3) {
 		s->_segMan->lookupNode(argv[1])->key = argv[2];
+		s->_segMan->writeBarrier(argv[2]);
+	}
 
 	return s->r_acc;
 }
@@ -319,8 +327,10 @@ reg_t kAddAfter(EngineState *s, int argc, reg_t *argv) {
 		return NULL_REG;
 	}
 
-	if (argc == 4)
+	if (argc == 4) {
 		newNode->key = argv[3];
+		s->_segMan->writeBarrier(argv[3]);
+	}
 
 	if (firstNode) { // We're really appending after
 		const reg_t oldNext = firstNode->succ;
@@ -328,6 +338,9 @@ reg_t kAddAfter(EngineState *s, int argc, reg_t *argv) {
 		newNode->pred = argv[1];
 		firstNode->succ = argv[2];
 		newNode->succ = oldNext;
+		s->_segMan->writeBarrier(argv[1]);
+		s->_segMan->writeBarrier(argv[2]);
+		s->_segMan->writeBarrier(oldNext);
 
 		if (oldNext.isNull())  // Appended after last node?
 			// Set new node as last list node
@@ -361,8 +374,10 @@ reg_t kAddBefore(EngineState *s, int argc, reg_t *argv) {
 		return NULL_REG;
 	}
 
-	if (argc == 4)
+	if (argc == 4) {
 		newNode->key = argv[3];
+		s->_segMan->writeBarrier(argv[3]);
+	}
 
 	if (firstNode) { // We're really appending before
 		const reg_t oldPred = firstNode->pred;
@@ -370,6 +385,9 @@ reg_t kAddBefore(EngineState *s, int argc, reg_t *argv) {
 		newNode->succ = argv[1];
 		firstNode->pred = argv[2];
 		newNode->pred = oldPred;
+		s->_segMan->writeBarrier(argv[1]);
+		s->_segMan->writeBarrier(argv[2]);
+		s->_segMan->writeBarrier(oldPred);
 
 		if (oldPred.isNull())  // Appended before first node?
 			// Set new node as first list node
@@ -431,6 +449,10 @@ reg_t kDeleteKey(EngineState *s, int argc, reg_t *argv) {
 	}
 #endif
 
+	// The neighbours may only be referenced by this node from now on
+	s->_segMan->writeBarrier(n->pred);
+	s->_segMan->writeBarrier(n->succ);
+
 	if (list->first == node_pos)
 		list->first = n->succ;
 	if (list->last == node_pos)
@@ -843,9 +865,25 @@ reg_t kArrayGetElement(EngineState *s, int argc, reg_t *argv) {
 	return array.getAsID(argv[1].toUint16());
 }
 
+/**
+ * Reports all references held by the given array to the write barrier of
+ * the garbage collector.
+ */
+static void arrayWriteBarrier(SegManager *segMan, SciArray &array) {
+	if (!segMan->isGCMarking())
+		return;
+
+	if (array.getType() == kArrayTypeID || array.getType() == kArrayTypeInt16) {
+		for (uint16 i = 0; i < array.size(); ++i)
+			segMan->writeBarrier(array.getAsID(i));
+	}
+}
+
 reg_t kArraySetElements(EngineState *s, int argc, reg_t *argv) {
 	SciArray &array = *s->_segMan->lookupArray(argv[0]);
 	array.setElements(argv[1].toUint16(), argc - 2, argv + 2);
+	for (int i = 2; i < argc; ++i)
+		s->_segMan->writeBarrier(argv[i]);
 	return argv[0];
 }
 
@@ -861,6 +899,7 @@ reg_t kArrayFree(EngineState *s, int argc, reg_t *argv) {
 reg_t kArrayFill(EngineState *s, int argc, reg_t *argv) {
 	SciArray &array = *s->_segMan->lookupArray(argv[0]);
 	array.fill(argv[1].toUint16(), argv[2].toUint16(), argv[3]);
+	s->_segMan->writeBarrier(argv[3]);
 	return argv[0];
 }
 
@@ -878,6 +917,7 @@ reg_t kArrayCopy(EngineState *s, int argc, reg_t *argv) {
 		target.copy(source, sourceIndex, targetIndex, count);
 	} else {
 		target.copy(*s->_segMan->lookupArray(argv[2]), sourceIndex, targetIndex, count);
+		arrayWriteBarrier(s->_segMan, target);
 	}
 
 	return argv[0];
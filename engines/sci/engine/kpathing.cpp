@@ -24,6 +24,7 @@
 #include "sci/engine/state.h"
 #include "sci/engine/selector.h"
 #include "sci/engine/kernel.h"
+#include "sci/engine/kpathing.h"
 #include "sci/graphics/paint16.h"
 #include "sci/graphics/palette.h"
 #include "sci/graphics/screen.h"
@@ -47,6 +48,12 @@ namespace Sci {
 
 #define AVOIDPATH_DYNMEM_STRING "AvoidPath polyline"
 
+// Number of polygon sets whose visibility graphs are kept
+#define AVOIDPATH_CACHE_SIZE 8
+
+// Size of the cells of the edge grid used for visibility tests
+#define VISIBILITY_GRID_CELL_SIZE 32
+
 #define POLY_LAST_POINT 0x7777
 #define POLY_POINT_SIZE 4
 
@@ -117,10 +124,14 @@ struct Vertex {
 	// Previous vertex in shortest path
 	Vertex *path_prev;
 
+	// Index in the visibility graph, or -1 if the vertex has no edges
+	int visIndex;
+
 public:
 	Vertex(const Common::Point &p) : v(p) {
 		costG = HUGE_DISTANCE;
 		path_prev = NULL;
+		visIndex = -1;
 	}
 };
 
@@ -242,11 +253,16 @@ public:
 
 typedef Common::List<Polygon *> PolygonList;
 
+struct VisibilityGraph;
+
 // Pathfinding state
 struct PathfindingState {
 	// List of all polygons
 	PolygonList polygons;
 
+	// Visibility graph of the polygons (owned by the AvoidPathCache)
+	VisibilityGraph *graph;
+
 	// Start and end points for pathfinding
 	Vertex *vertex_start, *vertex_end;
 
@@ -264,6 +280,7 @@ struct PathfindingState {
 	int _width, _height;
 
 	PathfindingState(int width, int height) : _width(width), _height(height) {
+		graph = NULL;
 		vertex_start = NULL;
 		vertex_end = NULL;
 		vertex_index = NULL;
@@ -668,6 +685,30 @@ static void fix_vertex_order(Polygon *polygon) {
 	}
 }
 
+/**
+ * Determines whether or not a line from a point to a vertex intersects the
+ * interior of the polygon, locally at that vertex
+ * Parameters: (Common::Point) p: The point
+ *             (Common::Point) prev, cur, next: The vertex and its neighbours
+ * Returns   : (int) 1 if the line (p, cur) intersects the interior of
+ *                   the polygon, locally at the vertex. 0 otherwise
+ */
+static int inside(const Common::Point &p, const Common::Point &prev, const Common::Point &cur, const Common::Point &next) {
+	if (left(prev, cur, next)) {
+		// Convex vertex, line (p, cur) intersects the inside
+		// if p is located left of both edges
+		if (left(cur, next, p) && left(prev, cur, p))
+			return 1;
+	} else {
+		// Non-convex vertex, line (p, cur) intersects the
+		// inside if p is located left of either edge
+		if (left(cur, next, p) || left(prev, cur, p))
+			return 1;
+	}
+
+	return 0;
+}
+
 /**
  * Determines whether or not a line from a point to a vertex intersects the
  * interior of the polygon, locally at that vertex
@@ -678,63 +719,311 @@ static void fix_vertex_order(Polygon *polygon) {
  */
 static int inside(const Common::Point &p, Vertex *vertex) {
 	// Check that it's not a single-vertex polygon
-	if (VERTEX_HAS_EDGES(vertex)) {
-		const Common::Point &prev = CLIST_PREV(vertex)->v;
-		const Common::Point &next = CLIST_NEXT(vertex)->v;
-		const Common::Point &cur = vertex->v;
-
-		if (left(prev, cur, next)) {
-			// Convex vertex, line (p, cur) intersects the inside
-			// if p is located left of both edges
-			if (left(cur, next, p) && left(prev, cur, p))
-				return 1;
-		} else {
-			// Non-convex vertex, line (p, cur) intersects the
-			// inside if p is located left of either edge
-			if (left(cur, next, p) || left(prev, cur, p))
-				return 1;
-		}
-	}
+	if (VERTEX_HAS_EDGES(vertex))
+		return inside(p, CLIST_PREV(vertex)->v, vertex->v, CLIST_NEXT(vertex)->v);
 
 	return 0;
 }
 
 /**
- * Returns a list of all vertices that are visible from a particular vertex.
- * @param s				the pathfinding state
- * @param vertex_cur	the vertex
- * @return list of vertices that are visible from vert
+ * Visibility graph of the vertices of a polygon set that have edges. The
+ * visibility of two such vertices only depends on the edges of the set, so
+ * the graph can be reused by every pathfinding request on the same set.
+ * Vertices without edges, like the start and end points, are tested against
+ * the edges for each request.
  */
-static VertexList *visible_vertices(PathfindingState *s, Vertex *vertex_cur) {
-	VertexList *visVerts = new VertexList();
+struct VisibilityGraph {
+	struct GraphVertex {
+		Common::Point prev, cur, next;
+	};
+
+	// Geometry of the polygon set, see computeSignature()
+	Common::Array<int16> signature;
+
+	// Vertices with edges, the edge of a vertex ends at its next vertex
+	Common::Array<GraphVertex> vertices;
+
+	// Visibility matrix with one bit per pair of vertices. A row is
+	// computed when its vertex is expanded by A* for the first time.
+	uint rowWords;
+	Common::Array<uint32> visibility;
+	Common::Array<bool> rowDone;
+
+	// Uniform grid of the edges, used to only test edges near a line
+	int gridLeft, gridTop;
+	int gridWidth, gridHeight;
+	Common::Array<uint> cellStart;
+	Common::Array<uint> cellEdges;
+	Common::Array<uint> edgeStamp;
+	uint stamp;
+
+	VisibilityGraph(const Common::Array<int16> &sig, const PathfindingState *s);
+
+	bool isVisible(uint from, uint to);
+	bool isBlocked(const Common::Point &a, const Common::Point &b);
+
+private:
+	void computeRow(uint from);
+	void findCells(const Common::Point &a, const Common::Point &b, int &x1, int &y1, int &x2, int &y2) const;
+};
 
+VisibilityGraph::VisibilityGraph(const Common::Array<int16> &sig, const PathfindingState *s) : signature(sig), stamp(0) {
 	for (int i = 0; i < s->vertices; i++) {
-		Vertex *vertex = s->vertex_index[i];
+		const Vertex *vertex = s->vertex_index[i];
+
+		if (vertex->visIndex >= 0) {
+			assert((uint)vertex->visIndex == vertices.size());
+			GraphVertex graphVertex;
+			graphVertex.prev = CLIST_PREV(vertex)->v;
+			graphVertex.cur = vertex->v;
+			graphVertex.next = CLIST_NEXT(vertex)->v;
+			vertices.push_back(graphVertex);
+		}
+	}
 
-		// Make sure we don't intersect a polygon locally at the vertices
-		if ((vertex == vertex_cur) || (inside(vertex->v, vertex_cur)) || (inside(vertex_cur->v, vertex)))
-			continue;
+	rowWords = (vertices.size() + 31) / 32;
+	visibility.resize(rowWords * vertices.size());
+	rowDone.resize(vertices.size());
+	for (uint i = 0; i < vertices.size(); i++)
+		rowDone[i] = false;
 
-		// Check for intersecting edges
-		int j;
-		for (j = 0; j < s->vertices; j++) {
-			Vertex *edge = s->vertex_index[j];
-			if (VERTEX_HAS_EDGES(edge)) {
-				if (between(vertex_cur->v, vertex->v, edge->v)) {
+	gridLeft = gridTop = 0;
+	gridWidth = gridHeight = 0;
+
+	if (vertices.empty())
+		return;
+
+	// The edges connect vertices, so their bounding box is the grid area
+	int right = gridLeft = vertices[0].cur.x;
+	int bottom = gridTop = vertices[0].cur.y;
+	for (uint i = 1; i < vertices.size(); i++) {
+		gridLeft = MIN<int>(gridLeft, vertices[i].cur.x);
+		gridTop = MIN<int>(gridTop, vertices[i].cur.y);
+		right = MAX<int>(right, vertices[i].cur.x);
+		bottom = MAX<int>(bottom, vertices[i].cur.y);
+	}
+	gridWidth = (right - gridLeft) / VISIBILITY_GRID_CELL_SIZE + 1;
+	gridHeight = (bottom - gridTop) / VISIBILITY_GRID_CELL_SIZE + 1;
+
+	// Add each edge to all cells covered by its bounding box
+	cellStart.resize(gridWidth * gridHeight + 1);
+	for (uint i = 0; i < cellStart.size(); i++)
+		cellStart[i] = 0;
+
+	for (uint e = 0; e < vertices.size(); e++) {
+		int x1, y1, x2, y2;
+		findCells(vertices[e].cur, vertices[e].next, x1, y1, x2, y2);
+		for (int y = y1; y <= y2; y++)
+			for (int x = x1; x <= x2; x++)
+				cellStart[y * gridWidth + x + 1]++;
+	}
+
+	for (uint i = 1; i < cellStart.size(); i++)
+		cellStart[i] += cellStart[i - 1];
+
+	Common::Array<uint> fill(cellStart.begin(), cellStart.size() - 1);
+	cellEdges.resize(cellStart.back());
+	for (uint e = 0; e < vertices.size(); e++) {
+		int x1, y1, x2, y2;
+		findCells(vertices[e].cur, vertices[e].next, x1, y1, x2, y2);
+		for (int y = y1; y <= y2; y++)
+			for (int x = x1; x <= x2; x++)
+				cellEdges[fill[y * gridWidth + x]++] = e;
+	}
+
+	edgeStamp.resize(vertices.size());
+	for (uint e = 0; e < edgeStamp.size(); e++)
+		edgeStamp[e] = 0;
+}
+
+/**
+ * Computes the range of grid cells covered by the bounding box of a line
+ * segment, clipped to the grid
+ */
+void VisibilityGraph::findCells(const Common::Point &a, const Common::Point &b, int &x1, int &y1, int &x2, int &y2) const {
+	x1 = CLIP<int>((MIN(a.x, b.x) - gridLeft) / VISIBILITY_GRID_CELL_SIZE, 0, gridWidth - 1);
+	y1 = CLIP<int>((MIN(a.y, b.y) - gridTop) / VISIBILITY_GRID_CELL_SIZE, 0, gridHeight - 1);
+	x2 = CLIP<int>((MAX(a.x, b.x) - gridLeft) / VISIBILITY_GRID_CELL_SIZE, 0, gridWidth - 1);
+	y2 = CLIP<int>((MAX(a.y, b.y) - gridTop) / VISIBILITY_GRID_CELL_SIZE, 0, gridHeight - 1);
+}
+
+/**
+ * Determines whether or not the line segment between two points is
+ * obstructed by an edge of the polygon set
+ * Parameters: (const Common::Point &) a, b: The line segment (a, b)
+ * Returns   : (bool) true if an edge obstructs the line segment
+ */
+bool VisibilityGraph::isBlocked(const Common::Point &a, const Common::Point &b) {
+	// Edges outside of the bounding box of (a, b) can neither intersect
+	// it nor have a vertex on it
+	if (vertices.empty()
+	        || MAX(a.x, b.x) < gridLeft || MIN(a.x, b.x) >= gridLeft + gridWidth * VISIBILITY_GRID_CELL_SIZE
+	        || MAX(a.y, b.y) < gridTop || MIN(a.y, b.y) >= gridTop + gridHeight * VISIBILITY_GRID_CELL_SIZE)
+		return false;
+
+	int x1, y1, x2, y2;
+	findCells(a, b, x1, y1, x2, y2);
+
+	// Edges may be in several cells, only test them once
+	if (++stamp == 0) {
+		for (uint e = 0; e < edgeStamp.size(); e++)
+			edgeStamp[e] = 0;
+		stamp = 1;
+	}
+
+	for (int y = y1; y <= y2; y++) {
+		for (int x = x1; x <= x2; x++) {
+			const uint cell = y * gridWidth + x;
+
+			for (uint i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+				const uint e = cellEdges[i];
+				if (edgeStamp[e] == stamp)
+					continue;
+				edgeStamp[e] = stamp;
+
+				const GraphVertex &edge = vertices[e];
+				if (between(a, b, edge.cur)) {
 					// If we hit a vertex, make sure we can pass through it without intersecting its polygon
-					if ((inside(vertex_cur->v, edge)) || (inside(vertex->v, edge)))
-						break;
+					if (inside(a, edge.prev, edge.cur, edge.next) || inside(b, edge.prev, edge.cur, edge.next))
+						return true;
 
 					// This edge won't properly intersect, so we continue
 					continue;
 				}
 
-				if (intersect_proper(vertex_cur->v, vertex->v, edge->v, CLIST_NEXT(edge)->v))
-					break;
+				if (intersect_proper(a, b, edge.cur, edge.next))
+					return true;
 			}
 		}
+	}
+
+	return false;
+}
+
+void VisibilityGraph::computeRow(uint from) {
+	const GraphVertex &cur = vertices[from];
+	uint32 *row = &visibility[from * rowWords];
+
+	for (uint to = 0; to < vertices.size(); to++) {
+		bool visible;
+
+		if (to == from) {
+			visible = false;
+		} else if (rowDone[to]) {
+			// Visibility is symmetric
+			visible = (visibility[to * rowWords + from / 32] >> (from % 32)) & 1;
+		} else {
+			const GraphVertex &vertex = vertices[to];
+
+			// Make sure we don't intersect a polygon locally at the vertices
+			visible = !inside(vertex.cur, cur.prev, cur.cur, cur.next)
+			          && !inside(cur.cur, vertex.prev, vertex.cur, vertex.next)
+			          && !isBlocked(cur.cur, vertex.cur);
+		}
+
+		if (visible)
+			row[to / 32] |= 1u << (to % 32);
+		else
+			row[to / 32] &= ~(1u << (to % 32));
+	}
+
+	rowDone[from] = true;
+}
+
+bool VisibilityGraph::isVisible(uint from, uint to) {
+	if (!rowDone[from])
+		computeRow(from);
+
+	return (visibility[from * rowWords + to / 32] >> (to % 32)) & 1;
+}
+
+AvoidPathCache::~AvoidPathCache() {
+	for (Common::List<VisibilityGraph *>::iterator it = _graphs.begin(); it != _graphs.end(); ++it)
+		delete *it;
+}
+
+VisibilityGraph *AvoidPathCache::find(const Common::Array<int16> &signature) {
+	for (Common::List<VisibilityGraph *>::iterator it = _graphs.begin(); it != _graphs.end(); ++it) {
+		VisibilityGraph *graph = *it;
+
+		if (graph->signature == signature) {
+			_graphs.erase(it);
+			_graphs.push_front(graph);
+			return graph;
+		}
+	}
+
+	return NULL;
+}
+
+void AvoidPathCache::add(VisibilityGraph *graph) {
+	if (_graphs.size() >= AVOIDPATH_CACHE_SIZE) {
+		delete _graphs.back();
+		_graphs.pop_back();
+	}
+
+	_graphs.push_front(graph);
+}
+
+/**
+ * Numbers the vertices of the polygon set that have edges, and describes
+ * the geometry of these vertices and their edges.
+ * Parameters: (PathfindingState *) s: The pathfinding state
+ *             (Common::Array<int16> &) signature: The geometry description
+ */
+static void computeSignature(PathfindingState *s, Common::Array<int16> &signature) {
+	int index = 0;
+
+	for (PolygonList::iterator it = s->polygons.begin(); it != s->polygons.end(); ++it) {
+		Polygon *polygon = *it;
+		Vertex *vertex;
+
+		if (!VERTEX_HAS_EDGES(polygon->vertices.first()))
+			continue;
 
-		if (j == s->vertices)
+		signature.push_back(polygon->vertices.size());
+		CLIST_FOREACH(vertex, &polygon->vertices) {
+			vertex->visIndex = index++;
+			signature.push_back(vertex->v.x);
+			signature.push_back(vertex->v.y);
+		}
+	}
+}
+
+/**
+ * Determines whether or not one vertex is visible from another one
+ * Parameters: (PathfindingState *) s: The pathfinding state
+ *             (Vertex *) from, to: The vertices
+ * Returns   : (bool) true if the vertices are different and visible from
+ *                    each other
+ */
+static bool isVisible(PathfindingState *s, Vertex *from, Vertex *to) {
+	if (from == to)
+		return false;
+
+	if (from->visIndex >= 0 && to->visIndex >= 0)
+		return s->graph->isVisible(from->visIndex, to->visIndex);
+
+	// Make sure we don't intersect a polygon locally at the vertices
+	if (inside(to->v, from) || inside(from->v, to))
+		return false;
+
+	return !s->graph->isBlocked(from->v, to->v);
+}
+
+/**
+ * Returns a list of all vertices that are visible from a particular vertex.
+ * @param s				the pathfinding state
+ * @param vertex_cur	the vertex
+ * @return list of vertices that are visible from vert
+ */
+static VertexList *visible_vertices(PathfindingState *s, Vertex *vertex_cur) {
+	VertexList *visVerts = new VertexList();
+
+	for (int i = 0; i < s->vertices; i++) {
+		Vertex *vertex = s->vertex_index[i];
+
+		if (isVisible(s, vertex_cur, vertex))
 			visVerts->push_front(vertex);
 	}
 
@@ -1345,6 +1634,17 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
 
 	pf_s->vertices = count;
 
+	// The visibility of vertices only depends on the final polygon set,
+	// after the start and end points have been taken care of
+	Common::Array<int16> signature;
+	computeSignature(pf_s, signature);
+
+	pf_s->graph = s->_avoidPathCache->find(signature);
+	if (!pf_s->graph) {
+		pf_s->graph = new VisibilityGraph(signature, pf_s);
+		s->_avoidPathCache->add(pf_s->graph);
+	}
+
 	return pf_s;
 }
 
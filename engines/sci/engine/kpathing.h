@@ -0,0 +1,63 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef SCI_ENGINE_KPATHING_H
+#define SCI_ENGINE_KPATHING_H
+
+#include "common/array.h"
+#include "common/list.h"
+
+namespace Sci {
+
+struct VisibilityGraph;
+
+/**
+ * Keeps the visibility graphs of the polygon sets most recently used by
+ * kAvoidPath. Actors find paths through the same polygons many times per
+ * second, and most of the pathfinding time is spent on visibility tests
+ * which only depend on the polygons themselves.
+ */
+class AvoidPathCache {
+public:
+	~AvoidPathCache();
+
+	/**
+	 * Looks up the graph of a polygon set. A graph that is found becomes
+	 * the most recently used one.
+	 * @param signature	the geometry of the polygon set
+	 * @return the graph, or NULL if it is not cached
+	 */
+	VisibilityGraph *find(const Common::Array<int16> &signature);
+
+	/**
+	 * Adds a graph to the cache, dropping the least recently used one if
+	 * the cache is full. The cache takes ownership of the graph.
+	 */
+	void add(VisibilityGraph *graph);
+
+private:
+	Common::List<VisibilityGraph *> _graphs;
+};
+
+} // End of namespace Sci
+
+#endif // SCI_ENGINE_KPATHING_H
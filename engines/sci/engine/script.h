@@ -69,6 +69,15 @@ struct offsetLookupArrayEntry {
 
 typedef Common::Array<offsetLookupArrayEntry> offsetLookupArrayType;
 
+/**
+ * A decoded PMachine instruction, as returned by readPMachineInstruction().
+ */
+struct PMachineInstruction {
+	int16 opparams[4];
+	uint16 size;     ///< Length of the instruction in bytes
+	byte extOpcode;
+};
+
 class Script : public SegmentObj {
 private:
 	int _nr; /**< Script number */
@@ -102,6 +111,19 @@ private:
 	uint16 _offsetLookupStringCount;
 	uint16 _offsetLookupSaidCount;
 
+	/**
+	 * Instructions that have been executed at least once, so that code
+	 * which runs repeatedly only gets decoded once. Code and data are
+	 * interleaved in scripts, so this is filled in as the code runs.
+	 * _instructionIndex maps each offset in the buffer to its entry in
+	 * _instructions plus one, or to 0 if it hasn't been decoded yet.
+	 */
+	Common::Array<uint16> _instructionIndex;
+	Common::Array<PMachineInstruction> _instructions;
+	PMachineInstruction _uncachedInstruction;
+
+	const PMachineInstruction &decodeInstruction(uint32 offset);
+
 public:
 	int getLocalsOffset() const { return _localsOffset; }
 	uint16 getLocalsCount() const { return _localsCount; }
@@ -118,6 +140,26 @@ public:
 	}
 
 	const byte *getBuf(uint offset = 0) const { return _buf->getUnsafeDataAt(offset); }
+
+	/**
+	 * Returns the instruction at the given offset, decoding it if this is
+	 * the first time it is executed. The reference is only valid until the
+	 * next instruction of this script is decoded.
+	 */
+	const PMachineInstruction &getInstruction(uint32 offset) {
+		if (offset < _instructionIndex.size()) {
+			const uint16 index = _instructionIndex[offset];
+			if (index)
+				return _instructions[index - 1];
+		}
+		return decodeInstruction(offset);
+	}
+
+	/**
+	 * Forgets all decoded instructions. Needs to be called whenever the
+	 * code of the script is changed.
+	 */
+	void invalidateInstructions();
 	SciSpan<const byte> getSpan(uint offset) const { return _buf->subspan(offset); }
 
 	int getScriptNumber() const { return _nr; }
@@ -43,6 +43,8 @@ SegManager::SegManager(ResourceManager *resMan, ScriptPatcher *scriptPatcher)
 	_saveDirPtr = NULL_REG;
 	_parserPtr = NULL_REG;
 
+	_gcMarking = false;
+
 #ifdef ENABLE_SCI32
 	_arraysSegId = 0;
 	_bitmapSegId = 0;
@@ -77,6 +79,11 @@ void SegManager::resetSegMan() {
 	_bitmapSegId = 0;
 #endif
 
+	// Any collection in progress referred to the old heap
+	_gcMarking = false;
+	_gcBarrierRefs.clear();
+	_gcAllocations.clear();
+
 	// Reinitialize class table
 	_classTable.clear();
 	createClassTable();
@@ -414,6 +421,7 @@ reg_t SegManager::allocateHunkEntry(const char *hunk_type, int size) {
 	h->size = size;
 	h->type = hunk_type;
 
+	gcAllocated(addr);
 	return addr;
 }
 
@@ -440,6 +448,7 @@ Clone *SegManager::allocateClone(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_clonesSegId, offset);
+	gcAllocated(*addr);
 	return &table->at(offset);
 }
 
@@ -454,6 +463,7 @@ List *SegManager::allocateList(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_listsSegId, offset);
+	gcAllocated(*addr);
 	return &table->at(offset);
 }
 
@@ -468,6 +478,7 @@ Node *SegManager::allocateNode(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_nodesSegId, offset);
+	gcAllocated(*addr);
 	return &table->at(offset);
 }
 
@@ -866,6 +877,7 @@ byte *SegManager::allocDynmem(int size, const char *descr, reg_t *addr) {
 
 	d._description = descr;
 
+	gcAllocated(*addr);
 	return (byte *)(d._buf);
 }
 
@@ -899,6 +911,8 @@ SciArray *SegManager::allocateArray(SciArrayType type, uint16 size, reg_t *addr)
 	SciArray *array = &table->at(offset);
 	array->setType(type);
 	array->resize(size);
+
+	gcAllocated(*addr);
 	return array;
 }
 
@@ -955,6 +969,7 @@ SciBitmap *SegManager::allocateBitmap(reg_t *addr, const int16 width, const int1
 
 	bitmap.create(width, height, skipColor, originX, originY, xResolution, yResolution, paletteSize, remap, gc);
 
+	gcAllocated(*addr);
 	return &bitmap;
 }
 
@@ -1050,6 +1065,13 @@ int SegManager::instantiateScript(int scriptNum, bool applyScriptPatches) {
 	g_sci->_guestAdditions->instantiateScriptHook(*scr);
 #endif
 
+	// Games set the new room number before loading the room's script, which
+	// makes this the earliest point at which we know the resources of the
+	// next room. These then get loaded while the engine is idle.
+	EngineState *s = g_sci->getEngineState();
+	if (s && s->variables[VAR_GLOBAL] && scriptNum == s->currentRoomNumber())
+		_resMan->prefetchRoom(scriptNum);
+
 	return segmentId;
 }
 
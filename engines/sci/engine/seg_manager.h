@@ -48,6 +48,7 @@ class Script;
 
 class SegManager : public Common::Serializable {
 	friend class Console;
+	friend class GarbageCollector;
 public:
 	/**
 	 * Initialize the segment manager.
@@ -458,7 +459,35 @@ public:
 
 	const Common::Array<SegmentObj *> &getSegments() const { return _heap; }
 
+	/**
+	 * Write barrier of the incremental garbage collector. Every reference
+	 * stored into a heap object (object variables, locals, list nodes and
+	 * arrays) has to be reported here, so that a collection which is
+	 * currently marking does not lose objects that are only reachable
+	 * through objects it has already scanned.
+	 * @param value		the reference being stored
+	 */
+	void writeBarrier(reg_t value) {
+		if (_gcMarking && value.getSegment())
+			_gcBarrierRefs.push_back(value);
+	}
+
+	/**
+	 * Returns true while a garbage collection is marking, i.e. while
+	 * stores have to be reported through writeBarrier().
+	 */
+	bool isGCMarking() const { return _gcMarking; }
+
 private:
+	/**
+	 * Reports a freshly allocated heap object to a marking garbage
+	 * collection, which has to scan it before the cycle may finish.
+	 */
+	void gcAllocated(reg_t addr) {
+		if (_gcMarking)
+			_gcAllocations.push_back(addr);
+	}
+
 	Common::Array<SegmentObj *> _heap;
 	Common::Array<Class> _classTable; /**< Table of all classes */
 	/** Map script ids to segment ids. */
@@ -481,6 +510,11 @@ private:
 	SegmentId _bitmapSegId;
 #endif
 
+	// State shared with the garbage collector
+	bool _gcMarking;
+	Common::Array<reg_t> _gcBarrierRefs; ///< References stored while marking
+	Common::Array<reg_t> _gcAllocations; ///< Objects allocated while marking
+
 public:
 	SegmentObj *allocSegment(SegmentObj *mem, SegmentId *segid);
 
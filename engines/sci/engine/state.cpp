@@ -24,8 +24,10 @@
 #include "sci/sci.h"	// for INCLUDE_OLDGFX
 #include "sci/debug.h"	// for g_debug_sleeptime_factor
 #include "sci/engine/file.h"
+#include "sci/engine/gc.h"
 #include "sci/engine/guest_additions.h"
 #include "sci/engine/kernel.h"
+#include "sci/engine/kpathing.h"
 #include "sci/engine/state.h"
 #include "sci/engine/selector.h"
 #include "sci/engine/vm.h"
@@ -68,13 +70,23 @@ static const uint16 s_halfWidthSJISMap[256] = {
 
 EngineState::EngineState(SegManager *segMan)
 : _segMan(segMan),
-	_dirseeker() {
+	_dirseeker(),
+	_gc(new GarbageCollector()),
+	_avoidPathCache(new AvoidPathCache()) {
+
+	// Nothing points to the globals until script 0 is loaded by initGlobals
+	for (int i = 0; i < 4; i++) {
+		variables[i] = nullptr;
+		variablesBase[i] = nullptr;
+	}
 
 	reset(false);
 }
 
 EngineState::~EngineState() {
 	delete _msgState;
+	delete _gc;
+	delete _avoidPathCache;
 }
 
 void EngineState::reset(bool isRestoring) {
@@ -100,6 +112,7 @@ void EngineState::reset(bool isRestoring) {
 	lastWaitTime = 0;
 
 	gcCountDown = 0;
+	_gc->abortCycle(_segMan);
 
 #ifdef ENABLE_SCI32
 	_eventCounter = 0;
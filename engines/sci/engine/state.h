@@ -44,8 +44,10 @@ class WriteStream;
 namespace Sci {
 
 class FileHandle;
+class AvoidPathCache;
 class DirSeeker;
 class EventManager;
+class GarbageCollector;
 class MessageState;
 class SoundCommandParser;
 class VirtualIndexFile;
@@ -190,6 +192,9 @@ public:
 	void shrinkStackToBase();
 
 	int gcCountDown; /**< Number of kernel calls until next gc */
+	GarbageCollector *_gc;
+
+	AvoidPathCache *_avoidPathCache; /**< Visibility graphs of recent kAvoidPath polygon sets */
 
 	MessageState *_msgState;
 
@@ -25,6 +25,7 @@
 #include "common/file.h"
 #include "common/fs.h"
 #include "common/macresman.h"
+#include "common/system.h"
 #include "common/textconsole.h"
 #include "common/translation.h"
 #ifdef ENABLE_SCI32
@@ -206,6 +207,9 @@ Resource::Resource(ResourceManager *resMan, ResourceId id) : SciSpan<const byte>
 	_fileOffset = 0;
 	_status = kResStatusNoMalloc;
 	_lockers = 0;
+	_lruPrev = nullptr;
+	_lruNext = nullptr;
+	_prefetched = false;
 	_source = nullptr;
 	_header = nullptr;
 	_headerSize = 0;
@@ -972,7 +976,12 @@ void ResourceManager::init() {
 	_maxMemoryLRU = 256 * 1024; // 256KiB
 	_memoryLocked = 0;
 	_memoryLRU = 0;
-	_LRU.clear();
+	_lruFirst = nullptr;
+	_lruLast = nullptr;
+	_cacheStats = CacheStats();
+	_roomResources.clear();
+	_currentRoom = -1;
+	_prefetchQueue.clear();
 	_resMap.clear();
 	_audioMapSCI1 = NULL;
 #ifdef ENABLE_SCI32
@@ -1078,17 +1087,45 @@ void ResourceManager::removeFromLRU(Resource *res) {
 		warning("resMan: trying to remove resource that isn't enqueued");
 		return;
 	}
-	_LRU.remove(res);
+
+	if (res->_lruPrev)
+		res->_lruPrev->_lruNext = res->_lruNext;
+	else
+		_lruFirst = res->_lruNext;
+
+	if (res->_lruNext)
+		res->_lruNext->_lruPrev = res->_lruPrev;
+	else
+		_lruLast = res->_lruPrev;
+
+	res->_lruPrev = res->_lruNext = nullptr;
 	_memoryLRU -= res->size();
 	res->_status = kResStatusAllocated;
 }
 
-void ResourceManager::addToLRU(Resource *res) {
+void ResourceManager::addToLRU(Resource *res, bool leastRecent) {
 	if (res->_status != kResStatusAllocated) {
 		warning("resMan: trying to enqueue resource with state %d", res->_status);
 		return;
 	}
-	_LRU.push_front(res);
+
+	if (leastRecent) {
+		res->_lruPrev = _lruLast;
+		res->_lruNext = nullptr;
+		if (_lruLast)
+			_lruLast->_lruNext = res;
+		else
+			_lruFirst = res;
+		_lruLast = res;
+	} else {
+		res->_lruPrev = nullptr;
+		res->_lruNext = _lruFirst;
+		if (_lruFirst)
+			_lruFirst->_lruPrev = res;
+		else
+			_lruLast = res;
+		_lruFirst = res;
+	}
 	_memoryLRU += res->size();
 #if SCI_VERBOSE_RESMAN
 	debug("Adding %s (%d bytes) to lru control: %d bytes total",
@@ -1101,15 +1138,11 @@ void ResourceManager::addToLRU(Resource *res) {
 void ResourceManager::printLRU() {
 	int mem = 0;
 	int entries = 0;
-	Common::List<Resource *>::iterator it = _LRU.begin();
-	Resource *res;
 
-	while (it != _LRU.end()) {
-		res = *it;
+	for (Resource *res = _lruFirst; res; res = res->_lruNext) {
 		debug("\t%s: %u bytes", res->_id.toString().c_str(), res->size());
 		mem += res->size();
 		++entries;
-		++it;
 	}
 
 	debug("Total: %d entries, %d bytes (mgr says %d)", entries, mem, _memoryLRU);
@@ -1117,10 +1150,12 @@ void ResourceManager::printLRU() {
 
 void ResourceManager::freeOldResources() {
 	while (_maxMemoryLRU < _memoryLRU) {
-		assert(!_LRU.empty());
-		Resource *goner = _LRU.back();
+		assert(_lruLast);
+		Resource *goner = _lruLast;
 		removeFromLRU(goner);
 		goner->unalloc();
+		goner->_prefetched = false;
+		_cacheStats.evictions++;
 #ifdef SCI_VERBOSE_RESMAN
 		debug("resMan-debug: LRU: Freeing %s (%d bytes)", goner->_id.toString().c_str(), goner->size);
 #endif
@@ -1152,9 +1187,19 @@ Resource *ResourceManager::findResource(ResourceId id, bool lock) {
 	if (!retval)
 		return NULL;
 
-	if (retval->_status == kResStatusNoMalloc)
+	if (retval->_status == kResStatusNoMalloc) {
+		_cacheStats.misses++;
 		loadResource(retval);
-	else if (retval->_status == kResStatusEnqueued)
+		rememberRoomResource(retval->_id);
+	} else {
+		_cacheStats.hits++;
+		if (retval->_prefetched) {
+			_cacheStats.prefetchHits++;
+			retval->_prefetched = false;
+		}
+	}
+
+	if (retval->_status == kResStatusEnqueued)
 		// The resource is removed from its current position
 		// in the LRU list because it has been requested
 		// again. Below, it will either be locked, or it
@@ -1204,6 +1249,71 @@ void ResourceManager::unlockResource(Resource *res) {
 	freeOldResources();
 }
 
+void ResourceManager::rememberRoomResource(const ResourceId &id) {
+	if (_currentRoom == -1)
+		return;
+
+	switch (id.getType()) {
+	case kResourceTypeView:
+	case kResourceTypePic:
+	case kResourceTypePalette:
+		break;
+	default:
+		return;
+	}
+
+	Common::Array<ResourceId> &resources = _roomResources[_currentRoom];
+	if (resources.size() >= kMaxRoomResources)
+		return;
+
+	for (uint i = 0; i < resources.size(); ++i) {
+		if (resources[i] == id)
+			return;
+	}
+	resources.push_back(id);
+}
+
+void ResourceManager::prefetchRoom(uint16 roomNumber) {
+	_currentRoom = roomNumber;
+	_prefetchQueue.clear();
+
+	// Rooms usually come with a pic, palette and view of the same number
+	_prefetchQueue.push(ResourceId(kResourceTypePic, roomNumber));
+	_prefetchQueue.push(ResourceId(kResourceTypePalette, roomNumber));
+	_prefetchQueue.push(ResourceId(kResourceTypeView, roomNumber));
+
+	RoomResourceMap::const_iterator it = _roomResources.find(roomNumber);
+	if (it != _roomResources.end()) {
+		const Common::Array<ResourceId> &resources = it->_value;
+		for (uint i = 0; i < resources.size(); ++i)
+			_prefetchQueue.push(resources[i]);
+	}
+}
+
+void ResourceManager::processPrefetch(uint32 deadline) {
+	while (!_prefetchQueue.empty() && (int32)(deadline - g_system->getMillis()) > 0) {
+		Resource *res = testResource(_prefetchQueue.pop());
+		if (!res || res->_status != kResStatusNoMalloc)
+			continue;
+
+		loadResource(res);
+		if (res->_status != kResStatusAllocated)
+			continue;
+
+		if (_memoryLRU + (int)res->size() > _maxMemoryLRU) {
+			// Out of room, and prefetching is not worth evicting anything
+			res->unalloc();
+			_prefetchQueue.clear();
+			break;
+		}
+
+		// Prefetched resources are the first to go if memory gets tight
+		res->_prefetched = true;
+		addToLRU(res, true);
+		_cacheStats.prefetched++;
+	}
+}
+
 const char *ResourceManager::versionDescription(ResVersion version) const {
 	switch (version) {
 	case kResVersionUnknown:
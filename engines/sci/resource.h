@@ -23,8 +23,10 @@
 #ifndef SCI_RESOURCE_H
 #define SCI_RESOURCE_H
 
+#include "common/array.h"
 #include "common/str.h"
 #include "common/list.h"
+#include "common/queue.h"
 #include "common/hashmap.h"
 
 #include "sci/graphics/helpers.h"		// for ViewType
@@ -296,6 +298,9 @@ protected:
 	int32 _fileOffset; /**< Offset in file */
 	ResourceStatus _status;
 	uint16 _lockers; /**< Number of places where this resource was locked */
+	Resource *_lruPrev; /**< More recently used neighbour in the LRU list */
+	Resource *_lruNext; /**< Less recently used neighbour in the LRU list */
+	bool _prefetched; /**< Loaded ahead of time and not requested since */
 	ResourceSource *_source;
 	ResourceManager *_resMan;
 
@@ -380,6 +385,40 @@ public:
 	 */
 	Resource *testResource(ResourceId id);
 
+	/**
+	 * Resource cache counters, shown by the "resource_cache" console command.
+	 */
+	struct CacheStats {
+		uint32 hits;         ///< Requests for resources that were already in memory
+		uint32 misses;       ///< Requests that had to load the resource
+		uint32 evictions;    ///< Resources freed to stay within the LRU memory limit
+		uint32 prefetched;   ///< Resources loaded ahead of time
+		uint32 prefetchHits; ///< Requests served by a prefetched resource
+
+		CacheStats() : hits(0), misses(0), evictions(0), prefetched(0), prefetchHits(0) {}
+	};
+
+	const CacheStats &getCacheStats() const { return _cacheStats; }
+	void resetCacheStats() { _cacheStats = CacheStats(); }
+	int getMemoryLRU() const { return _memoryLRU; }
+	int getMaxMemoryLRU() const { return _maxMemoryLRU; }
+	int getMemoryLocked() const { return _memoryLocked; }
+
+	/**
+	 * Queues the pic, palette and view resources of a room for loading ahead
+	 * of time. These are the ones sharing the room's number, plus the ones
+	 * that were loaded during earlier visits to the room.
+	 */
+	void prefetchRoom(uint16 roomNumber);
+
+	/**
+	 * Loads queued resources, until the queue is empty, the deadline has
+	 * passed or the LRU memory limit is reached. Prefetching never evicts
+	 * anything.
+	 * @param deadline	Time (as in OSystem::getMillis) at which to stop
+	 */
+	void processPrefetch(uint32 deadline);
+
 	/**
 	 * Returns a list of all resources of the specified type.
 	 * @param type		The resource type to look for
@@ -479,7 +518,18 @@ protected:
 	SourcesList _sources;
 	int _memoryLocked;	///< Amount of resource bytes in locked memory
 	int _memoryLRU;		///< Amount of resource bytes under LRU control
-	Common::List<Resource *> _LRU; ///< Last Resource Used list
+	Resource *_lruFirst; ///< Most recently used resource under LRU control
+	Resource *_lruLast;  ///< Least recently used resource under LRU control
+	CacheStats _cacheStats;
+
+	enum {
+		kMaxRoomResources = 128 ///< Limit of remembered resources per room
+	};
+
+	typedef Common::HashMap<uint16, Common::Array<ResourceId> > RoomResourceMap;
+	RoomResourceMap _roomResources; ///< Graphics resources loaded in each room
+	int _currentRoom; ///< Room whose resources are being recorded, or -1
+	Common::Queue<ResourceId> _prefetchQueue;
 	ResourceMap _resMap;
 	Common::List<Common::File *> _volumeFiles; ///< list of opened volume files
 	ResourceSource *_audioMapSCI1; ///< Currently loaded audio map for SCI1
@@ -612,8 +662,9 @@ protected:
 	bool hasOldScriptHeader();
 
 	void printLRU();
-	void addToLRU(Resource *res);
+	void addToLRU(Resource *res, bool leastRecent = false);
 	void removeFromLRU(Resource *res);
+	void rememberRoomResource(const ResourceId &id);
 
 	ResourceCompression getViewCompression();
 	ViewType detectViewType();
@@ -34,6 +34,7 @@
 #include "sci/event.h"
 
 #include "sci/engine/features.h"
+#include "sci/engine/gc.h"
 #include "sci/engine/guest_additions.h"
 #include "sci/engine/message.h"
 #include "sci/engine/object.h"
@@ -864,6 +865,13 @@ void SciEngine::sleep(uint32 msecs) {
 			g_sci->_gfxFrameout->updateScreen();
 		}
 #endif
+
+		// Use the time we would spend waiting to mark objects for the
+		// garbage collector and to load resources of the current room
+		// ahead of time
+		_gamestate->_gc->step(_gamestate, wakeUpTime);
+		_resMan->processPrefetch(wakeUpTime);
+
 		time = g_system->getMillis();
 		if (time + 10 < wakeUpTime) {
 			g_system->delayMillis(10);
@@ -34,6 +34,9 @@
 #include "scumm/resource.h"
 #include "scumm/scumm.h"
 #include "scumm/sound.h"
+#include "scumm/he/intern_he.h"
+#include "scumm/he/moonbase/moonbase.h"
+#include "scumm/he/moonbase/ai_main.h"
 
 namespace Scumm {
 
@@ -97,6 +100,11 @@ ScummDebugger::ScummDebugger(ScummEngine *s)
 	registerCmd("imuse",     WRAP_METHOD(ScummDebugger, Cmd_IMuse));
 
 	registerCmd("resetcursors",    WRAP_METHOD(ScummDebugger, Cmd_ResetCursors));
+
+#ifdef ENABLE_HE
+	if (_vm->_game.id == GID_MOONBASE)
+		registerCmd("aistats",   WRAP_METHOD(ScummDebugger, Cmd_AIStats));
+#endif
 }
 
 ScummDebugger::~ScummDebugger() {
@@ -842,4 +850,37 @@ bool ScummDebugger::Cmd_ResetCursors(int argc, const char **argv) {
 	return false;
 }
 
+bool ScummDebugger::Cmd_AIStats(int argc, const char **argv) {
+#ifdef ENABLE_HE
+	Moonbase *moonbase = ((ScummEngine_v100he *)_vm)->_moonbase;
+	if (!moonbase || !moonbase->_ai) {
+		debugPrintf("The Moonbase AI is not available\n");
+		return true;
+	}
+
+	AI *ai = moonbase->_ai;
+
+	if (argc > 1 && !strcmp(argv[1], "reset")) {
+		ai->resetThinkStats();
+		debugPrintf("AI statistics reset\n");
+		return true;
+	}
+
+	if (argc > 2 && !strcmp(argv[1], "budget")) {
+		ai->_searchBudget = MAX(atoi(argv[2]), 1);
+	} else if (argc > 1) {
+		debugPrintf("Usage: %s [reset | budget <ms>]\n", argv[0]);
+		return true;
+	}
+
+	debugPrintf("Search budget: %d ms per call\n", ai->_searchBudget);
+	debugPrintf("Calls: %d, think time: %d ms, average %d ms, max %d ms per call\n",
+		ai->_thinkCalls, ai->_thinkTime, ai->_thinkCalls ? ai->_thinkTime / ai->_thinkCalls : 0, ai->_thinkTimeMax);
+	debugPrintf("Turns: %d, last turn: %d ms over %d calls, current turn: %d ms over %d calls\n",
+		ai->_turns, ai->_lastTurnThinkTime, ai->_lastTurnCalls, ai->_turnThinkTime, ai->_turnCalls);
+	debugPrintf("Search nodes expanded: %d, nodes alive: %d\n", ai->_searchExpansions, Node::getNodeCount());
+#endif
+	return true;
+}
+
 } // End of namespace Scumm
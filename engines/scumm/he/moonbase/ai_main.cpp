@@ -160,6 +160,40 @@ AI::AI(ScummEngine_v100he *vm) : _vm(vm) {
 
 	memset(_moveList, 0, sizeof(_moveList));
 	_mcpParams = 0;
+
+	_searchBudget = SEARCH_BUDGET;
+	resetThinkStats();
+}
+
+void AI::resetThinkStats() {
+	_thinkCalls = 0;
+	_thinkTime = 0;
+	_thinkTimeMax = 0;
+	_turns = 0;
+	_turnCalls = 0;
+	_turnThinkTime = 0;
+	_lastTurnCalls = 0;
+	_lastTurnThinkTime = 0;
+	_searchExpansions = 0;
+}
+
+void AI::updateThinkStats(uint32 thinkTime, bool turnDone) {
+	_thinkCalls++;
+	_thinkTime += thinkTime;
+	_thinkTimeMax = MAX(_thinkTimeMax, thinkTime);
+
+	_turnCalls++;
+	_turnThinkTime += thinkTime;
+
+	if (turnDone) {
+		debugC(DEBUG_MOONBASE_AI, "Turn took %d ms of thinking over %d calls", _turnThinkTime, _turnCalls);
+
+		_turns++;
+		_lastTurnCalls = _turnCalls;
+		_lastTurnThinkTime = _turnThinkTime;
+		_turnCalls = 0;
+		_turnThinkTime = 0;
+	}
 }
 
 void AI::resetAI() {
@@ -250,6 +284,9 @@ int AI::masterControlProgram(const int paramCount, const int32 *params) {
 	Node *retNode;
 	static int retNodeFlag;
 
+	const uint32 thinkStart = _vm->_system->getMillis();
+	bool turnDone = false;
+
 	// Memory cleanup in case of quit during game
 	if (_vm->readVar(_vm->VAR_U32_USER_VAR_F)) {
 		if (myTree != NULL) {
@@ -938,6 +975,7 @@ int AI::masterControlProgram(const int paramCount, const int32 *params) {
 		launchAction = NULL;
 
 		_aiState = STATE_CHOOSE_BEHAVIOR;
+		turnDone = true;
 
 		int rSh, rU, rP, rA = 0;
 		rSh = _vm->readVar(_vm->VAR_U32_USER_VAR_A);
@@ -1018,6 +1056,8 @@ int AI::masterControlProgram(const int paramCount, const int32 *params) {
 			_vm->writeVar(_vm->VAR_U32_USER_VAR_E, -999);
 	}
 
+	updateThinkStats(_vm->_system->getMillis() - thinkStart, turnDone);
+
 	return 1;
 }
 
@@ -204,6 +204,25 @@ public:
 	patternList *_moveList[5];
 
 	const int32 *_mcpParams;
+
+	// Milliseconds a tree search may run per call of the master control program
+	uint32 _searchBudget;
+
+	// Think time statistics, shown by the "aistats" debugger command
+	uint32 _thinkCalls;
+	uint32 _thinkTime;
+	uint32 _thinkTimeMax;
+	uint32 _turns;
+	uint32 _turnCalls;
+	uint32 _turnThinkTime;
+	uint32 _lastTurnCalls;
+	uint32 _lastTurnThinkTime;
+	uint32 _searchExpansions;
+
+	void resetThinkStats();
+
+private:
+	void updateThinkStats(uint32 thinkTime, bool turnDone);
 };
 
 } // End of namespace Scumm
@@ -36,6 +36,15 @@ Node::Node() {
 	_depth = 0;
 	_nodeCount++;
 	_contents = NULL;
+	_pool = NULL;
+}
+
+Node::Node(NodePool *pool) {
+	_parent = NULL;
+	_depth = 0;
+	_nodeCount++;
+	_contents = NULL;
+	_pool = pool;
 }
 
 Node::Node(Node *sourceNode) {
@@ -45,6 +54,21 @@ Node::Node(Node *sourceNode) {
 	_depth = sourceNode->getDepth();
 
 	_contents = sourceNode->getContainedObject()->duplicate();
+	_pool = NULL;
+}
+
+Node *Node::create(NodePool *pool) {
+	if (pool)
+		return new (*pool) Node(pool);
+
+	return new Node;
+}
+
+void Node::destroy(Node *node) {
+	if (node->_pool)
+		node->_pool->deleteChunk(node);
+	else
+		delete node;
 }
 
 Node::~Node() {
@@ -64,7 +88,7 @@ int Node::generateChildren() {
 	static int i = 0;
 
 	while (i < numChildren) {
-		Node *tempNode = new Node;
+		Node *tempNode = create(_pool);
 		_children.push_back(tempNode);
 		tempNode->setParent(this);
 		tempNode->setDepth(_depth + 1);
@@ -76,7 +100,7 @@ int Node::generateChildren() {
 
 		if (!completionFlag) {
 			_children.pop_back();
-			delete tempNode;
+			destroy(tempNode);
 			return 0;
 		}
 
@@ -86,7 +110,7 @@ int Node::generateChildren() {
 			tempNode->setContainedObject(thisContObj);
 		} else {
 			_children.pop_back();
-			delete tempNode;
+			destroy(tempNode);
 			numChildrenGenerated--;
 		}
 	}
@@ -105,7 +129,7 @@ int Node::generateNextChild() {
 
 	static int i = 0;
 
-	Node *tempNode = new Node;
+	Node *tempNode = create(_pool);
 	_children.push_back(tempNode);
 	tempNode->setParent(this);
 	tempNode->setDepth(_depth + 1);
@@ -117,7 +141,7 @@ int Node::generateNextChild() {
 		tempNode->setContainedObject(thisContObj);
 	} else {
 		_children.pop_back();
-		delete tempNode;
+		destroy(tempNode);
 	}
 
 	++i;
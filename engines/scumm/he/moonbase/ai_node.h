@@ -24,6 +24,7 @@
 #define SCUMM_HE_MOONBASE_AI_NODE_H
 
 #include "common/array.h"
+#include "common/memorypool.h"
 
 namespace Scumm {
 
@@ -62,6 +63,10 @@ public:
 	float returnG() const { return getG(); }
 };
 
+class Node;
+
+typedef Common::ObjectPool<Node> NodePool;
+
 class Node {
 private:
 	Node *_parent;
@@ -72,11 +77,22 @@ private:
 
 	IContainedObject *_contents;
 
+	// Pool this node, and the children generated from it, are allocated from
+	NodePool *_pool;
+
 public:
 	Node();
+	Node(NodePool *pool);
 	Node(Node *sourceNode);
 	~Node();
 
+	/**
+	 * Creates a node in the given pool, or on the heap if there is no pool.
+	 * Nodes created this way must be destroyed with destroy().
+	 */
+	static Node *create(NodePool *pool);
+	static void destroy(Node *node);
+
 	void setParent(Node *parentPtr) { _parent = parentPtr; }
 	Node *getParent() const { return _parent; }
 
@@ -28,56 +28,90 @@
 
 namespace Scumm {
 
-static int compareTreeNodes(const void *a, const void *b) {
-	if (((const TreeNode *)a)->value < ((const TreeNode *)b)->value)
-		return -1;
-	else if (((const TreeNode *)a)->value > ((const TreeNode *)b)->value)
-		return 1;
-	else
-		return 0;
+void OpenList::push(float value, Node *node) {
+	_heap.push_back(TreeNode(value, _order++, node));
+
+	// Sift the new entry up
+	uint i = _heap.size() - 1;
+	while (i > 0) {
+		const uint parent = (i - 1) / 2;
+		if (!isBefore(_heap[i], _heap[parent]))
+			break;
+
+		SWAP(_heap[i], _heap[parent]);
+		i = parent;
+	}
+}
+
+Node *OpenList::pop() {
+	assert(!_heap.empty());
+
+	Node *node = _heap.front().node;
+	_heap.front() = _heap.back();
+	_heap.pop_back();
+
+	// Sift the moved entry down
+	const uint size = _heap.size();
+	uint i = 0;
+	while (true) {
+		const uint left = i * 2 + 1;
+		const uint right = left + 1;
+		uint first = i;
+
+		if (left < size && isBefore(_heap[left], _heap[first]))
+			first = left;
+		if (right < size && isBefore(_heap[right], _heap[first]))
+			first = right;
+		if (first == i)
+			break;
+
+		SWAP(_heap[i], _heap[first]);
+		i = first;
+	}
+
+	return node;
+}
+
+bool OpenList::isBefore(const TreeNode &a, const TreeNode &b) {
+	if (a.value != b.value)
+		return a.value < b.value;
+
+	return a.order > b.order;
 }
 
 Tree::Tree(AI *ai) : _ai(ai) {
-	pBaseNode = new Node;
+	pBaseNode = Node::create(&_nodePool);
 	_maxDepth = MAX_DEPTH;
 	_maxNodes = MAX_NODES;
 	_currentNode = 0;
 	_currentChildIndex = 0;
-
-	_currentMap = new Common::SortedArray<TreeNode *>(compareTreeNodes);
 }
 
 Tree::Tree(IContainedObject *contents, AI *ai) : _ai(ai) {
-	pBaseNode = new Node;
+	pBaseNode = Node::create(&_nodePool);
 	pBaseNode->setContainedObject(contents);
 	_maxDepth = MAX_DEPTH;
 	_maxNodes = MAX_NODES;
 	_currentNode = 0;
 	_currentChildIndex = 0;
-
-	_currentMap = new Common::SortedArray<TreeNode *>(compareTreeNodes);
 }
 
 Tree::Tree(IContainedObject *contents, int maxDepth, AI *ai) : _ai(ai) {
-	pBaseNode = new Node;
+	pBaseNode = Node::create(&_nodePool);
 	pBaseNode->setContainedObject(contents);
 	_maxDepth = maxDepth;
 	_maxNodes = MAX_NODES;
 	_currentNode = 0;
 	_currentChildIndex = 0;
-
-	_currentMap = new Common::SortedArray<TreeNode *>(compareTreeNodes);
 }
 
 Tree::Tree(IContainedObject *contents, int maxDepth, int maxNodes, AI *ai) : _ai(ai) {
-	pBaseNode = new Node;
+	pBaseNode = Node::create(&_nodePool);
 	pBaseNode->setContainedObject(contents);
 	_maxDepth = maxDepth;
 	_maxNodes = maxNodes;
 	_currentNode = 0;
 	_currentChildIndex = 0;
-
-	_currentMap = new Common::SortedArray<TreeNode *>(compareTreeNodes);
 }
 
 void Tree::duplicateTree(Node *sourceNode, Node *destNode) {
@@ -96,7 +130,6 @@ Tree::Tree(const Tree *sourceTree, AI *ai) : _ai(ai) {
 	pBaseNode = new Node(sourceTree->getBaseNode());
 	_maxDepth = sourceTree->getMaxDepth();
 	_maxNodes = sourceTree->getMaxNodes();
-	_currentMap = new Common::SortedArray<TreeNode *>(compareTreeNodes);
 	_currentNode = 0;
 	_currentChildIndex = 0;
 
@@ -116,16 +149,14 @@ Tree::~Tree() {
 			// Delete this node, and move up to the parent for further processing
 			Node *pTemp = pNodeItr;
 			pNodeItr = pNodeItr->getParent();
-			delete pTemp;
+			Node::destroy(pTemp);
 			pTemp = NULL;
 		}
 	}
-
-	delete _currentMap;
 }
 
 Node *Tree::aStarSearch() {
-	Common::SortedArray<TreeNode *> mmfpOpen(compareTreeNodes);
+	OpenList mmfpOpen;
 
 	Node *currentNode = NULL;
 	float currentT;
@@ -135,11 +166,10 @@ Node *Tree::aStarSearch() {
 	float temp = pBaseNode->getContainedObject()->calcT();
 
 	if (static_cast<int>(temp) != SUCCESS) {
-		mmfpOpen.insert(new TreeNode(pBaseNode->getObjectT(), pBaseNode));
+		mmfpOpen.push(pBaseNode->getObjectT(), pBaseNode);
 
-		while (mmfpOpen.size() && (retNode == NULL)) {
-			currentNode = mmfpOpen.front()->node;
-			mmfpOpen.erase(mmfpOpen.begin());
+		while (!mmfpOpen.empty() && (retNode == NULL)) {
+			currentNode = mmfpOpen.pop();
 
 			if ((currentNode->getDepth() < _maxDepth) && (Node::getNodeCount() < _maxNodes)) {
 				// Generate nodes
@@ -152,7 +182,7 @@ Node *Tree::aStarSearch() {
 					if (currentT == SUCCESS)
 						retNode = *i;
 					else
-						mmfpOpen.insert(new TreeNode(currentT, (*i)));
+						mmfpOpen.push(currentT, (*i));
 				}
 			} else {
 				retNode = currentNode;
@@ -170,11 +200,12 @@ Node *Tree::aStarSearch_singlePassInit() {
 	Node *retNode = NULL;
 
 	_currentChildIndex = 1;
+	_currentMap.clear();
 
 	float temp = pBaseNode->getContainedObject()->calcT();
 
 	if (static_cast<int>(temp) != SUCCESS) {
-		_currentMap->insert(new TreeNode(pBaseNode->getObjectT(), pBaseNode));
+		_currentMap.push(pBaseNode->getObjectT(), pBaseNode);
 	} else {
 		retNode = pBaseNode;
 	}
@@ -183,23 +214,36 @@ Node *Tree::aStarSearch_singlePassInit() {
 }
 
 Node *Tree::aStarSearch_singlePass() {
-	float currentT = 0.0;
-	Node *retNode = NULL;
-
 	static int maxTime = 0;
 
 	if (_currentChildIndex == 1) {
 		maxTime = _ai->getPlayerMaxTime();
 	}
 
+	// Keep expanding nodes until a result is found, or the time budget for
+	// this call is used up. A node whose children could not be generated
+	// completely yet is continued with the next call.
+	const uint32 startTime = _ai->_vm->_system->getMillis();
+	Node *retNode = NULL;
+
+	do {
+		retNode = aStarSearch_expand(maxTime);
+	} while ((retNode == NULL) && (_ai->_vm->_system->getMillis() - startTime < _ai->_searchBudget));
+
+	return retNode;
+}
+
+Node *Tree::aStarSearch_expand(int maxTime) {
+	float currentT = 0.0;
+	Node *retNode = NULL;
+
 	if (_currentChildIndex) {
-		if (!(_currentMap->size())) {
+		if (_currentMap.empty()) {
 			retNode = _currentNode;
 			return retNode;
 		}
 
-		_currentNode = _currentMap->front()->node;
-		_currentMap->erase(_currentMap->begin());
+		_currentNode = _currentMap.pop();
 	}
 
 	if ((_currentNode->getDepth() < _maxDepth) && (Node::getNodeCount() < _maxNodes) && ((!maxTime) || (_ai->getTimerValue(3) < maxTime))) {
@@ -207,9 +251,11 @@ Node *Tree::aStarSearch_singlePass() {
 		_currentChildIndex = _currentNode->generateChildren();
 
 		if (_currentChildIndex) {
+			_ai->_searchExpansions++;
+
 			Common::Array<Node *> vChildren = _currentNode->getChildren();
 
-			if (!vChildren.size() && !_currentMap->size()) {
+			if (!vChildren.size() && _currentMap.empty()) {
 				_currentChildIndex = 0;
 				retNode = _currentNode;
 			}
@@ -222,11 +268,11 @@ Node *Tree::aStarSearch_singlePass() {
 					retNode = *i;
 					i = vChildren.end() - 1;
 				} else {
-					_currentMap->insert(new TreeNode(currentT, (*i)));
+					_currentMap.push(currentT, (*i));
 				}
 			}
 
-			if (!(_currentMap->size()) && (currentT != SUCCESS)) {
+			if (_currentMap.empty() && (currentT != SUCCESS)) {
 				assert(_currentNode != NULL);
 				retNode = _currentNode;
 			}
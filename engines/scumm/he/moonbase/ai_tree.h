@@ -30,14 +30,38 @@ namespace Scumm {
 
 const int MAX_DEPTH = 100;
 const int MAX_NODES = 1000000;
+const uint32 SEARCH_BUDGET = 10;
 
 class AI;
 
 struct TreeNode {
 	float value;
+	uint32 order;
 	Node *node;
 
-	TreeNode(float v, Node *n) { value = v; node = n; }
+	TreeNode(float v, uint32 o, Node *n) { value = v; order = o; node = n; }
+};
+
+/**
+ * Open list of the A* search: a binary min-heap on the node values. Nodes
+ * with the same value are taken newest first.
+ */
+class OpenList {
+public:
+	OpenList() : _order(0) {}
+
+	bool empty() const { return _heap.empty(); }
+	uint size() const { return _heap.size(); }
+	void clear() { _heap.clear(); _order = 0; }
+
+	void push(float value, Node *node);
+	Node *pop();
+
+private:
+	static bool isBefore(const TreeNode &a, const TreeNode &b);
+
+	Common::Array<TreeNode> _heap;
+	uint32 _order;
 };
 
 class Tree {
@@ -49,11 +73,16 @@ private:
 
 	int _currentChildIndex;
 
-	Common::SortedArray<TreeNode *> *_currentMap;
+	OpenList _currentMap;
 	Node *_currentNode;
 
+	// All nodes of the tree, apart from copies made by duplicateTree()
+	NodePool _nodePool;
+
 	AI *_ai;
 
+	Node *aStarSearch_expand(int maxTime);
+
 public:
 	Tree(AI *ai);
 	Tree(IContainedObject *contents, AI *ai);
@@ -350,6 +350,18 @@ void IMuseDigital::callback() {
 					feedSize -= curFeedSize;
 					assert(feedSize >= 0);
 				} while (feedSize != 0);
+
+				// Decompress the bundle blocks for the next callback now, so
+				// that they are cached by the time the track needs them
+				if (track->stream && track->soundDesc) {
+					int32 readAheadOffset = track->regionOffset;
+					int32 readAheadSize = track->feedSize / _callbackFps;
+					if (bits == 12) {
+						readAheadOffset = (readAheadOffset * 3) / 4;
+						readAheadSize = (readAheadSize * 3) / 4;
+					}
+					_sound->readAheadRegion(track->soundDesc, track->curRegion, readAheadOffset, readAheadSize);
+				}
 			}
 			if (_mixer->isReady()) {
 				_mixer->setChannelVolume(track->mixChanHandle, track->getVol());
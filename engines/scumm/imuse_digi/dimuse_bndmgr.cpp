@@ -37,6 +37,14 @@ BundleDirCache::BundleDirCache() {
 		_budleDirCache[fileId].numFiles = 0;
 		_budleDirCache[fileId].isCompressed = false;
 		_budleDirCache[fileId].indexTable = NULL;
+		for (int i = 0; i < kNumDecompressedBlocks; i++) {
+			_budleDirCache[fileId].blocks[i].index = -1;
+			_budleDirCache[fileId].blocks[i].block = -1;
+			_budleDirCache[fileId].blocks[i].size = 0;
+			_budleDirCache[fileId].blocks[i].lastUse = 0;
+			_budleDirCache[fileId].blocks[i].data = NULL;
+		}
+		_budleDirCache[fileId].blockUseCounter = 0;
 	}
 }
 
@@ -44,6 +52,8 @@ BundleDirCache::~BundleDirCache() {
 	for (int fileId = 0; fileId < ARRAYSIZE(_budleDirCache); fileId++) {
 		free(_budleDirCache[fileId].bundleTable);
 		free(_budleDirCache[fileId].indexTable);
+		for (int i = 0; i < kNumDecompressedBlocks; i++)
+			free(_budleDirCache[fileId].blocks[i].data);
 	}
 }
 
@@ -63,6 +73,37 @@ bool BundleDirCache::isSndDataExtComp(int slot) {
 	return _budleDirCache[slot].isCompressed;
 }
 
+BundleDirCache::DecompressedBlock *BundleDirCache::findBlock(int slot, int32 index, int32 block) {
+	FileDirCache &dir = _budleDirCache[slot];
+	for (int i = 0; i < kNumDecompressedBlocks; i++) {
+		if (dir.blocks[i].index == index && dir.blocks[i].block == block) {
+			dir.blocks[i].lastUse = ++dir.blockUseCounter;
+			return &dir.blocks[i];
+		}
+	}
+
+	return NULL;
+}
+
+BundleDirCache::DecompressedBlock *BundleDirCache::allocBlock(int slot, int32 index, int32 block) {
+	FileDirCache &dir = _budleDirCache[slot];
+	DecompressedBlock *oldest = &dir.blocks[0];
+	for (int i = 1; i < kNumDecompressedBlocks; i++) {
+		if (dir.blocks[i].lastUse < oldest->lastUse)
+			oldest = &dir.blocks[i];
+	}
+
+	if (!oldest->data) {
+		oldest->data = (byte *)malloc(0x2000);
+		assert(oldest->data);
+	}
+	oldest->index = index;
+	oldest->block = block;
+	oldest->size = 0;
+	oldest->lastUse = ++dir.blockUseCounter;
+	return oldest;
+}
+
 int BundleDirCache::matchFile(const char *filename) {
 	int32 tag, offset;
 	bool found = false;
@@ -147,6 +188,7 @@ BundleMgr::BundleMgr(BundleDirCache *cache) {
 	_numCompItems = 0;
 	_curSampleId = -1;
 	_fileBundleId = -1;
+	_slot = -1;
 	_file = new ScummFile();
 	_compInputBuff = NULL;
 }
@@ -184,17 +226,15 @@ bool BundleMgr::open(const char *filename, bool &compressed, bool errorFlag) {
 		return false;
 	}
 
-	int slot = _cache->matchFile(filename);
-	assert(slot != -1);
-	compressed = _cache->isSndDataExtComp(slot);
-	_numFiles = _cache->getNumFiles(slot);
+	_slot = _cache->matchFile(filename);
+	assert(_slot != -1);
+	compressed = _cache->isSndDataExtComp(_slot);
+	_numFiles = _cache->getNumFiles(_slot);
 	assert(_numFiles);
-	_bundleTable = _cache->getTable(slot);
-	_indexTable = _cache->getIndexTable(slot);
+	_bundleTable = _cache->getTable(_slot);
+	_indexTable = _cache->getIndexTable(_slot);
 	assert(_bundleTable);
 	_compTableLoaded = false;
-	_outputSize = 0;
-	_lastBlock = -1;
 
 	return true;
 }
@@ -206,9 +246,8 @@ void BundleMgr::close() {
 		_numFiles = 0;
 		_numCompItems = 0;
 		_compTableLoaded = false;
-		_lastBlock = -1;
-		_outputSize = 0;
 		_curSampleId = -1;
+		_slot = -1;
 		free(_compTable);
 		_compTable = NULL;
 		free(_compInputBuff);
@@ -246,10 +285,46 @@ bool BundleMgr::loadCompTable(int32 index) {
 	return true;
 }
 
+BundleDirCache::DecompressedBlock *BundleMgr::getBlock(int32 index, int32 block) {
+	BundleDirCache::DecompressedBlock *cached = _cache->findBlock(_slot, index, block);
+	if (cached)
+		return cached;
+
+	cached = _cache->allocBlock(_slot, index, block);
+
+	// CMI hack: one more zero byte at the end of input buffer
+	_compInputBuff[_compTable[block].size] = 0;
+	_file->seek(_bundleTable[index].offset + _compTable[block].offset, SEEK_SET);
+	_file->read(_compInputBuff, _compTable[block].size);
+	cached->size = BundleCodecs::decompressCodec(_compTable[block].codec, _compInputBuff, cached->data, _compTable[block].size);
+	if (cached->size > 0x2000) {
+		error("_outputSize: %d", cached->size);
+	}
+
+	return cached;
+}
+
 int32 BundleMgr::decompressSampleByCurIndex(int32 offset, int32 size, byte **compFinal, int headerSize, bool headerOutside) {
 	return decompressSampleByIndex(_curSampleId, offset, size, compFinal, headerSize, headerOutside);
 }
 
+void BundleMgr::readAheadByCurIndex(int32 offset, int32 size, int headerSize) {
+	if (_curSampleId == -1 || !_file->isOpen() || size <= 0)
+		return;
+
+	if (!_compTableLoaded) {
+		_compTableLoaded = loadCompTable(_curSampleId);
+		if (!_compTableLoaded)
+			return;
+	}
+
+	const int firstBlock = (offset + headerSize) / 0x2000;
+	const int lastBlock = MIN<int>((offset + headerSize + size - 1) / 0x2000, _numCompItems - 1);
+
+	for (int i = firstBlock; i <= lastBlock; i++)
+		getBlock(_curSampleId, i);
+}
+
 int32 BundleMgr::decompressSampleByIndex(int32 index, int32 offset, int32 size, byte **compFinal, int headerSize, bool headerOutside) {
 	int32 i, finalSize, outputSize;
 	int skip, firstBlock, lastBlock;
@@ -279,7 +354,11 @@ int32 BundleMgr::decompressSampleByIndex(int32 index, int32 offset, int32 size,
 	if ((lastBlock >= _numCompItems) && (_numCompItems > 0))
 		lastBlock = _numCompItems - 1;
 
+	// The output never exceeds the requested size, so there is no need to
+	// allocate whole blocks. The buffer is handed over to the caller.
 	int32 blocksFinalSize = 0x2000 * (1 + lastBlock - firstBlock);
+	if (size > 0 && size < blocksFinalSize)
+		blocksFinalSize = size;
 	*compFinal = (byte *)malloc(blocksFinalSize);
 	assert(*compFinal);
 	finalSize = 0;
@@ -287,19 +366,9 @@ int32 BundleMgr::decompressSampleByIndex(int32 index, int32 offset, int32 size,
 	skip = (offset + headerSize) % 0x2000;
 
 	for (i = firstBlock; i <= lastBlock; i++) {
-		if (_lastBlock != i) {
-			// CMI hack: one more zero byte at the end of input buffer
-			_compInputBuff[_compTable[i].size] = 0;
-			_file->seek(_bundleTable[index].offset + _compTable[i].offset, SEEK_SET);
-			_file->read(_compInputBuff, _compTable[i].size);
-			_outputSize = BundleCodecs::decompressCodec(_compTable[i].codec, _compInputBuff, _compOutputBuff, _compTable[i].size);
-			if (_outputSize > 0x2000) {
-				error("_outputSize: %d", _outputSize);
-			}
-			_lastBlock = i;
-		}
+		const BundleDirCache::DecompressedBlock *block = getBlock(index, i);
 
-		outputSize = _outputSize;
+		outputSize = block->size;
 
 		if (headerOutside) {
 			outputSize -= skip;
@@ -316,7 +385,7 @@ int32 BundleMgr::decompressSampleByIndex(int32 index, int32 offset, int32 size,
 
 		assert(finalSize + outputSize <= blocksFinalSize);
 
-		memcpy(*compFinal + finalSize, _compOutputBuff + skip, outputSize);
+		memcpy(*compFinal + finalSize, block->data + skip, outputSize);
 		finalSize += outputSize;
 
 		size -= outputSize;
@@ -43,6 +43,24 @@ public:
 		int32 index;
 	};
 
+	/**
+	 * A decompressed 0x2000 byte block of a sound in a bundle. The blocks are
+	 * shared by all sounds playing from the same bundle, so that tracks which
+	 * play the same data, like a track and its fade out clone, decompress it
+	 * only once.
+	 */
+	struct DecompressedBlock {
+		int32 index;		// index of the sound in the bundle, -1 if unused
+		int32 block;		// number of the block in the sound
+		int32 size;			// number of decompressed bytes
+		uint32 lastUse;
+		byte *data;
+	};
+
+	enum {
+		kNumDecompressedBlocks = 16	// blocks cached per bundle
+	};
+
 private:
 
 	struct FileDirCache {
@@ -51,6 +69,8 @@ private:
 		int32 numFiles;
 		bool isCompressed;
 		IndexNode *indexTable;
+		DecompressedBlock blocks[kNumDecompressedBlocks];
+		uint32 blockUseCounter;
 	} _budleDirCache[4];
 
 public:
@@ -62,6 +82,11 @@ public:
 	IndexNode *getIndexTable(int slot);
 	int32 getNumFiles(int slot);
 	bool isSndDataExtComp(int slot);
+
+	/** Returns the cached block of a sound, or NULL if it is not cached. */
+	DecompressedBlock *findBlock(int slot, int32 index, int32 block);
+	/** Returns the least recently used block of the bundle, assigned to the given sound block. */
+	DecompressedBlock *allocBlock(int slot, int32 index, int32 block);
 };
 
 class BundleMgr {
@@ -85,12 +110,11 @@ private:
 	BaseScummFile *_file;
 	bool _compTableLoaded;
 	int _fileBundleId;
-	byte _compOutputBuff[0x2000];
+	int _slot;
 	byte *_compInputBuff;
-	int _outputSize;
-	int _lastBlock;
 
 	bool loadCompTable(int32 index);
+	BundleDirCache::DecompressedBlock *getBlock(int32 index, int32 block);
 
 public:
 
@@ -103,6 +127,13 @@ public:
 	int32 decompressSampleByName(const char *name, int32 offset, int32 size, byte **compFinal, bool headerOutside);
 	int32 decompressSampleByIndex(int32 index, int32 offset, int32 size, byte **compFinal, int header_size, bool headerOutside);
 	int32 decompressSampleByCurIndex(int32 offset, int32 size, byte **compFinal, int headerSize, bool headerOutside);
+
+	/**
+	 * Decompresses the blocks of the current sound which hold the given
+	 * range into the block cache, so that a later decompressSampleByCurIndex()
+	 * call for it finds them there.
+	 */
+	void readAheadByCurIndex(int32 offset, int32 size, int headerSize);
 };
 
 } // End of namespace Scumm
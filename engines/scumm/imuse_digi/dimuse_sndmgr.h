@@ -154,6 +154,7 @@ public:
 	void getSyncSizeAndPtrById(SoundDesc *soundDesc, int number, int32 &sync_size, byte **sync_ptr);
 
 	int32 getDataFromRegion(SoundDesc *soundDesc, int region, byte **buf, int32 offset, int32 size);
+	void readAheadRegion(SoundDesc *soundDesc, int region, int32 offset, int32 size);
 };
 
 } // End of namespace Scumm
@@ -147,6 +147,9 @@ RenderedImage::RenderedImage(const Common::String &filename, bool &result) :
 	checkForTransparency();
 #endif
 
+	// Loaded images never change, so blits can skip their transparent areas
+	_surface.buildSpans();
+
 	return;
 }
 
@@ -208,6 +211,8 @@ bool RenderedImage::setContent(const byte *pixeldata, uint size, uint offset, ui
 		in += stride;
 	}
 
+	_surface.invalidateSpans();
+
 	return true;
 }
 
@@ -216,6 +221,7 @@ void RenderedImage::replaceContent(byte *pixeldata, int width, int height) {
 	_surface.h = height;
 	_surface.pitch = width * 4;
 	_surface.setPixels(pixeldata);
+	_surface.invalidateSpans();
 }
 // -----------------------------------------------------------------------------
 
@@ -25,6 +25,14 @@
 
 #include "common/endian.h"
 
+#if defined(__SSE2__)
+#define CONVERSION_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
 namespace Graphics {
 
 // TODO: YUV to RGB conversion function
@@ -96,6 +104,338 @@ inline void crossBlitLogic3BppSource(byte *dst, const byte *src, const uint w, c
 	}
 }
 
+/**
+ * Converts one row of pixels between two fixed pixel formats. Conversions
+ * to a larger pixel size go from the end of the row to its start, so that
+ * they can work in place.
+ */
+typedef void (*CrossBlitRowFunc)(byte *dst, const byte *src, uint w);
+
+// The per pixel conversions produce exactly the same values as going
+// through colorToARGB and ARGBToColor
+
+inline uint32 convert565To8888(uint16 color, uint32 alpha) {
+	const uint r = (color >> 11) & 0x1F;
+	const uint g = (color >> 5) & 0x3F;
+	const uint b = color & 0x1F;
+
+	return alpha
+	       | (((r << 3) | (r >> 2)) << 16)
+	       | (((g << 2) | (g >> 4)) << 8)
+	       | ((b << 3) | (b >> 2));
+}
+
+inline uint16 convert8888To565(uint32 color) {
+	return ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F);
+}
+
+inline uint16 convert555To565(uint16 color) {
+	return ((color << 1) & 0xFFC0) | ((color >> 4) & 0x0020) | (color & 0x001F);
+}
+
+inline uint32 convertARGBToRGBA(uint32 color) {
+	return (color << 8) | (color >> 24);
+}
+
+inline uint32 convertRGBAToARGB(uint32 color) {
+	return (color >> 8) | (color << 24);
+}
+
+/** RGB565 to XRGB8888 (alpha 0) or ARGB8888 (alpha 0xFF000000) */
+template<uint32 alpha>
+void crossBlitRow565To8888(byte *dst, const byte *src, uint w) {
+	const uint16 *s = (const uint16 *)src;
+	uint32 *d = (uint32 *)dst;
+
+#if defined(CONVERSION_SSE2)
+	const __m128i mask5 = _mm_set1_epi16(0x1F);
+	const __m128i mask6 = _mm_set1_epi16(0x3F);
+	const __m128i alphaHi = _mm_set1_epi16((int16)(alpha >> 16));
+
+	for (; w >= 8; w -= 8) {
+		const __m128i c = _mm_loadu_si128((const __m128i *)(s + w - 8));
+		const __m128i r = _mm_srli_epi16(c, 11);
+		const __m128i g = _mm_and_si128(_mm_srli_epi16(c, 5), mask6);
+		const __m128i b = _mm_and_si128(c, mask5);
+
+		const __m128i ar = _mm_or_si128(alphaHi, _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2)));
+		const __m128i gb = _mm_or_si128(_mm_slli_epi16(_mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4)), 8),
+		                                _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2)));
+
+		_mm_storeu_si128((__m128i *)(d + w - 8), _mm_unpacklo_epi16(gb, ar));
+		_mm_storeu_si128((__m128i *)(d + w - 4), _mm_unpackhi_epi16(gb, ar));
+	}
+#elif defined(CONVERSION_NEON)
+	const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+	const uint16x8_t mask6 = vdupq_n_u16(0x3F);
+	const uint16x8_t alphaHi = vdupq_n_u16((uint16)(alpha >> 16));
+
+	for (; w >= 8; w -= 8) {
+		const uint16x8_t c = vld1q_u16(s + w - 8);
+		const uint16x8_t r = vshrq_n_u16(c, 11);
+		const uint16x8_t g = vandq_u16(vshrq_n_u16(c, 5), mask6);
+		const uint16x8_t b = vandq_u16(c, mask5);
+
+		const uint16x8_t ar = vorrq_u16(alphaHi, vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2)));
+		const uint16x8_t gb = vorrq_u16(vshlq_n_u16(vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4)), 8),
+		                                vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2)));
+
+		const uint16x8x2_t pixels = vzipq_u16(gb, ar);
+		vst1q_u32(d + w - 8, vreinterpretq_u32_u16(pixels.val[0]));
+		vst1q_u32(d + w - 4, vreinterpretq_u32_u16(pixels.val[1]));
+	}
+#else
+	for (; w >= 4; w -= 4) {
+		const uint16 c0 = s[w - 4], c1 = s[w - 3], c2 = s[w - 2], c3 = s[w - 1];
+		d[w - 1] = convert565To8888(c3, alpha);
+		d[w - 2] = convert565To8888(c2, alpha);
+		d[w - 3] = convert565To8888(c1, alpha);
+		d[w - 4] = convert565To8888(c0, alpha);
+	}
+#endif
+
+	while (w > 0) {
+		--w;
+		d[w] = convert565To8888(s[w], alpha);
+	}
+}
+
+/** XRGB8888 or ARGB8888 to RGB565 */
+void crossBlitRow8888To565(byte *dst, const byte *src, uint w) {
+	const uint32 *s = (const uint32 *)src;
+	uint16 *d = (uint16 *)dst;
+
+#if defined(CONVERSION_SSE2)
+	const __m128i maskR = _mm_set1_epi32(0xF800);
+	const __m128i maskG = _mm_set1_epi32(0x07E0);
+	const __m128i maskB = _mm_set1_epi32(0x001F);
+
+	for (; w >= 8; w -= 8) {
+		__m128i c[2];
+
+		for (int i = 0; i < 2; ++i) {
+			const __m128i p = _mm_loadu_si128((const __m128i *)s + i);
+			const __m128i v = _mm_or_si128(_mm_or_si128(
+			                      _mm_and_si128(_mm_srli_epi32(p, 8), maskR),
+			                      _mm_and_si128(_mm_srli_epi32(p, 5), maskG)),
+			                      _mm_and_si128(_mm_srli_epi32(p, 3), maskB));
+
+			// Sign extend, so that the signed saturation of the pack keeps the bits
+			c[i] = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+		}
+
+		_mm_storeu_si128((__m128i *)d, _mm_packs_epi32(c[0], c[1]));
+		s += 8;
+		d += 8;
+	}
+#elif defined(CONVERSION_NEON)
+	const uint32x4_t maskR = vdupq_n_u32(0xF800);
+	const uint32x4_t maskG = vdupq_n_u32(0x07E0);
+	const uint32x4_t maskB = vdupq_n_u32(0x001F);
+
+	for (; w >= 8; w -= 8) {
+		uint16x4_t c[2];
+
+		for (int i = 0; i < 2; ++i) {
+			const uint32x4_t p = vld1q_u32(s + 4 * i);
+			const uint32x4_t v = vorrq_u32(vorrq_u32(
+			                         vandq_u32(vshrq_n_u32(p, 8), maskR),
+			                         vandq_u32(vshrq_n_u32(p, 5), maskG)),
+			                         vandq_u32(vshrq_n_u32(p, 3), maskB));
+			c[i] = vmovn_u32(v);
+		}
+
+		vst1q_u16(d, vcombine_u16(c[0], c[1]));
+		s += 8;
+		d += 8;
+	}
+#else
+	for (; w >= 4; w -= 4) {
+		d[0] = convert8888To565(s[0]);
+		d[1] = convert8888To565(s[1]);
+		d[2] = convert8888To565(s[2]);
+		d[3] = convert8888To565(s[3]);
+		s += 4;
+		d += 4;
+	}
+#endif
+
+	for (; w > 0; --w)
+		*d++ = convert8888To565(*s++);
+}
+
+/** RGB555 to RGB565 */
+void crossBlitRow555To565(byte *dst, const byte *src, uint w) {
+	const uint16 *s = (const uint16 *)src;
+	uint16 *d = (uint16 *)dst;
+
+#if defined(CONVERSION_SSE2)
+	const __m128i maskRG = _mm_set1_epi16((int16)0xFFC0);
+	const __m128i maskG = _mm_set1_epi16(0x0020);
+	const __m128i maskB = _mm_set1_epi16(0x001F);
+
+	for (; w >= 8; w -= 8) {
+		const __m128i c = _mm_loadu_si128((const __m128i *)s);
+		_mm_storeu_si128((__m128i *)d, _mm_or_si128(_mm_or_si128(
+		                     _mm_and_si128(_mm_slli_epi16(c, 1), maskRG),
+		                     _mm_and_si128(_mm_srli_epi16(c, 4), maskG)),
+		                     _mm_and_si128(c, maskB)));
+		s += 8;
+		d += 8;
+	}
+#elif defined(CONVERSION_NEON)
+	const uint16x8_t maskRG = vdupq_n_u16(0xFFC0);
+	const uint16x8_t maskG = vdupq_n_u16(0x0020);
+	const uint16x8_t maskB = vdupq_n_u16(0x001F);
+
+	for (; w >= 8; w -= 8) {
+		const uint16x8_t c = vld1q_u16(s);
+		vst1q_u16(d, vorrq_u16(vorrq_u16(
+		              vandq_u16(vshlq_n_u16(c, 1), maskRG),
+		              vandq_u16(vshrq_n_u16(c, 4), maskG)),
+		              vandq_u16(c, maskB)));
+		s += 8;
+		d += 8;
+	}
+#else
+	for (; w >= 4; w -= 4) {
+		d[0] = convert555To565(s[0]);
+		d[1] = convert555To565(s[1]);
+		d[2] = convert555To565(s[2]);
+		d[3] = convert555To565(s[3]);
+		s += 4;
+		d += 4;
+	}
+#endif
+
+	for (; w > 0; --w)
+		*d++ = convert555To565(*s++);
+}
+
+/** ARGB8888 to RGBA8888 (rotate left) or RGBA8888 to ARGB8888 (rotate right) */
+template<bool toRGBA>
+void crossBlitRowRotate8888(byte *dst, const byte *src, uint w) {
+	const uint32 *s = (const uint32 *)src;
+	uint32 *d = (uint32 *)dst;
+
+#if defined(CONVERSION_SSE2)
+	for (; w >= 4; w -= 4) {
+		const __m128i c = _mm_loadu_si128((const __m128i *)s);
+		if (toRGBA)
+			_mm_storeu_si128((__m128i *)d, _mm_or_si128(_mm_slli_epi32(c, 8), _mm_srli_epi32(c, 24)));
+		else
+			_mm_storeu_si128((__m128i *)d, _mm_or_si128(_mm_srli_epi32(c, 8), _mm_slli_epi32(c, 24)));
+		s += 4;
+		d += 4;
+	}
+#elif defined(CONVERSION_NEON)
+	for (; w >= 4; w -= 4) {
+		const uint32x4_t c = vld1q_u32(s);
+		if (toRGBA)
+			vst1q_u32(d, vorrq_u32(vshlq_n_u32(c, 8), vshrq_n_u32(c, 24)));
+		else
+			vst1q_u32(d, vorrq_u32(vshrq_n_u32(c, 8), vshlq_n_u32(c, 24)));
+		s += 4;
+		d += 4;
+	}
+#else
+	for (; w >= 4; w -= 4) {
+		for (int i = 0; i < 4; ++i)
+			d[i] = toRGBA ? convertARGBToRGBA(s[i]) : convertRGBAToARGB(s[i]);
+		s += 4;
+		d += 4;
+	}
+#endif
+
+	for (; w > 0; --w) {
+		*d++ = toRGBA ? convertARGBToRGBA(*s) : convertRGBAToARGB(*s);
+		++s;
+	}
+}
+
+/**
+ * Looks up a specialised row conversion for a pair of formats.
+ * @return the conversion, or 0 if the generic code has to be used
+ */
+CrossBlitRowFunc findCrossBlitRowFunc(const PixelFormat &dstFmt, const PixelFormat &srcFmt) {
+	const PixelFormat rgb555(2, 5, 5, 5, 0, 10, 5, 0, 0);
+	const PixelFormat rgb565(2, 5, 6, 5, 0, 11, 5, 0, 0);
+	const PixelFormat xrgb8888(4, 8, 8, 8, 0, 16, 8, 0, 0);
+	const PixelFormat argb8888(4, 8, 8, 8, 8, 16, 8, 0, 24);
+	const PixelFormat rgba8888(4, 8, 8, 8, 8, 24, 16, 8, 0);
+
+	if (srcFmt == rgb565) {
+		if (dstFmt == xrgb8888)
+			return &crossBlitRow565To8888<0>;
+		if (dstFmt == argb8888)
+			return &crossBlitRow565To8888<0xFF000000>;
+	} else if (srcFmt == rgb555) {
+		if (dstFmt == rgb565)
+			return &crossBlitRow555To565;
+	} else if (srcFmt == xrgb8888) {
+		if (dstFmt == rgb565)
+			return &crossBlitRow8888To565;
+	} else if (srcFmt == argb8888) {
+		if (dstFmt == rgb565)
+			return &crossBlitRow8888To565;
+		if (dstFmt == rgba8888)
+			return &crossBlitRowRotate8888<true>;
+	} else if (srcFmt == rgba8888) {
+		if (dstFmt == argb8888)
+			return &crossBlitRowRotate8888<false>;
+	}
+
+	return 0;
+}
+
+template<typename DstColor, bool backward>
+inline void crossBlitMapLogic(byte *dst, const byte *src, const uint w, const uint h,
+                              const uint srcDelta, const uint dstDelta, const uint32 *map) {
+	for (uint y = 0; y < h; ++y) {
+		uint x = w;
+
+		if (backward) {
+			for (; x >= 4; x -= 4) {
+				*(DstColor *)(dst - 0 * sizeof(DstColor)) = map[src[ 0]];
+				*(DstColor *)(dst - 1 * sizeof(DstColor)) = map[src[-1]];
+				*(DstColor *)(dst - 2 * sizeof(DstColor)) = map[src[-2]];
+				*(DstColor *)(dst - 3 * sizeof(DstColor)) = map[src[-3]];
+				src -= 4;
+				dst -= 4 * sizeof(DstColor);
+			}
+		} else {
+			for (; x >= 4; x -= 4) {
+				*(DstColor *)(dst + 0 * sizeof(DstColor)) = map[src[0]];
+				*(DstColor *)(dst + 1 * sizeof(DstColor)) = map[src[1]];
+				*(DstColor *)(dst + 2 * sizeof(DstColor)) = map[src[2]];
+				*(DstColor *)(dst + 3 * sizeof(DstColor)) = map[src[3]];
+				src += 4;
+				dst += 4 * sizeof(DstColor);
+			}
+		}
+
+		for (; x > 0; --x) {
+			*(DstColor *)dst = map[*src];
+
+			if (backward) {
+				src -= 1;
+				dst -= sizeof(DstColor);
+			} else {
+				src += 1;
+				dst += sizeof(DstColor);
+			}
+		}
+
+		if (backward) {
+			src -= srcDelta;
+			dst -= dstDelta;
+		} else {
+			src += srcDelta;
+			dst += dstDelta;
+		}
+	}
+}
+
 } // End of anonymous namespace
 
 // Function to blit a rect from one color format to another
@@ -126,6 +466,21 @@ bool crossBlit(byte *dst, const byte *src,
 		return true;
 	}
 
+	// Use a specialised conversion for the most common format pairs
+	CrossBlitRowFunc rowFunc = findCrossBlitRowFunc(dstFmt, srcFmt);
+	if (rowFunc) {
+		if (dstFmt.bytesPerPixel > srcFmt.bytesPerPixel) {
+			// Go from the bottom up, for the same reason as below
+			for (uint y = h; y > 0; --y)
+				rowFunc(dst + (y - 1) * dstPitch, src + (y - 1) * srcPitch, w);
+		} else {
+			for (uint y = 0; y < h; ++y)
+				rowFunc(dst + y * dstPitch, src + y * srcPitch, w);
+		}
+
+		return true;
+	}
+
 	// Faster, but larger, to provide optimized handling for each case.
 	const uint srcDelta = (srcPitch - w * srcFmt.bytesPerPixel);
 	const uint dstDelta = (dstPitch - w * dstFmt.bytesPerPixel);
@@ -167,4 +522,29 @@ bool crossBlit(byte *dst, const byte *src,
 	return true;
 }
 
+// Function to blit a rect from one color format to another using a map
+bool crossBlitMap(byte *dst, const byte *src,
+                  const uint dstPitch, const uint srcPitch,
+                  const uint w, const uint h,
+                  const uint bytesPerPixel, const uint32 *map) {
+	// Error out if conversion is impossible
+	if ((bytesPerPixel != 2) && (bytesPerPixel != 4))
+		return false;
+
+	const uint srcDelta = (srcPitch - w);
+	const uint dstDelta = (dstPitch - w * bytesPerPixel);
+
+	// We need to blit the surface from bottom right to top left here, so
+	// that it can be converted in place, like in crossBlit.
+	dst += h * dstPitch - dstDelta - bytesPerPixel;
+	src += h * srcPitch - srcDelta - 1;
+
+	if (bytesPerPixel == 2)
+		crossBlitMapLogic<uint16, true>(dst, src, w, h, srcDelta, dstDelta, map);
+	else
+		crossBlitMapLogic<uint32, true>(dst, src, w, h, srcDelta, dstDelta, map);
+
+	return true;
+}
+
 } // End of namespace Graphics
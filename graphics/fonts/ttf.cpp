@@ -58,6 +58,15 @@ inline int divRoundToNearest(int dividend, int divisor) {
 	return (dividend + (divisor / 2)) / divisor;
 }
 
+struct U32StringHash {
+	uint operator()(const Common::U32String &str) const {
+		uint hash = 0;
+		for (uint32 i = 0; i < str.size(); ++i)
+			hash = hash * 31 + str[i];
+		return hash;
+	}
+};
+
 } // End of anonymous namespace
 
 class TTFLibrary : public Common::Singleton<TTFLibrary> {
@@ -107,6 +116,14 @@ void TTFLibrary::closeFont(FT_Face &face) {
 	FT_Done_Face(face);
 }
 
+static int s_maxPageSize = 512;
+static uint s_maxCachePages = 2;
+
+void setTTFGlyphCacheLimits(uint pageSize, uint cachePages) {
+	s_maxPageSize = MAX<uint>(pageSize, 1);
+	s_maxCachePages = MAX<uint>(cachePages, 1);
+}
+
 class TTFFont : public Font {
 public:
 	TTFFont();
@@ -125,6 +142,9 @@ public:
 	virtual Common::Rect getBoundingBox(uint32 chr) const;
 
 	virtual void drawChar(Surface *dst, uint32 chr, int x, int y, uint32 color) const;
+
+	virtual int getStringWidth(const Common::String &str) const;
+	virtual int getStringWidth(const Common::U32String &str) const;
 private:
 	bool _initialized;
 	FT_Face _face;
@@ -136,17 +156,61 @@ private:
 	int _ascent, _descent;
 
 	struct Glyph {
-		Surface image;
 		int xOffset, yOffset;
 		int advance;
 		FT_UInt slot;
+
+		// Where the bitmap is stored in the atlas, page is -1 when there is
+		// no bitmap or it was evicted
+		int width, height;
+		int page;
+		int x, y;
+	};
+
+	/**
+	 * A surface the glyph bitmaps are packed into, in rows ("shelves") as
+	 * high as the highest glyph in them.
+	 */
+	struct AtlasPage {
+		Surface surface;
+		int shelfX, shelfY, shelfHeight;
+		// Pages of glyphs loaded up front are never evicted
+		bool pinned;
+		uint32 lastUse;
 	};
 
-	bool cacheGlyph(Glyph &glyph, uint32 chr) const;
-	typedef Common::HashMap<uint32, Glyph> GlyphCache;
-	mutable GlyphCache _glyphs;
+	static const uint kMaxCachedStringWidths = 1024;
+	static const uint kMaxCachedKerningPairs = 4096;
+
+	mutable Common::Array<Glyph> _glyphs;
+	// Indices into _glyphs, or -1 for characters without a glyph
+	int _latin1Glyphs[256];
+	typedef Common::HashMap<uint32, int> GlyphMap;
+	mutable GlyphMap _glyphMap;
 	bool _allowLateCaching;
-	void assureCached(uint32 chr) const;
+
+	mutable Common::Array<AtlasPage *> _pages;
+	mutable int _pinnedPage, _cachePage;
+	mutable uint32 _useCounter;
+	// Glyph metrics are kept for every character ever looked up, but only
+	// this many pages of bitmaps loaded later on are kept around.
+	const int _maxPageSize;
+	const uint _maxCachePages;
+
+	typedef Common::HashMap<uint32, int> KerningCache;
+	mutable KerningCache _kerning;
+	typedef Common::HashMap<Common::String, int> StringWidthCache;
+	mutable StringWidthCache _stringWidths;
+	typedef Common::HashMap<Common::U32String, int, U32StringHash> U32StringWidthCache;
+	mutable U32StringWidthCache _u32StringWidths;
+
+	Glyph *getGlyph(uint32 chr) const;
+	int cacheGlyph(uint32 chr, bool pinned) const;
+	bool loadGlyph(FT_UInt slot) const;
+	void storeGlyphBitmap(Glyph &glyph, bool pinned) const;
+	bool allocateGlyph(Glyph &glyph, bool pinned) const;
+	int addPage(int width, int height, bool pinned) const;
+	void evictPage(int page) const;
 
 	Common::SeekableReadStream *readTTFTable(FT_ULong tag) const;
 
@@ -161,8 +225,11 @@ private:
 
 TTFFont::TTFFont()
     : _initialized(false), _face(), _ttfFile(0), _size(0), _width(0), _height(0), _ascent(0),
-      _descent(0), _glyphs(), _loadFlags(FT_LOAD_TARGET_NORMAL), _renderMode(FT_RENDER_MODE_NORMAL),
-      _hasKerning(false), _allowLateCaching(false) {
+      _descent(0), _glyphs(), _allowLateCaching(false), _pinnedPage(-1), _cachePage(-1), _useCounter(0),
+      _maxPageSize(s_maxPageSize), _maxCachePages(s_maxCachePages),
+      _loadFlags(FT_LOAD_TARGET_NORMAL), _renderMode(FT_RENDER_MODE_NORMAL), _hasKerning(false) {
+	for (uint i = 0; i < ARRAYSIZE(_latin1Glyphs); ++i)
+		_latin1Glyphs[i] = -1;
 }
 
 TTFFont::~TTFFont() {
@@ -172,11 +239,13 @@ TTFFont::~TTFFont() {
 		delete[] _ttfFile;
 		_ttfFile = 0;
 
-		for (GlyphCache::iterator i = _glyphs.begin(), end = _glyphs.end(); i != end; ++i)
-			i->_value.image.free();
-
 		_initialized = false;
 	}
+
+	for (uint i = 0; i < _pages.size(); ++i) {
+		_pages[i]->surface.free();
+		delete _pages[i];
+	}
 }
 
 bool TTFFont::load(Common::SeekableReadStream &stream, int size, TTFSizeMode sizeMode, uint dpi, TTFRenderMode renderMode, const uint32 *mapping) {
@@ -253,11 +322,8 @@ bool TTFFont::load(Common::SeekableReadStream &stream, int size, TTFSizeMode siz
 		_allowLateCaching = true;
 
 		// Load all ISO-8859-1 characters.
-		for (uint i = 0; i < 256; ++i) {
-			if (!cacheGlyph(_glyphs[i], i)) {
-				_glyphs.erase(i);
-			}
-		}
+		for (uint i = 0; i < 256; ++i)
+			_latin1Glyphs[i] = cacheGlyph(i, true);
 	} else {
 		// We have a fixed map of characters do not load more later.
 		_allowLateCaching = false;
@@ -267,11 +333,9 @@ bool TTFFont::load(Common::SeekableReadStream &stream, int size, TTFSizeMode siz
 			const bool isRequired = (mapping[i] & 0x80000000) != 0;
 			// Check whether loading an important glyph fails and error out if
 			// that is the case.
-			if (!cacheGlyph(_glyphs[i], unicode)) {
-				_glyphs.erase(i);
-				if (isRequired)
-					return false;
-			}
+			_latin1Glyphs[i] = cacheGlyph(unicode, true);
+			if (_latin1Glyphs[i] < 0 && isRequired)
+				return false;
 		}
 	}
 
@@ -408,57 +472,79 @@ int TTFFont::getMaxCharWidth() const {
 }
 
 int TTFFont::getCharWidth(uint32 chr) const {
-	assureCached(chr);
-	GlyphCache::const_iterator glyphEntry = _glyphs.find(chr);
-	if (glyphEntry == _glyphs.end())
+	const Glyph *glyph = getGlyph(chr);
+	if (!glyph)
 		return 0;
 	else
-		return glyphEntry->_value.advance;
+		return glyph->advance;
 }
 
 int TTFFont::getKerningOffset(uint32 left, uint32 right) const {
 	if (!_hasKerning)
 		return 0;
 
-	assureCached(left);
-	assureCached(right);
-
-	FT_UInt leftGlyph, rightGlyph;
-	GlyphCache::const_iterator glyphEntry;
-
-	glyphEntry = _glyphs.find(left);
-	if (glyphEntry != _glyphs.end()) {
-		leftGlyph = glyphEntry->_value.slot;
-	} else {
+	// Looking up the right glyph may move the left one, so only keep its slot
+	const Glyph *glyph = getGlyph(left);
+	if (!glyph)
 		return 0;
-	}
+	FT_UInt leftGlyph = glyph->slot;
 
-	glyphEntry = _glyphs.find(right);
-	if (glyphEntry != _glyphs.end()) {
-		rightGlyph = glyphEntry->_value.slot;
-	} else {
+	glyph = getGlyph(right);
+	if (!glyph)
 		return 0;
-	}
+	FT_UInt rightGlyph = glyph->slot;
 
 	if (!leftGlyph || !rightGlyph)
 		return 0;
 
+	// Fonts have at most 65535 glyphs, so both fit in the key
+	const uint32 pair = (leftGlyph << 16) | rightGlyph;
+	KerningCache::const_iterator kerning = _kerning.find(pair);
+	if (kerning != _kerning.end())
+		return kerning->_value;
+
+	if (_kerning.size() >= kMaxCachedKerningPairs)
+		_kerning.clear();
+
 	FT_Vector kerningVector;
 	FT_Get_Kerning(_face, leftGlyph, rightGlyph, FT_KERNING_DEFAULT, &kerningVector);
-	return (kerningVector.x / 64);
+	const int offset = kerningVector.x / 64;
+	_kerning[pair] = offset;
+	return offset;
 }
 
 Common::Rect TTFFont::getBoundingBox(uint32 chr) const {
-	assureCached(chr);
-	GlyphCache::const_iterator glyphEntry = _glyphs.find(chr);
-	if (glyphEntry == _glyphs.end()) {
+	const Glyph *glyph = getGlyph(chr);
+	if (!glyph)
 		return Common::Rect();
-	} else {
-		const int xOffset = glyphEntry->_value.xOffset;
-		const int yOffset = glyphEntry->_value.yOffset;
-		const Graphics::Surface &image = glyphEntry->_value.image;
-		return Common::Rect(xOffset, yOffset, xOffset + image.w, yOffset + image.h);
-	}
+	else
+		return Common::Rect(glyph->xOffset, glyph->yOffset, glyph->xOffset + glyph->width, glyph->yOffset + glyph->height);
+}
+
+int TTFFont::getStringWidth(const Common::String &str) const {
+	StringWidthCache::const_iterator entry = _stringWidths.find(str);
+	if (entry != _stringWidths.end())
+		return entry->_value;
+
+	if (_stringWidths.size() >= kMaxCachedStringWidths)
+		_stringWidths.clear();
+
+	const int width = Font::getStringWidth(str);
+	_stringWidths[str] = width;
+	return width;
+}
+
+int TTFFont::getStringWidth(const Common::U32String &str) const {
+	U32StringWidthCache::const_iterator entry = _u32StringWidths.find(str);
+	if (entry != _u32StringWidths.end())
+		return entry->_value;
+
+	if (_u32StringWidths.size() >= kMaxCachedStringWidths)
+		_u32StringWidths.clear();
+
+	const int width = Font::getStringWidth(str);
+	_u32StringWidths[str] = width;
+	return width;
 }
 
 namespace {
@@ -500,12 +586,24 @@ void renderGlyph(uint8 *dstPos, const int dstPitch, const uint8 *srcPos, const i
 } // End of anonymous namespace
 
 void TTFFont::drawChar(Surface *dst, uint32 chr, int x, int y, uint32 color) const {
-	assureCached(chr);
-	GlyphCache::const_iterator glyphEntry = _glyphs.find(chr);
-	if (glyphEntry == _glyphs.end())
+	Glyph *glyphEntry = getGlyph(chr);
+	if (!glyphEntry || !glyphEntry->width || !glyphEntry->height)
 		return;
 
-	const Glyph &glyph = glyphEntry->_value;
+	Glyph &glyph = *glyphEntry;
+
+	// Bring the bitmap back in when its page was evicted
+	if (glyph.page < 0) {
+		if (!loadGlyph(glyph.slot))
+			return;
+
+		storeGlyphBitmap(glyph, false);
+		if (glyph.page < 0)
+			return;
+	}
+
+	const AtlasPage &page = *_pages[glyph.page];
+	_pages[glyph.page]->lastUse = ++_useCounter;
 
 	x += glyph.xOffset;
 	y += glyph.yOffset;
@@ -515,10 +613,11 @@ void TTFFont::drawChar(Surface *dst, uint32 chr, int x, int y, uint32 color) con
 	if (y > dst->h)
 		return;
 
-	int w = glyph.image.w;
-	int h = glyph.image.h;
+	int w = glyph.width;
+	int h = glyph.height;
 
-	const uint8 *srcPos = (const uint8 *)glyph.image.getPixels();
+	const uint8 *srcPos = (const uint8 *)page.surface.getBasePtr(glyph.x, glyph.y);
+	const int srcPitch = page.surface.pitch;
 
 	// Make sure we are not drawing outside the screen bounds
 	if (x < 0) {
@@ -534,7 +633,7 @@ void TTFFont::drawChar(Surface *dst, uint32 chr, int x, int y, uint32 color) con
 		return;
 
 	if (y < 0) {
-		srcPos -= y * glyph.image.pitch;
+		srcPos -= y * srcPitch;
 		h += y;
 		y = 0;
 	}
@@ -563,22 +662,62 @@ void TTFFont::drawChar(Surface *dst, uint32 chr, int x, int y, uint32 color) con
 			}
 
 			dstPos += dst->pitch;
-			srcPos += glyph.image.pitch;
+			srcPos += srcPitch;
 		}
 	} else if (dst->format.bytesPerPixel == 2) {
-		renderGlyph<uint16>(dstPos, dst->pitch, srcPos, glyph.image.pitch, w, h, color, dst->format);
+		renderGlyph<uint16>(dstPos, dst->pitch, srcPos, srcPitch, w, h, color, dst->format);
 	} else if (dst->format.bytesPerPixel == 4) {
-		renderGlyph<uint32>(dstPos, dst->pitch, srcPos, glyph.image.pitch, w, h, color, dst->format);
+		renderGlyph<uint32>(dstPos, dst->pitch, srcPos, srcPitch, w, h, color, dst->format);
+	}
+}
+
+TTFFont::Glyph *TTFFont::getGlyph(uint32 chr) const {
+	int index;
+
+	if (chr < ARRAYSIZE(_latin1Glyphs)) {
+		index = _latin1Glyphs[chr];
+	} else {
+		GlyphMap::const_iterator entry = _glyphMap.find(chr);
+		if (entry != _glyphMap.end()) {
+			index = entry->_value;
+		} else if (_allowLateCaching) {
+			// Characters without a glyph are remembered too, so they are
+			// only looked up once
+			index = cacheGlyph(chr, false);
+			_glyphMap[chr] = index;
+		} else {
+			index = -1;
+		}
 	}
+
+	return index >= 0 ? &_glyphs[index] : 0;
 }
 
-bool TTFFont::cacheGlyph(Glyph &glyph, uint32 chr) const {
+int TTFFont::cacheGlyph(uint32 chr, bool pinned) const {
 	FT_UInt slot = FT_Get_Char_Index(_face, chr);
 	if (!slot)
-		return false;
+		return -1;
+
+	if (!loadGlyph(slot))
+		return -1;
 
+	Glyph glyph;
 	glyph.slot = slot;
+	glyph.xOffset = _face->glyph->bitmap_left;
+	glyph.yOffset = _ascent - _face->glyph->bitmap_top;
+	glyph.advance = ftCeil26_6(_face->glyph->advance.x);
+	glyph.width = _face->glyph->bitmap.width;
+	glyph.height = _face->glyph->bitmap.rows;
+	glyph.page = -1;
+	glyph.x = glyph.y = 0;
 
+	storeGlyphBitmap(glyph, pinned);
+
+	_glyphs.push_back(glyph);
+	return _glyphs.size() - 1;
+}
+
+bool TTFFont::loadGlyph(FT_UInt slot) const {
 	// We use the light target and render mode to improve the looks of the
 	// glyphs. It is most noticable in FreeSansBold.ttf, where otherwise the
 	// 't' glyph looks like it is cut off on the right side.
@@ -591,13 +730,22 @@ bool TTFFont::cacheGlyph(Glyph &glyph, uint32 chr) const {
 	if (_face->glyph->format != FT_GLYPH_FORMAT_BITMAP)
 		return false;
 
-	glyph.xOffset = _face->glyph->bitmap_left;
-	glyph.yOffset = _ascent - _face->glyph->bitmap_top;
+	const FT_Bitmap &bitmap = _face->glyph->bitmap;
+	if (bitmap.pixel_mode != FT_PIXEL_MODE_MONO && bitmap.pixel_mode != FT_PIXEL_MODE_GRAY) {
+		warning("TTFFont::loadGlyph: Unsupported pixel mode %d", bitmap.pixel_mode);
+		return false;
+	}
 
-	glyph.advance = ftCeil26_6(_face->glyph->advance.x);
+	return true;
+}
+
+void TTFFont::storeGlyphBitmap(Glyph &glyph, bool pinned) const {
+	if (!glyph.width || !glyph.height || !allocateGlyph(glyph, pinned))
+		return;
 
 	const FT_Bitmap &bitmap = _face->glyph->bitmap;
-	glyph.image.create(bitmap.width, bitmap.rows, PixelFormat::createFormatCLUT8());
+	AtlasPage &page = *_pages[glyph.page];
+	page.lastUse = ++_useCounter;
 
 	const uint8 *src = bitmap.buffer;
 	int srcPitch = bitmap.pitch;
@@ -606,56 +754,134 @@ bool TTFFont::cacheGlyph(Glyph &glyph, uint32 chr) const {
 		srcPitch = -srcPitch;
 	}
 
-	uint8 *dst = (uint8 *)glyph.image.getPixels();
-	memset(dst, 0, glyph.image.h * glyph.image.pitch);
+	uint8 *dst = (uint8 *)page.surface.getBasePtr(glyph.x, glyph.y);
 
 	switch (bitmap.pixel_mode) {
 	case FT_PIXEL_MODE_MONO:
-		for (int y = 0; y < (int)bitmap.rows; ++y) {
+		for (int y = 0; y < glyph.height; ++y) {
 			const uint8 *curSrc = src;
 			uint8 mask = 0;
 
-			for (int x = 0; x < (int)bitmap.width; ++x) {
+			for (int x = 0; x < glyph.width; ++x) {
 				if ((x % 8) == 0)
 					mask = *curSrc++;
 
-				if (mask & 0x80)
-					*dst = 255;
-
+				dst[x] = (mask & 0x80) ? 255 : 0;
 				mask <<= 1;
-				++dst;
 			}
 
+			dst += page.surface.pitch;
 			src += srcPitch;
 		}
 		break;
 
 	case FT_PIXEL_MODE_GRAY:
-		for (int y = 0; y < (int)bitmap.rows; ++y) {
-			memcpy(dst, src, bitmap.width);
-			dst += glyph.image.pitch;
+		for (int y = 0; y < glyph.height; ++y) {
+			memcpy(dst, src, glyph.width);
+			dst += page.surface.pitch;
 			src += srcPitch;
 		}
 		break;
 
 	default:
-		warning("TTFFont::cacheGlyph: Unsupported pixel mode %d", bitmap.pixel_mode);
-		glyph.image.free();
-		return false;
+		break;
 	}
+}
+
+bool TTFFont::allocateGlyph(Glyph &glyph, bool pinned) const {
+	int &current = pinned ? _pinnedPage : _cachePage;
 
+	if (current >= 0) {
+		AtlasPage &page = *_pages[current];
+
+		// Start a new shelf when the glyph doesn't fit on the current one
+		if (page.shelfX + glyph.width > page.surface.w) {
+			page.shelfX = 0;
+			page.shelfY += page.shelfHeight;
+			page.shelfHeight = 0;
+		}
+
+		if (page.shelfX + glyph.width <= page.surface.w && page.shelfY + glyph.height <= page.surface.h) {
+			glyph.page = current;
+			glyph.x = page.shelfX;
+			glyph.y = page.shelfY;
+
+			page.shelfX += glyph.width;
+			page.shelfHeight = MAX(page.shelfHeight, glyph.height);
+			return true;
+		}
+	}
+
+	// The page is full, continue on a new one. A page big enough for 16
+	// rows of 16 glyphs fits all of ISO-8859-1 for most fonts.
+	const int size = CLIP(_height * 16, MIN(128, _maxPageSize), _maxPageSize);
+	current = addPage(MAX(size, glyph.width), MAX(size, glyph.height), pinned);
+	if (current < 0)
+		return false;
+
+	AtlasPage &page = *_pages[current];
+	glyph.page = current;
+	glyph.x = 0;
+	glyph.y = 0;
+
+	page.shelfX = glyph.width;
+	page.shelfHeight = glyph.height;
 	return true;
 }
 
-void TTFFont::assureCached(uint32 chr) const {
-	if (!chr || !_allowLateCaching || _glyphs.contains(chr)) {
-		return;
+int TTFFont::addPage(int width, int height, bool pinned) const {
+	int index = -1;
+
+	if (!pinned) {
+		uint cachePages = 0;
+		for (uint i = 0; i < _pages.size(); ++i) {
+			if (_pages[i]->pinned)
+				continue;
+
+			cachePages++;
+			if (index < 0 || _pages[i]->lastUse < _pages[index]->lastUse)
+				index = i;
+		}
+
+		// Reuse the least recently used page once there are enough of them
+		if (cachePages >= _maxCachePages) {
+			evictPage(index);
+		} else {
+			index = -1;
+		}
+	}
+
+	if (index < 0) {
+		_pages.push_back(new AtlasPage());
+		index = _pages.size() - 1;
 	}
 
-	Glyph newGlyph;
-	if (cacheGlyph(newGlyph, chr)) {
-		_glyphs[chr] = newGlyph;
+	AtlasPage &page = *_pages[index];
+	if (page.surface.w < width || page.surface.h < height) {
+		page.surface.free();
+		page.surface.create(MAX<int>(page.surface.w, width), MAX<int>(page.surface.h, height), PixelFormat::createFormatCLUT8());
 	}
+
+	// Glyphs are only written over their own area, which skips the gaps
+	// between them when drawing.
+	memset(page.surface.getPixels(), 0, page.surface.pitch * page.surface.h);
+
+	page.shelfX = 0;
+	page.shelfY = 0;
+	page.shelfHeight = 0;
+	page.pinned = pinned;
+	page.lastUse = ++_useCounter;
+	return index;
+}
+
+void TTFFont::evictPage(int page) const {
+	for (uint i = 0; i < _glyphs.size(); ++i) {
+		if (_glyphs[i].page == page)
+			_glyphs[i].page = -1;
+	}
+
+	if (_cachePage == page)
+		_cachePage = -1;
 }
 
 Font *loadTTFFont(Common::SeekableReadStream &stream, int size, TTFSizeMode sizeMode, uint dpi, TTFRenderMode renderMode, const uint32 *mapping) {
@@ -114,6 +114,20 @@ Font *loadTTFFont(Common::SeekableReadStream &stream, int size, TTFSizeMode size
  */
 Font *loadTTFFontFromArchive(const Common::String &filename, int size, TTFSizeMode sizeMode = kTTFSizeModeCharacter, uint dpi = 0, TTFRenderMode renderMode = kTTFRenderModeLight, const uint32 *mapping = 0);
 
+/**
+ * Limits the memory used for the glyph bitmaps of TTF fonts loaded afterwards.
+ *
+ * Glyphs are packed into atlas pages. The glyphs loaded with the font are
+ * kept for its whole life, the ones needed later on (e.g. for CJK text) share
+ * a fixed number of pages, and the least recently used page is recycled when
+ * they are full.
+ *
+ * @param pageSize   The largest width and height of an atlas page. Pages are
+ *                   only bigger when a single glyph does not fit.
+ * @param cachePages The number of pages for glyphs loaded later on.
+ */
+void setTTFGlyphCacheLimits(uint pageSize = 512, uint cachePages = 2);
+
 void shutdownTTF();
 
 } // End of namespace Graphics
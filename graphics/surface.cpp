@@ -439,7 +439,16 @@ Graphics::Surface *Surface::convertTo(const PixelFormat &dstFormat, const byte *
 
 	surface->create(w, h, dstFormat);
 
-	if (format.bytesPerPixel == 1) {
+	if (format.bytesPerPixel == 1 && dstFormat.bytesPerPixel != 3) {
+		// Converting from paletted to high color, through a table
+		assert(palette);
+
+		uint32 map[256];
+		for (int i = 0; i < 256; i++)
+			map[i] = dstFormat.RGBToColor(palette[i * 3], palette[i * 3 + 1], palette[i * 3 + 2]);
+
+		crossBlitMap((byte *)surface->getPixels(), (const byte *)getPixels(), surface->pitch, pitch, w, h, dstFormat.bytesPerPixel, map);
+	} else if (format.bytesPerPixel == 1) {
 		// Converting from paletted to high color
 		assert(palette);
 
@@ -465,6 +474,9 @@ Graphics::Surface *Surface::convertTo(const PixelFormat &dstFormat, const byte *
 				dstRow += dstFormat.bytesPerPixel;
 			}
 		}
+	} else if (dstFormat.bytesPerPixel != 3) {
+		// Converting from high color to high color
+		crossBlit((byte *)surface->getPixels(), (const byte *)getPixels(), surface->pitch, pitch, w, h, dstFormat, format);
 	} else {
 		// Converting from high color to high color
 		for (int y = 0; y < h; y++) {
@@ -114,6 +114,9 @@ HeaderState loadHeader(Common::SeekableReadStream &in, ThumbnailHeader &header,
 		return kHeaderPresent;
 	}
 }
+
+bool s_screenThumbnailsEnabled = true;
+
 } // end of anonymous namespace
 
 bool checkThumbnailHeader(Common::SeekableReadStream &in) {
@@ -205,7 +208,9 @@ bool loadThumbnail(Common::SeekableReadStream &in, Graphics::Surface *&thumbnail
 bool saveThumbnail(Common::WriteStream &out) {
 	Graphics::Surface thumb;
 
-	if (!createThumbnailFromScreen(&thumb)) {
+	if (!s_screenThumbnailsEnabled) {
+		thumb.create(1, 1, Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
+	} else if (!createThumbnailFromScreen(&thumb)) {
 		warning("Couldn't create thumbnail from screen, aborting thumbnail save");
 		return false;
 	}
@@ -271,6 +276,9 @@ bool saveThumbnail(Common::WriteStream &out, const Graphics::Surface &thumb) {
 	return true;
 }
 
+void setScreenThumbnailsEnabled(bool enabled) {
+	s_screenThumbnailsEnabled = enabled;
+}
 
 /**
  * Returns an array indicating which pixels of a source image horizontally or vertically get
@@ -65,6 +65,14 @@ bool saveThumbnail(Common::WriteStream &out);
  */
 bool saveThumbnail(Common::WriteStream &out, const Graphics::Surface &thumb);
 
+/**
+ * Enables or disables creating thumbnails from the screen contents.
+ * While disabled, saveThumbnail saves a blank 1x1 thumbnail instead, so
+ * the format of saves stays the same. Backends use this for saves that
+ * nobody gets to see.
+ */
+void setScreenThumbnailsEnabled(bool enabled);
+
 /**
  * Grabs framebuffer into surface
  *
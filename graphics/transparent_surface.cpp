@@ -28,6 +28,7 @@
 
 
 #include "common/algorithm.h"
+#include "common/array.h"
 #include "common/endian.h"
 #include "common/util.h"
 #include "common/rect.h"
@@ -37,6 +38,11 @@
 #include "graphics/transparent_surface.h"
 #include "graphics/transform_tools.h"
 
+#if defined(__SSE2__) && defined(SCUMM_LITTLE_ENDIAN)
+#define TRANSPARENT_SURFACE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace Graphics {
 
 static const int kBModShift = 0;//img->format.bShift;
@@ -57,12 +63,35 @@ static const int kGIndex = 1;
 static const int kRIndex = 0;
 #endif
 
-void doBlitOpaqueFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep);
-void doBlitBinaryFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep);
-void doBlitAlphaBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color);
-void doBlitAdditiveBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color);
-void doBlitSubtractiveBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color);
-void doBlitMultiplyBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color);
+/**
+ * Runs of visible pixels in the rows of a surface, see
+ * TransparentSurface::buildSpans(). Fully transparent pixels are not part
+ * of any run.
+ */
+struct TransparentSurfaceSpans {
+	struct Span {
+		uint16 start, end;
+		bool opaque;
+	};
+
+	// The surface the index was built for
+	const void *pixels;
+	int w, h, pitch;
+
+	// The runs of row y are spans[rowStart[y]] up to spans[rowStart[y + 1]]
+	Common::Array<uint32> rowStart;
+	Common::Array<Span> spans;
+};
+
+/**
+ * Blends one row of pixels into the target.
+ * @param in		the first input pixel
+ * @param out		the first output pixel
+ * @param width		the number of pixels
+ * @param inStep	the distance in bytes between input pixels, 4 or -4
+ * @param color		colormod in 0xAARRGGBB format
+ */
+typedef void (*BlendRowFunc)(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color);
 
 TransparentSurface::TransparentSurface() : Surface(), _alphaMode(ALPHA_FULL) {}
 
@@ -84,15 +113,21 @@ TransparentSurface::TransparentSurface(const Surface &surf, bool copyData) : Sur
 /**
  * Optimized version of doBlit to be used w/opaque blitting (no alpha).
  */
-void doBlitOpaqueFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep) {
+static void doBlitOpaqueFast(const byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep) {
 
-	byte *in;
+	const byte *in;
 	byte *out;
 
 	for (uint32 i = 0; i < height; i++) {
 		out = outo;
 		in = ino;
-		memcpy(out, in, width * 4);
+		if (inStep == 4) {
+			memcpy(out, in, width * 4);
+		} else {
+			// Flipped horizontally
+			for (uint32 j = 0; j < width; j++)
+				memcpy(out + j * 4, in + (int32)j * inStep, 4);
+		}
 		for (uint32 j = 0; j < width; j++) {
 			out[kAIndex] = 0xFF;
 			out += 4;
@@ -103,297 +138,730 @@ void doBlitOpaqueFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32
 }
 
 /**
- * Optimized version of doBlit to be used w/binary blitting (blit or no-blit, no blending).
+ * Blits rows of pixels, one row at a time
+ * @param ino a pointer to the input surface
+ * @param outo a pointer to the output surface
+ * @param width width of the input surface
+ * @param height height of the input surface
+ * @param pitch pitch of the output surface - that is, width in bytes of every row, usually bpp * width of the TARGET surface (the area we are blitting to might be smaller, do the math)
+ * @inStep size in bytes to skip to address each pixel, usually bpp of the source surface
+ * @inoStep width in bytes of every row on the *input* surface / kind of like pitch
+ * @color colormod in 0xAARRGGBB format - 0xFFFFFFFF for no colormod
+ * @blendRow the blending of a row
  */
-void doBlitBinaryFast(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep) {
+static void doBlitRows(const byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color, BlendRowFunc blendRow) {
+	for (uint32 i = 0; i < height; i++) {
+		blendRow(ino, outo, width, inStep, color);
+		outo += pitch;
+		ino += inoStep;
+	}
+}
 
-	byte *in;
-	byte *out;
+/**
+ * Binary blitting (blit or no-blit, no blending).
+ */
+static void blendRowBinaryScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	for (uint32 j = 0; j < width; j++) {
+		uint32 pix = *(const uint32 *)in;
+		int a = in[kAIndex];
 
-	for (uint32 i = 0; i < height; i++) {
-		out = outo;
-		in = ino;
-		for (uint32 j = 0; j < width; j++) {
-			uint32 pix = *(uint32 *)in;
-			int a = in[kAIndex];
+		if (a != 0) {   // Full opacity (Any value not exactly 0 is Opaque here)
+			*(uint32 *)out = pix;
+			out[kAIndex] = 0xFF;
+		}
+		out += 4;
+		in += inStep;
+	}
+}
 
-			if (a != 0) {   // Full opacity (Any value not exactly 0 is Opaque here)
-				*(uint32 *)out = pix;
-				out[kAIndex] = 0xFF;
-			}
-			out += 4;
-			in += inStep;
+/**
+ * Alpha blending without colormod.
+ */
+static void blendRowAlphaScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	for (uint32 j = 0; j < width; j++) {
+
+		if (in[kAIndex] != 0) {
+			out[kAIndex] = 255;
+			out[kRIndex] = ((in[kRIndex] * in[kAIndex]) + out[kRIndex] * (255 - in[kAIndex])) >> 8;
+			out[kGIndex] = ((in[kGIndex] * in[kAIndex]) + out[kGIndex] * (255 - in[kAIndex])) >> 8;
+			out[kBIndex] = ((in[kBIndex] * in[kAIndex]) + out[kBIndex] * (255 - in[kAIndex])) >> 8;
 		}
-		outo += pitch;
-		ino += inoStep;
+
+		in += inStep;
+		out += 4;
 	}
 }
 
 /**
- * Optimized version of doBlit to be used with alpha blended blitting
- * @param ino a pointer to the input surface
- * @param outo a pointer to the output surface
- * @param width width of the input surface
- * @param height height of the input surface
- * @param pitch pitch of the output surface - that is, width in bytes of every row, usually bpp * width of the TARGET surface (the area we are blitting to might be smaller, do the math)
- * @inStep size in bytes to skip to address each pixel, usually bpp of the source surface
- * @inoStep width in bytes of every row on the *input* surface / kind of like pitch
- * @color colormod in 0xAARRGGBB format - 0xFFFFFFFF for no colormod
+ * Alpha blending without colormod, of pixels which are all fully opaque.
+ * This gives the same result as blendRowAlpha.
  */
-void doBlitAlphaBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color) {
-	byte *in;
-	byte *out;
+static void blendRowAlphaOpaqueScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	for (uint32 j = 0; j < width; j++) {
+		out[kAIndex] = 255;
+		out[kRIndex] = (in[kRIndex] * 255) >> 8;
+		out[kGIndex] = (in[kGIndex] * 255) >> 8;
+		out[kBIndex] = (in[kBIndex] * 255) >> 8;
+
+		in += inStep;
+		out += 4;
+	}
+}
 
-	if (color == 0xffffffff) {
+/**
+ * Alpha blending with colormod.
+ */
+static void blendRowAlphaModScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	byte ca = (color >> kAModShift) & 0xFF;
+	byte cr = (color >> kRModShift) & 0xFF;
+	byte cg = (color >> kGModShift) & 0xFF;
+	byte cb = (color >> kBModShift) & 0xFF;
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+	for (uint32 j = 0; j < width; j++) {
 
-				if (in[kAIndex] != 0) {
-					out[kAIndex] = 255;
-					out[kRIndex] = ((in[kRIndex] * in[kAIndex]) + out[kRIndex] * (255 - in[kAIndex])) >> 8;
-					out[kGIndex] = ((in[kGIndex] * in[kAIndex]) + out[kGIndex] * (255 - in[kAIndex])) >> 8;
-					out[kBIndex] = ((in[kBIndex] * in[kAIndex]) + out[kBIndex] * (255 - in[kAIndex])) >> 8;
-				}
+		uint32 ina = in[kAIndex] * ca >> 8;
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+		if (ina != 0) {
+			out[kAIndex] = 255;
+			out[kBIndex] = (out[kBIndex] * (255 - ina) >> 8);
+			out[kGIndex] = (out[kGIndex] * (255 - ina) >> 8);
+			out[kRIndex] = (out[kRIndex] * (255 - ina) >> 8);
+
+			out[kBIndex] = out[kBIndex] + (in[kBIndex] * ina * cb >> 16);
+			out[kGIndex] = out[kGIndex] + (in[kGIndex] * ina * cg >> 16);
+			out[kRIndex] = out[kRIndex] + (in[kRIndex] * ina * cr >> 16);
 		}
-	} else {
 
-		byte ca = (color >> kAModShift) & 0xFF;
-		byte cr = (color >> kRModShift) & 0xFF;
-		byte cg = (color >> kGModShift) & 0xFF;
-		byte cb = (color >> kBModShift) & 0xFF;
+		in += inStep;
+		out += 4;
+	}
+}
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+/**
+ * Additive blending without colormod.
+ */
+static void blendRowAdditiveScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	for (uint32 j = 0; j < width; j++) {
 
-				uint32 ina = in[kAIndex] * ca >> 8;
+		if (in[kAIndex] != 0) {
+			out[kRIndex] = MIN((in[kRIndex] * in[kAIndex] >> 8) + out[kRIndex], 255);
+			out[kGIndex] = MIN((in[kGIndex] * in[kAIndex] >> 8) + out[kGIndex], 255);
+			out[kBIndex] = MIN((in[kBIndex] * in[kAIndex] >> 8) + out[kBIndex], 255);
+		}
 
-				if (ina != 0) {
-					out[kAIndex] = 255;
-					out[kBIndex] = (out[kBIndex] * (255 - ina) >> 8);
-					out[kGIndex] = (out[kGIndex] * (255 - ina) >> 8);
-					out[kRIndex] = (out[kRIndex] * (255 - ina) >> 8);
+		in += inStep;
+		out += 4;
+	}
+}
 
-					out[kBIndex] = out[kBIndex] + (in[kBIndex] * ina * cb >> 16);
-					out[kGIndex] = out[kGIndex] + (in[kGIndex] * ina * cg >> 16);
-					out[kRIndex] = out[kRIndex] + (in[kRIndex] * ina * cr >> 16);
-				}
+/**
+ * Additive blending with colormod.
+ */
+static void blendRowAdditiveModScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	byte ca = (color >> kAModShift) & 0xFF;
+	byte cr = (color >> kRModShift) & 0xFF;
+	byte cg = (color >> kGModShift) & 0xFF;
+	byte cb = (color >> kBModShift) & 0xFF;
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+	for (uint32 j = 0; j < width; j++) {
+
+		uint32 ina = in[kAIndex] * ca >> 8;
+
+		if (cb != 255) {
+			out[kBIndex] = MIN<uint>(out[kBIndex] + ((in[kBIndex] * cb * ina) >> 16), 255u);
+		} else {
+			out[kBIndex] = MIN<uint>(out[kBIndex] + (in[kBIndex] * ina >> 8), 255u);
+		}
+
+		if (cg != 255) {
+			out[kGIndex] = MIN<uint>(out[kGIndex] + ((in[kGIndex] * cg * ina) >> 16), 255u);
+		} else {
+			out[kGIndex] = MIN<uint>(out[kGIndex] + (in[kGIndex] * ina >> 8), 255u);
+		}
+
+		if (cr != 255) {
+			out[kRIndex] = MIN<uint>(out[kRIndex] + ((in[kRIndex] * cr * ina) >> 16), 255u);
+		} else {
+			out[kRIndex] = MIN<uint>(out[kRIndex] + (in[kRIndex] * ina >> 8), 255u);
 		}
+
+		in += inStep;
+		out += 4;
 	}
 }
 
 /**
- * Optimized version of doBlit to be used with additive blended blitting
+ * Subtractive blending without colormod.
  */
-void doBlitAdditiveBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color) {
-	byte *in;
-	byte *out;
+static void blendRowSubtractiveScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	for (uint32 j = 0; j < width; j++) {
 
-	if (color == 0xffffffff) {
+		if (in[kAIndex] != 0) {
+			out[kRIndex] = MAX(out[kRIndex] - ((in[kRIndex] * out[kRIndex]) * in[kAIndex] >> 16), 0);
+			out[kGIndex] = MAX(out[kGIndex] - ((in[kGIndex] * out[kGIndex]) * in[kAIndex] >> 16), 0);
+			out[kBIndex] = MAX(out[kBIndex] - ((in[kBIndex] * out[kBIndex]) * in[kAIndex] >> 16), 0);
+		}
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+		in += inStep;
+		out += 4;
+	}
+}
 
-				if (in[kAIndex] != 0) {
-					out[kRIndex] = MIN((in[kRIndex] * in[kAIndex] >> 8) + out[kRIndex], 255);
-					out[kGIndex] = MIN((in[kGIndex] * in[kAIndex] >> 8) + out[kGIndex], 255);
-					out[kBIndex] = MIN((in[kBIndex] * in[kAIndex] >> 8) + out[kBIndex], 255);
-				}
+/**
+ * Subtractive blending with colormod.
+ */
+static void blendRowSubtractiveModScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	byte cr = (color >> kRModShift) & 0xFF;
+	byte cg = (color >> kGModShift) & 0xFF;
+	byte cb = (color >> kBModShift) & 0xFF;
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+	for (uint32 j = 0; j < width; j++) {
+
+		out[kAIndex] = 255;
+		if (cb != 255) {
+			out[kBIndex] = MAX<int>(out[kBIndex] - ((in[kBIndex] * cb * out[kBIndex] * (uint32)in[kAIndex]) >> 24), 0);
+		} else {
+			out[kBIndex] = MAX(out[kBIndex] - (in[kBIndex] * (out[kBIndex]) * in[kAIndex] >> 16), 0);
 		}
-	} else {
 
-		byte ca = (color >> kAModShift) & 0xFF;
-		byte cr = (color >> kRModShift) & 0xFF;
-		byte cg = (color >> kGModShift) & 0xFF;
-		byte cb = (color >> kBModShift) & 0xFF;
+		if (cg != 255) {
+			out[kGIndex] = MAX<int>(out[kGIndex] - ((in[kGIndex] * cg * out[kGIndex] * (uint32)in[kAIndex]) >> 24), 0);
+		} else {
+			out[kGIndex] = MAX(out[kGIndex] - (in[kGIndex] * (out[kGIndex]) * in[kAIndex] >> 16), 0);
+		}
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+		if (cr != 255) {
+			out[kRIndex] = MAX<int>(out[kRIndex] - ((in[kRIndex] * cr * out[kRIndex] * (uint32)in[kAIndex]) >> 24), 0);
+		} else {
+			out[kRIndex] = MAX(out[kRIndex] - (in[kRIndex] * (out[kRIndex]) * in[kAIndex] >> 16), 0);
+		}
 
-				uint32 ina = in[kAIndex] * ca >> 8;
+		in += inStep;
+		out += 4;
+	}
+}
 
-				if (cb != 255) {
-					out[kBIndex] = MIN<uint>(out[kBIndex] + ((in[kBIndex] * cb * ina) >> 16), 255u);
-				} else {
-					out[kBIndex] = MIN<uint>(out[kBIndex] + (in[kBIndex] * ina >> 8), 255u);
-				}
+/**
+ * Multiply blending without colormod.
+ */
+static void blendRowMultiplyScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	for (uint32 j = 0; j < width; j++) {
 
-				if (cg != 255) {
-					out[kGIndex] = MIN<uint>(out[kGIndex] + ((in[kGIndex] * cg * ina) >> 16), 255u);
-				} else {
-					out[kGIndex] = MIN<uint>(out[kGIndex] + (in[kGIndex] * ina >> 8), 255u);
-				}
+		if (in[kAIndex] != 0) {
+			out[kRIndex] = MIN((in[kRIndex] * in[kAIndex] >> 8) * out[kRIndex] >> 8, 255);
+			out[kGIndex] = MIN((in[kGIndex] * in[kAIndex] >> 8) * out[kGIndex] >> 8, 255);
+			out[kBIndex] = MIN((in[kBIndex] * in[kAIndex] >> 8) * out[kBIndex] >> 8, 255);
+		}
 
-				if (cr != 255) {
-					out[kRIndex] = MIN<uint>(out[kRIndex] + ((in[kRIndex] * cr * ina) >> 16), 255u);
-				} else {
-					out[kRIndex] = MIN<uint>(out[kRIndex] + (in[kRIndex] * ina >> 8), 255u);
-				}
+		in += inStep;
+		out += 4;
+	}
+}
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+/**
+ * Multiply blending with colormod.
+ */
+static void blendRowMultiplyModScalar(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	byte ca = (color >> kAModShift) & 0xFF;
+	byte cr = (color >> kRModShift) & 0xFF;
+	byte cg = (color >> kGModShift) & 0xFF;
+	byte cb = (color >> kBModShift) & 0xFF;
+
+	for (uint32 j = 0; j < width; j++) {
+
+		uint32 ina = in[kAIndex] * ca >> 8;
+
+		if (cb != 255) {
+			out[kBIndex] = MIN<uint>(out[kBIndex] * ((in[kBIndex] * cb * ina) >> 16) >> 8, 255u);
+		} else {
+			out[kBIndex] = MIN<uint>(out[kBIndex] * (in[kBIndex] * ina >> 8) >> 8, 255u);
 		}
+
+		if (cg != 255) {
+			out[kGIndex] = MIN<uint>(out[kGIndex] * ((in[kGIndex] * cg * ina) >> 16) >> 8, 255u);
+		} else {
+			out[kGIndex] = MIN<uint>(out[kGIndex] * (in[kGIndex] * ina >> 8) >> 8, 255u);
+		}
+
+		if (cr != 255) {
+			out[kRIndex] = MIN<uint>(out[kRIndex] * ((in[kRIndex] * cr * ina) >> 16) >> 8, 255u);
+		} else {
+			out[kRIndex] = MIN<uint>(out[kRIndex] * (in[kRIndex] * ina >> 8) >> 8, 255u);
+		}
+
+		in += inStep;
+		out += 4;
 	}
 }
 
+#ifdef TRANSPARENT_SURFACE_SSE2
+
+// The SSE2 versions work on four pixels at a time. On little endian
+// machines, the pixels unpacked to 16 bit lanes are A, B, G, R.
+
+/** Loads the next four input pixels, in output order */
+static inline __m128i loadPixels(const byte *in, int32 inStep) {
+	if (inStep > 0)
+		return _mm_loadu_si128((const __m128i *)in);
+
+	// Flipped, the next pixels are at lower addresses
+	return _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(in - 12)), _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+/** Copies the alpha lane of each pixel to its other lanes */
+static inline __m128i broadcastAlpha(__m128i pixels) {
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(0, 0, 0, 0)), _MM_SHUFFLE(0, 0, 0, 0));
+}
+
+/** Selects a where mask is set, and b elsewhere */
+static inline __m128i selectPixels(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
 /**
- * Optimized version of doBlit to be used with subtractive blended blitting
+ * Returns the colormod of each color lane as a factor for the high half
+ * of a product: x * c >> 16, or x >> 8 for a colormod of 255. The alpha
+ * lanes are 0.
  */
-void doBlitSubtractiveBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color) {
-	byte *in;
-	byte *out;
+static inline __m128i colorModFactors(uint32 color) {
+	const int16 cr = (color >> kRModShift) & 0xFF;
+	const int16 cg = (color >> kGModShift) & 0xFF;
+	const int16 cb = (color >> kBModShift) & 0xFF;
 
-	if (color == 0xffffffff) {
+	return _mm_set_epi16(cr == 255 ? 256 : cr, cg == 255 ? 256 : cg, cb == 255 ? 256 : cb, 0,
+	                     cr == 255 ? 256 : cr, cg == 255 ? 256 : cg, cb == 255 ? 256 : cb, 0);
+}
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+static void blendRowBinary(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
 
-				if (in[kAIndex] != 0) {
-					out[kRIndex] = MAX(out[kRIndex] - ((in[kRIndex] * out[kRIndex]) * in[kAIndex] >> 16), 0);
-					out[kGIndex] = MAX(out[kGIndex] - ((in[kGIndex] * out[kGIndex]) * in[kAIndex] >> 16), 0);
-					out[kBIndex] = MAX(out[kBIndex] - ((in[kBIndex] * out[kBIndex]) * in[kAIndex] >> 16), 0);
-				}
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		const __m128i skip = _mm_cmpeq_epi32(_mm_and_si128(src, alphaMask), _mm_setzero_si128());
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+		_mm_storeu_si128((__m128i *)out, selectPixels(skip, dst, _mm_or_si128(src, alphaMask)));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowBinaryScalar(in, out, width, inStep, color);
+}
+
+static void blendRowAlpha(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
+	const __m128i max = _mm_set1_epi16(255);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i result[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+			const __m128i a = broadcastAlpha(s);
+
+			result[i] = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, _mm_sub_epi16(max, a))), 8);
 		}
-	} else {
 
-		byte cr = (color >> kRModShift) & 0xFF;
-		byte cg = (color >> kGModShift) & 0xFF;
-		byte cb = (color >> kBModShift) & 0xFF;
+		const __m128i skip = _mm_cmpeq_epi32(_mm_and_si128(src, alphaMask), zero);
+		const __m128i blended = _mm_or_si128(_mm_packus_epi16(result[0], result[1]), alphaMask);
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+		_mm_storeu_si128((__m128i *)out, selectPixels(skip, dst, blended));
+		in += 4 * inStep;
+		out += 16;
+	}
 
-				out[kAIndex] = 255;
-				if (cb != 255) {
-					out[kBIndex] = MAX(out[kBIndex] - ((in[kBIndex] * cb  * (out[kBIndex]) * in[kAIndex]) >> 24), 0);
-				} else {
-					out[kBIndex] = MAX(out[kBIndex] - (in[kBIndex] * (out[kBIndex]) * in[kAIndex] >> 16), 0);
-				}
+	blendRowAlphaScalar(in, out, width, inStep, color);
+}
 
-				if (cg != 255) {
-					out[kGIndex] = MAX(out[kGIndex] - ((in[kGIndex] * cg  * (out[kGIndex]) * in[kAIndex]) >> 24), 0);
-				} else {
-					out[kGIndex] = MAX(out[kGIndex] - (in[kGIndex] * (out[kGIndex]) * in[kAIndex] >> 16), 0);
-				}
+static void blendRowAlphaOpaque(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
+	const __m128i one = _mm_set1_epi8(1);
 
-				if (cr != 255) {
-					out[kRIndex] = MAX(out[kRIndex] - ((in[kRIndex] * cr * (out[kRIndex]) * in[kAIndex]) >> 24), 0);
-				} else {
-					out[kRIndex] = MAX(out[kRIndex] - (in[kRIndex] * (out[kRIndex]) * in[kAIndex] >> 16), 0);
-				}
+	for (; width >= 4; width -= 4) {
+		// c * 255 >> 8 is c - 1, except for 0
+		_mm_storeu_si128((__m128i *)out, _mm_or_si128(_mm_subs_epu8(loadPixels(in, inStep), one), alphaMask));
+		in += 4 * inStep;
+		out += 16;
+	}
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+	blendRowAlphaOpaqueScalar(in, out, width, inStep, color);
+}
+
+static void blendRowAlphaMod(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const int16 ca = (color >> kAModShift) & 0xFF;
+	const int16 cr = (color >> kRModShift) & 0xFF;
+	const int16 cg = (color >> kGModShift) & 0xFF;
+	const int16 cb = (color >> kBModShift) & 0xFF;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
+	const __m128i max = _mm_set1_epi16(255);
+	const __m128i alphaMod = _mm_set1_epi16(ca);
+	const __m128i colorMod = _mm_set_epi16(cr, cg, cb, 0, cr, cg, cb, 0);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i result[2], skip[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+			const __m128i ina = _mm_srli_epi16(_mm_mullo_epi16(broadcastAlpha(s), alphaMod), 8);
+
+			// in * ina fits 16 bits, so the high half of the product
+			// with the colormod is in * ina * c >> 16
+			const __m128i kept = _mm_srli_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(max, ina)), 8);
+			const __m128i added = _mm_mulhi_epu16(_mm_mullo_epi16(s, ina), colorMod);
+
+			result[i] = _mm_add_epi16(kept, added);
+			skip[i] = _mm_cmpeq_epi16(ina, zero);
+		}
+
+		const __m128i blended = _mm_or_si128(_mm_packus_epi16(result[0], result[1]), alphaMask);
+		_mm_storeu_si128((__m128i *)out, selectPixels(_mm_packs_epi16(skip[0], skip[1]), dst, blended));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowAlphaModScalar(in, out, width, inStep, color);
+}
+
+static void blendRowAdditive(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colorLanes = _mm_set_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i added[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			added[i] = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(s, broadcastAlpha(s)), 8), colorLanes);
+		}
+
+		_mm_storeu_si128((__m128i *)out, _mm_adds_epu8(dst, _mm_packus_epi16(added[0], added[1])));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowAdditiveScalar(in, out, width, inStep, color);
+}
+
+static void blendRowAdditiveMod(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMod = _mm_set1_epi16((color >> kAModShift) & 0xFF);
+	const __m128i colorMod = colorModFactors(color);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i added[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i ina = _mm_srli_epi16(_mm_mullo_epi16(broadcastAlpha(s), alphaMod), 8);
+			added[i] = _mm_mulhi_epu16(_mm_mullo_epi16(s, ina), colorMod);
+		}
+
+		_mm_storeu_si128((__m128i *)out, _mm_adds_epu8(dst, _mm_packus_epi16(added[0], added[1])));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowAdditiveModScalar(in, out, width, inStep, color);
+}
+
+static void blendRowSubtractive(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colorLanes = _mm_set_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i subtracted[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+			subtracted[i] = _mm_and_si128(_mm_mulhi_epu16(_mm_mullo_epi16(s, d), broadcastAlpha(s)), colorLanes);
+		}
+
+		_mm_storeu_si128((__m128i *)out, _mm_subs_epu8(dst, _mm_packus_epi16(subtracted[0], subtracted[1])));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowSubtractiveScalar(in, out, width, inStep, color);
+}
+
+static void blendRowSubtractiveMod(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
+	const __m128i colorMod = colorModFactors(color);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i result[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+
+			// Both in * out and the alpha times the factor fit 16 bits, so
+			// in * c * out * alpha >> 24 is the high half of their product
+			// shifted by 8, which never exceeds out
+			const __m128i factor = _mm_mullo_epi16(broadcastAlpha(s), colorMod);
+			result[i] = _mm_sub_epi16(d, _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(s, d), factor), 8));
 		}
+
+		_mm_storeu_si128((__m128i *)out, _mm_or_si128(_mm_packus_epi16(result[0], result[1]), alphaMask));
+		in += 4 * inStep;
+		out += 16;
 	}
+
+	blendRowSubtractiveModScalar(in, out, width, inStep, color);
 }
 
+static void blendRowMultiply(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i result[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+			const __m128i t = _mm_srli_epi16(_mm_mullo_epi16(s, broadcastAlpha(s)), 8);
+			result[i] = _mm_srli_epi16(_mm_mullo_epi16(t, d), 8);
+		}
+
+		// Alpha is left alone, and so are the pixels with alpha 0
+		const __m128i keep = _mm_or_si128(alphaMask, _mm_cmpeq_epi32(_mm_and_si128(src, alphaMask), zero));
+		_mm_storeu_si128((__m128i *)out, selectPixels(keep, dst, _mm_packus_epi16(result[0], result[1])));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowMultiplyScalar(in, out, width, inStep, color);
+}
+
+static void blendRowMultiplyMod(const byte *in, byte *out, uint32 width, int32 inStep, uint32 color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF);
+	const __m128i alphaMod = _mm_set1_epi16((color >> kAModShift) & 0xFF);
+	const __m128i colorMod = colorModFactors(color);
+
+	for (; width >= 4; width -= 4) {
+		const __m128i src = loadPixels(in, inStep);
+		const __m128i dst = _mm_loadu_si128((const __m128i *)out);
+		__m128i result[2];
+
+		for (int i = 0; i < 2; i++) {
+			const __m128i s = i ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			const __m128i d = i ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+			const __m128i ina = _mm_srli_epi16(_mm_mullo_epi16(broadcastAlpha(s), alphaMod), 8);
+			const __m128i t = _mm_mulhi_epu16(_mm_mullo_epi16(s, ina), colorMod);
+			result[i] = _mm_srli_epi16(_mm_mullo_epi16(d, t), 8);
+		}
+
+		// Unlike without colormod, transparent pixels clear the target too
+		_mm_storeu_si128((__m128i *)out, selectPixels(alphaMask, dst, _mm_packus_epi16(result[0], result[1])));
+		in += 4 * inStep;
+		out += 16;
+	}
+
+	blendRowMultiplyModScalar(in, out, width, inStep, color);
+}
+
+#else
+
+#define blendRowBinary blendRowBinaryScalar
+#define blendRowAlpha blendRowAlphaScalar
+#define blendRowAlphaOpaque blendRowAlphaOpaqueScalar
+#define blendRowAlphaMod blendRowAlphaModScalar
+#define blendRowAdditive blendRowAdditiveScalar
+#define blendRowAdditiveMod blendRowAdditiveModScalar
+#define blendRowSubtractive blendRowSubtractiveScalar
+#define blendRowSubtractiveMod blendRowSubtractiveModScalar
+#define blendRowMultiply blendRowMultiplyScalar
+#define blendRowMultiplyMod blendRowMultiplyModScalar
+
+#endif
+
 /**
- * Optimized version of doBlit to be used with multiply blended blitting
+ * Selects the blending of rows for a blit.
+ * @param blendMode the blend mode
+ * @param alphaMode the alpha mode of the source surface
+ * @param color colormod in 0xAARRGGBB format - 0xFFFFFFFF for no colormod
+ * @param opaqueRow set to the blending of rows of fully opaque pixels
+ * @return the blending of rows, or 0 if fully transparent pixels change
+ *         the target, so that the blit cannot use the span index
  */
-void doBlitMultiplyBlend(byte *ino, byte *outo, uint32 width, uint32 height, uint32 pitch, int32 inStep, int32 inoStep, uint32 color) {
-	byte *in;
-	byte *out;
+static BlendRowFunc findBlendRowFunc(TSpriteBlendMode blendMode, AlphaType alphaMode, uint32 color, BlendRowFunc &opaqueRow) {
+	BlendRowFunc blendRow;
+
+	if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && alphaMode == ALPHA_BINARY) {
+		blendRow = blendRowBinary;
+	} else if (blendMode == BLEND_ADDITIVE) {
+		blendRow = (color == 0xFFFFFFFF) ? blendRowAdditive : blendRowAdditiveMod;
+	} else if (blendMode == BLEND_SUBTRACTIVE) {
+		blendRow = (color == 0xFFFFFFFF) ? blendRowSubtractive : blendRowSubtractiveMod;
+	} else if (blendMode == BLEND_MULTIPLY) {
+		blendRow = (color == 0xFFFFFFFF) ? blendRowMultiply : blendRowMultiplyMod;
+	} else {
+		assert(blendMode == BLEND_NORMAL);
+		blendRow = (color == 0xFFFFFFFF) ? blendRowAlpha : blendRowAlphaMod;
+	}
 
-	if (color == 0xffffffff) {
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+	opaqueRow = (blendRow == blendRowAlpha) ? blendRowAlphaOpaque : blendRow;
+	return blendRow;
+}
 
-				if (in[kAIndex] != 0) {
-					out[kRIndex] = MIN((in[kRIndex] * in[kAIndex] >> 8) * out[kRIndex] >> 8, 255);
-					out[kGIndex] = MIN((in[kGIndex] * in[kAIndex] >> 8) * out[kGIndex] >> 8, 255);
-					out[kBIndex] = MIN((in[kBIndex] * in[kAIndex] >> 8) * out[kBIndex] >> 8, 255);
-				}
+/**
+ * Tells whether fully transparent pixels leave the target alone, for
+ * the blending of a row.
+ */
+static bool skipsTransparentPixels(BlendRowFunc blendRow) {
+	// Both set the alpha of the target, or clear its color
+	return blendRow != blendRowSubtractiveMod && blendRow != blendRowMultiplyMod;
+}
 
-				in += inStep;
-				out += 4;
-			}
-			outo += pitch;
-			ino += inoStep;
+/**
+ * Blits the runs of visible pixels of a part of a surface.
+ * @param spans the span index of the surface
+ * @param srcX, srcY the position of the part in the surface
+ * @param width, height the size of the part
+ * @param outo a pointer to the output surface
+ * @param pitch pitch of the output surface
+ * @param flipping how the part is flipped
+ * @param color colormod in 0xAARRGGBB format - 0xFFFFFFFF for no colormod
+ * @param blendRow the blending of rows of translucent pixels
+ * @param opaqueRow the blending of rows of opaque pixels
+ */
+static void doBlitSpans(const TransparentSurfaceSpans &spans, int srcX, int srcY, int width, int height,
+                        byte *outo, uint32 pitch, int flipping, uint32 color, BlendRowFunc blendRow, BlendRowFunc opaqueRow) {
+	for (int i = 0; i < height; i++) {
+		const int y = (flipping & FLIP_V) ? srcY + height - 1 - i : srcY + i;
+		const byte *row = (const byte *)spans.pixels + y * spans.pitch;
+
+		for (uint32 s = spans.rowStart[y]; s < spans.rowStart[y + 1]; s++) {
+			const TransparentSurfaceSpans::Span &span = spans.spans[s];
+			const int start = MAX<int>(span.start, srcX);
+			const int end = MIN<int>(span.end, srcX + width);
+
+			if (start >= end)
+				continue;
+
+			BlendRowFunc func = span.opaque ? opaqueRow : blendRow;
+			if (flipping & FLIP_H)
+				func(row + (end - 1) * 4, outo + (srcX + width - end) * 4, end - start, -4, color);
+			else
+				func(row + start * 4, outo + (start - srcX) * 4, end - start, 4, color);
 		}
-	} else {
-		byte ca = (color >> kAModShift) & 0xFF;
-		byte cr = (color >> kRModShift) & 0xFF;
-		byte cg = (color >> kGModShift) & 0xFF;
-		byte cb = (color >> kBModShift) & 0xFF;
 
-		for (uint32 i = 0; i < height; i++) {
-			out = outo;
-			in = ino;
-			for (uint32 j = 0; j < width; j++) {
+		outo += pitch;
+	}
+}
 
-				uint32 ina = in[kAIndex] * ca >> 8;
+void TransparentSurface::blitImage(Graphics::Surface &target, const Graphics::Surface &img, bool scaled,
+                                   int posX, int posY, int flipping, uint color, TSpriteBlendMode blendMode) const {
+	if ((img.w <= 0) || (img.h <= 0))
+		return;
 
-				if (cb != 255) {
-					out[kBIndex] = MIN<uint>(out[kBIndex] * ((in[kBIndex] * cb * ina) >> 16) >> 8, 255u);
-				} else {
-					out[kBIndex] = MIN<uint>(out[kBIndex] * (in[kBIndex] * ina >> 8) >> 8, 255u);
-				}
+	// Flip surface
+	int xp = 0, yp = 0;
 
-				if (cg != 255) {
-					out[kGIndex] = MIN<uint>(out[kGIndex] * ((in[kGIndex] * cg * ina) >> 16) >> 8, 255u);
-				} else {
-					out[kGIndex] = MIN<uint>(out[kGIndex] * (in[kGIndex] * ina >> 8) >> 8, 255u);
-				}
+	int inStep = 4;
+	int inoStep = img.pitch;
+	if (flipping & FLIP_H) {
+		inStep = -inStep;
+		xp = img.w - 1;
+	}
 
-				if (cr != 255) {
-					out[kRIndex] = MIN<uint>(out[kRIndex] * ((in[kRIndex] * cr * ina) >> 16) >> 8, 255u);
-				} else {
-					out[kRIndex] = MIN<uint>(out[kRIndex] * (in[kRIndex] * ina >> 8) >> 8, 255u);
-				}
+	if (flipping & FLIP_V) {
+		inoStep = -inoStep;
+		yp = img.h - 1;
+	}
 
-				in += inStep;
-				out += 4;
+	const byte *ino = (const byte *)img.getBasePtr(xp, yp);
+	byte *outo = (byte *)target.getBasePtr(posX, posY);
+
+	if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && _alphaMode == ALPHA_OPAQUE) {
+		doBlitOpaqueFast(ino, outo, img.w, img.h, target.pitch, inStep, inoStep);
+		return;
+	}
+
+	BlendRowFunc opaqueRow;
+	BlendRowFunc blendRow = findBlendRowFunc(blendMode, _alphaMode, color, opaqueRow);
+
+	// The part of an unscaled image is always in the pixels of this surface
+	if (!scaled && hasSpans() && skipsTransparentPixels(blendRow)) {
+		const int offset = (const byte *)img.getPixels() - (const byte *)pixels;
+		doBlitSpans(*_spans, (offset % pitch) / 4, offset / pitch, img.w, img.h,
+		            outo, target.pitch, flipping, color, blendRow, opaqueRow);
+	} else {
+		doBlitRows(ino, outo, img.w, img.h, target.pitch, inStep, inoStep, color, blendRow);
+	}
+}
+
+void TransparentSurface::buildSpans() {
+	assert(format.bytesPerPixel == 4);
+
+	TransparentSurfaceSpans *spans = new TransparentSurfaceSpans();
+	spans->pixels = pixels;
+	spans->w = w;
+	spans->h = h;
+	spans->pitch = pitch;
+	spans->rowStart.resize(h + 1);
+
+	for (int y = 0; y < h; y++) {
+		const byte *in = (const byte *)getBasePtr(0, y);
+		spans->rowStart[y] = spans->spans.size();
+
+		int x = 0;
+		while (x < w) {
+			const byte a = in[x * 4 + kAIndex];
+			if (a == 0) {
+				x++;
+				continue;
 			}
-			outo += pitch;
-			ino += inoStep;
+
+			// Extend the run while the pixels stay opaque, or translucent
+			TransparentSurfaceSpans::Span span;
+			span.start = x;
+			span.opaque = (a == 255);
+			for (x++; x < w; x++) {
+				const byte next = in[x * 4 + kAIndex];
+				if (next == 0 || (next == 255) != span.opaque)
+					break;
+			}
+			span.end = x;
+
+			spans->spans.push_back(span);
 		}
 	}
 
+	spans->rowStart[h] = spans->spans.size();
+
+	_spans = Common::SharedPtr<TransparentSurfaceSpans>(spans);
+}
+
+void TransparentSurface::invalidateSpans() {
+	_spans.reset();
+}
+
+bool TransparentSurface::hasSpans() const {
+	return _spans && _spans->pixels == pixels && _spans->w == w && _spans->h == h && _spans->pitch == pitch;
 }
 
 Common::Rect TransparentSurface::blit(Graphics::Surface &target, int posX, int posY, int flipping, Common::Rect *pPartRect, uint color, int width, int height, TSpriteBlendMode blendMode) {
@@ -494,43 +962,7 @@ Common::Rect TransparentSurface::blit(Graphics::Surface &target, int posX, int p
 		img->h = CLIP((int)img->h, 0, (int)MAX((int)target.h - posY, 0));
 	}
 
-	// Flip surface
-	if ((img->w > 0) && (img->h > 0)) {
-		int xp = 0, yp = 0;
-
-		int inStep = 4;
-		int inoStep = img->pitch;
-		if (flipping & FLIP_H) {
-			inStep = -inStep;
-			xp = img->w - 1;
-		}
-
-		if (flipping & FLIP_V) {
-			inoStep = -inoStep;
-			yp = img->h - 1;
-		}
-
-		byte *ino = (byte *)img->getBasePtr(xp, yp);
-		byte *outo = (byte *)target.getBasePtr(posX, posY);
-
-		if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && _alphaMode == ALPHA_OPAQUE) {
-			doBlitOpaqueFast(ino, outo, img->w, img->h, target.pitch, inStep, inoStep);
-		} else if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && _alphaMode == ALPHA_BINARY) {
-			doBlitBinaryFast(ino, outo, img->w, img->h, target.pitch, inStep, inoStep);
-		} else {
-			if (blendMode == BLEND_ADDITIVE) {
-				doBlitAdditiveBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			} else if (blendMode == BLEND_SUBTRACTIVE) {
-				doBlitSubtractiveBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			} else if (blendMode == BLEND_MULTIPLY) {
-				doBlitMultiplyBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			} else {
-				assert(blendMode == BLEND_NORMAL);
-				doBlitAlphaBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			}
-		}
-
-	}
+	blitImage(target, *img, imgScaled != nullptr, posX, posY, flipping, color, blendMode);
 
 	retSize.setWidth(img->w);
 	retSize.setHeight(img->h);
@@ -641,43 +1073,7 @@ Common::Rect TransparentSurface::blitClip(Graphics::Surface &target, Common::Rec
 		img->h = CLIP((int)img->h, 0, (int)MAX((int)clippingArea.bottom - posY, 0));
 	}
 
-	// Flip surface
-	if ((img->w > 0) && (img->h > 0)) {
-		int xp = 0, yp = 0;
-
-		int inStep = 4;
-		int inoStep = img->pitch;
-		if (flipping & FLIP_H) {
-			inStep = -inStep;
-			xp = img->w - 1;
-		}
-
-		if (flipping & FLIP_V) {
-			inoStep = -inoStep;
-			yp = img->h - 1;
-		}
-
-		byte *ino = (byte *)img->getBasePtr(xp, yp);
-		byte *outo = (byte *)target.getBasePtr(posX, posY);
-
-		if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && _alphaMode == ALPHA_OPAQUE) {
-			doBlitOpaqueFast(ino, outo, img->w, img->h, target.pitch, inStep, inoStep);
-		} else if (color == 0xFFFFFFFF && blendMode == BLEND_NORMAL && _alphaMode == ALPHA_BINARY) {
-			doBlitBinaryFast(ino, outo, img->w, img->h, target.pitch, inStep, inoStep);
-		} else {
-			if (blendMode == BLEND_ADDITIVE) {
-				doBlitAdditiveBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			} else if (blendMode == BLEND_SUBTRACTIVE) {
-				doBlitSubtractiveBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			} else if (blendMode == BLEND_MULTIPLY) {
-				doBlitMultiplyBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			} else {
-				assert(blendMode == BLEND_NORMAL);
-				doBlitAlphaBlend(ino, outo, img->w, img->h, target.pitch, inStep, inoStep, color);
-			}
-		}
-
-	}
+	blitImage(target, *img, imgScaled != nullptr, posX, posY, flipping, color, blendMode);
 
 	retSize.setWidth(img->w);
 	retSize.setHeight(img->h);
@@ -700,6 +1096,7 @@ Common::Rect TransparentSurface::blitClip(Graphics::Surface &target, Common::Rec
  */
 void TransparentSurface::applyColorKey(uint8 rKey, uint8 gKey, uint8 bKey, bool overwriteAlpha) {
 	assert(format.bytesPerPixel == 4);
+	invalidateSpans();
 	for (int i = 0; i < h; i++) {
 		for (int j = 0; j < w; j++) {
 			uint32 pix = ((uint32 *)pixels)[i * w + j];
@@ -23,6 +23,8 @@
 #ifndef GRAPHICS_TRANSPARENTSURFACE_H
 #define GRAPHICS_TRANSPARENTSURFACE_H
 
+#include "common/ptr.h"
+
 #include "graphics/surface.h"
 #include "graphics/transform_struct.h"
 
@@ -73,6 +75,8 @@ enum TFilteringMode {
 	FILTER_BILINEAR = 1
 };
 
+struct TransparentSurfaceSpans;
+
 /**
  * A transparent graphics surface, which implements alpha blitting.
  */
@@ -174,8 +178,28 @@ struct TransparentSurface : public Graphics::Surface {
 
 	AlphaType getAlphaMode() const;
 	void setAlphaMode(AlphaType);
+
+	/**
+	 * Indexes the runs of transparent, opaque and translucent pixels in
+	 * each row of the surface. Unscaled blits then skip the transparent
+	 * runs and copy the opaque ones without blending, so they take time
+	 * in proportion to the visible pixels. This is worth it for surfaces
+	 * which are blitted more than once.
+	 *
+	 * The index is dropped when the pixels, size or pitch of the surface
+	 * change. Callers which change the pixel data in place have to call
+	 * invalidateSpans() themselves.
+	 */
+	void buildSpans();
+	void invalidateSpans();
+	bool hasSpans() const;
+
 private:
 	AlphaType _alphaMode;
+	Common::SharedPtr<TransparentSurfaceSpans> _spans;
+
+	void blitImage(Graphics::Surface &target, const Graphics::Surface &img, bool scaled,
+	               int posX, int posY, int flipping, uint color, TSpriteBlendMode blendMode) const;
 
 	template <typename Size>
 	void scaleNN(int *scaleCacheX, TransparentSurface *target) const;
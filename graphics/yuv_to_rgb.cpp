@@ -86,6 +86,18 @@
 #include "graphics/surface.h"
 #include "graphics/yuv_to_rgb.h"
 
+#include "common/util.h"
+
+#if defined(__SSE2__)
+#define YUV_TO_RGB_SSE2
+#define YUV_TO_RGB_VECTOR
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(SCUMM_LITTLE_ENDIAN)
+#define YUV_TO_RGB_NEON
+#define YUV_TO_RGB_VECTOR
+#include <arm_neon.h>
+#endif
+
 namespace Common {
 DECLARE_SINGLETON(Graphics::YUVToRGBManager);
 }
@@ -159,6 +171,8 @@ YUVToRGBLookup::YUVToRGBLookup(Graphics::PixelFormat format, YUVToRGBManager::Lu
 
 YUVToRGBManager::YUVToRGBManager() {
 	_lookup = 0;
+	_sliceRunner = 0;
+	_sliceCount = 1;
 
 	int16 *Cr_r_tab = &_colorTab[0 * 256];
 	int16 *Cr_g_tab = &_colorTab[1 * 256];
@@ -192,21 +206,467 @@ const YUVToRGBLookup *YUVToRGBManager::getLookup(Graphics::PixelFormat format, Y
 	return _lookup;
 }
 
+void YUVToRGBManager::setSliceRunner(SliceRunner *runner, uint slices) {
+	_sliceRunner = runner;
+	_sliceCount = MAX<uint>(slices, 1);
+}
+
+/**
+ * The conversion of one frame, which can be split into slices of rows
+ * that are converted independently.
+ */
+class YUVToRGBConversion : public YUVToRGBManager::SliceJob {
+public:
+	typedef void (*ConvertRowsFunc)(const YUVToRGBConversion &conversion, int yStart, int yEnd);
+
+	YUVToRGBConversion(Graphics::Surface *dst, const YUVToRGBLookup *lookup_, const int16 *colorTab_, const byte *ySrc_, const byte *uSrc_, const byte *vSrc_, int yWidth_, int yHeight_, int yPitch_, int uvPitch_) :
+		convertRows(0), rowAlignment(1), sliceCount(1),
+		dstPtr((byte *)dst->getPixels()), dstPitch(dst->pitch), lookup(lookup_), colorTab(colorTab_),
+		ySrc(ySrc_), uSrc(uSrc_), vSrc(vSrc_), yWidth(yWidth_), yHeight(yHeight_), yPitch(yPitch_), uvPitch(uvPitch_) {
+	}
+
+	ConvertRowsFunc convertRows;
+	int rowAlignment; // Slices start on a multiple of this
+	uint sliceCount;
+
+	byte *dstPtr;
+	int dstPitch;
+	const YUVToRGBLookup *lookup;
+	const int16 *colorTab;
+	const byte *ySrc, *uSrc, *vSrc;
+	int yWidth, yHeight, yPitch, uvPitch;
+
+	virtual void convertSlice(uint slice) const {
+		assert(slice < sliceCount);
+		convertRows(*this, getSliceStart(slice), slice + 1 == sliceCount ? yHeight : getSliceStart(slice + 1));
+	}
+
+private:
+	int getSliceStart(uint slice) const {
+		return (int)(yHeight * slice / sliceCount) / rowAlignment * rowAlignment;
+	}
+};
+
+void YUVToRGBManager::convert(YUVToRGBConversion &conversion) {
+	// Small frames are not worth waking up the workers
+	const int kMinSliceHeight = 32;
+
+	conversion.sliceCount = 1;
+	if (_sliceRunner)
+		conversion.sliceCount = CLIP<int>(conversion.yHeight / kMinSliceHeight, 1, _sliceCount);
+
+	if (conversion.sliceCount > 1)
+		_sliceRunner->runSlices(conversion, conversion.sliceCount);
+	else
+		conversion.convertRows(conversion, 0, conversion.yHeight);
+}
+
+// The chroma tables of YUVToRGBManager as 16 bit fixed point factors. For
+// every chroma value, (|chroma - 128| << shift) * factor >> 16 is exactly
+// the magnitude of the table entry, so the vector code below produces the
+// same pixels as the lookup tables.
+enum {
+	kCrRFactor = 45917, // 0.419 / 0.299, shift 1
+	kCrGFactor = 46764, // 0.299 / 0.419, shift 0
+	kCbGFactor = 22569, // 0.114 / 0.331, shift 0
+	kCbBFactor = 58110  // 0.587 / 0.331, shift 1
+};
+
+// For ITU luminance, x + (x * kITUFactor >> 16) is x * 255 / 219 rounded
+// down, for every x in [0, 219]. Values outside of that range stay outside
+// of [0, 255], so saturating to bytes afterwards gives the clamped table
+// entries.
+static const int kITUFactor = 10776;
+
+#ifdef YUV_TO_RGB_VECTOR
+
+enum {
+	kChannelR,
+	kChannelG,
+	kChannelB,
+	kChannelFull,
+	kChannelEmpty
+};
+
+/**
+ * Finds the channel stored in each byte of a 32 bit pixel format.
+ * @return false if the channels are not whole bytes
+ */
+static bool findChannelBytes(const Graphics::PixelFormat &format, int channelBytes[4]) {
+	if (format.rLoss || format.gLoss || format.bLoss || (format.aLoss != 0 && format.aLoss != 8))
+		return false;
+	if ((format.rShift | format.gShift | format.bShift | format.aShift) & 7)
+		return false;
+
+	for (int i = 0; i < 4; i++)
+		channelBytes[i] = kChannelEmpty;
+
+	channelBytes[format.rShift / 8] = kChannelR;
+	channelBytes[format.gShift / 8] = kChannelG;
+	channelBytes[format.bShift / 8] = kChannelB;
+	if (format.aLoss == 0)
+		channelBytes[format.aShift / 8] = kChannelFull;
+
+	return true;
+}
+
+#endif
+
+#if defined(YUV_TO_RGB_SSE2)
+
+struct VectorPack {
+	bool supported;
+	bool itu;
+	__m128i lumaOffset;
+	// 16 bit pixels
+	__m128i rLoss, gLoss, bLoss;
+	__m128i rShift, gShift, bShift;
+	__m128i alpha;
+	// 32 bit pixels
+	int channelBytes[4];
+};
+
+static void initVectorPack(VectorPack &pack, const Graphics::PixelFormat &format, YUVToRGBManager::LuminanceScale scale) {
+	pack.supported = (format.bytesPerPixel == 2 || findChannelBytes(format, pack.channelBytes));
+	pack.itu = (scale == YUVToRGBManager::kScaleITU);
+	pack.lumaOffset = _mm_set1_epi16(pack.itu ? -16 : 0);
+	pack.rLoss = _mm_cvtsi32_si128(format.rLoss);
+	pack.gLoss = _mm_cvtsi32_si128(format.gLoss);
+	pack.bLoss = _mm_cvtsi32_si128(format.bLoss);
+	pack.rShift = _mm_cvtsi32_si128(format.rShift);
+	pack.gShift = _mm_cvtsi32_si128(format.gShift);
+	pack.bShift = _mm_cvtsi32_si128(format.bShift);
+	pack.alpha = _mm_set1_epi16((int16)format.RGBToColor(0, 0, 0));
+}
+
+static inline __m128i scaleChroma(__m128i d, int factor, int shift) {
+	const __m128i sign = _mm_srai_epi16(d, 15);
+	const __m128i a = _mm_sll_epi16(_mm_sub_epi16(_mm_xor_si128(d, sign), sign), _mm_cvtsi32_si128(shift));
+	const __m128i p = _mm_mulhi_epu16(a, _mm_set1_epi16((int16)factor));
+	return _mm_sub_epi16(_mm_xor_si128(p, sign), sign);
+}
+
+/**
+ * Computes what 8 chroma samples add to the luminance of each channel.
+ */
+static inline void computeChroma(__m128i u, __m128i v, __m128i lumaOffset, __m128i &crR, __m128i &crbG, __m128i &cbB) {
+	const __m128i offset = _mm_set1_epi16(128);
+	const __m128i du = _mm_sub_epi16(u, offset);
+	const __m128i dv = _mm_sub_epi16(v, offset);
+
+	crR = _mm_add_epi16(lumaOffset, scaleChroma(dv, kCrRFactor, 1));
+	crbG = _mm_sub_epi16(lumaOffset, _mm_add_epi16(scaleChroma(dv, kCrGFactor, 0), scaleChroma(du, kCbGFactor, 0)));
+	cbB = _mm_add_epi16(lumaOffset, scaleChroma(du, kCbBFactor, 1));
+}
+
+template<bool itu>
+static inline __m128i computeChannel(__m128i y, __m128i chroma) {
+	__m128i c = _mm_add_epi16(y, chroma);
+	if (itu)
+		c = _mm_add_epi16(c, _mm_mulhi_epi16(c, _mm_set1_epi16(kITUFactor)));
+	return c;
+}
+
+/**
+ * Computes one channel of 16 pixels, as bytes.
+ */
+template<bool itu>
+static inline __m128i computeChannel(__m128i y, const __m128i chroma[2]) {
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_packus_epi16(computeChannel<itu>(_mm_unpacklo_epi8(y, zero), chroma[0]),
+	                        computeChannel<itu>(_mm_unpackhi_epi8(y, zero), chroma[1]));
+}
+
+static inline __m128i packPixels(__m128i r, __m128i g, __m128i b, const VectorPack &pack) {
+	__m128i p = pack.alpha;
+	p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(r, pack.rLoss), pack.rShift));
+	p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(g, pack.gLoss), pack.gShift));
+	p = _mm_or_si128(p, _mm_sll_epi16(_mm_srl_epi16(b, pack.bLoss), pack.bShift));
+	return p;
+}
+
+static inline void storePixels(uint16 *dst, __m128i r, __m128i g, __m128i b, const VectorPack &pack) {
+	const __m128i zero = _mm_setzero_si128();
+	_mm_storeu_si128((__m128i *)dst, packPixels(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero), pack));
+	_mm_storeu_si128((__m128i *)(dst + 8), packPixels(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero), pack));
+}
+
+static inline void storePixels(uint32 *dst, __m128i r, __m128i g, __m128i b, const VectorPack &pack) {
+	const __m128i channels[] = { r, g, b, _mm_set1_epi8((char)0xFF), _mm_setzero_si128() };
+	const __m128i c0 = channels[pack.channelBytes[0]];
+	const __m128i c1 = channels[pack.channelBytes[1]];
+	const __m128i c2 = channels[pack.channelBytes[2]];
+	const __m128i c3 = channels[pack.channelBytes[3]];
+
+	const __m128i lo01 = _mm_unpacklo_epi8(c0, c1), lo23 = _mm_unpacklo_epi8(c2, c3);
+	const __m128i hi01 = _mm_unpackhi_epi8(c0, c1), hi23 = _mm_unpackhi_epi8(c2, c3);
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo01, lo23));
+	_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(lo01, lo23));
+	_mm_storeu_si128((__m128i *)(dst + 8), _mm_unpacklo_epi16(hi01, hi23));
+	_mm_storeu_si128((__m128i *)(dst + 12), _mm_unpackhi_epi16(hi01, hi23));
+}
+
+template<bool itu, typename PixelInt>
+static inline void convertPixels(PixelInt *dst, __m128i y, const __m128i crR[2], const __m128i crbG[2], const __m128i cbB[2], const VectorPack &pack) {
+	storePixels(dst, computeChannel<itu>(y, crR), computeChannel<itu>(y, crbG), computeChannel<itu>(y, cbB), pack);
+}
+
+template<typename PixelInt, bool itu>
+static int convertRowYUV444VectorImpl(PixelInt *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int width, const VectorPack &packRef) {
+	// Keep the constants in registers, the stores could alias them
+	const VectorPack pack = packRef;
+	const __m128i zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		const __m128i y = _mm_loadu_si128((const __m128i *)(ySrc + x));
+		const __m128i u = _mm_loadu_si128((const __m128i *)(uSrc + x));
+		const __m128i v = _mm_loadu_si128((const __m128i *)(vSrc + x));
+
+		__m128i crR[2], crbG[2], cbB[2];
+		computeChroma(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(v, zero), pack.lumaOffset, crR[0], crbG[0], cbB[0]);
+		computeChroma(_mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(v, zero), pack.lumaOffset, crR[1], crbG[1], cbB[1]);
+		convertPixels<itu>(dst + x, y, crR, crbG, cbB, pack);
+	}
+
+	return x;
+}
+
+template<typename PixelInt, bool itu>
+static int convertRowsYUV420VectorImpl(byte *dstPtr, int dstPitch, const byte *ySrc, int yPitch, const byte *uSrc, const byte *vSrc, int width, const VectorPack &packRef) {
+	// Keep the constants in registers, the stores could alias them
+	const VectorPack pack = packRef;
+	const __m128i zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		const __m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(uSrc + x / 2)), zero);
+		const __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(vSrc + x / 2)), zero);
+
+		__m128i crR, crbG, cbB;
+		computeChroma(u, v, pack.lumaOffset, crR, crbG, cbB);
+
+		// Each chroma sample covers two pixels
+		const __m128i crR2[2] = { _mm_unpacklo_epi16(crR, crR), _mm_unpackhi_epi16(crR, crR) };
+		const __m128i crbG2[2] = { _mm_unpacklo_epi16(crbG, crbG), _mm_unpackhi_epi16(crbG, crbG) };
+		const __m128i cbB2[2] = { _mm_unpacklo_epi16(cbB, cbB), _mm_unpackhi_epi16(cbB, cbB) };
+
+		convertPixels<itu>((PixelInt *)dstPtr + x, _mm_loadu_si128((const __m128i *)(ySrc + x)), crR2, crbG2, cbB2, pack);
+		convertPixels<itu>((PixelInt *)(dstPtr + dstPitch) + x, _mm_loadu_si128((const __m128i *)(ySrc + yPitch + x)), crR2, crbG2, cbB2, pack);
+	}
+
+	return x;
+}
+
+#elif defined(YUV_TO_RGB_NEON)
+
+struct VectorPack {
+	bool supported;
+	bool itu;
+	int16x8_t lumaOffset;
+	// 16 bit pixels
+	int16x8_t rLoss, gLoss, bLoss; // Negative, for right shifts
+	int16x8_t rShift, gShift, bShift;
+	uint16x8_t alpha;
+	// 32 bit pixels
+	int channelBytes[4];
+};
+
+static void initVectorPack(VectorPack &pack, const Graphics::PixelFormat &format, YUVToRGBManager::LuminanceScale scale) {
+	pack.supported = (format.bytesPerPixel == 2 || findChannelBytes(format, pack.channelBytes));
+	pack.itu = (scale == YUVToRGBManager::kScaleITU);
+	pack.lumaOffset = vdupq_n_s16(pack.itu ? -16 : 0);
+	pack.rLoss = vdupq_n_s16(-format.rLoss);
+	pack.gLoss = vdupq_n_s16(-format.gLoss);
+	pack.bLoss = vdupq_n_s16(-format.bLoss);
+	pack.rShift = vdupq_n_s16(format.rShift);
+	pack.gShift = vdupq_n_s16(format.gShift);
+	pack.bShift = vdupq_n_s16(format.bShift);
+	pack.alpha = vdupq_n_u16((uint16)format.RGBToColor(0, 0, 0));
+}
+
+static inline int16x8_t scaleChroma(int16x8_t d, uint16 factor, int shift) {
+	const uint16x8_t a = vshlq_u16(vreinterpretq_u16_s16(vabsq_s16(d)), vdupq_n_s16(shift));
+	const uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(a), vdup_n_u16(factor)), 16);
+	const uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(a), vdup_n_u16(factor)), 16);
+	const int16x8_t p = vreinterpretq_s16_u16(vcombine_u16(lo, hi));
+	return vbslq_s16(vcltq_s16(d, vdupq_n_s16(0)), vnegq_s16(p), p);
+}
+
+/**
+ * Computes what 8 chroma samples add to the luminance of each channel.
+ */
+static inline void computeChroma(int16x8_t u, int16x8_t v, int16x8_t lumaOffset, int16x8_t &crR, int16x8_t &crbG, int16x8_t &cbB) {
+	const int16x8_t offset = vdupq_n_s16(128);
+	const int16x8_t du = vsubq_s16(u, offset);
+	const int16x8_t dv = vsubq_s16(v, offset);
+
+	crR = vaddq_s16(lumaOffset, scaleChroma(dv, kCrRFactor, 1));
+	crbG = vsubq_s16(lumaOffset, vaddq_s16(scaleChroma(dv, kCrGFactor, 0), scaleChroma(du, kCbGFactor, 0)));
+	cbB = vaddq_s16(lumaOffset, scaleChroma(du, kCbBFactor, 1));
+}
+
+template<bool itu>
+static inline int16x8_t computeChannel(int16x8_t y, int16x8_t chroma) {
+	int16x8_t c = vaddq_s16(y, chroma);
+	if (itu) {
+		// The doubling multiply needs half of the factor
+		c = vaddq_s16(c, vqdmulhq_s16(c, vdupq_n_s16(kITUFactor / 2)));
+	}
+	return c;
+}
+
+/**
+ * Computes one channel of 16 pixels, as bytes.
+ */
+template<bool itu>
+static inline uint8x16_t computeChannel(uint8x16_t y, const int16x8_t chroma[2]) {
+	return vcombine_u8(vqmovun_s16(computeChannel<itu>(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y))), chroma[0])),
+	                   vqmovun_s16(computeChannel<itu>(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y))), chroma[1])));
+}
+
+static inline uint16x8_t packPixels(uint8x8_t r, uint8x8_t g, uint8x8_t b, const VectorPack &pack) {
+	uint16x8_t p = pack.alpha;
+	p = vorrq_u16(p, vshlq_u16(vshlq_u16(vmovl_u8(r), pack.rLoss), pack.rShift));
+	p = vorrq_u16(p, vshlq_u16(vshlq_u16(vmovl_u8(g), pack.gLoss), pack.gShift));
+	p = vorrq_u16(p, vshlq_u16(vshlq_u16(vmovl_u8(b), pack.bLoss), pack.bShift));
+	return p;
+}
+
+static inline void storePixels(uint16 *dst, uint8x16_t r, uint8x16_t g, uint8x16_t b, const VectorPack &pack) {
+	vst1q_u16(dst, packPixels(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b), pack));
+	vst1q_u16(dst + 8, packPixels(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b), pack));
+}
+
+static inline void storePixels(uint32 *dst, uint8x16_t r, uint8x16_t g, uint8x16_t b, const VectorPack &pack) {
+	const uint8x16_t channels[] = { r, g, b, vdupq_n_u8(0xFF), vdupq_n_u8(0) };
+
+	uint8x16x4_t pixels;
+	pixels.val[0] = channels[pack.channelBytes[0]];
+	pixels.val[1] = channels[pack.channelBytes[1]];
+	pixels.val[2] = channels[pack.channelBytes[2]];
+	pixels.val[3] = channels[pack.channelBytes[3]];
+	vst4q_u8((uint8_t *)dst, pixels);
+}
+
+template<bool itu, typename PixelInt>
+static inline void convertPixels(PixelInt *dst, uint8x16_t y, const int16x8_t crR[2], const int16x8_t crbG[2], const int16x8_t cbB[2], const VectorPack &pack) {
+	storePixels(dst, computeChannel<itu>(y, crR), computeChannel<itu>(y, crbG), computeChannel<itu>(y, cbB), pack);
+}
+
+static inline int16x8_t loadSamples(uint8x8_t samples) {
+	return vreinterpretq_s16_u16(vmovl_u8(samples));
+}
+
+template<typename PixelInt, bool itu>
+static int convertRowYUV444VectorImpl(PixelInt *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int width, const VectorPack &packRef) {
+	// Keep the constants in registers, the stores could alias them
+	const VectorPack pack = packRef;
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		const uint8x16_t u = vld1q_u8(uSrc + x);
+		const uint8x16_t v = vld1q_u8(vSrc + x);
+
+		int16x8_t crR[2], crbG[2], cbB[2];
+		computeChroma(loadSamples(vget_low_u8(u)), loadSamples(vget_low_u8(v)), pack.lumaOffset, crR[0], crbG[0], cbB[0]);
+		computeChroma(loadSamples(vget_high_u8(u)), loadSamples(vget_high_u8(v)), pack.lumaOffset, crR[1], crbG[1], cbB[1]);
+		convertPixels<itu>(dst + x, vld1q_u8(ySrc + x), crR, crbG, cbB, pack);
+	}
+
+	return x;
+}
+
+template<typename PixelInt, bool itu>
+static int convertRowsYUV420VectorImpl(byte *dstPtr, int dstPitch, const byte *ySrc, int yPitch, const byte *uSrc, const byte *vSrc, int width, const VectorPack &packRef) {
+	// Keep the constants in registers, the stores could alias them
+	const VectorPack pack = packRef;
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		int16x8_t crR, crbG, cbB;
+		computeChroma(loadSamples(vld1_u8(uSrc + x / 2)), loadSamples(vld1_u8(vSrc + x / 2)), pack.lumaOffset, crR, crbG, cbB);
+
+		// Each chroma sample covers two pixels
+		const int16x8x2_t crR2 = vzipq_s16(crR, crR);
+		const int16x8x2_t crbG2 = vzipq_s16(crbG, crbG);
+		const int16x8x2_t cbB2 = vzipq_s16(cbB, cbB);
+
+		convertPixels<itu>((PixelInt *)dstPtr + x, vld1q_u8(ySrc + x), crR2.val, crbG2.val, cbB2.val, pack);
+		convertPixels<itu>((PixelInt *)(dstPtr + dstPitch) + x, vld1q_u8(ySrc + yPitch + x), crR2.val, crbG2.val, cbB2.val, pack);
+	}
+
+	return x;
+}
+
+#endif
+
+#ifdef YUV_TO_RGB_VECTOR
+
+/**
+ * Converts the start of a YUV444 row, 16 pixels at a time.
+ * @return the number of pixels converted
+ */
+template<typename PixelInt>
+static int convertRowYUV444Vector(PixelInt *dst, const byte *ySrc, const byte *uSrc, const byte *vSrc, int width, const VectorPack &pack) {
+	if (!pack.supported)
+		return 0;
+	if (pack.itu)
+		return convertRowYUV444VectorImpl<PixelInt, true>(dst, ySrc, uSrc, vSrc, width, pack);
+	return convertRowYUV444VectorImpl<PixelInt, false>(dst, ySrc, uSrc, vSrc, width, pack);
+}
+
+/**
+ * Converts the start of two YUV420 rows sharing their chroma, 16 pixels
+ * at a time.
+ * @return the number of pixels converted in each row
+ */
+template<typename PixelInt>
+static int convertRowsYUV420Vector(byte *dstPtr, int dstPitch, const byte *ySrc, int yPitch, const byte *uSrc, const byte *vSrc, int width, const VectorPack &pack) {
+	if (!pack.supported)
+		return 0;
+	if (pack.itu)
+		return convertRowsYUV420VectorImpl<PixelInt, true>(dstPtr, dstPitch, ySrc, yPitch, uSrc, vSrc, width, pack);
+	return convertRowsYUV420VectorImpl<PixelInt, false>(dstPtr, dstPitch, ySrc, yPitch, uSrc, vSrc, width, pack);
+}
+
+#endif
+
 #define PUT_PIXEL(s, d) \
 	L = &rgbToPix[(s)]; \
 	*((PixelInt *)(d)) = (L[cr_r] | L[crb_g] | L[cb_b])
 
 template<typename PixelInt>
-void convertYUV444ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+void convertYUV444ToRGB(const YUVToRGBConversion &conversion, int yStart, int yEnd) {
 	// Keep the tables in pointers here to avoid a dereference on each pixel
-	const int16 *Cr_r_tab = colorTab;
+	const int16 *Cr_r_tab = conversion.colorTab;
 	const int16 *Cr_g_tab = Cr_r_tab + 256;
 	const int16 *Cb_g_tab = Cr_g_tab + 256;
 	const int16 *Cb_b_tab = Cb_g_tab + 256;
-	const uint32 *rgbToPix = lookup->getRGBToPix();
-
-	for (int h = 0; h < yHeight; h++) {
-		for (int w = 0; w < yWidth; w++) {
+	const uint32 *rgbToPix = conversion.lookup->getRGBToPix();
+	const int yWidth = conversion.yWidth;
+
+#ifdef YUV_TO_RGB_VECTOR
+	VectorPack pack;
+	initVectorPack(pack, conversion.lookup->getFormat(), conversion.lookup->getScale());
+#endif
+
+	for (int h = yStart; h < yEnd; h++) {
+		byte *dstPtr = conversion.dstPtr + h * conversion.dstPitch;
+		const byte *ySrc = conversion.ySrc + h * conversion.yPitch;
+		const byte *uSrc = conversion.uSrc + h * conversion.uvPitch;
+		const byte *vSrc = conversion.vSrc + h * conversion.uvPitch;
+
+		int w = 0;
+#ifdef YUV_TO_RGB_VECTOR
+		w = convertRowYUV444Vector((PixelInt *)dstPtr, ySrc, uSrc, vSrc, yWidth, pack);
+		dstPtr += w * sizeof(PixelInt);
+		ySrc += w;
+		uSrc += w;
+		vSrc += w;
+#endif
+
+		for (; w < yWidth; w++) {
 			const uint32 *L;
 
 			int16 cr_r  = Cr_r_tab[*vSrc];
@@ -219,11 +679,6 @@ void convertYUV444ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 			ySrc++;
 			dstPtr += sizeof(PixelInt);
 		}
-
-		dstPtr += dstPitch - yWidth * sizeof(PixelInt);
-		ySrc += yPitch - yWidth;
-		uSrc += uvPitch - yWidth;
-		vSrc += uvPitch - yWidth;
 	}
 }
 
@@ -233,29 +688,52 @@ void YUVToRGBManager::convert444(Graphics::Surface *dst, YUVToRGBManager::Lumina
 	assert(dst->format.bytesPerPixel == 2 || dst->format.bytesPerPixel == 4);
 	assert(ySrc && uSrc && vSrc);
 
-	const YUVToRGBLookup *lookup = getLookup(dst->format, scale);
+	YUVToRGBConversion conversion(dst, getLookup(dst->format, scale), _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
 
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
-		convertYUV444ToRGB<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		conversion.convertRows = convertYUV444ToRGB<uint16>;
 	else
-		convertYUV444ToRGB<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		conversion.convertRows = convertYUV444ToRGB<uint32>;
+
+	convert(conversion);
 }
 
 template<typename PixelInt>
-void convertYUV420ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
-	int halfHeight = yHeight >> 1;
-	int halfWidth = yWidth >> 1;
+void convertYUV420ToRGB(const YUVToRGBConversion &conversion, int yStart, int yEnd) {
+	const int halfWidth = conversion.yWidth >> 1;
+	const int yPitch = conversion.yPitch;
+	const int dstPitch = conversion.dstPitch;
 
 	// Keep the tables in pointers here to avoid a dereference on each pixel
-	const int16 *Cr_r_tab = colorTab;
+	const int16 *Cr_r_tab = conversion.colorTab;
 	const int16 *Cr_g_tab = Cr_r_tab + 256;
 	const int16 *Cb_g_tab = Cr_g_tab + 256;
 	const int16 *Cb_b_tab = Cb_g_tab + 256;
-	const uint32 *rgbToPix = lookup->getRGBToPix();
-
-	for (int h = 0; h < halfHeight; h++) {
-		for (int w = 0; w < halfWidth; w++) {
+	const uint32 *rgbToPix = conversion.lookup->getRGBToPix();
+
+#ifdef YUV_TO_RGB_VECTOR
+	VectorPack pack;
+	initVectorPack(pack, conversion.lookup->getFormat(), conversion.lookup->getScale());
+#endif
+
+	// Slices start on even rows, so the rows are always converted in pairs
+	for (int h = yStart >> 1; h < (yEnd >> 1); h++) {
+		byte *dstPtr = conversion.dstPtr + 2 * h * dstPitch;
+		const byte *ySrc = conversion.ySrc + 2 * h * yPitch;
+		const byte *uSrc = conversion.uSrc + h * conversion.uvPitch;
+		const byte *vSrc = conversion.vSrc + h * conversion.uvPitch;
+
+		int w = 0;
+#ifdef YUV_TO_RGB_VECTOR
+		w = convertRowsYUV420Vector<PixelInt>(dstPtr, dstPitch, ySrc, yPitch, uSrc, vSrc, conversion.yWidth, pack) >> 1;
+		dstPtr += 2 * w * sizeof(PixelInt);
+		ySrc += 2 * w;
+		uSrc += w;
+		vSrc += w;
+#endif
+
+		for (; w < halfWidth; w++) {
 			const uint32 *L;
 
 			int16 cr_r  = Cr_r_tab[*vSrc];
@@ -273,11 +751,6 @@ void convertYUV420ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 			ySrc++;
 			dstPtr += sizeof(PixelInt);
 		}
-
-		dstPtr += dstPitch;
-		ySrc += (yPitch << 1) - yWidth;
-		uSrc += uvPitch - halfWidth;
-		vSrc += uvPitch - halfWidth;
 	}
 }
 
@@ -289,15 +762,82 @@ void YUVToRGBManager::convert420(Graphics::Surface *dst, YUVToRGBManager::Lumina
 	assert((yWidth & 1) == 0);
 	assert((yHeight & 1) == 0);
 
-	const YUVToRGBLookup *lookup = getLookup(dst->format, scale);
+	YUVToRGBConversion conversion(dst, getLookup(dst->format, scale), _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+	conversion.rowAlignment = 2;
 
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
-		convertYUV420ToRGB<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		conversion.convertRows = convertYUV420ToRGB<uint16>;
 	else
-		convertYUV420ToRGB<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		conversion.convertRows = convertYUV420ToRGB<uint32>;
+
+	convert(conversion);
 }
 
+#ifdef YUV_TO_RGB_VECTOR
+
+/**
+ * Bilinearly scales a quarter of a chroma row to a full row, for a row of
+ * the image. The chroma row must have one extra column, and the next row
+ * is read as well.
+ */
+static void interpolateRowYUV410(byte *dst, const byte *src, int uvPitch, int yDiff, int quarterWidth) {
+	for (int x = 0; x < quarterWidth; x++) {
+		// Interpolating vertically first gives the same results
+		const int left = src[x] * (4 - yDiff) + src[x + uvPitch] * yDiff;
+		const int right = src[x + 1] * (4 - yDiff) + src[x + uvPitch + 1] * yDiff;
+
+		for (int xDiff = 0; xDiff < 4; xDiff++)
+			*dst++ = (left * (4 - xDiff) + right * xDiff) >> 4;
+	}
+}
+
+template<typename PixelInt>
+void convertYUV410ToRGB(const YUVToRGBConversion &conversion, int yStart, int yEnd) {
+	// Keep the tables in pointers here to avoid a dereference on each pixel
+	const int16 *Cr_r_tab = conversion.colorTab;
+	const int16 *Cr_g_tab = Cr_r_tab + 256;
+	const int16 *Cb_g_tab = Cr_g_tab + 256;
+	const int16 *Cb_b_tab = Cb_g_tab + 256;
+	const uint32 *rgbToPix = conversion.lookup->getRGBToPix();
+	const int yWidth = conversion.yWidth;
+	const int uvPitch = conversion.uvPitch;
+
+	VectorPack pack;
+	initVectorPack(pack, conversion.lookup->getFormat(), conversion.lookup->getScale());
+
+	// The chroma of each part of a row is scaled up to a temporary row,
+	// which is then converted like YUV444
+	const int kChunkWidth = 256;
+	byte uRow[kChunkWidth], vRow[kChunkWidth];
+
+	for (int y = yStart; y < yEnd; y++) {
+		const int index = (y >> 2) * uvPitch;
+		const int yDiff = y & 3;
+
+		for (int x = 0; x < yWidth; x += kChunkWidth) {
+			const int chunkWidth = MIN(kChunkWidth, yWidth - x);
+			interpolateRowYUV410(uRow, conversion.uSrc + index + x / 4, uvPitch, yDiff, chunkWidth / 4);
+			interpolateRowYUV410(vRow, conversion.vSrc + index + x / 4, uvPitch, yDiff, chunkWidth / 4);
+
+			PixelInt *dst = (PixelInt *)(conversion.dstPtr + y * conversion.dstPitch) + x;
+			const byte *ySrc = conversion.ySrc + y * conversion.yPitch + x;
+
+			for (int w = convertRowYUV444Vector(dst, ySrc, uRow, vRow, chunkWidth, pack); w < chunkWidth; w++) {
+				const uint32 *L;
+
+				int16 cr_r  = Cr_r_tab[vRow[w]];
+				int16 crb_g = Cr_g_tab[vRow[w]] + Cb_g_tab[uRow[w]];
+				int16 cb_b  = Cb_b_tab[uRow[w]];
+
+				PUT_PIXEL(ySrc[w], dst + w);
+			}
+		}
+	}
+}
+
+#else
+
 #define READ_QUAD(ptr, prefix) \
 	byte prefix##A = ptr[index]; \
 	byte prefix##B = ptr[index + 1]; \
@@ -323,17 +863,23 @@ void YUVToRGBManager::convert420(Graphics::Surface *dst, YUVToRGBManager::Lumina
 	xDiff++
 
 template<typename PixelInt>
-void convertYUV410ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup, int16 *colorTab, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+void convertYUV410ToRGB(const YUVToRGBConversion &conversion, int yStart, int yEnd) {
 	// Keep the tables in pointers here to avoid a dereference on each pixel
-	const int16 *Cr_r_tab = colorTab;
+	const int16 *Cr_r_tab = conversion.colorTab;
 	const int16 *Cr_g_tab = Cr_r_tab + 256;
 	const int16 *Cb_g_tab = Cr_g_tab + 256;
 	const int16 *Cb_b_tab = Cb_g_tab + 256;
-	const uint32 *rgbToPix = lookup->getRGBToPix();
+	const uint32 *rgbToPix = conversion.lookup->getRGBToPix();
+	const byte *uSrc = conversion.uSrc;
+	const byte *vSrc = conversion.vSrc;
+	const int uvPitch = conversion.uvPitch;
+
+	int quarterWidth = conversion.yWidth >> 2;
 
-	int quarterWidth = yWidth >> 2;
+	for (int y = yStart; y < yEnd; y++) {
+		byte *dstPtr = conversion.dstPtr + y * conversion.dstPitch;
+		const byte *ySrc = conversion.ySrc + y * conversion.yPitch;
 
-	for (int y = 0; y < yHeight; y++) {
 		for (int x = 0; x < quarterWidth; x++) {
 			// Perform bilinear interpolation on the the chroma values
 			// Based on the algorithm found here: http://tech-algorithm.com/articles/bilinear-image-scaling/
@@ -356,9 +902,6 @@ void convertYUV410ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 			DO_YUV410_PIXEL();
 			DO_YUV410_PIXEL();
 		}
-
-		dstPtr += dstPitch - yWidth * sizeof(PixelInt);
-		ySrc += yPitch - yWidth;
 	}
 }
 
@@ -366,6 +909,8 @@ void convertYUV410ToRGB(byte *dstPtr, int dstPitch, const YUVToRGBLookup *lookup
 #undef DO_INTERPOLATION
 #undef DO_YUV410_PIXEL
 
+#endif
+
 void YUVToRGBManager::convert410(Graphics::Surface *dst, YUVToRGBManager::LuminanceScale scale, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
 	// Sanity checks
 	assert(dst && dst->getPixels());
@@ -374,13 +919,17 @@ void YUVToRGBManager::convert410(Graphics::Surface *dst, YUVToRGBManager::Lumina
 	assert((yWidth & 3) == 0);
 	assert((yHeight & 3) == 0);
 
-	const YUVToRGBLookup *lookup = getLookup(dst->format, scale);
+	YUVToRGBConversion conversion(dst, getLookup(dst->format, scale), _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
 
 	// Use a templated function to avoid an if check on every pixel
 	if (dst->format.bytesPerPixel == 2)
-		convertYUV410ToRGB<uint16>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		conversion.convertRows = convertYUV410ToRGB<uint16>;
 	else
-		convertYUV410ToRGB<uint32>((byte *)dst->getPixels(), dst->pitch, lookup, _colorTab, ySrc, uSrc, vSrc, yWidth, yHeight, yPitch, uvPitch);
+		conversion.convertRows = convertYUV410ToRGB<uint32>;
+
+	convert(conversion);
 }
 
+#undef PUT_PIXEL
+
 } // End of namespace Graphics
@@ -42,6 +42,7 @@
 namespace Graphics {
 
 class YUVToRGBLookup;
+class YUVToRGBConversion;
 
 class YUVToRGBManager : public Common::Singleton<YUVToRGBManager> {
 public:
@@ -102,15 +103,58 @@ public:
 	 */
 	void convert410(Graphics::Surface *dst, LuminanceScale scale, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch);
 
+	/**
+	 * A conversion split into horizontal slices, which can be converted
+	 * independently of each other.
+	 */
+	class SliceJob {
+	public:
+		virtual ~SliceJob() {}
+
+		/** Convert one of the slices of the image */
+		virtual void convertSlice(uint slice) const = 0;
+	};
+
+	/**
+	 * Runs the slices of conversions on worker threads.
+	 *
+	 * OSystem has no way to start threads, so this has to be provided
+	 * by the backend or the engine which wants to use several cores.
+	 */
+	class SliceRunner {
+	public:
+		virtual ~SliceRunner() {}
+
+		/**
+		 * Call job.convertSlice() for every slice in [0, count), in any
+		 * order and on any thread, and return once all of them are done.
+		 */
+		virtual void runSlices(const SliceJob &job, uint count) = 0;
+	};
+
+	/**
+	 * Set the runner used to convert large images in slices, or 0 to
+	 * convert all images on the calling thread. The runner is not owned
+	 * by the manager.
+	 *
+	 * @param runner  the slice runner
+	 * @param slices  the maximum number of slices of an image
+	 */
+	void setSliceRunner(SliceRunner *runner, uint slices);
+
 private:
 	friend class Common::Singleton<SingletonBaseType>;
 	YUVToRGBManager();
 	~YUVToRGBManager();
 
 	const YUVToRGBLookup *getLookup(Graphics::PixelFormat format, LuminanceScale scale);
+	void convert(YUVToRGBConversion &conversion);
 
 	YUVToRGBLookup *_lookup;
 	int16 _colorTab[4 * 256]; // 2048 bytes
+
+	SliceRunner *_sliceRunner;
+	uint _sliceCount;
 };
 
 } // End of namespace Graphics
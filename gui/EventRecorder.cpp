@@ -37,6 +37,7 @@ DECLARE_SINGLETON(GUI::EventRecorder);
 #include "gui/gui-manager.h"
 #include "gui/widget.h"
 #include "gui/onscreendialog.h"
+#include "common/algorithm.h"
 #include "common/random.h"
 #include "common/savefile.h"
 #include "common/textconsole.h"
@@ -69,6 +70,26 @@ void writeTime(Common::WriteStream *outFile, uint32 d) {
 	}
 }
 
+/**
+ * Returns the real time for benchmarking, in counts. g_system->getMillis()
+ * can't be used here, as it returns the recorded time during playback.
+ */
+static uint64 getBenchmarkCounter() {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	return SDL_GetPerformanceCounter();
+#else
+	return SDL_GetTicks();
+#endif
+}
+
+static uint64 benchmarkCountsToMicros(uint64 counts) {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	return counts * 1000000 / SDL_GetPerformanceFrequency();
+#else
+	return counts * 1000;
+#endif
+}
+
 EventRecorder::EventRecorder() {
 	_timerManager = NULL;
 	_recordMode = kPassthrough;
@@ -89,6 +110,13 @@ EventRecorder::EventRecorder() {
 	_screenshotPeriod = 0;
 	_playbackFile = 0;
 
+	_benchmark = false;
+	_benchmarkReported = false;
+	_benchmarkStart = 0;
+	_frameEnd = 0;
+	_renderStart = 0;
+	_mixingTime = 0;
+
 	DebugMan.addDebugChannel(kDebugLevelEventRec, "EventRec", "Event recorder debug level");
 }
 
@@ -102,6 +130,11 @@ void EventRecorder::deinit() {
 	if (!_initialized) {
 		return;
 	}
+	if (_benchmark) {
+		reportBenchmark();
+		_benchmark = false;
+		_benchmarkFrames.clear();
+	}
 	setFileHeader();
 	_needRedraw = false;
 	_initialized = false;
@@ -152,6 +185,8 @@ void EventRecorder::processMillis(uint32 &millis, bool skipRecord) {
 			_fakeTimer = _nextEvent.time;
 			_nextEvent = _playbackFile->getNextEvent();
 			_timerManager->handler();
+		} else if (_benchmark && (_nextEvent.type == Common::EVENT_RTL || _nextEvent.type == Common::EVENT_INVALID)) {
+			finishBenchmark();
 		} else {
 			if (_nextEvent.type == Common::EVENT_RTL) {
 				error("playback:action=stopplayback");
@@ -261,7 +296,7 @@ Common::String EventRecorder::generateRecordFileName(const Common::String &targe
 }
 
 
-void EventRecorder::init(Common::String recordFileName, RecordMode mode) {
+void EventRecorder::init(Common::String recordFileName, RecordMode mode, bool benchmark) {
 	_fakeMixerManager = new NullSdlMixerManager();
 	_fakeMixerManager->init();
 	_fakeMixerManager->suspendAudio();
@@ -295,6 +330,16 @@ void EventRecorder::init(Common::String recordFileName, RecordMode mode) {
 		applyPlaybackSettings();
 		_nextEvent = _playbackFile->getNextEvent();
 	}
+	_benchmark = benchmark && (_recordMode == kRecorderPlayback);
+	if (_benchmark) {
+		// Replay as fast as possible, without showing anything
+		ConfMan.setBool("disable_display", true, Common::ConfigManager::kTransientDomain);
+		_fastPlayback = true;
+		_benchmarkReported = false;
+		_benchmarkFrames.clear();
+		_mixingTime = 0;
+		_benchmarkStart = _frameEnd = getBenchmarkCounter();
+	}
 	if (_recordMode == kRecorderRecord) {
 		getConfig();
 	}
@@ -430,7 +475,13 @@ void EventRecorder::updateSubsystems() {
 	}
 	RecordMode oldRecordMode = _recordMode;
 	_recordMode = kPassthrough;
-	_fakeMixerManager->update();
+	if (_benchmark) {
+		const uint64 start = getBenchmarkCounter();
+		_fakeMixerManager->update();
+		_mixingTime += getBenchmarkCounter() - start;
+	} else {
+		_fakeMixerManager->update();
+	}
 	_recordMode = oldRecordMode;
 }
 
@@ -556,6 +607,10 @@ Common::SaveFileManager *EventRecorder::getSaveManager(Common::SaveFileManager *
 }
 
 void EventRecorder::preDrawOverlayGui() {
+	if (_benchmark) {
+		_renderStart = getBenchmarkCounter();
+		return;
+	}
 	if ((_initialized) || (_needRedraw)) {
 		RecordMode oldMode = _recordMode;
 		_recordMode = kPassthrough;
@@ -572,6 +627,19 @@ void EventRecorder::preDrawOverlayGui() {
 }
 
 void EventRecorder::postDrawOverlayGui() {
+	if (_benchmark) {
+		const uint64 now = getBenchmarkCounter();
+		BenchmarkFrame frame;
+		frame.total = benchmarkCountsToMicros(now - _frameEnd);
+		frame.render = benchmarkCountsToMicros(now - _renderStart);
+		frame.mixing = benchmarkCountsToMicros(_mixingTime);
+		frame.engine = frame.total - MIN(frame.total, frame.render + frame.mixing);
+		_benchmarkFrames.push_back(frame);
+
+		_frameEnd = now;
+		_mixingTime = 0;
+		return;
+	}
     if ((_initialized) || (_needRedraw)) {
 		RecordMode oldMode = _recordMode;
 		_recordMode = kPassthrough;
@@ -673,6 +741,54 @@ void EventRecorder::deleteTemporarySave() {
 	_temporarySlot = -1;
 }
 
+/**
+ * Ends a benchmark when the recording has been replayed completely: the
+ * results are reported, and the engine is asked to quit.
+ */
+void EventRecorder::finishBenchmark() {
+	reportBenchmark();
+
+	_nextEvent = Common::RecorderEvent();
+	_nextEvent.recordedtype = Common::kRecorderEventTypeNormal;
+	_nextEvent.type = Common::EVENT_QUIT;
+}
+
+/**
+ * Prints the results of a benchmark, as key=value pairs in the same format
+ * as the other playback messages.
+ */
+void EventRecorder::reportBenchmark() {
+	if (_benchmarkReported) {
+		return;
+	}
+	_benchmarkReported = true;
+
+	const uint64 wallTime = benchmarkCountsToMicros(getBenchmarkCounter() - _benchmarkStart);
+	debug("benchmark:frames=%d walltime=%.3f gametime=%d", _benchmarkFrames.size(), wallTime / 1000.0, _fakeTimer);
+	if (_benchmarkFrames.empty()) {
+		return;
+	}
+
+	reportBenchmarkStat("frame", &BenchmarkFrame::total);
+	reportBenchmarkStat("engine", &BenchmarkFrame::engine);
+	reportBenchmarkStat("render", &BenchmarkFrame::render);
+	reportBenchmarkStat("mixing", &BenchmarkFrame::mixing);
+}
+
+void EventRecorder::reportBenchmarkStat(const char *name, uint32 BenchmarkFrame::*value) {
+	Common::Array<uint32> times;
+	uint64 sum = 0;
+	for (uint i = 0; i < _benchmarkFrames.size(); ++i) {
+		times.push_back(_benchmarkFrames[i].*value);
+		sum += times.back();
+	}
+	Common::sort(times.begin(), times.end());
+
+	const uint32 p99 = times[(times.size() - 1) * 99 / 100];
+	debug("benchmark:stat=%s min=%.3f avg=%.3f p99=%.3f max=%.3f total=%.3f", name,
+		times.front() / 1000.0, sum / 1000.0 / times.size(), p99 / 1000.0, times.back() / 1000.0, sum / 1000.0);
+}
+
 } // End of namespace GUI
 
 #endif // ENABLE_EVENTRECORDER
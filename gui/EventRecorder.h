@@ -78,7 +78,7 @@ public:
 		kRecorderPlaybackPause = 3	/**< kRecordetPlaybackPause, interal state when user pauses the playback */
 	};
 
-	void init(Common::String recordFileName, RecordMode mode);
+	void init(Common::String recordFileName, RecordMode mode, bool benchmark = false);
 	void deinit();
 	bool processDelayMillis();
 	uint32 getRandomSeed(const Common::String &name);
@@ -229,6 +229,26 @@ private:
 	Common::String _recordFileName;
 	bool _fastPlayback;
 	bool _needRedraw;
+
+	/** Timings of a single frame in benchmark mode, in microseconds */
+	struct BenchmarkFrame {
+		uint32 total;
+		uint32 engine;
+		uint32 render;
+		uint32 mixing;
+	};
+
+	bool _benchmark;
+	bool _benchmarkReported;
+	uint64 _benchmarkStart;
+	uint64 _frameEnd;
+	uint64 _renderStart;
+	uint64 _mixingTime;
+	Common::Array<BenchmarkFrame> _benchmarkFrames;
+
+	void finishBenchmark();
+	void reportBenchmark();
+	void reportBenchmarkStat(const char *name, uint32 BenchmarkFrame::*value);
 };
 
 } // End of namespace GUI
@@ -0,0 +1,59 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#ifndef GUI_THEME_CACHE_H
+#define GUI_THEME_CACHE_H
+
+#include "common/str.h"
+#include "common/stream.h"
+
+namespace GUI {
+
+/**
+ * Strings in the theme cache are stored with a 32 bit length in front.
+ * These are shared by all the parts of the theme written to the cache, so
+ * that the file uses a single encoding.
+ */
+inline void writeThemeCacheString(Common::WriteStream &out, const Common::String &str) {
+	out.writeUint32BE(str.size());
+	out.write(str.c_str(), str.size());
+}
+
+/**
+ * Reads a string written by writeThemeCacheString(). An empty string is
+ * returned when the length runs past the end of the stream.
+ */
+inline Common::String readThemeCacheString(Common::SeekableReadStream &in) {
+	const uint32 length = in.readUint32BE();
+	if (length > (uint32)(in.size() - in.pos()))
+		return Common::String();
+
+	Common::String str;
+	for (uint32 i = 0; i < length; ++i)
+		str += (char)in.readByte();
+	return str;
+}
+
+} // End of namespace GUI
+
+#endif
@@ -24,6 +24,9 @@
 #include "common/config-manager.h"
 #include "common/file.h"
 #include "common/fs.h"
+#include "common/md5.h"
+#include "common/memstream.h"
+#include "common/savefile.h"
 #include "common/unzip.h"
 #include "common/tokenizer.h"
 #include "common/translation.h"
@@ -41,6 +44,7 @@
 
 #include "gui/widget.h"
 #include "gui/ThemeEngine.h"
+#include "gui/ThemeCache.h"
 #include "gui/ThemeEval.h"
 #include "gui/ThemeParser.h"
 
@@ -207,6 +211,8 @@ ThemeEngine::ThemeEngine(Common::String id, GraphicsMode mode) :
 	_cursorWidth = _cursorHeight = 0;
 	_cursorPalSize = 0;
 
+	_themeCursorHotspotX = _themeCursorHotspotY = 0;
+
 	// We prefer files in archive bundles over the common search paths.
 	_themeFiles.add("default", &SearchMan, 0, false);
 }
@@ -508,6 +514,10 @@ bool ThemeEngine::addFont(TextData textId, const Common::String &file, const Com
 
 	_texts[textId] = new TextDrawData;
 
+	_themeFonts[textId].file = file;
+	_themeFonts[textId].scalableFile = scalableFile;
+	_themeFonts[textId].pointsize = pointsize;
+
 	if (file == "default") {
 		_texts[textId]->_fontPtr = _font;
 	} else {
@@ -576,6 +586,9 @@ bool ThemeEngine::addTextColor(TextColor colorId, int r, int g, int b) {
 }
 
 bool ThemeEngine::addBitmap(const Common::String &filename) {
+	if (Common::find(_themeBitmaps.begin(), _themeBitmaps.end(), filename) == _themeBitmaps.end())
+		_themeBitmaps.push_back(filename);
+
 	// Nothing has to be done if the bitmap already has been loaded.
 	Graphics::Surface *surf = _bitmaps[filename];
 	if (surf)
@@ -634,6 +647,9 @@ bool ThemeEngine::addBitmap(const Common::String &filename) {
 }
 
 bool ThemeEngine::addAlphaBitmap(const Common::String &filename) {
+	if (Common::find(_themeAlphaBitmaps.begin(), _themeAlphaBitmaps.end(), filename) == _themeAlphaBitmaps.end())
+		_themeAlphaBitmaps.push_back(filename);
+
 	// Nothing has to be done if the bitmap already has been loaded.
 	Graphics::TransparentSurface *surf = _abitmaps[filename];
 	if (surf)
@@ -724,9 +740,7 @@ void ThemeEngine::loadTheme(const Common::String &themeId) {
 }
 
 void ThemeEngine::unloadTheme() {
-	if (!_themeOk)
-		return;
-
+	// This also cleans up after themes which failed to load.
 	for (int i = 0; i < kDrawDataMAX; ++i) {
 		delete _widgets[i];
 		_widgets[i] = 0;
@@ -742,6 +756,12 @@ void ThemeEngine::unloadTheme() {
 		_textColors[i] = 0;
 	}
 
+	for (int i = 0; i < kTextDataMAX; ++i)
+		_themeFonts[i] = ThemeFont();
+	_themeBitmaps.clear();
+	_themeAlphaBitmaps.clear();
+	_themeCursor.clear();
+
 	_themeEval->reset();
 	_themeOk = false;
 }
@@ -765,21 +785,31 @@ bool ThemeEngine::loadDefaultXML() {
 	for (int i = 0; i < ARRAYSIZE(defaultXML); i++)
 		strncat((char *)tmpXML, defaultXML[i], xmllen);
 
+	_themeName = "ScummVM Classic Theme (Builtin Version)";
+	_themeId = "builtin";
+	_themeFile.clear();
+
+	Common::MemoryReadStream xmlStream(tmpXML, xmllen);
+	const Common::String cacheKey = "builtin " + Common::computeStreamMD5AsString(xmlStream) + " " + getOverlayCacheKey();
+	if (loadThemeCache(cacheKey)) {
+		free(tmpXML);
+		return true;
+	}
+
 	if (!_parser->loadBuffer(tmpXML, xmllen)) {
 		free(tmpXML);
 
 		return false;
 	}
 
-	_themeName = "ScummVM Classic Theme (Builtin Version)";
-	_themeId = "builtin";
-	_themeFile.clear();
-
 	bool result = _parser->parse();
 	_parser->close();
 
 	free(tmpXML);
 
+	if (result)
+		saveThemeCache(cacheKey);
+
 	return result;
 #else
 	warning("The built-in theme is not enabled in the current build. Please load an external theme");
@@ -816,6 +846,26 @@ bool ThemeEngine::loadThemeXML(const Common::String &themeId) {
 		return false;
 	}
 
+	// Hashing the theme files is much quicker than parsing and decoding them,
+	// so the theme cache is only used when the STX files and the bitmaps,
+	// which the cache stores decoded, are unchanged.
+	Common::ArchiveMemberList cachedMembers = members;
+	_themeArchive->listMatchingMembers(cachedMembers, "*.bmp");
+	_themeArchive->listMatchingMembers(cachedMembers, "*.png");
+
+	Common::String cacheKey = stxHeader;
+	for (Common::ArchiveMemberList::iterator i = cachedMembers.begin(); i != cachedMembers.end(); ++i) {
+		Common::SeekableReadStream *stream = (*i)->createReadStream();
+		if (stream) {
+			cacheKey += " " + (*i)->getName() + ":" + Common::computeStreamMD5AsString(*stream);
+			delete stream;
+		}
+	}
+	cacheKey += " " + getOverlayCacheKey();
+
+	if (loadThemeCache(cacheKey))
+		return true;
+
 	//
 	// Loop over all STX files, load and parse them
 	//
@@ -838,11 +888,366 @@ bool ThemeEngine::loadThemeXML(const Common::String &themeId) {
 	}
 
 	assert(!_themeName.empty());
+	saveThemeCache(cacheKey);
 	return true;
 }
 
 
 
+/**********************************************************
+ * Theme cache
+ *********************************************************/
+enum {
+	kThemeCacheTag = MKTAG('T','H','M','C'),
+	kThemeCacheEndTag = MKTAG('T','H','M','E'),
+	kThemeCacheVersion = 3
+};
+
+static void writeCacheColor(Common::WriteStream &out, const Graphics::DrawStep::Color &color) {
+	out.writeByte(color.r);
+	out.writeByte(color.g);
+	out.writeByte(color.b);
+	out.writeByte(color.set ? 1 : 0);
+}
+
+static void readCacheColor(Common::SeekableReadStream &in, Graphics::DrawStep::Color &color) {
+	color.r = in.readByte();
+	color.g = in.readByte();
+	color.b = in.readByte();
+	color.set = (in.readByte() != 0);
+}
+
+static void writeCacheSurface(Common::WriteStream &out, const Graphics::Surface &surface) {
+	out.writeUint16BE(surface.w);
+	out.writeUint16BE(surface.h);
+	for (int y = 0; y < surface.h; ++y)
+		out.write(surface.getBasePtr(0, y), surface.w * surface.format.bytesPerPixel);
+}
+
+static bool readCacheSurface(Common::SeekableReadStream &in, Graphics::Surface &surface, const Graphics::PixelFormat &format) {
+	const uint16 w = in.readUint16BE();
+	const uint16 h = in.readUint16BE();
+	if ((uint32)w * h * format.bytesPerPixel > (uint32)(in.size() - in.pos()))
+		return false;
+
+	surface.create(w, h, format);
+	for (int y = 0; y < surface.h; ++y)
+		in.read(surface.getBasePtr(0, y), surface.w * format.bytesPerPixel);
+	return true;
+}
+
+Common::String ThemeEngine::getThemeCacheName() const {
+	// The leading dot keeps the cache out of the cloud sync.
+	return Common::String::format(".%s-%dx%d.themecache", _themeId.c_str(), _system->getOverlayWidth(), _system->getOverlayHeight());
+}
+
+Common::String ThemeEngine::getOverlayCacheKey() const {
+	return Common::String::format("%dx%d %s", _system->getOverlayWidth(), _system->getOverlayHeight(), _overlayFormat.toString().c_str());
+}
+
+bool ThemeEngine::loadThemeCache(const Common::String &key) {
+	Common::SeekableReadStream *file = _system->getSavefileManager()->openForLoading(getThemeCacheName());
+	if (!file)
+		return false;
+
+	// Read the whole cache at once, it is parsed from memory.
+	const int32 size = file->size();
+	byte *data = size > 0 ? (byte *)malloc(size) : 0;
+	if (!data || file->read(data, size) != (uint32)size) {
+		free(data);
+		delete file;
+		return false;
+	}
+	delete file;
+
+	Common::MemoryReadStream in(data, size, DisposeAfterUse::YES);
+	if (in.readUint32BE() != kThemeCacheTag || in.readUint32BE() != kThemeCacheVersion || readThemeCacheString(in) != key)
+		return false;
+
+	debug(6, "Loading theme %s from the theme cache", _themeId.c_str());
+
+	if (!readThemeCache(in)) {
+		warning("Theme cache '%s' is broken", getThemeCacheName().c_str());
+		// Start over with the theme description
+		unloadTheme();
+		return false;
+	}
+
+	return true;
+}
+
+bool ThemeEngine::readThemeCache(Common::SeekableReadStream &in) {
+	for (uint32 count = in.readUint32BE(); count > 0 && !in.eos(); --count) {
+		const Common::String name = readThemeCacheString(in);
+		_themeBitmaps.push_back(name);
+
+		Graphics::Surface *surf = new Graphics::Surface();
+		if (!readCacheSurface(in, *surf, _overlayFormat)) {
+			delete surf;
+			break;
+		}
+
+		// Bitmaps loaded for a previous theme are kept, just like addBitmap() does.
+		if (_bitmaps[name]) {
+			surf->free();
+			delete surf;
+		} else {
+			_bitmaps[name] = surf;
+		}
+	}
+
+	for (uint32 count = in.readUint32BE(); count > 0 && !in.eos(); --count) {
+		const Common::String name = readThemeCacheString(in);
+		_themeAlphaBitmaps.push_back(name);
+
+		Graphics::TransparentSurface *surf = new Graphics::TransparentSurface();
+		if (!readCacheSurface(in, *surf, _overlayFormat)) {
+			delete surf;
+			break;
+		}
+
+		if (_abitmaps[name]) {
+			surf->free();
+			delete surf;
+		} else {
+			_abitmaps[name] = surf;
+		}
+	}
+
+	for (int i = 0; i < kDrawDataMAX && !in.eos(); ++i) {
+		if (!in.readByte())
+			continue;
+
+		WidgetDrawData *drawData = new WidgetDrawData;
+		_widgets[i] = drawData;
+
+		drawData->_layer = (DrawLayer)in.readByte();
+		drawData->_textDataId = (TextData)in.readSint32BE();
+		drawData->_textColorId = (TextColor)in.readSint32BE();
+		drawData->_textAlignH = (Graphics::TextAlign)in.readSint32BE();
+		drawData->_textAlignV = (TextAlignVertical)in.readSint32BE();
+
+		for (uint32 steps = in.readUint32BE(); steps > 0 && !in.eos(); --steps) {
+			Graphics::DrawStep step;
+
+			step.drawingCall = ThemeParser::getDrawingFunctionCallback(readThemeCacheString(in));
+			if (!step.drawingCall)
+				return false;
+
+			const Common::String bitmap = readThemeCacheString(in);
+			if (!bitmap.empty())
+				step.blitSrc = getBitmap(bitmap);
+			const Common::String alphaBitmap = readThemeCacheString(in);
+			if (!alphaBitmap.empty())
+				step.blitAlphaSrc = getAlphaBitmap(alphaBitmap);
+
+			readCacheColor(in, step.fgColor);
+			readCacheColor(in, step.bgColor);
+			readCacheColor(in, step.gradColor1);
+			readCacheColor(in, step.gradColor2);
+			readCacheColor(in, step.bevelColor);
+
+			step.autoWidth = (in.readByte() != 0);
+			step.autoHeight = (in.readByte() != 0);
+			step.x = in.readSint16BE();
+			step.y = in.readSint16BE();
+			step.w = in.readSint16BE();
+			step.h = in.readSint16BE();
+			step.padding.left = in.readSint16BE();
+			step.padding.top = in.readSint16BE();
+			step.padding.right = in.readSint16BE();
+			step.padding.bottom = in.readSint16BE();
+			step.xAlign = (Graphics::DrawStep::VectorAlignment)in.readByte();
+			step.yAlign = (Graphics::DrawStep::VectorAlignment)in.readByte();
+			step.shadow = in.readByte();
+			step.stroke = in.readByte();
+			step.factor = in.readByte();
+			step.radius = in.readByte();
+			step.bevel = in.readByte();
+			step.fillMode = in.readByte();
+			step.shadowFillMode = in.readByte();
+			step.extraData = in.readUint32BE();
+			step.scale = in.readUint32BE();
+			step.autoscale = (AutoScaleMode)in.readByte();
+
+			drawData->_steps.push_back(step);
+		}
+	}
+
+	for (int i = 0; i < kTextColorMAX && !in.eos(); ++i) {
+		if (!in.readByte())
+			continue;
+
+		const int r = in.readSint32BE();
+		const int g = in.readSint32BE();
+		const int b = in.readSint32BE();
+		addTextColor((TextColor)i, r, g, b);
+	}
+
+	// Fonts have caches of their own, and depend on the GUI language.
+	for (int i = 0; i < kTextDataMAX && !in.eos(); ++i) {
+		if (!in.readByte())
+			continue;
+
+		const Common::String fontFile = readThemeCacheString(in);
+		const Common::String scalableFile = readThemeCacheString(in);
+		const int pointsize = in.readSint32BE();
+		if (in.eos() || !addFont((TextData)i, fontFile, scalableFile, pointsize))
+			return false;
+	}
+
+	if (in.readByte()) {
+		const Common::String cursor = readThemeCacheString(in);
+		const int hotspotX = in.readSint32BE();
+		const int hotspotY = in.readSint32BE();
+		if (in.eos() || !createCursor(cursor, hotspotX, hotspotY))
+			return false;
+	}
+
+	if (!_themeEval->loadFromStream(in))
+		return false;
+
+	return in.readUint32BE() == kThemeCacheEndTag && !in.eos();
+}
+
+void ThemeEngine::saveThemeCache(const Common::String &key) {
+	Common::SaveFileManager *saveFileMan = _system->getSavefileManager();
+
+	// Only the cache for the current overlay is kept, caches for other
+	// resolutions of this theme would otherwise pile up.
+	Common::StringArray oldCaches = saveFileMan->listSavefiles(Common::String::format(".%s-*.themecache", _themeId.c_str()));
+	for (Common::StringArray::const_iterator i = oldCaches.begin(); i != oldCaches.end(); ++i) {
+		if (!i->equalsIgnoreCase(getThemeCacheName()))
+			saveFileMan->removeSavefile(*i);
+	}
+
+	Common::OutSaveFile *out = saveFileMan->openForSaving(getThemeCacheName(), false);
+	if (!out) {
+		debug(6, "Could not create the theme cache for %s", _themeId.c_str());
+		return;
+	}
+
+	out->writeUint32BE(kThemeCacheTag);
+	out->writeUint32BE(kThemeCacheVersion);
+	writeThemeCacheString(*out, key);
+
+	// Decoded bitmaps, in the overlay format
+	Common::StringArray bitmaps;
+	for (uint i = 0; i < _themeBitmaps.size(); ++i) {
+		if (getBitmap(_themeBitmaps[i]))
+			bitmaps.push_back(_themeBitmaps[i]);
+	}
+	out->writeUint32BE(bitmaps.size());
+	for (uint i = 0; i < bitmaps.size(); ++i) {
+		writeThemeCacheString(*out, bitmaps[i]);
+		writeCacheSurface(*out, *getBitmap(bitmaps[i]));
+	}
+
+	Common::StringArray alphaBitmaps;
+	for (uint i = 0; i < _themeAlphaBitmaps.size(); ++i) {
+		if (getAlphaBitmap(_themeAlphaBitmaps[i]))
+			alphaBitmaps.push_back(_themeAlphaBitmaps[i]);
+	}
+	out->writeUint32BE(alphaBitmaps.size());
+	for (uint i = 0; i < alphaBitmaps.size(); ++i) {
+		writeThemeCacheString(*out, alphaBitmaps[i]);
+		writeCacheSurface(*out, *getAlphaBitmap(alphaBitmaps[i]));
+	}
+
+	// Draw data
+	for (int i = 0; i < kDrawDataMAX; ++i) {
+		const WidgetDrawData *drawData = _widgets[i];
+		out->writeByte(drawData ? 1 : 0);
+		if (!drawData)
+			continue;
+
+		out->writeByte(drawData->_layer);
+		out->writeSint32BE(drawData->_textDataId);
+		out->writeSint32BE(drawData->_textColorId);
+		out->writeSint32BE(drawData->_textAlignH);
+		out->writeSint32BE(drawData->_textAlignV);
+
+		out->writeUint32BE(drawData->_steps.size());
+		for (Common::List<Graphics::DrawStep>::const_iterator step = drawData->_steps.begin(); step != drawData->_steps.end(); ++step) {
+			writeThemeCacheString(*out, ThemeParser::getDrawingFunctionName(step->drawingCall));
+
+			Common::String bitmap, alphaBitmap;
+			for (ImagesMap::const_iterator j = _bitmaps.begin(); j != _bitmaps.end(); ++j) {
+				if (step->blitSrc && j->_value == step->blitSrc)
+					bitmap = j->_key;
+			}
+			for (AImagesMap::const_iterator j = _abitmaps.begin(); j != _abitmaps.end(); ++j) {
+				if (step->blitAlphaSrc && j->_value == step->blitAlphaSrc)
+					alphaBitmap = j->_key;
+			}
+			writeThemeCacheString(*out, bitmap);
+			writeThemeCacheString(*out, alphaBitmap);
+
+			writeCacheColor(*out, step->fgColor);
+			writeCacheColor(*out, step->bgColor);
+			writeCacheColor(*out, step->gradColor1);
+			writeCacheColor(*out, step->gradColor2);
+			writeCacheColor(*out, step->bevelColor);
+
+			out->writeByte(step->autoWidth ? 1 : 0);
+			out->writeByte(step->autoHeight ? 1 : 0);
+			out->writeSint16BE(step->x);
+			out->writeSint16BE(step->y);
+			out->writeSint16BE(step->w);
+			out->writeSint16BE(step->h);
+			out->writeSint16BE(step->padding.left);
+			out->writeSint16BE(step->padding.top);
+			out->writeSint16BE(step->padding.right);
+			out->writeSint16BE(step->padding.bottom);
+			out->writeByte(step->xAlign);
+			out->writeByte(step->yAlign);
+			out->writeByte(step->shadow);
+			out->writeByte(step->stroke);
+			out->writeByte(step->factor);
+			out->writeByte(step->radius);
+			out->writeByte(step->bevel);
+			out->writeByte(step->fillMode);
+			out->writeByte(step->shadowFillMode);
+			out->writeUint32BE(step->extraData);
+			out->writeUint32BE(step->scale);
+			out->writeByte(step->autoscale);
+		}
+	}
+
+	for (int i = 0; i < kTextColorMAX; ++i) {
+		out->writeByte(_textColors[i] ? 1 : 0);
+		if (_textColors[i]) {
+			out->writeSint32BE(_textColors[i]->r);
+			out->writeSint32BE(_textColors[i]->g);
+			out->writeSint32BE(_textColors[i]->b);
+		}
+	}
+
+	for (int i = 0; i < kTextDataMAX; ++i) {
+		out->writeByte(_texts[i] ? 1 : 0);
+		if (_texts[i]) {
+			writeThemeCacheString(*out, _themeFonts[i].file);
+			writeThemeCacheString(*out, _themeFonts[i].scalableFile);
+			out->writeSint32BE(_themeFonts[i].pointsize);
+		}
+	}
+
+	out->writeByte(_themeCursor.empty() ? 0 : 1);
+	if (!_themeCursor.empty()) {
+		writeThemeCacheString(*out, _themeCursor);
+		out->writeSint32BE(_themeCursorHotspotX);
+		out->writeSint32BE(_themeCursorHotspotY);
+	}
+
+	_themeEval->saveToStream(*out);
+	out->writeUint32BE(kThemeCacheEndTag);
+
+	out->finalize();
+	if (out->err())
+		warning("Could not write the theme cache '%s'", getThemeCacheName().c_str());
+	delete out;
+}
+
 /**********************************************************
  * Draw Date descriptors drawing functions
  *********************************************************/
@@ -1351,6 +1756,10 @@ void ThemeEngine::applyScreenShading(ShadingStyle style) {
 }
 
 bool ThemeEngine::createCursor(const Common::String &filename, int hotspotX, int hotspotY) {
+	_themeCursor = filename;
+	_themeCursorHotspotX = hotspotX;
+	_themeCursorHotspotY = hotspotY;
+
 	if (!_system->hasFeature(OSystem::kFeatureCursorPalette))
 		return true;
 
@@ -29,6 +29,7 @@
 #include "common/hashmap.h"
 #include "common/list.h"
 #include "common/str.h"
+#include "common/str-array.h"
 #include "common/rect.h"
 
 #include "graphics/surface.h"
@@ -609,6 +610,29 @@ protected:
 	 */
 	void unloadTheme();
 
+	/**
+	 * Loads the theme from the theme cache, instead of parsing its
+	 * description.
+	 *
+	 * @param key Identifies the theme sources and the overlay the cache
+	 *            was written for.
+	 * @returns true if a matching cache was found and loaded.
+	 */
+	bool loadThemeCache(const Common::String &key);
+	bool readThemeCache(Common::SeekableReadStream &in);
+
+	/**
+	 * Writes the parsed draw data, layouts and decoded bitmaps of the
+	 * current theme to the theme cache.
+	 */
+	void saveThemeCache(const Common::String &key);
+
+	/** Returns the file name of the theme cache for the current overlay size. */
+	Common::String getThemeCacheName() const;
+
+	/** Returns the part of a theme cache key which describes the overlay. */
+	Common::String getOverlayCacheKey() const;
+
 	const Graphics::Font *loadScalableFont(const Common::String &filename, const Common::String &charset, const int pointsize, Common::String &name);
 	const Graphics::Font *loadFont(const Common::String &filename, Common::String &name);
 	Common::String genCacheFilename(const Common::String &filename) const;
@@ -738,6 +762,21 @@ protected:
 	byte _cursorPal[3 * MAX_CURS_COLORS];
 	byte _cursorPalSize;
 
+	/**
+	 * Resources requested by the theme description. Fonts and the cursor
+	 * are not stored in the theme cache, they are set up again from these.
+	 */
+	struct ThemeFont {
+		Common::String file;
+		Common::String scalableFile;
+		int pointsize;
+	};
+	ThemeFont _themeFonts[kTextDataMAX];
+	Common::StringArray _themeBitmaps;
+	Common::StringArray _themeAlphaBitmaps;
+	Common::String _themeCursor;
+	int _themeCursorHotspotX, _themeCursorHotspotY;
+
 	Common::Rect _clip;
 };
 
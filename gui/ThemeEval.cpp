@@ -21,6 +21,7 @@
  */
 
 #include "gui/ThemeEval.h"
+#include "gui/ThemeCache.h"
 
 #include "graphics/scaler.h"
 
@@ -176,4 +177,44 @@ bool ThemeEval::addImportedLayout(const Common::String &name) {
 	return true;
 }
 
+void ThemeEval::saveToStream(Common::WriteStream &out) const {
+	out.writeUint32BE(_vars.size());
+	for (VariablesMap::const_iterator i = _vars.begin(); i != _vars.end(); ++i) {
+		writeThemeCacheString(out, i->_key);
+		out.writeSint32BE(i->_value);
+	}
+
+	out.writeUint32BE(_layouts.size());
+	for (LayoutsMap::const_iterator i = _layouts.begin(); i != _layouts.end(); ++i) {
+		writeThemeCacheString(out, i->_key);
+		i->_value->saveToStream(out);
+	}
+}
+
+bool ThemeEval::loadFromStream(Common::SeekableReadStream &in) {
+	reset();
+
+	for (uint32 vars = in.readUint32BE(); vars > 0 && !in.eos(); --vars) {
+		const Common::String name = readThemeCacheString(in);
+		_vars[name] = in.readSint32BE();
+	}
+
+	for (uint32 layouts = in.readUint32BE(); layouts > 0 && !in.eos(); --layouts) {
+		const Common::String name = readThemeCacheString(in);
+		ThemeLayout *layout = ThemeLayout::loadFromStream(in, 0);
+		if (!layout) {
+			reset();
+			return false;
+		}
+		_layouts[name] = layout;
+	}
+
+	if (in.err() || in.eos()) {
+		reset();
+		return false;
+	}
+
+	return true;
+}
+
 } // End of namespace GUI
@@ -97,6 +97,16 @@ public:
 
 	void reset();
 
+	/** Writes the variables and layouts to a theme cache. */
+	void saveToStream(Common::WriteStream &out) const;
+
+	/**
+	 * Replaces the variables and layouts with the ones from a theme cache.
+	 *
+	 * @return Whether the data could be read.
+	 */
+	bool loadFromStream(Common::SeekableReadStream &in);
+
 private:
 	VariablesMap _vars;
 	VariablesMap _builtin;
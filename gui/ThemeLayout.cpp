@@ -24,6 +24,7 @@
 #include "common/system.h"
 
 #include "gui/ThemeLayout.h"
+#include "gui/ThemeCache.h"
 
 #include "graphics/font.h"
 
@@ -121,6 +122,135 @@ int16 ThemeLayoutStacked::getParentHeight() {
 	return p->getHeight() - height;
 }
 
+void ThemeLayout::saveFields(Common::WriteStream &out) const {
+	out.writeSint16BE(_x);
+	out.writeSint16BE(_y);
+	out.writeSint16BE(_w);
+	out.writeSint16BE(_h);
+	out.writeSint16BE(_padding.left);
+	out.writeSint16BE(_padding.right);
+	out.writeSint16BE(_padding.top);
+	out.writeSint16BE(_padding.bottom);
+	out.writeByte(_centered ? 1 : 0);
+	out.writeSint16BE(_defaultW);
+	out.writeSint16BE(_defaultH);
+	out.writeSint16BE(_textHAlign);
+
+	out.writeUint16BE(_children.size());
+	for (uint i = 0; i < _children.size(); ++i)
+		_children[i]->saveToStream(out);
+}
+
+bool ThemeLayout::loadFields(Common::SeekableReadStream &in) {
+	_x = in.readSint16BE();
+	_y = in.readSint16BE();
+	_w = in.readSint16BE();
+	_h = in.readSint16BE();
+	_padding.left = in.readSint16BE();
+	_padding.right = in.readSint16BE();
+	_padding.top = in.readSint16BE();
+	_padding.bottom = in.readSint16BE();
+	_centered = (in.readByte() != 0);
+	_defaultW = in.readSint16BE();
+	_defaultH = in.readSint16BE();
+	_textHAlign = (Graphics::TextAlign)in.readSint16BE();
+
+	for (uint16 children = in.readUint16BE(); children > 0; --children) {
+		if (in.err() || in.eos())
+			return false;
+
+		ThemeLayout *child = loadFromStream(in, this);
+		if (!child)
+			return false;
+		_children.push_back(child);
+	}
+
+	return !in.err() && !in.eos();
+}
+
+ThemeLayout *ThemeLayout::loadFromStream(Common::SeekableReadStream &in, ThemeLayout *parent) {
+	ThemeLayout *layout = 0;
+
+	// The constructor arguments come first, followed by the fields all
+	// layouts have in common.
+	switch (in.readByte()) {
+	case kCacheMain: {
+		const int16 x = in.readSint16BE();
+		const int16 y = in.readSint16BE();
+		layout = new ThemeLayoutMain(x, y, -1, -1);
+		break;
+	}
+
+	case kCacheStacked: {
+		const LayoutType type = (LayoutType)in.readByte();
+		const int8 spacing = in.readSByte();
+		if (parent && (type == kLayoutVertical || type == kLayoutHorizontal))
+			layout = new ThemeLayoutStacked(parent, type, spacing, false);
+		break;
+	}
+
+	case kCacheWidget:
+		if (parent)
+			layout = new ThemeLayoutWidget(parent, readThemeCacheString(in), -1, -1, Graphics::kTextAlignInvalid);
+		break;
+
+	case kCacheTabWidget: {
+		const Common::String name = readThemeCacheString(in);
+		const int tabHeight = in.readSint32BE();
+		if (parent)
+			layout = new ThemeLayoutTabWidget(parent, name, -1, -1, Graphics::kTextAlignInvalid, tabHeight);
+		break;
+	}
+
+	case kCacheSpacing:
+		if (parent)
+			layout = new ThemeLayoutSpacing(parent, 0);
+		break;
+
+	default:
+		break;
+	}
+
+	if (layout && !layout->loadFields(in)) {
+		delete layout;
+		layout = 0;
+	}
+
+	return layout;
+}
+
+void ThemeLayoutMain::saveToStream(Common::WriteStream &out) const {
+	out.writeByte(kCacheMain);
+	out.writeSint16BE(_defaultX);
+	out.writeSint16BE(_defaultY);
+	saveFields(out);
+}
+
+void ThemeLayoutStacked::saveToStream(Common::WriteStream &out) const {
+	out.writeByte(kCacheStacked);
+	out.writeByte(_type);
+	out.writeSByte(_spacing);
+	saveFields(out);
+}
+
+void ThemeLayoutWidget::saveToStream(Common::WriteStream &out) const {
+	out.writeByte(kCacheWidget);
+	writeThemeCacheString(out, _name);
+	saveFields(out);
+}
+
+void ThemeLayoutTabWidget::saveToStream(Common::WriteStream &out) const {
+	out.writeByte(kCacheTabWidget);
+	writeThemeCacheString(out, _name);
+	out.writeSint32BE(_tabHeight);
+	saveFields(out);
+}
+
+void ThemeLayoutSpacing::saveToStream(Common::WriteStream &out) const {
+	out.writeByte(kCacheSpacing);
+	saveFields(out);
+}
+
 #ifdef LAYOUT_DEBUG_DIALOG
 void ThemeLayout::debugDraw(Graphics::Surface *screen, const Graphics::Font *font) {
 	uint32 color = 0xFFFFFFFF;
@@ -25,6 +25,7 @@
 
 #include "common/array.h"
 #include "common/rect.h"
+#include "common/stream.h"
 #include "graphics/font.h"
 
 #ifdef LAYOUT_DEBUG_DIALOG
@@ -105,6 +106,16 @@ public:
 
 	Graphics::TextAlign getTextHAlign() { return _textHAlign; }
 
+	/** Writes the layout, including its children, to a theme cache. */
+	virtual void saveToStream(Common::WriteStream &out) const = 0;
+
+	/**
+	 * Reads a layout written by saveToStream().
+	 *
+	 * @return The layout, or 0 if the data is broken.
+	 */
+	static ThemeLayout *loadFromStream(Common::SeekableReadStream &in, ThemeLayout *parent);
+
 #ifdef LAYOUT_DEBUG_DIALOG
 	void debugDraw(Graphics::Surface *screen, const Graphics::Font *font);
 
@@ -112,6 +123,18 @@ public:
 #endif
 
 protected:
+	/** Types of layouts in the theme cache */
+	enum CacheType {
+		kCacheMain,
+		kCacheStacked,
+		kCacheWidget,
+		kCacheTabWidget,
+		kCacheSpacing
+	};
+
+	void saveFields(Common::WriteStream &out) const;
+	bool loadFields(Common::SeekableReadStream &in);
+
 	ThemeLayout *_parent;
 	int16 _x, _y, _w, _h;
 	Common::Rect _padding;
@@ -137,6 +160,8 @@ public:
 		_y = _defaultY;
 	}
 
+	void saveToStream(Common::WriteStream &out) const;
+
 #ifdef LAYOUT_DEBUG_DIALOG
 	const char *getName() const { return "Global Layout"; }
 #endif
@@ -167,6 +192,8 @@ public:
 	void reflowLayoutHorizontal();
 	void reflowLayoutVertical();
 
+	void saveToStream(Common::WriteStream &out) const;
+
 #ifdef LAYOUT_DEBUG_DIALOG
 	const char *getName() const {
 		return (_type == kLayoutVertical)
@@ -208,6 +235,8 @@ public:
 
 	void reflowLayout() {}
 
+	void saveToStream(Common::WriteStream &out) const;
+
 #ifdef LAYOUT_DEBUG_DIALOG
 	virtual const char *getName() const { return _name.c_str(); }
 #endif
@@ -249,6 +278,8 @@ public:
 		return false;
 	}
 
+	void saveToStream(Common::WriteStream &out) const;
+
 protected:
 	LayoutType getLayoutType() { return kLayoutTabWidget; }
 
@@ -273,6 +304,8 @@ public:
 
 	bool getWidgetData(const Common::String &name, int16 &x, int16 &y, uint16 &w, uint16 &h) { return false; }
 	void reflowLayout() {}
+
+	void saveToStream(Common::WriteStream &out) const;
 #ifdef LAYOUT_DEBUG_DIALOG
 	const char *getName() const { return "SPACE"; }
 #endif
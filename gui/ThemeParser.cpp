@@ -310,32 +310,38 @@ bool ThemeParser::parserCallback_color(ParserNode *node) {
 }
 
 
-static Graphics::DrawingFunctionCallback getDrawingFunctionCallback(const Common::String &name) {
-
-	if (name == "circle")
-		return &Graphics::VectorRenderer::drawCallback_CIRCLE;
-	if (name == "square")
-		return &Graphics::VectorRenderer::drawCallback_SQUARE;
-	if (name == "roundedsq")
-		return &Graphics::VectorRenderer::drawCallback_ROUNDSQ;
-	if (name == "bevelsq")
-		return &Graphics::VectorRenderer::drawCallback_BEVELSQ;
-	if (name == "line")
-		return &Graphics::VectorRenderer::drawCallback_LINE;
-	if (name == "triangle")
-		return &Graphics::VectorRenderer::drawCallback_TRIANGLE;
-	if (name == "fill")
-		return &Graphics::VectorRenderer::drawCallback_FILLSURFACE;
-	if (name == "tab")
-		return &Graphics::VectorRenderer::drawCallback_TAB;
-	if (name == "void")
-		return &Graphics::VectorRenderer::drawCallback_VOID;
-	if (name == "bitmap")
-		return &Graphics::VectorRenderer::drawCallback_BITMAP;
-	if (name == "cross")
-		return &Graphics::VectorRenderer::drawCallback_CROSS;
-	if (name == "alphabitmap")
-		return &Graphics::VectorRenderer::drawCallback_ALPHABITMAP;
+static const struct {
+	const char *name;
+	Graphics::DrawingFunctionCallback callback;
+} kDrawingFunctions[] = {
+	{ "circle", &Graphics::VectorRenderer::drawCallback_CIRCLE },
+	{ "square", &Graphics::VectorRenderer::drawCallback_SQUARE },
+	{ "roundedsq", &Graphics::VectorRenderer::drawCallback_ROUNDSQ },
+	{ "bevelsq", &Graphics::VectorRenderer::drawCallback_BEVELSQ },
+	{ "line", &Graphics::VectorRenderer::drawCallback_LINE },
+	{ "triangle", &Graphics::VectorRenderer::drawCallback_TRIANGLE },
+	{ "fill", &Graphics::VectorRenderer::drawCallback_FILLSURFACE },
+	{ "tab", &Graphics::VectorRenderer::drawCallback_TAB },
+	{ "void", &Graphics::VectorRenderer::drawCallback_VOID },
+	{ "bitmap", &Graphics::VectorRenderer::drawCallback_BITMAP },
+	{ "cross", &Graphics::VectorRenderer::drawCallback_CROSS },
+	{ "alphabitmap", &Graphics::VectorRenderer::drawCallback_ALPHABITMAP }
+};
+
+Graphics::DrawingFunctionCallback ThemeParser::getDrawingFunctionCallback(const Common::String &name) {
+	for (uint i = 0; i < ARRAYSIZE(kDrawingFunctions); ++i) {
+		if (name == kDrawingFunctions[i].name)
+			return kDrawingFunctions[i].callback;
+	}
+
+	return 0;
+}
+
+const char *ThemeParser::getDrawingFunctionName(Graphics::DrawingFunctionCallback callback) {
+	for (uint i = 0; i < ARRAYSIZE(kDrawingFunctions); ++i) {
+		if (callback == kDrawingFunctions[i].callback)
+			return kDrawingFunctions[i].name;
+	}
 
 	return 0;
 }
@@ -26,6 +26,8 @@
 #include "common/scummsys.h"
 #include "common/xmlparser.h"
 
+#include "graphics/VectorRenderer.h"
+
 namespace GUI {
 
 class ThemeEngine;
@@ -47,6 +49,12 @@ public:
 		return true;
 	}
 
+	/** Returns the drawing function with the given name, or 0 if there is none. */
+	static Graphics::DrawingFunctionCallback getDrawingFunctionCallback(const Common::String &name);
+
+	/** Returns the name of a drawing function, or 0 if it is unknown. */
+	static const char *getDrawingFunctionName(Graphics::DrawingFunctionCallback callback);
+
 protected:
 	ThemeEngine *_theme;
 
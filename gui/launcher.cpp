@@ -22,6 +22,7 @@
 
 #include "base/version.h"
 
+#include "common/algorithm.h"
 #include "common/config-manager.h"
 #include "common/events.h"
 #include "common/fs.h"
@@ -89,10 +90,14 @@ enum {
 	kCmdSavePathClear = 'PSAC'
 };
 
+enum {
+	kPathCheckBudget = 10	///< Time in ms to spend on path checks per tick
+};
+
 #pragma mark -
 
 LauncherDialog::LauncherDialog()
-	: Dialog(0, 0, 320, 200) {
+	: Dialog(0, 0, 320, 200), _nextPathCheck(0) {
 	_backgroundType = GUI::ThemeEngine::kDialogBackgroundMain;
 	const int screenW = g_system->getOverlayWidth();
 	const int screenH = g_system->getOverlayHeight();
@@ -108,9 +113,9 @@ LauncherDialog::LauncherDialog()
 void LauncherDialog::selectTarget(const String &target) {
 	if (!target.empty()) {
 		int itemToSelect = 0;
-		StringArray::const_iterator iter;
-		for (iter = _domains.begin(); iter != _domains.end(); ++iter, ++itemToSelect) {
-			if (target == *iter) {
+		ListEntryArray::const_iterator iter;
+		for (iter = _entries.begin(); iter != _entries.end(); ++iter, ++itemToSelect) {
+			if (target == iter->target) {
 				_list->setSelected(itemToSelect);
 				break;
 			}
@@ -237,7 +242,7 @@ void LauncherDialog::close() {
 	// Save last selection
 	const int sel = _list->getSelected();
 	if (sel >= 0)
-		ConfMan.set("lastselectedgame", _domains[sel], ConfigManager::kApplicationDomain);
+		ConfMan.set("lastselectedgame", _entries[sel].target, ConfigManager::kApplicationDomain);
 	else
 		ConfMan.removeKey("lastselectedgame", ConfigManager::kApplicationDomain);
 
@@ -246,13 +251,18 @@ void LauncherDialog::close() {
 }
 
 void LauncherDialog::updateListing() {
-	StringArray l;
-	ListWidget::ColorList colors;
-	ThemeEngine::FontColor color;
+	// Remember the entries of the previous listing, so that the targets
+	// which did not change need neither be looked up again nor have their
+	// path checked again.
+	Common::HashMap<String, uint> oldEntries;
+	for (uint i = 0; i < _entries.size(); ++i)
+		oldEntries[_entries[i].target] = i;
 
 	// Retrieve a list of all games defined in the config file
-	_domains.clear();
 	const ConfigManager::DomainMap &domains = ConfMan.getGameDomains();
+	ListEntryArray entries;
+	entries.reserve(domains.size());
+
 	ConfigManager::DomainMap::const_iterator iter;
 	for (iter = domains.begin(); iter != domains.end(); ++iter) {
 #ifdef __DS__
@@ -263,43 +273,95 @@ void LauncherDialog::updateListing() {
 		}
 #endif
 
-		String gameid(iter->_value.getVal("gameid"));
-		String description(iter->_value.getVal("description"));
-		Common::FSNode path(iter->_value.getVal("path"));
+		Common::HashMap<String, uint>::const_iterator old = oldEntries.find(iter->_key);
+		if (old != oldEntries.end() && _entries[old->_value].isUpToDate(iter->_value))
+			entries.push_back(_entries[old->_value]);
+		else
+			entries.push_back(createListEntry(iter->_key, iter->_value));
+	}
+
+	Common::sort(entries.begin(), entries.end());
+	_entries = entries;
+
+	// Check the paths which are not known yet from handleTickle()
+	_nextPathCheck = 0;
 
-		if (gameid.empty())
-			gameid = iter->_key;
-		if (description.empty()) {
-			PlainGameDescriptor g = EngineMan.findGame(gameid);
-			if (g.description)
-				description = g.description;
+	setListEntries();
+}
+
+void LauncherDialog::updateListEntry(const String &target) {
+	for (uint i = 0; i < _entries.size(); ++i) {
+		if (_entries[i].target == target) {
+			_entries.remove_at(i);
+			break;
 		}
+	}
 
-		if (description.empty()) {
-			description = Common::String::format("Unknown (target %s, gameid %s)", iter->_key.c_str(), gameid.c_str());
+	int item = -1;
+	const ConfigManager::Domain *domain = ConfMan.getDomain(target);
+	if (domain && ConfMan.hasGameDomain(target)) {
+		const ListEntry entry = createListEntry(target, *domain);
+
+		// Find the position of the entry in the sorted list
+		uint first = 0, last = _entries.size();
+		while (first < last) {
+			const uint mid = (first + last) / 2;
+			if (_entries[mid] < entry)
+				first = mid + 1;
+			else
+				last = mid;
 		}
 
-		if (!gameid.empty() && !description.empty()) {
-			// Insert the game into the launcher list
-			int pos = 0, size = l.size();
+		_entries.insert_at(first, entry);
+		item = first;
+	}
 
-			while (pos < size && (scumm_stricmp(description.c_str(), l[pos].c_str()) > 0))
-				pos++;
+	// The indices of the unchecked entries may have moved
+	_nextPathCheck = 0;
 
-			color = ThemeEngine::kFontColorNormal;
-			if (!path.isDirectory()) {
-				color = ThemeEngine::kFontColorAlternate;
-				// If more conditions which grey out entries are added we should consider
-				// enabling this so that it is easy to spot why a certain game entry cannot
-				// be started.
+	setListEntries();
 
-				// description += Common::String::format(" (%s)", _("Not found"));
-			}
+	// The user just picked this game, so show its state right away
+	if (item != -1)
+		checkEntryPath(item);
+}
 
-			l.insert_at(pos, description);
-			colors.insert_at(pos, color);
-			_domains.insert_at(pos, iter->_key);
-		}
+LauncherDialog::ListEntry LauncherDialog::createListEntry(const String &target, const ConfigManager::Domain &domain) const {
+	ListEntry entry;
+	entry.target = target;
+	entry.gameidSetting = domain.getVal("gameid");
+	entry.descriptionSetting = domain.getVal("description");
+	entry.path = domain.getVal("path");
+	entry.pathChecked = false;
+	entry.pathFound = false;
+
+	String gameid(entry.gameidSetting);
+	if (gameid.empty())
+		gameid = target;
+
+	entry.description = entry.descriptionSetting;
+	if (entry.description.empty()) {
+		PlainGameDescriptor g = EngineMan.findGame(gameid);
+		if (g.description)
+			entry.description = g.description;
+	}
+
+	if (entry.description.empty()) {
+		entry.description = Common::String::format("Unknown (target %s, gameid %s)", target.c_str(), gameid.c_str());
+	}
+
+	return entry;
+}
+
+void LauncherDialog::setListEntries() {
+	StringArray l;
+	ListWidget::ColorList colors;
+	l.reserve(_entries.size());
+	colors.reserve(_entries.size());
+
+	for (ListEntryArray::const_iterator iter = _entries.begin(); iter != _entries.end(); ++iter) {
+		l.push_back(iter->description);
+		colors.push_back(iter->getColor());
 	}
 
 	const int oldSel = _list->getSelected();
@@ -316,6 +378,19 @@ void LauncherDialog::updateListing() {
 	_list->setFilter(_searchWidget->getEditString());
 }
 
+void LauncherDialog::checkEntryPath(uint item) {
+	ListEntry &entry = _entries[item];
+	entry.pathChecked = true;
+	entry.pathFound = Common::FSNode(entry.path).isDirectory();
+
+	if (!entry.pathFound) {
+		// If more conditions which grey out entries are added we should consider
+		// adding a suffix to the description, so that it is easy to spot why a
+		// certain game entry cannot be started.
+		_list->setItemColor(item, entry.getColor());
+	}
+}
+
 void LauncherDialog::addGame() {
 
 #ifndef DISABLE_MASS_ADD
@@ -397,13 +472,14 @@ void LauncherDialog::removeGame(int item) {
 	if (alert.runModal() == GUI::kMessageOK) {
 		// Remove the currently selected game from the list
 		assert(item >= 0);
-		ConfMan.removeGameDomain(_domains[item]);
+		const String target = _entries[item].target;
+		ConfMan.removeGameDomain(target);
 
 		// Write config to disk
 		ConfMan.flushToDisk();
 
 		// Update the ListWidget and force a redraw
-		updateListing();
+		updateListEntry(target);
 		g_gui.scheduleTopDialogRedraw();
 	}
 }
@@ -416,19 +492,23 @@ void LauncherDialog::editGame(int item) {
 	// This is useful because e.g. MonkeyVGA needs AdLib music to have decent
 	// music support etc.
 	assert(item >= 0);
-	String gameId(ConfMan.get("gameid", _domains[item]));
+	String gameId(ConfMan.get("gameid", _entries[item].target));
 	if (gameId.empty())
-		gameId = _domains[item];
+		gameId = _entries[item].target;
 
-	EditGameDialog editDialog(_domains[item]);
+	const String target = _entries[item].target;
+	EditGameDialog editDialog(target);
 	if (editDialog.runModal() > 0) {
 		// User pressed OK, so make changes permanent
 
 		// Write config to disk
 		ConfMan.flushToDisk();
 
-		// Update the ListWidget, reselect the edited game and force a redraw
-		updateListing();
+		// Update the ListWidget, reselect the edited game and force a redraw.
+		// The target may have been renamed.
+		updateListEntry(target);
+		if (editDialog.getDomain() != target)
+			updateListEntry(editDialog.getDomain());
 		selectTarget(editDialog.getDomain());
 		g_gui.scheduleTopDialogRedraw();
 	}
@@ -453,17 +533,17 @@ void LauncherDialog::recordGame(int item) {
 	RecorderDialog recorderDialog;
 	MessageDialog alert(_("Do you want to load saved game?"),
 		_("Yes"), _("No"));
-	switch(recorderDialog.runModal(_domains[item])) {
+	switch(recorderDialog.runModal(_entries[item].target)) {
 	case RecorderDialog::kRecordDialogClose:
 		break;
 	case RecorderDialog::kRecordDialogPlayback:
-		ConfMan.setActiveDomain(_domains[item]);
+		ConfMan.setActiveDomain(_entries[item].target);
 		close();
 		ConfMan.set("record_mode", "playback", ConfigManager::kTransientDomain);
 		ConfMan.set("record_file_name", recorderDialog.getFileName(), ConfigManager::kTransientDomain);
 		break;
 	case RecorderDialog::kRecordDialogRecord:
-		ConfMan.setActiveDomain(_domains[item]);
+		ConfMan.setActiveDomain(_entries[item].target);
 		if (alert.runModal() == GUI::kMessageOK) {
 			loadGame(item);
 		}
@@ -478,15 +558,15 @@ void LauncherDialog::recordGame(int item) {
 #endif
 
 void LauncherDialog::loadGame(int item) {
-	String gameId = ConfMan.get("gameid", _domains[item]);
+	String gameId = ConfMan.get("gameid", _entries[item].target);
 	if (gameId.empty())
-		gameId = _domains[item];
+		gameId = _entries[item].target;
 
 	const Plugin *plugin = nullptr;
 
 	EngineMan.findGame(gameId, &plugin);
 
-	String target = _domains[item];
+	String target = _entries[item].target;
 	target.toLowercase();
 
 	if (plugin) {
@@ -495,7 +575,7 @@ void LauncherDialog::loadGame(int item) {
 			metaEngine.hasFeature(MetaEngine::kSupportsLoadingDuringStartup)) {
 			int slot = _loadDialog->runModalWithPluginAndTarget(plugin, target);
 			if (slot >= 0) {
-				ConfMan.setActiveDomain(_domains[item]);
+				ConfMan.setActiveDomain(_entries[item].target);
 				ConfMan.setInt("save_slot", slot, Common::ConfigManager::kTransientDomain);
 				close();
 			}
@@ -622,7 +702,7 @@ bool LauncherDialog::doGameDetection(const Common::String &path) {
 			ConfMan.flushToDisk();
 
 			// Update the ListWidget, select the new item, and force a redraw
-			updateListing();
+			updateListEntry(editDialog.getDomain());
 			selectTarget(editDialog.getDomain());
 			g_gui.scheduleTopDialogRedraw();
 		} else {
@@ -666,7 +746,7 @@ void LauncherDialog::handleCommand(CommandSender *sender, uint32 cmd, uint32 dat
 	case kListItemDoubleClickedCmd:
 		// Start the selected game.
 		assert(item >= 0);
-		ConfMan.setActiveDomain(_domains[item]);
+		ConfMan.setActiveDomain(_entries[item].target);
 		close();
 		break;
 	case kListItemRemovalRequestCmd:
@@ -694,6 +774,19 @@ void LauncherDialog::handleCommand(CommandSender *sender, uint32 cmd, uint32 dat
 	}
 }
 
+void LauncherDialog::handleTickle() {
+	// The paths of the games are checked in the background, so that the
+	// launcher shows up without waiting for slow storage
+	const uint32 start = g_system->getMillis();
+	while (_nextPathCheck < _entries.size() && g_system->getMillis() - start < kPathCheckBudget) {
+		if (!_entries[_nextPathCheck].pathChecked)
+			checkEntryPath(_nextPathCheck);
+		++_nextPathCheck;
+	}
+
+	Dialog::handleTickle();
+}
+
 void LauncherDialog::updateButtons() {
 	bool enable = (_list->getSelected() >= 0);
 	if (enable != _startButton->isEnabled()) {
@@ -713,7 +806,7 @@ void LauncherDialog::updateButtons() {
 	bool en = enable;
 
 	if (item >= 0)
-		en = !(Common::checkGameGUIOption(GUIO_NOLAUNCHLOAD, ConfMan.get("guioptions", _domains[item])));
+		en = !(Common::checkGameGUIOption(GUIO_NOLAUNCHLOAD, ConfMan.get("guioptions", _entries[item].target)));
 
 	if (en != _loadButton->isEnabled()) {
 		_loadButton->setEnabled(en);
@@ -23,6 +23,8 @@
 #ifndef GUI_LAUNCHER_DIALOG_H
 #define GUI_LAUNCHER_DIALOG_H
 
+#include "common/config-manager.h"
+
 #include "gui/dialog.h"
 #include "engines/game.h"
 
@@ -52,8 +54,44 @@ public:
 	virtual void handleKeyDown(Common::KeyState state);
 	virtual void handleKeyUp(Common::KeyState state);
 	virtual void handleOtherEvent(Common::Event evt);
+	virtual void handleTickle();
 	bool doGameDetection(const Common::String &path);
 protected:
+	/**
+	 * A configured target as shown in the game list. The entries are kept
+	 * sorted by description, in the order of the list widget.
+	 */
+	struct ListEntry {
+		String target;
+		/** The text shown in the list */
+		String description;
+
+		/** The settings the entry was created from */
+		String gameidSetting;
+		String descriptionSetting;
+		String path;
+
+		/** Whether the path has been looked up since the entry was created */
+		bool pathChecked;
+		/** Whether the path is an existing directory, only valid when checked */
+		bool pathFound;
+
+		ThemeEngine::FontColor getColor() const {
+			return (pathChecked && !pathFound) ? ThemeEngine::kFontColorAlternate : ThemeEngine::kFontColorNormal;
+		}
+
+		bool isUpToDate(const Common::ConfigManager::Domain &domain) const {
+			return gameidSetting == domain.getVal("gameid") && descriptionSetting == domain.getVal("description") && path == domain.getVal("path");
+		}
+
+		bool operator<(const ListEntry &other) const {
+			const int cmp = scumm_stricmp(description.c_str(), other.description.c_str());
+			return cmp < 0 || (cmp == 0 && target < other.target);
+		}
+	};
+	typedef Common::Array<ListEntry> ListEntryArray;
+
+
 	EditTextWidget  *_searchWidget;
 	ListWidget		*_list;
 	ButtonWidget	*_addButton;
@@ -67,7 +105,8 @@ protected:
 #endif
 	StaticTextWidget	*_searchDesc;
 	ButtonWidget	*_searchClearButton;
-	StringArray		_domains;
+	ListEntryArray	_entries;
+	uint			_nextPathCheck;
 	BrowserDialog	*_browser;
 	SaveLoadChooser	*_loadDialog;
 
@@ -78,9 +117,39 @@ protected:
 	/**
 	 * Fill the list widget with all currently configured targets, and trigger
 	 * a redraw.
+	 *
+	 * Entries of targets whose settings did not change are reused, including
+	 * the result of their path check. The paths of new entries are checked
+	 * from handleTickle().
 	 */
 	void updateListing();
 
+	/**
+	 * Update the list entry of a single target after it was added, edited or
+	 * removed, and trigger a redraw. Unlike updateListing() this does not
+	 * look at the other targets.
+	 *
+	 * @target	name of the target to update
+	 */
+	void updateListEntry(const String &target);
+
+	/**
+	 * Create the list entry for a configured target. Its path is not checked.
+	 */
+	ListEntry createListEntry(const String &target, const Common::ConfigManager::Domain &domain) const;
+
+	/**
+	 * Pass the entries to the list widget, keeping the selection and the
+	 * search filter.
+	 */
+	void setListEntries();
+
+	/**
+	 * Look up whether the path of an entry exists, and grey it out in the
+	 * list if it does not.
+	 */
+	void checkEntryPath(uint item);
+
 	void updateButtons();
 	void switchButtonsText(ButtonWidget *button, const char *normalText, const char *shiftedText);
 
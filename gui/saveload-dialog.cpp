@@ -37,7 +37,9 @@
 #include "gui/widgets/edittext.h"
 
 #include "graphics/scaler.h"
+#include "graphics/thumbnail.h"
 #include <common/savefile.h>
+#include "common/memstream.h"
 
 namespace GUI {
 
@@ -735,9 +737,40 @@ enum {
 	kNewSaveCmd = 'SAVE'
 };
 
+enum {
+	kSlotIndexVersion = 1,
+	// Time spent loading slot information per GUI tick
+	kSlotLoadBudget = 10
+};
+
+static Common::String readIndexString(Common::SeekableReadStream &in) {
+	Common::String str;
+	for (uint16 length = in.readUint16BE(); length > 0 && !in.eos(); --length)
+		str += (char)in.readByte();
+	return str;
+}
+
+static void writeIndexString(Common::WriteStream &out, const Common::String &str) {
+	out.writeUint16BE(str.size());
+	out.write(str.c_str(), str.size());
+}
+
+static bool isSameThumbnail(const Graphics::Surface *a, const Graphics::Surface *b) {
+	if (!a || !b)
+		return a == b;
+	if (a->w != b->w || a->h != b->h || a->format != b->format)
+		return false;
+
+	for (int y = 0; y < a->h; ++y) {
+		if (memcmp(a->getBasePtr(0, y), b->getBasePtr(0, y), a->w * a->format.bytesPerPixel))
+			return false;
+	}
+	return true;
+}
+
 SaveLoadChooserGrid::SaveLoadChooserGrid(const Common::String &title, bool saveMode)
 	: SaveLoadChooserDialog("SaveLoadChooser", saveMode), _lines(0), _columns(0), _entriesPerPage(0),
-	_curPage(0), _newSaveContainer(0), _nextFreeSaveSlot(0), _buttons() {
+	_curPage(0), _newSaveContainer(0), _nextFreeSaveSlot(0), _buttons(), _slotIndex(0), _slotIndexChanged(false) {
 	_backgroundType = ThemeEngine::kDialogBackgroundSpecial;
 
 	new StaticTextWidget(this, "SaveLoadChooser.Title", title);
@@ -758,6 +791,7 @@ SaveLoadChooserGrid::SaveLoadChooserGrid(const Common::String &title, bool saveM
 SaveLoadChooserGrid::~SaveLoadChooserGrid() {
 	removeWidget(_pageDisplay);
 	delete _pageDisplay;
+	delete _slotIndex;
 }
 
 const Common::String &SaveLoadChooserGrid::getResultString() const {
@@ -768,6 +802,15 @@ void SaveLoadChooserGrid::handleCommand(CommandSender *sender, uint32 cmd, uint3
 	if (cmd <= _entriesPerPage && cmd + _curPage * _entriesPerPage <= _saveList.size()) {
 		const SaveStateDescriptor &desc = _saveList[cmd - 1 + _curPage * _entriesPerPage];
 
+		// The slot might have been clicked before its information was loaded
+		if (_saveMode && !desc.getLocked()) {
+			SlotInfo &info = _slotInfos[desc.getSaveSlot()];
+			if (!info.verified)
+				verifySlotInfo(desc.getSaveSlot(), info);
+			if (info.writeProtected)
+				return;
+		}
+
 		if (_saveMode) {
 			_resultString = desc.getDescription();
 		}
@@ -819,6 +862,10 @@ void SaveLoadChooserGrid::handleMouseWheel(int x, int y, int direction) {
 }
 
 void SaveLoadChooserGrid::updateSaveList() {
+	// Saves might have been replaced by synced ones
+	for (SlotInfoMap::iterator i = _slotInfos.begin(); i != _slotInfos.end(); ++i)
+		i->_value.verified = false;
+
 	SaveLoadChooserDialog::updateSaveList();
 	updateSaves();
 	g_gui.scheduleTopDialogRedraw();
@@ -828,6 +875,7 @@ void SaveLoadChooserGrid::open() {
 	SaveLoadChooserDialog::open();
 
 	listSaves();
+	loadSlotIndex();
 	_resultString.clear();
 
 	// Load information to restore the last page the user had open.
@@ -1003,6 +1051,21 @@ void SaveLoadChooserGrid::close() {
 
 	SaveLoadChooserDialog::close();
 	hideButtons();
+
+	_pendingSlots.clear();
+	saveSlotIndex();
+	delete _slotIndex;
+	_slotIndex = 0;
+}
+
+void SaveLoadChooserGrid::handleTickle() {
+	// Load the information of the saves bit by bit, so that the dialog
+	// stays responsive with many saves on slow storage.
+	const uint32 start = g_system->getMillis();
+	while (!_pendingSlots.empty() && g_system->getMillis() - start < kSlotLoadBudget)
+		loadPendingSlot();
+
+	SaveLoadChooserDialog::handleTickle();
 }
 
 int SaveLoadChooserGrid::runIntern() {
@@ -1066,71 +1129,329 @@ void SaveLoadChooserGrid::updateSaves() {
 	hideButtons();
 
 	for (uint i = _curPage * _entriesPerPage, curNum = 0; i < _saveList.size() && curNum < _entriesPerPage; ++i, ++curNum) {
-		const uint saveSlot = _saveList[i].getSaveSlot();
-
-		SaveStateDescriptor desc =  (_saveList[i].getLocked() ? _saveList[i] : _metaEngine->querySaveMetaInfos(_target.c_str(), saveSlot));
 		SlotButton &curButton = _buttons[curNum];
 		curButton.setVisible(true);
-		const Graphics::Surface *thumbnail = desc.getThumbnail();
-		if (thumbnail) {
-			curButton.button->setGfx(desc.getThumbnail());
-		} else {
-			curButton.button->setGfx(kThumbnailWidth, kThumbnailHeight2, 0, 0, 0);
+		updateSlotButton(curButton, _saveList[i]);
+	}
+
+	queueSlotLoads();
+
+	const uint numPages = (_entriesPerPage != 0 && !_saveList.empty()) ? ((_saveList.size() + _entriesPerPage - 1) / _entriesPerPage) : 1;
+	_pageDisplay->setLabel(Common::String::format("%u/%u", _curPage + 1, numPages));
+
+	if (_curPage > 0)
+		_prevButton->setEnabled(true);
+	else
+		_prevButton->setEnabled(false);
+
+	if ((_curPage + 1) * _entriesPerPage < _saveList.size())
+		_nextButton->setEnabled(true);
+	else
+		_nextButton->setEnabled(false);
+}
+
+void SaveLoadChooserGrid::updateSlotButton(SlotButton &button, const SaveStateDescriptor &save) {
+	const int saveSlot = save.getSaveSlot();
+
+	// Locked slots are being synced and cannot be queried yet. For all
+	// others we show what we know so far, the rest is filled in by
+	// handleTickle().
+	SlotInfo info;
+	if (save.getLocked()) {
+		info.description = save.getDescription();
+		info.writeProtected = true;
+	} else {
+		info = _slotInfos[saveSlot];
+		if (info.description.empty())
+			info.description = save.getDescription();
+	}
+
+	if (info.thumbnail) {
+		button.button->setGfx(info.thumbnail.get());
+	} else {
+		button.button->setGfx(kThumbnailWidth, kThumbnailHeight2, 0, 0, 0);
+	}
+	button.description->setLabel(Common::String::format("%d. %s", saveSlot, info.description.c_str()));
+
+	Common::String tooltip(_("Name: "));
+	tooltip += info.description;
+
+	if (_saveDateSupport) {
+		if (!info.saveDate.empty()) {
+			tooltip += "\n";
+			tooltip +=  _("Date: ") + info.saveDate;
 		}
-		curButton.description->setLabel(Common::String::format("%d. %s", saveSlot, desc.getDescription().c_str()));
 
-		Common::String tooltip(_("Name: "));
-		tooltip += desc.getDescription();
+		if (!info.saveTime.empty()) {
+			tooltip += "\n";
+			tooltip += _("Time: ") + info.saveTime;
+		}
+	}
 
-		if (_saveDateSupport) {
-			const Common::String &saveDate = desc.getSaveDate();
-			if (!saveDate.empty()) {
-				tooltip += "\n";
-				tooltip +=  _("Date: ") + saveDate;
-			}
+	if (_playTimeSupport) {
+		if (!info.playTime.empty()) {
+			tooltip += "\n";
+			tooltip += _("Playtime: ") + info.playTime;
+		}
+	}
 
-			const Common::String &saveTime = desc.getSaveTime();
-			if (!saveTime.empty()) {
-				tooltip += "\n";
-				tooltip += _("Time: ") + saveTime;
+	button.button->setTooltip(tooltip);
+
+	// In save mode we disable the button, when it's write protected.
+	// TODO: Maybe we should not display it at all then?
+	if (_saveMode && info.writeProtected) {
+		button.button->setEnabled(false);
+	} else {
+		button.button->setEnabled(true);
+	}
+
+	//that would make it look "disabled" if slot is locked
+	if (save.getLocked()) {
+		button.button->setEnabled(false);
+		button.description->setEnabled(false);
+	} else {
+		button.description->setEnabled(true);
+	}
+}
+
+Common::String SaveLoadChooserGrid::getSlotIndexName() const {
+	// The leading dot keeps the index out of the engines' save patterns
+	// and out of the cloud sync.
+	return "." + _target + ".saveindex";
+}
+
+void SaveLoadChooserGrid::loadSlotIndex() {
+	// Thumbnails loaded by a previous run of the dialog are kept, as long
+	// as the save still has the same description. Everything else is
+	// taken from the index.
+	const SlotInfoMap oldInfos = _slotInfos;
+	_slotInfos.clear();
+	_slotIndexChanged = false;
+
+	delete _slotIndex;
+	_slotIndex = g_system->getSavefileManager()->openForLoading(getSlotIndexName());
+
+	if (_slotIndex && (_slotIndex->readUint32BE() != MKTAG('S','V','I','X') || _slotIndex->readUint32BE() != kSlotIndexVersion)) {
+		delete _slotIndex;
+		_slotIndex = 0;
+	}
+
+	if (_slotIndex) {
+		for (uint32 count = _slotIndex->readUint32BE(); count > 0; --count) {
+			const int slot = _slotIndex->readSint32BE();
+
+			SlotInfo info;
+			info.description = readIndexString(*_slotIndex);
+			info.saveDate = readIndexString(*_slotIndex);
+			info.saveTime = readIndexString(*_slotIndex);
+			info.playTime = readIndexString(*_slotIndex);
+			info.writeProtected = (_slotIndex->readByte() != 0);
+			info.thumbnailOffset = _slotIndex->readUint32BE();
+
+			if (_slotIndex->err() || _slotIndex->eos()) {
+				warning("SaveLoadChooserGrid: Save index '%s' is broken", getSlotIndexName().c_str());
+				_slotInfos.clear();
+				_slotIndexChanged = true;
+				break;
 			}
+
+			_slotInfos[slot] = info;
 		}
+	}
 
-		if (_playTimeSupport) {
-			const Common::String &playTime = desc.getPlayTime();
-			if (!playTime.empty()) {
-				tooltip += "\n";
-				tooltip += _("Playtime: ") + playTime;
-			}
+	// Drop what does not match the saves anymore
+	SlotInfoMap infos = _slotInfos;
+	_slotInfos.clear();
+	for (SaveStateList::const_iterator x = _saveList.begin(); x != _saveList.end(); ++x) {
+		if (x->getLocked())
+			continue;
+
+		const int slot = x->getSaveSlot();
+		SlotInfoMap::iterator info = infos.find(slot);
+		if (info == infos.end() || info->_value.description != x->getDescription()) {
+			_slotIndexChanged = true;
+			continue;
 		}
 
-		curButton.button->setTooltip(tooltip);
+		SlotInfoMap::const_iterator oldInfo = oldInfos.find(slot);
+		if (oldInfo != oldInfos.end() && oldInfo->_value.description == x->getDescription())
+			info->_value.thumbnail = oldInfo->_value.thumbnail;
 
-		// In save mode we disable the button, when it's write protected.
-		// TODO: Maybe we should not display it at all then?
-		if (_saveMode && desc.getWriteProtectedFlag()) {
-			curButton.button->setEnabled(false);
-		} else {
-			curButton.button->setEnabled(true);
-		}
+		_slotInfos[slot] = info->_value;
+	}
+
+	if (infos.size() != _slotInfos.size())
+		_slotIndexChanged = true;
+}
 
-		//that would make it look "disabled" if slot is locked
-		curButton.button->setEnabled(!desc.getLocked());
-		curButton.description->setEnabled(!desc.getLocked());
+void SaveLoadChooserGrid::saveSlotIndex() {
+	if (!_slotIndexChanged)
+		return;
+
+	// Thumbnails which were not needed in this run are only in the old
+	// index file. Load them before it is replaced.
+	for (SlotInfoMap::iterator i = _slotInfos.begin(); i != _slotInfos.end(); ++i) {
+		if (!i->_value.thumbnail)
+			loadIndexThumbnail(i->_value);
 	}
 
-	const uint numPages = (_entriesPerPage != 0 && !_saveList.empty()) ? ((_saveList.size() + _entriesPerPage - 1) / _entriesPerPage) : 1;
-	_pageDisplay->setLabel(Common::String::format("%u/%u", _curPage + 1, numPages));
+	delete _slotIndex;
+	_slotIndex = 0;
 
-	if (_curPage > 0)
-		_prevButton->setEnabled(true);
-	else
-		_prevButton->setEnabled(false);
+	// Slots which were only queued have nothing worth remembering
+	SlotInfoMap infos;
+	for (SlotInfoMap::const_iterator i = _slotInfos.begin(); i != _slotInfos.end(); ++i) {
+		if (i->_value.verified || !i->_value.description.empty())
+			infos[i->_key] = i->_value;
+	}
 
-	if ((_curPage + 1) * _entriesPerPage < _saveList.size())
-		_nextButton->setEnabled(true);
+	uint32 headerSize = 3 * 4;
+	for (SlotInfoMap::const_iterator i = infos.begin(); i != infos.end(); ++i) {
+		const SlotInfo &info = i->_value;
+		headerSize += 4 + 4 * 2 + info.description.size() + info.saveDate.size() + info.saveTime.size() + info.playTime.size() + 1 + 4;
+	}
+
+	Common::MemoryWriteStreamDynamic thumbnails(DisposeAfterUse::YES);
+	for (SlotInfoMap::iterator i = infos.begin(); i != infos.end(); ++i) {
+		SlotInfo &info = i->_value;
+		info.thumbnailOffset = 0;
+		if (info.thumbnail) {
+			const uint32 offset = headerSize + thumbnails.pos();
+			if (Graphics::saveThumbnail(thumbnails, *info.thumbnail))
+				info.thumbnailOffset = offset;
+		}
+	}
+
+	Common::OutSaveFile *out = g_system->getSavefileManager()->openForSaving(getSlotIndexName(), false);
+	if (!out)
+		return;
+
+	out->writeUint32BE(MKTAG('S','V','I','X'));
+	out->writeUint32BE(kSlotIndexVersion);
+	out->writeUint32BE(infos.size());
+
+	for (SlotInfoMap::const_iterator i = infos.begin(); i != infos.end(); ++i) {
+		const SlotInfo &info = i->_value;
+		out->writeSint32BE(i->_key);
+		writeIndexString(*out, info.description);
+		writeIndexString(*out, info.saveDate);
+		writeIndexString(*out, info.saveTime);
+		writeIndexString(*out, info.playTime);
+		out->writeByte(info.writeProtected ? 1 : 0);
+		out->writeUint32BE(info.thumbnailOffset);
+	}
+	out->write(thumbnails.getData(), thumbnails.size());
+
+	out->finalize();
+	if (out->err())
+		warning("SaveLoadChooserGrid: Could not write save index '%s'", getSlotIndexName().c_str());
 	else
-		_nextButton->setEnabled(false);
+		_slotIndexChanged = false;
+	delete out;
+}
+
+bool SaveLoadChooserGrid::loadIndexThumbnail(SlotInfo &info) {
+	if (!_slotIndex || !info.thumbnailOffset)
+		return false;
+
+	Graphics::Surface *thumbnail = 0;
+	if (!_slotIndex->seek(info.thumbnailOffset) || !Graphics::loadThumbnail(*_slotIndex, thumbnail)) {
+		info.thumbnailOffset = 0;
+		_slotIndexChanged = true;
+		return false;
+	}
+
+	info.thumbnail = Common::SharedPtr<Graphics::Surface>(thumbnail, Graphics::SurfaceDeleter());
+	return true;
+}
+
+void SaveLoadChooserGrid::verifySlotInfo(int slot, SlotInfo &info) {
+	const SaveStateDescriptor desc = _metaEngine->querySaveMetaInfos(_target.c_str(), slot);
+	const Graphics::Surface *thumbnail = desc.getThumbnail();
+
+	// Compare against the stored thumbnail, so that the index is only
+	// rewritten when something changed.
+	if (!info.thumbnail)
+		loadIndexThumbnail(info);
+
+	if (info.description != desc.getDescription() || info.saveDate != desc.getSaveDate() ||
+	    info.saveTime != desc.getSaveTime() || info.playTime != desc.getPlayTime() ||
+	    info.writeProtected != desc.getWriteProtectedFlag() || !isSameThumbnail(info.thumbnail.get(), thumbnail)) {
+		info.description = desc.getDescription();
+		info.saveDate = desc.getSaveDate();
+		info.saveTime = desc.getSaveTime();
+		info.playTime = desc.getPlayTime();
+		info.writeProtected = desc.getWriteProtectedFlag();
+
+		info.thumbnail.reset();
+		if (thumbnail) {
+			Graphics::Surface *copy = new Graphics::Surface();
+			copy->copyFrom(*thumbnail);
+			info.thumbnail = Common::SharedPtr<Graphics::Surface>(copy, Graphics::SurfaceDeleter());
+		}
+
+		_slotIndexChanged = true;
+	}
+
+	info.verified = true;
+}
+
+void SaveLoadChooserGrid::queueSlotLoads() {
+	_pendingSlots.clear();
+
+	if (_entriesPerPage == 0)
+		return;
+
+	const uint first = _curPage * _entriesPerPage;
+	const uint last = MIN<uint>(first + _entriesPerPage, _saveList.size());
+
+	// Thumbnails from the index are cheap to load, so the visible ones are
+	// shown first. Then the visible slots are checked against their saves.
+	for (uint i = first; i < last; ++i) {
+		const SlotInfo &info = _slotInfos[_saveList[i].getSaveSlot()];
+		if (!_saveList[i].getLocked() && !info.thumbnail && info.thumbnailOffset)
+			_pendingSlots.push_back(PendingSlot(_saveList[i].getSaveSlot(), true));
+	}
+
+	for (uint i = first; i < last; ++i) {
+		if (!_saveList[i].getLocked() && !_slotInfos[_saveList[i].getSaveSlot()].verified)
+			_pendingSlots.push_back(PendingSlot(_saveList[i].getSaveSlot(), false));
+	}
+
+	// Prepare the neighbouring pages, so that paging does not stall either
+	const uint next = MIN<uint>(last + _entriesPerPage, _saveList.size());
+	const uint prev = first > _entriesPerPage ? first - _entriesPerPage : 0;
+	for (uint i = last; i < next; ++i) {
+		if (!_saveList[i].getLocked() && !_slotInfos[_saveList[i].getSaveSlot()].verified)
+			_pendingSlots.push_back(PendingSlot(_saveList[i].getSaveSlot(), false));
+	}
+	for (uint i = prev; i < first; ++i) {
+		if (!_saveList[i].getLocked() && !_slotInfos[_saveList[i].getSaveSlot()].verified)
+			_pendingSlots.push_back(PendingSlot(_saveList[i].getSaveSlot(), false));
+	}
+}
+
+void SaveLoadChooserGrid::loadPendingSlot() {
+	const PendingSlot pending = _pendingSlots.remove_at(0);
+	SlotInfo &info = _slotInfos[pending.slot];
+
+	if (pending.fromIndex) {
+		if (info.thumbnail || !loadIndexThumbnail(info))
+			return;
+	} else {
+		if (info.verified)
+			return;
+		verifySlotInfo(pending.slot, info);
+	}
+
+	// Update the button, if the slot is still visible
+	for (uint i = _curPage * _entriesPerPage, curNum = 0; i < _saveList.size() && curNum < _entriesPerPage; ++i, ++curNum) {
+		if (_saveList[i].getSaveSlot() == pending.slot && !_saveList[i].getLocked()) {
+			updateSlotButton(_buttons[curNum], _saveList[i]);
+			g_gui.scheduleTopDialogRedraw();
+			break;
+		}
+	}
 }
 
 SavenameDialog::SavenameDialog()
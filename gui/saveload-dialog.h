@@ -28,6 +28,8 @@
 
 #include "engines/metaengine.h"
 
+#include "common/hashmap.h"
+
 namespace GUI {
 
 #if defined(USE_CLOUD) && defined(USE_LIBCURL)
@@ -203,6 +205,8 @@ public:
 	virtual SaveLoadChooserType getType() const { return kSaveLoadDialogGrid; }
 
 	virtual void close();
+
+	virtual void handleTickle();
 protected:
 	virtual void handleCommand(CommandSender *sender, uint32 cmd, uint32 data);
 	virtual void handleMouseWheel(int x, int y, int direction);
@@ -243,6 +247,56 @@ private:
 	void destroyButtons();
 	void hideButtons();
 	void updateSaves();
+	void updateSlotButton(SlotButton &button, const SaveStateDescriptor &save);
+
+	/**
+	 * Meta information of a save slot, which is shown on its button.
+	 *
+	 * This is remembered in a small index file next to the saves, so that
+	 * the dialog can be shown without parsing the save files first.
+	 */
+	struct SlotInfo {
+		SlotInfo() : thumbnailOffset(0), writeProtected(false), verified(false) {}
+
+		Common::String description;
+		Common::String saveDate;
+		Common::String saveTime;
+		Common::String playTime;
+		Common::SharedPtr<Graphics::Surface> thumbnail;
+		/** Offset of the thumbnail in the index file, 0 if it is not stored there. */
+		uint32 thumbnailOffset;
+		bool writeProtected;
+		/** Whether the information was read from the save file since the dialog was opened. */
+		bool verified;
+	};
+	typedef Common::HashMap<int, SlotInfo> SlotInfoMap;
+	SlotInfoMap _slotInfos;
+
+	/** The index file, which is kept open to load thumbnails on demand. */
+	Common::SeekableReadStream *_slotIndex;
+	bool _slotIndexChanged;
+
+	/**
+	 * Slots, whose information is loaded while the dialog is idle. The
+	 * visible slots come first.
+	 */
+	struct PendingSlot {
+		PendingSlot() : slot(0), fromIndex(false) {}
+		PendingSlot(int s, bool i) : slot(s), fromIndex(i) {}
+
+		int slot;
+		/** Load only the thumbnail stored in the index, rather than the save. */
+		bool fromIndex;
+	};
+	Common::Array<PendingSlot> _pendingSlots;
+
+	Common::String getSlotIndexName() const;
+	void loadSlotIndex();
+	void saveSlotIndex();
+	bool loadIndexThumbnail(SlotInfo &info);
+	void verifySlotInfo(int slot, SlotInfo &info);
+	void queueSlotLoads();
+	void loadPendingSlot();
 };
 
 #endif // !DISABLE_SAVELOADCHOOSER_GRID
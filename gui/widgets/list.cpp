@@ -205,6 +205,25 @@ void ListWidget::append(const String &s, ThemeEngine::FontColor color) {
 	scrollBarRecalc();
 }
 
+void ListWidget::setItemColor(int item, ThemeEngine::FontColor color) {
+	assert(item >= 0 && item < (int)_dataList.size());
+
+	if (_listColors.empty()) {
+		if (color == ThemeEngine::kFontColorNormal)
+			return;
+
+		// Like in append(), the other entries get the default color
+		_listColors.resize(_dataList.size());
+		for (uint i = 0; i < _listColors.size(); ++i)
+			_listColors[i] = ThemeEngine::kFontColorNormal;
+	}
+
+	if (_listColors[item] != color) {
+		_listColors[item] = color;
+		markAsDirty();
+	}
+}
+
 void ListWidget::scrollTo(int item) {
 	int size = _list.size();
 	if (item >= size)
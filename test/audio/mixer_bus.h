@@ -0,0 +1,121 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/mixer_bus.h"
+#include "audio/mixer.h"
+
+#include "common/array.h"
+#include "common/str.h"
+
+#include "test/benchmark.h"
+
+class MixerBusTestSuite : public CxxTest::TestSuite
+{
+	public:
+	void test_accumulate_matches_scalar() {
+		uint32 seed = 0x12345678;
+
+		// Odd lengths exercise the scalar tail of the vector versions
+		const uint lengths[] = { 1, 3, 4, 7, 64, 1021 };
+		const Audio::st_volume_t volumes[] = { 0, 1, 127, 255, Audio::Mixer::kMaxMixerVolume };
+
+		for (uint l = 0; l < ARRAYSIZE(lengths); ++l) {
+			const uint len = lengths[l];
+			Common::Array<int16> src(2 * len);
+			for (uint i = 0; i < src.size(); ++i) {
+				seed = seed * 1103515245 + 12345;
+				src[i] = (int16)(seed >> 16);
+			}
+			// Make sure the extremes are covered as well
+			src[0] = -32768;
+			src[src.size() - 1] = 32767;
+
+			for (uint v = 0; v < ARRAYSIZE(volumes); ++v) {
+				const Audio::st_volume_t volL = volumes[v];
+				const Audio::st_volume_t volR = volumes[ARRAYSIZE(volumes) - 1 - v];
+
+				Common::Array<int32> expected(2 * len, -5), actual(2 * len, -5);
+				Audio::mixBusAccumulateScalar(expected.begin(), src.begin(), len, volL, volR);
+				Audio::mixBusAccumulate(actual.begin(), src.begin(), len, volL, volR);
+
+				for (uint i = 0; i < 2 * len; ++i)
+					TS_ASSERT_EQUALS(actual[i], expected[i]);
+			}
+		}
+	}
+
+	void test_accumulate_truncates() {
+		const int16 src[4] = { -1, 1, -513, 513 };
+		int32 bus[4] = { 0, 0, 0, 0 };
+
+		Audio::mixBusAccumulate(bus, src, 2, 255, 255);
+
+		// Products are divided by 256, rounding towards zero
+		TS_ASSERT_EQUALS(bus[0], 0);
+		TS_ASSERT_EQUALS(bus[1], 0);
+		TS_ASSERT_EQUALS(bus[2], -510);
+		TS_ASSERT_EQUALS(bus[3], 510);
+	}
+
+	void test_resolve_saturates() {
+		const int32 bus[10] = { 0, 1, -1, 32767, 32768, -32768, -32769, 1000000, -1000000, 12345 };
+		int16 expected[10], actual[10];
+
+		Audio::mixBusResolveScalar(expected, bus, 5);
+		Audio::mixBusResolve(actual, bus, 5);
+
+		const int16 clamped[10] = { 0, 1, -1, 32767, 32767, -32768, -32768, 32767, -32768, 12345 };
+		for (int i = 0; i < 10; ++i) {
+			TS_ASSERT_EQUALS(expected[i], clamped[i]);
+			TS_ASSERT_EQUALS(actual[i], clamped[i]);
+		}
+	}
+
+	void test_benchmark() {
+#ifdef TEST_RUN_BENCHMARKS
+		const uint len = 2048;
+		const uint iterations = 200;
+		const uint channelCounts[] = { 1, 4, 16 };
+
+		Common::Array<int16> src(2 * len, 1234), out(2 * len);
+		Common::Array<int32> bus(2 * len);
+
+		for (uint c = 0; c < ARRAYSIZE(channelCounts); ++c) {
+			const uint channels = channelCounts[c];
+
+			const double scalar = measure(bus, src, out, len, channels, iterations, true);
+			const double vector = measure(bus, src, out, len, channels, iterations, false);
+
+			TS_TRACE(Common::String::format("mixer bus, %2u channels: scalar %.2f ns/sample, dispatched %.2f ns/sample",
+				channels, scalar, vector).c_str());
+		}
+#endif
+	}
+
+	private:
+#ifdef TEST_RUN_BENCHMARKS
+	/**
+	 * Mixes the given number of channels into the bus and resolves it,
+	 * returning the time per output sample in nanoseconds.
+	 */
+	static double measure(Common::Array<int32> &bus, const Common::Array<int16> &src, Common::Array<int16> &out,
+	                      uint len, uint channels, uint iterations, bool scalar) {
+		const double start = getBenchmarkTime();
+
+		for (uint i = 0; i < iterations; ++i) {
+			memset(bus.begin(), 0, bus.size() * sizeof(int32));
+			for (uint ch = 0; ch < channels; ++ch) {
+				if (scalar)
+					Audio::mixBusAccumulateScalar(bus.begin(), src.begin(), len, 200, 100);
+				else
+					Audio::mixBusAccumulate(bus.begin(), src.begin(), len, 200, 100);
+			}
+			if (scalar)
+				Audio::mixBusResolveScalar(out.begin(), bus.begin(), len);
+			else
+				Audio::mixBusResolve(out.begin(), bus.begin(), len);
+		}
+
+		return (getBenchmarkTime() - start) * 1e3 / ((double)iterations * 2 * len);
+	}
+#endif
+};
@@ -0,0 +1,121 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/mixer_queue.h"
+
+#ifdef POSIX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+class MixerQueueTestSuite : public CxxTest::TestSuite
+{
+	public:
+	void test_fifo() {
+		Audio::MixerQueue<int, 4> queue;
+		int value = -1;
+
+		TS_ASSERT(queue.empty());
+		TS_ASSERT(!queue.pop(value));
+
+		TS_ASSERT(queue.push(1));
+		TS_ASSERT(queue.push(2));
+		TS_ASSERT(queue.push(3));
+		TS_ASSERT(queue.push(4));
+		TS_ASSERT(!queue.push(5));
+
+		TS_ASSERT(queue.pop(value));
+		TS_ASSERT_EQUALS(value, 1);
+		TS_ASSERT(queue.push(5));
+
+		for (int i = 2; i <= 5; ++i) {
+			TS_ASSERT(queue.pop(value));
+			TS_ASSERT_EQUALS(value, i);
+		}
+
+		TS_ASSERT(queue.empty());
+		TS_ASSERT(!queue.pop(value));
+	}
+
+	void test_wraparound() {
+		Audio::MixerQueue<uint32, 8> queue;
+		uint32 value;
+
+		// Go around the ring many times with varying fill levels
+		uint32 next = 0, expected = 0;
+		for (uint round = 0; round < 1000; ++round) {
+			const uint fill = round % 9;
+			for (uint i = 0; i < fill; ++i)
+				TS_ASSERT(queue.push(next++));
+			for (uint i = 0; i < fill; ++i) {
+				TS_ASSERT(queue.pop(value));
+				TS_ASSERT_EQUALS(value, expected++);
+			}
+		}
+		TS_ASSERT(queue.empty());
+	}
+
+#ifdef POSIX
+	struct Command {
+		uint32 serial;
+		uint32 check;
+	};
+
+	typedef Audio::MixerQueue<Command, 64> CommandQueue;
+
+	enum {
+		kStressCommands = 500000
+	};
+
+	struct MixThread {
+		CommandQueue *queue;
+		uint32 received;
+		uint32 errors;
+	};
+
+	static void *mixThread(void *arg) {
+		MixThread *mix = (MixThread *)arg;
+
+		// Drain the queue like mixCallback does, checking that commands
+		// arrive complete and in order
+		while (mix->received < kStressCommands) {
+			Command cmd;
+			bool any = false;
+			while (mix->queue->pop(cmd)) {
+				if (cmd.serial != mix->received || cmd.check != ~cmd.serial)
+					mix->errors++;
+				mix->received++;
+				any = true;
+			}
+			if (!any)
+				sched_yield();
+		}
+		return 0;
+	}
+
+	void test_stress() {
+		CommandQueue queue;
+		MixThread mix;
+		mix.queue = &queue;
+		mix.received = 0;
+		mix.errors = 0;
+
+		pthread_t thread;
+		TS_ASSERT_EQUALS(pthread_create(&thread, 0, mixThread, &mix), 0);
+
+		// Hammer the queue from the "engine" thread
+		for (uint32 i = 0; i < kStressCommands; ++i) {
+			Command cmd;
+			cmd.serial = i;
+			cmd.check = ~i;
+			while (!queue.push(cmd))
+				sched_yield();
+		}
+
+		pthread_join(thread, 0);
+
+		TS_ASSERT_EQUALS(mix.received, (uint32)kStressCommands);
+		TS_ASSERT_EQUALS(mix.errors, 0U);
+		TS_ASSERT(queue.empty());
+	}
+#endif
+};
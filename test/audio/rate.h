@@ -0,0 +1,255 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/audiostream.h"
+#include "audio/decoders/raw.h"
+#include "audio/mixer.h"
+#include "audio/rate.h"
+
+#include "common/array.h"
+#include "common/endian.h"
+#include "common/str.h"
+
+#include "test/benchmark.h"
+
+#include <math.h>
+
+/**
+ * Endless mono sine wave.
+ */
+class RateTestSineStream : public Audio::AudioStream {
+public:
+	RateTestSineStream(int rate, double frequency, double amplitude)
+		: _rate(rate), _step(2.0 * M_PI * frequency / rate), _amplitude(amplitude), _pos(0) {}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		for (int i = 0; i < numSamples; ++i)
+			buffer[i] = (int16)floor(sin(_step * _pos++) * _amplitude + 0.5);
+		return numSamples;
+	}
+
+	bool isStereo() const { return false; }
+	int getRate() const { return _rate; }
+	bool endOfData() const { return false; }
+
+private:
+	const int _rate;
+	const double _step;
+	const double _amplitude;
+	uint32 _pos;
+};
+
+class RateTestSuite : public CxxTest::TestSuite
+{
+	public:
+	enum Converter {
+		kDefault,
+		kPolyphase
+	};
+
+	static Audio::RateConverter *createConverter(Converter type, int inRate, int outRate) {
+		if (type == kPolyphase)
+			return Audio::makePolyphaseRateConverter(inRate, outRate, false);
+		// Unless configured otherwise, this is the nearest/linear converter
+		return Audio::makeRateConverter(inRate, outRate, false);
+	}
+
+	/**
+	 * Resample a 1 kHz sine and return THD+N of the result in dB.
+	 */
+	static double measureThdN(Converter type, int inRate, int outRate) {
+		const double frequency = 1000.0;
+		RateTestSineStream stream(inRate, frequency, 16384.0);
+		Audio::RateConverter *converter = createConverter(type, inRate, outRate);
+
+		// Skip the filter warm up, then analyse 200 whole periods
+		const int warmUp = 256;
+		const int length = outRate / 5;
+		Common::Array<int16> out(2 * (warmUp + length), 0);
+		converter->flow(stream, out.begin(), warmUp + length, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+		delete converter;
+
+		const double step = 2.0 * M_PI * frequency / outRate;
+		double mean = 0.0, a = 0.0, b = 0.0;
+		for (int i = 0; i < length; ++i) {
+			const double y = out[2 * (warmUp + i)];
+			mean += y;
+			a += y * sin(step * i);
+			b += y * cos(step * i);
+		}
+		mean /= length;
+		a *= 2.0 / length;
+		b *= 2.0 / length;
+
+		double signal = 0.0, noise = 0.0;
+		for (int i = 0; i < length; ++i) {
+			const double fit = a * sin(step * i) + b * cos(step * i);
+			const double residual = out[2 * (warmUp + i)] - mean - fit;
+			signal += fit * fit;
+			noise += residual * residual;
+		}
+
+		return 10.0 * log10(noise / signal);
+	}
+
+	void test_polyphase_quality() {
+		const int inRates[] = { 8000, 11025, 22050 };
+		const int outRates[] = { 44100, 48000 };
+
+		for (uint i = 0; i < ARRAYSIZE(inRates); ++i) {
+			for (uint o = 0; o < ARRAYSIZE(outRates); ++o) {
+				const double linear = measureThdN(kDefault, inRates[i], outRates[o]);
+				const double sinc = measureThdN(kPolyphase, inRates[i], outRates[o]);
+
+				TS_ASSERT_LESS_THAN(sinc, -70.0);
+				TS_ASSERT_LESS_THAN(sinc, linear - 10.0);
+			}
+		}
+	}
+
+	void test_polyphase_downsampling() {
+		TS_ASSERT_LESS_THAN(measureThdN(kPolyphase, 44100, 22050), -70.0);
+		TS_ASSERT_LESS_THAN(measureThdN(kPolyphase, 48000, 44100), -70.0);
+	}
+
+	void test_polyphase_unsupported() {
+		// Equal rates are handled by the copy converter
+		TS_ASSERT(!Audio::makePolyphaseRateConverter(22050, 22050, false));
+		// 44101 is prime, which would need 44101 phases
+		TS_ASSERT(!Audio::makePolyphaseRateConverter(22050, 44101, false));
+	}
+
+	void test_polyphase_stereo() {
+		// Left and right are filtered independently, and reverseStereo swaps them
+		byte samples[512 * 2];
+		for (int i = 0; i < 512; i += 2) {
+			WRITE_LE_UINT16(samples + 2 * i, (uint16)1000);
+			WRITE_LE_UINT16(samples + 2 * i + 2, (uint16)-1000);
+		}
+
+		for (int reverse = 0; reverse < 2; ++reverse) {
+			Audio::AudioStream *stream = Audio::makeRawStream(samples, sizeof(samples), 22050,
+				Audio::FLAG_16BITS | Audio::FLAG_STEREO | Audio::FLAG_LITTLE_ENDIAN, DisposeAfterUse::NO);
+			Audio::RateConverter *converter = Audio::makePolyphaseRateConverter(22050, 44100, true, reverse != 0);
+
+			int16 out[2 * 256];
+			memset(out, 0, sizeof(out));
+			TS_ASSERT_EQUALS(converter->flow(*stream, out, 256, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume), 256);
+
+			// Once the filter has settled, both channels are constant
+			const int left = reverse ? -1000 : 1000;
+			for (int i = 64; i < 256; ++i) {
+				TS_ASSERT_EQUALS(out[2 * i], left);
+				TS_ASSERT_EQUALS(out[2 * i + 1], -left);
+			}
+
+			delete converter;
+			delete stream;
+		}
+	}
+
+	void test_polyphase_tail() {
+		// The output lags taps/2 input samples behind. Draining pushes
+		// the end of the sound out, instead of cutting it off.
+		const int length = 1000;
+		byte samples[length * 2];
+		for (int i = 0; i < length; ++i)
+			WRITE_LE_UINT16(samples + 2 * i, (uint16)1000);
+
+		Audio::AudioStream *stream = Audio::makeRawStream(samples, sizeof(samples), 11025,
+			Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN, DisposeAfterUse::NO);
+		Audio::RateConverter *converter = createConverter(kPolyphase, 11025, 44100);
+
+		Common::Array<int16> out(2 * 8 * length, 0);
+		const int flowed = converter->flow(*stream, out.begin(), 8 * length, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+		TS_ASSERT(stream->endOfStream());
+
+		// 16 input samples (half of the 32 taps) at four times the rate
+		const int drained = converter->drain(out.begin() + 2 * flowed, 8 * length - flowed, Audio::Mixer::kMaxMixerVolume);
+		TS_ASSERT_EQUALS(drained, 16 * 4);
+		TS_ASSERT_EQUALS(converter->drain(out.begin(), 8 * length, Audio::Mixer::kMaxMixerVolume), 0);
+
+		// The signal holds, apart from the ringing of the filter, until the
+		// tail reaches the step at the end of the sound
+		const int end = flowed + drained;
+		for (int i = 128; i < end - 16; ++i)
+			TS_ASSERT_DELTA(out[2 * i], 1000, 30);
+		TS_ASSERT_DELTA(out[2 * (end - 2)], 500, 50);
+
+		delete converter;
+		delete stream;
+	}
+
+	void test_polyphase_shared_tables() {
+		// Converters for the same ratio share their coefficients. Their
+		// output must not depend on which other converters exist, or
+		// on the order in which they are destroyed.
+		const int length = 1024;
+		Common::Array<int16> expected(2 * length, 0), shared(2 * length, 0), reused(2 * length, 0);
+
+		RateTestSineStream stream1(11025, 1000.0, 16384.0);
+		Audio::RateConverter *converter1 = createConverter(kPolyphase, 11025, 44100);
+		converter1->flow(stream1, expected.begin(), length, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+
+		RateTestSineStream stream2(11025, 1000.0, 16384.0);
+		Audio::RateConverter *converter2 = createConverter(kPolyphase, 11025, 44100);
+		Audio::RateConverter *other = createConverter(kPolyphase, 22050, 44100);
+		delete converter1;
+		converter2->flow(stream2, shared.begin(), length, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+		delete converter2;
+
+		// The table was released by now and has to be computed again
+		RateTestSineStream stream3(11025, 1000.0, 16384.0);
+		Audio::RateConverter *converter3 = createConverter(kPolyphase, 11025, 44100);
+		converter3->flow(stream3, reused.begin(), length, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+		delete converter3;
+		delete other;
+
+		TS_ASSERT(expected == shared);
+		TS_ASSERT(expected == reused);
+	}
+
+	void test_benchmark() {
+#ifdef TEST_RUN_BENCHMARKS
+		struct Setup {
+			const char *name;
+			Converter type;
+			int inRate, outRate;
+		};
+
+		// The default converter is the nearest one for integer downsampling
+		// and the linear one otherwise, so each ratio is compared against
+		// the polyphase converter.
+		const Setup setups[] = {
+			{ "nearest",   kDefault,   44100, 22050 },
+			{ "polyphase", kPolyphase, 44100, 22050 },
+			{ "nearest",   kDefault,   44100, 11025 },
+			{ "polyphase", kPolyphase, 44100, 11025 },
+			{ "linear",    kDefault,   11025, 44100 },
+			{ "polyphase", kPolyphase, 11025, 44100 },
+			{ "linear",    kDefault,   22050, 48000 },
+			{ "polyphase", kPolyphase, 22050, 48000 },
+			{ "linear",    kDefault,   48000, 44100 },
+			{ "polyphase", kPolyphase, 48000, 44100 }
+		};
+
+		const int length = 44100;
+		Common::Array<int16> out(2 * length);
+
+		for (uint s = 0; s < ARRAYSIZE(setups); ++s) {
+			const Setup &setup = setups[s];
+			RateTestSineStream stream(setup.inRate, 1000.0, 16384.0);
+			Audio::RateConverter *converter = createConverter(setup.type, setup.inRate, setup.outRate);
+
+			const double start = getBenchmarkTime();
+			converter->flow(stream, out.begin(), length, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+			const double us = getBenchmarkTime() - start;
+			delete converter;
+
+			// This includes generating the sine, which is the same for all
+			TS_TRACE(Common::String::format("%-9s %5d -> %5d Hz: %6.1f ns/sample, THD+N %6.1f dB",
+				setup.name, setup.inRate, setup.outRate, us * 1e3 / length,
+				measureThdN(setup.type, setup.inRate, setup.outRate)).c_str());
+		}
+#endif
+	}
+};
@@ -0,0 +1,25 @@
+#ifndef TEST_BENCHMARK_H
+#define TEST_BENCHMARK_H
+
+/*
+ * Benchmarks only report timings, which mean nothing in a regular test
+ * run. They are built into the runner of 'make benchmark' instead of the
+ * one of 'make test', and only where there is a clock to measure with.
+ */
+#if defined(TEST_BENCHMARKS) && defined(POSIX)
+#define TEST_RUN_BENCHMARKS
+
+#include <sys/time.h>
+
+/**
+ * Returns the time in microseconds, relative to an arbitrary point.
+ */
+static inline double getBenchmarkTime() {
+	struct timeval now;
+	gettimeofday(&now, 0);
+	return now.tv_sec * 1e6 + now.tv_usec;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,177 @@
+#include <cxxtest/TestSuite.h>
+
+#include "graphics/conversion.h"
+#include "graphics/pixelformat.h"
+
+#include "common/array.h"
+#include "common/str.h"
+
+#include "test/benchmark.h"
+
+class ConversionTestSuite : public CxxTest::TestSuite
+{
+	public:
+	struct FormatPair {
+		const char *name;
+		Graphics::PixelFormat src, dst;
+	};
+
+	static Common::Array<FormatPair> formatPairs() {
+		const Graphics::PixelFormat rgb555(2, 5, 5, 5, 0, 10, 5, 0, 0);
+		const Graphics::PixelFormat rgb565(2, 5, 6, 5, 0, 11, 5, 0, 0);
+		const Graphics::PixelFormat xrgb8888(4, 8, 8, 8, 0, 16, 8, 0, 0);
+		const Graphics::PixelFormat argb8888(4, 8, 8, 8, 8, 16, 8, 0, 24);
+		const Graphics::PixelFormat rgba8888(4, 8, 8, 8, 8, 24, 16, 8, 0);
+		const Graphics::PixelFormat abgr8888(4, 8, 8, 8, 8, 0, 8, 16, 24);
+
+		const FormatPair pairs[] = {
+			{ "RGB565 -> XRGB8888",   rgb565,   xrgb8888 },
+			{ "RGB565 -> ARGB8888",   rgb565,   argb8888 },
+			{ "XRGB8888 -> RGB565",   xrgb8888, rgb565   },
+			{ "ARGB8888 -> RGB565",   argb8888, rgb565   },
+			{ "ARGB8888 -> RGBA8888", argb8888, rgba8888 },
+			{ "RGBA8888 -> ARGB8888", rgba8888, argb8888 },
+			{ "RGB555 -> RGB565",     rgb555,   rgb565   },
+			// Not specialised, uses the generic code
+			{ "RGB565 -> ABGR8888",   rgb565,   abgr8888 }
+		};
+
+		return Common::Array<FormatPair>(pairs, ARRAYSIZE(pairs));
+	}
+
+	static uint32 readPixel(const byte *p, uint bytesPerPixel) {
+		return bytesPerPixel == 2 ? *(const uint16 *)p : *(const uint32 *)p;
+	}
+
+	static uint32 testPixel(uint i) {
+		// Cover all 16 bit values, and a spread of 32 bit ones
+		return i * 0x9E3779B1;
+	}
+
+	/**
+	 * Fills a source image and converts it the way crossBlit always did,
+	 * one pixel at a time through colorToARGB and ARGBToColor.
+	 */
+	static void fillImage(const FormatPair &pair, uint w, uint h, uint srcPitch, uint dstPitch,
+	                      Common::Array<byte> &src, Common::Array<byte> &expected) {
+		src.resize(srcPitch * h);
+		expected.resize(dstPitch * h);
+
+		for (uint y = 0; y < h; ++y) {
+			for (uint x = 0; x < w; ++x) {
+				const uint32 color = testPixel(y * w + x);
+				byte a, r, g, b;
+				pair.src.colorToARGB(color, a, r, g, b);
+				const uint32 converted = pair.dst.ARGBToColor(a, r, g, b);
+
+				if (pair.src.bytesPerPixel == 2)
+					*(uint16 *)&src[y * srcPitch + x * 2] = color;
+				else
+					*(uint32 *)&src[y * srcPitch + x * 4] = color;
+
+				if (pair.dst.bytesPerPixel == 2)
+					*(uint16 *)&expected[y * dstPitch + x * 2] = converted;
+				else
+					*(uint32 *)&expected[y * dstPitch + x * 4] = converted;
+			}
+		}
+	}
+
+	void checkImage(const FormatPair &pair, uint w, uint h, uint dstPitch, const byte *dst, const Common::Array<byte> &expected) {
+		for (uint y = 0; y < h; ++y) {
+			for (uint x = 0; x < w; ++x) {
+				const uint offset = y * dstPitch + x * pair.dst.bytesPerPixel;
+				if (readPixel(dst + offset, pair.dst.bytesPerPixel) != readPixel(&expected[offset], pair.dst.bytesPerPixel)) {
+					TS_FAIL(Common::String::format("%s: pixel %d,%d is %08x instead of %08x", pair.name, x, y,
+						readPixel(dst + offset, pair.dst.bytesPerPixel), readPixel(&expected[offset], pair.dst.bytesPerPixel)).c_str());
+					return;
+				}
+			}
+		}
+	}
+
+	void test_crossblit() {
+		const Common::Array<FormatPair> pairs = formatPairs();
+
+		// Widths that are not a multiple of the vector sizes, and padded rows
+		const uint w = 301, h = 240;
+		for (uint i = 0; i < pairs.size(); ++i) {
+			const FormatPair &pair = pairs[i];
+			const uint srcPitch = w * pair.src.bytesPerPixel + 12;
+			const uint dstPitch = w * pair.dst.bytesPerPixel + 4;
+
+			Common::Array<byte> src, expected;
+			fillImage(pair, w, h, srcPitch, dstPitch, src, expected);
+
+			Common::Array<byte> dst(dstPitch * h);
+			TS_ASSERT(Graphics::crossBlit(&dst[0], &src[0], dstPitch, srcPitch, w, h, pair.dst, pair.src));
+			checkImage(pair, w, h, dstPitch, &dst[0], expected);
+		}
+	}
+
+	void test_crossblit_in_place() {
+		const Common::Array<FormatPair> pairs = formatPairs();
+
+		const uint w = 77, h = 13;
+		for (uint i = 0; i < pairs.size(); ++i) {
+			const FormatPair &pair = pairs[i];
+			const uint srcPitch = w * pair.src.bytesPerPixel;
+			const uint dstPitch = w * pair.dst.bytesPerPixel;
+
+			Common::Array<byte> src, expected;
+			fillImage(pair, w, h, srcPitch, dstPitch, src, expected);
+
+			Common::Array<byte> buffer(MAX(srcPitch, dstPitch) * h);
+			memcpy(&buffer[0], &src[0], src.size());
+			TS_ASSERT(Graphics::crossBlit(&buffer[0], &buffer[0], dstPitch, srcPitch, w, h, pair.dst, pair.src));
+			checkImage(pair, w, h, dstPitch, &buffer[0], expected);
+		}
+	}
+
+	void test_crossblitmap() {
+		uint32 map[256];
+		for (uint i = 0; i < 256; ++i)
+			map[i] = testPixel(i);
+
+		const uint w = 37, h = 9;
+		for (uint bytesPerPixel = 2; bytesPerPixel <= 4; bytesPerPixel += 2) {
+			// Converted in place, which is the hardest case
+			Common::Array<byte> buffer(w * h * bytesPerPixel);
+			for (uint i = 0; i < w * h; ++i)
+				buffer[i] = i * 7;
+
+			TS_ASSERT(Graphics::crossBlitMap(&buffer[0], &buffer[0], w * bytesPerPixel, w, w, h, bytesPerPixel, map));
+
+			for (uint i = 0; i < w * h; ++i) {
+				const uint32 expected = bytesPerPixel == 2 ? (uint16)map[(byte)(i * 7)] : map[(byte)(i * 7)];
+				TS_ASSERT_EQUALS(readPixel(&buffer[i * bytesPerPixel], bytesPerPixel), expected);
+			}
+		}
+
+		TS_ASSERT(!Graphics::crossBlitMap(0, 0, 0, 0, 0, 0, 3, map));
+	}
+
+	void test_benchmark() {
+#ifdef TEST_RUN_BENCHMARKS
+		const Common::Array<FormatPair> pairs = formatPairs();
+
+		const uint w = 640, h = 480, frames = 20;
+		for (uint i = 0; i < pairs.size(); ++i) {
+			const FormatPair &pair = pairs[i];
+			const uint srcPitch = w * pair.src.bytesPerPixel;
+			const uint dstPitch = w * pair.dst.bytesPerPixel;
+
+			Common::Array<byte> src, expected;
+			fillImage(pair, w, h, srcPitch, dstPitch, src, expected);
+			Common::Array<byte> dst(dstPitch * h);
+
+			const double start = getBenchmarkTime();
+			for (uint f = 0; f < frames; ++f)
+				Graphics::crossBlit(&dst[0], &src[0], dstPitch, srcPitch, w, h, pair.dst, pair.src);
+			const double us = getBenchmarkTime() - start;
+
+			TS_TRACE(Common::String::format("%-20s %8.1f MPix/s", pair.name, (double)w * h * frames / MAX(us, 1.0)).c_str());
+		}
+#endif
+	}
+};
@@ -0,0 +1,252 @@
+#include <cxxtest/TestSuite.h>
+
+#include "graphics/transparent_surface.h"
+
+#include "common/str.h"
+#include "common/util.h"
+
+#include "test/benchmark.h"
+
+class TransparentSurfaceTestSuite : public CxxTest::TestSuite
+{
+	public:
+	enum {
+		kA = 0, kB = 1, kG = 2, kR = 3
+	};
+
+	static uint32 nextRandom(uint32 &seed) {
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	}
+
+	static byte *pixel(Graphics::Surface &surface, int x, int y) {
+		return (byte *)surface.getBasePtr(x, y);
+	}
+
+	/**
+	 * Creates a sprite with transparent and opaque areas, and some
+	 * translucent pixels in between.
+	 */
+	static void createSprite(Graphics::TransparentSurface &sprite, int w, int h) {
+		sprite.create(w, h, Graphics::TransparentSurface::getSupportedPixelFormat());
+
+		uint32 seed = 1;
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				uint32 color = nextRandom(seed);
+				byte a;
+				if (x < w / 4 || y < h / 5)
+					a = 0;
+				else if (x < w / 2)
+					a = 255;
+				else
+					a = (x + y) % 3 == 0 ? 0 : (nextRandom(seed) & 0xFF);
+
+				*(uint32 *)sprite.getBasePtr(x, y) = (color << 8) | a;
+			}
+		}
+	}
+
+	static void createTarget(Graphics::Surface &target, int w, int h) {
+		target.create(w, h, Graphics::TransparentSurface::getSupportedPixelFormat());
+
+		uint32 seed = 2;
+		for (int y = 0; y < h; y++)
+			for (int x = 0; x < w; x++)
+				*(uint32 *)target.getBasePtr(x, y) = nextRandom(seed) << 8 | (nextRandom(seed) & 0xFF);
+	}
+
+	/**
+	 * Blends one pixel, the way the blitting code always did.
+	 */
+	static void blendPixel(const byte *in, byte *out, Graphics::TSpriteBlendMode blendMode, Graphics::AlphaType alphaMode, uint32 color) {
+		const uint ca = (color >> 24) & 0xFF;
+		const int cmod[4] = { 0, (int)(color & 0xFF), (int)((color >> 8) & 0xFF), (int)((color >> 16) & 0xFF) };
+		const uint ina = in[kA] * ca >> 8;
+
+		if (color == 0xFFFFFFFF && blendMode == Graphics::BLEND_NORMAL && alphaMode == Graphics::ALPHA_OPAQUE) {
+			memcpy(out, in, 4);
+			out[kA] = 255;
+			return;
+		}
+
+		if (color == 0xFFFFFFFF && blendMode == Graphics::BLEND_NORMAL && alphaMode == Graphics::ALPHA_BINARY) {
+			if (in[kA] != 0) {
+				memcpy(out, in, 4);
+				out[kA] = 255;
+			}
+			return;
+		}
+
+		for (int c = kB; c <= kR; c++) {
+			switch (blendMode) {
+			case Graphics::BLEND_ADDITIVE:
+				if (color == 0xFFFFFFFF) {
+					if (in[kA] != 0)
+						out[c] = MIN((in[c] * in[kA] >> 8) + out[c], 255);
+				} else if (cmod[c] != 255) {
+					out[c] = MIN<uint>(out[c] + ((in[c] * cmod[c] * ina) >> 16), 255u);
+				} else {
+					out[c] = MIN<uint>(out[c] + (in[c] * ina >> 8), 255u);
+				}
+				break;
+
+			case Graphics::BLEND_SUBTRACTIVE:
+				if (color == 0xFFFFFFFF) {
+					if (in[kA] != 0)
+						out[c] = MAX(out[c] - ((in[c] * out[c]) * in[kA] >> 16), 0);
+				} else if (cmod[c] != 255) {
+					out[c] = MAX<int>(out[c] - ((in[c] * cmod[c] * out[c] * (uint32)in[kA]) >> 24), 0);
+				} else {
+					out[c] = MAX(out[c] - (in[c] * out[c] * in[kA] >> 16), 0);
+				}
+				break;
+
+			case Graphics::BLEND_MULTIPLY:
+				if (color == 0xFFFFFFFF) {
+					if (in[kA] != 0)
+						out[c] = MIN((in[c] * in[kA] >> 8) * out[c] >> 8, 255);
+				} else if (cmod[c] != 255) {
+					out[c] = MIN<uint>(out[c] * ((in[c] * cmod[c] * ina) >> 16) >> 8, 255u);
+				} else {
+					out[c] = MIN<uint>(out[c] * (in[c] * ina >> 8) >> 8, 255u);
+				}
+				break;
+
+			default:
+				if (color == 0xFFFFFFFF) {
+					if (in[kA] != 0)
+						out[c] = ((in[c] * in[kA]) + out[c] * (255 - in[kA])) >> 8;
+				} else if (ina != 0) {
+					out[c] = (out[c] * (255 - ina) >> 8);
+					out[c] = out[c] + (in[c] * ina * cmod[c] >> 16);
+				}
+				break;
+			}
+		}
+
+		if (blendMode == Graphics::BLEND_NORMAL && (color == 0xFFFFFFFF ? in[kA] != 0 : ina != 0))
+			out[kA] = 255;
+		if (blendMode == Graphics::BLEND_SUBTRACTIVE && color != 0xFFFFFFFF)
+			out[kA] = 255;
+	}
+
+	void checkBlits(bool useSpans) {
+		const Graphics::TSpriteBlendMode blendModes[] = {
+			Graphics::BLEND_NORMAL, Graphics::BLEND_ADDITIVE, Graphics::BLEND_SUBTRACTIVE, Graphics::BLEND_MULTIPLY
+		};
+		const Graphics::AlphaType alphaModes[] = {
+			Graphics::ALPHA_OPAQUE, Graphics::ALPHA_BINARY, Graphics::ALPHA_FULL
+		};
+		const uint32 colors[] = { 0xFFFFFFFF, 0xC0FF8040, 0xFF20FFFF, 0xE0F0FE80 };
+		const int positions[][2] = { { 5, 7 }, { -9, -4 }, { 40, 30 } };
+
+		Graphics::TransparentSurface sprite;
+		createSprite(sprite, 37, 23);
+		if (useSpans)
+			sprite.buildSpans();
+
+		Graphics::Surface target, expected;
+		createTarget(expected, 64, 48);
+		target.copyFrom(expected);
+
+		for (uint b = 0; b < ARRAYSIZE(blendModes); b++) {
+			for (uint a = 0; a < ARRAYSIZE(alphaModes); a++) {
+				for (uint c = 0; c < ARRAYSIZE(colors); c++) {
+					for (int flipping = 0; flipping <= Graphics::FLIP_HV; flipping++) {
+						for (uint p = 0; p < ARRAYSIZE(positions); p++) {
+							const int posX = positions[p][0];
+							const int posY = positions[p][1];
+
+							sprite.setAlphaMode(alphaModes[a]);
+							sprite.blit(target, posX, posY, flipping, nullptr, colors[c], -1, -1, blendModes[b]);
+
+							for (int y = 0; y < sprite.h; y++) {
+								for (int x = 0; x < sprite.w; x++) {
+									if (posX + x < 0 || posX + x >= expected.w || posY + y < 0 || posY + y >= expected.h)
+										continue;
+
+									const int srcX = (flipping & Graphics::FLIP_H) ? sprite.w - 1 - x : x;
+									const int srcY = (flipping & Graphics::FLIP_V) ? sprite.h - 1 - y : y;
+									blendPixel(pixel(sprite, srcX, srcY), pixel(expected, posX + x, posY + y), blendModes[b], alphaModes[a], colors[c]);
+								}
+							}
+
+							if (memcmp(target.getPixels(), expected.getPixels(), target.pitch * target.h)) {
+								TS_FAIL(Common::String::format("Blend mode %d, alpha mode %d, color %08x, flipping %d, position %d,%d%s",
+									blendModes[b], alphaModes[a], colors[c], flipping, posX, posY, useSpans ? " with spans" : "").c_str());
+								target.copyFrom(expected);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		target.free();
+		expected.free();
+		sprite.free();
+	}
+
+	void test_blit() {
+		checkBlits(false);
+	}
+
+	void test_blit_spans() {
+		checkBlits(true);
+	}
+
+	void test_blit_part() {
+		Graphics::TransparentSurface sprite;
+		createSprite(sprite, 37, 23);
+
+		Graphics::Surface withSpans, withoutSpans;
+		createTarget(withoutSpans, 64, 48);
+		withSpans.copyFrom(withoutSpans);
+
+		Common::Rect part(6, 3, 31, 20);
+		for (int flipping = 0; flipping <= Graphics::FLIP_HV; flipping++) {
+			sprite.invalidateSpans();
+			sprite.blitClip(withoutSpans, Common::Rect(4, 4, 50, 40), -3 + flipping * 7, 2, flipping, &part);
+			sprite.buildSpans();
+			TS_ASSERT(sprite.hasSpans());
+			sprite.blitClip(withSpans, Common::Rect(4, 4, 50, 40), -3 + flipping * 7, 2, flipping, &part);
+		}
+
+		TS_ASSERT(!memcmp(withSpans.getPixels(), withoutSpans.getPixels(), withSpans.pitch * withSpans.h));
+
+		// Changed pixels drop the index
+		sprite.applyColorKey(0, 0, 0);
+		TS_ASSERT(!sprite.hasSpans());
+
+		withSpans.free();
+		withoutSpans.free();
+		sprite.free();
+	}
+
+	void test_benchmark() {
+#ifdef TEST_RUN_BENCHMARKS
+		Graphics::TransparentSurface sprite;
+		createSprite(sprite, 256, 256);
+
+		Graphics::Surface target;
+		createTarget(target, 640, 480);
+
+		const int blits = 200;
+		for (int useSpans = 0; useSpans < 2; useSpans++) {
+			if (useSpans)
+				sprite.buildSpans();
+
+			const double start = getBenchmarkTime();
+			for (int i = 0; i < blits; i++)
+				sprite.blit(target, i % 300, i % 200);
+			const double us = getBenchmarkTime() - start;
+
+			TS_TRACE(Common::String::format("256x256 alpha blit %s spans: %6.1f us", useSpans ? "with" : "without", us / blits).c_str());
+		}
+
+		target.free();
+		sprite.free();
+#endif
+	}
+};
@@ -0,0 +1,149 @@
+#include <cxxtest/TestSuite.h>
+
+#include "graphics/font.h"
+#include "graphics/surface.h"
+#include "graphics/fonts/ttf.h"
+
+#include "backends/fs/stdiostream.h"
+
+#include "common/ptr.h"
+#include "common/str.h"
+#include "common/ustr.h"
+
+class TTFFontTestSuite : public CxxTest::TestSuite
+{
+	public:
+#ifdef USE_FREETYPE2
+	static Graphics::Font *loadFont(const char *name, int size) {
+		Common::ScopedPtr<StdioStream> stream(StdioStream::makeFromPath(Common::String(TEST_SRCDIR "/gui/themes/fonts/") + name, false));
+		TS_ASSERT(stream);
+		if (!stream)
+			return 0;
+
+		Graphics::Font *font = Graphics::loadTTFFont(*stream, size);
+		TS_ASSERT(font);
+		return font;
+	}
+
+	/**
+	 * Draws a character on its own, anti-aliased, so two fonts can be
+	 * compared pixel by pixel.
+	 */
+	static void drawChar(const Graphics::Font &font, uint32 chr, Graphics::Surface &surface) {
+		const int w = font.getMaxCharWidth() * 2;
+		const int h = font.getFontHeight() * 2;
+		if (surface.w != w || surface.h != h)
+			surface.create(w, h, Graphics::PixelFormat(4, 8, 8, 8, 8, 24, 16, 8, 0));
+
+		memset(surface.getPixels(), 0, surface.pitch * surface.h);
+		font.drawChar(&surface, chr, w / 4, h / 4, surface.format.RGBToColor(255, 255, 255));
+	}
+
+	static bool sameChar(const Graphics::Font &font, const Graphics::Font &reference, uint32 chr) {
+		Graphics::Surface surface, referenceSurface;
+		drawChar(font, chr, surface);
+		drawChar(reference, chr, referenceSurface);
+
+		const bool same = surface.w == referenceSurface.w && surface.h == referenceSurface.h
+			&& !memcmp(surface.getPixels(), referenceSurface.getPixels(), surface.pitch * surface.h);
+		surface.free();
+		referenceSurface.free();
+		return same;
+	}
+
+	static bool hasPixels(const Graphics::Font &font, uint32 chr) {
+		Graphics::Surface surface;
+		drawChar(font, chr, surface);
+
+		bool found = false;
+		for (int y = 0; y < surface.h && !found; y++) {
+			for (int x = 0; x < surface.w && !found; x++)
+				found = *(const uint32 *)surface.getBasePtr(x, y) != 0;
+		}
+		surface.free();
+		return found;
+	}
+#endif
+
+	void test_atlas_packing() {
+#ifdef USE_FREETYPE2
+		// Pages this small hold only a few glyphs each, so ISO-8859-1 is
+		// spread over many pages and shelves.
+		Common::ScopedPtr<Graphics::Font> reference(loadFont("FreeSans.ttf", 14));
+		Graphics::setTTFGlyphCacheLimits(32, 1);
+		Common::ScopedPtr<Graphics::Font> font(loadFont("FreeSans.ttf", 14));
+		Graphics::setTTFGlyphCacheLimits();
+		if (!reference || !font)
+			return;
+
+		for (uint32 chr = 0x20; chr < 0x100; chr++) {
+			if (!sameChar(*font, *reference, chr))
+				TS_FAIL(Common::String::format("Glyph %02X differs", chr).c_str());
+		}
+
+		TS_ASSERT(hasPixels(*font, 'A'));
+		TS_ASSERT(hasPixels(*font, 0xE9));
+		TS_ASSERT(!hasPixels(*font, ' '));
+#endif
+	}
+
+	void test_page_eviction() {
+#ifdef USE_FREETYPE2
+		// A single cache page fits far fewer CJK glyphs than are drawn, so
+		// pages are recycled and the glyphs rendered again.
+		Common::ScopedPtr<Graphics::Font> reference(loadFont("mplus-2c-regular.ttf", 16));
+		Graphics::setTTFGlyphCacheLimits(64, 1);
+		Common::ScopedPtr<Graphics::Font> font(loadFont("mplus-2c-regular.ttf", 16));
+		Graphics::setTTFGlyphCacheLimits();
+		if (!reference || !font)
+			return;
+
+		const uint32 first = 0x4E00, last = 0x4F00;
+		for (int pass = 0; pass < 2; pass++) {
+			for (uint32 chr = first; chr < last; chr++) {
+				if (!sameChar(*font, *reference, chr))
+					TS_FAIL(Common::String::format("Glyph %04X differs in pass %d", chr, pass).c_str());
+			}
+		}
+
+		// The glyphs loaded with the font are never evicted
+		TS_ASSERT(sameChar(*font, *reference, 'A'));
+		TS_ASSERT(hasPixels(*font, first));
+		TS_ASSERT_EQUALS(font->getCharWidth(first), reference->getCharWidth(first));
+#endif
+	}
+
+	void test_string_width_cache() {
+#ifdef USE_FREETYPE2
+		Common::ScopedPtr<Graphics::Font> font(loadFont("FreeSansBold.ttf", 12));
+		if (!font)
+			return;
+
+		const char *const texts[] = { "", "W", "AVAWAY", "Hello World", "Toggle Fullscreen", "Quit" };
+		for (int pass = 0; pass < 2; pass++) {
+			for (uint i = 0; i < ARRAYSIZE(texts); i++) {
+				const Common::String str(texts[i]);
+				TS_ASSERT_EQUALS(font->getStringWidth(str), font->Graphics::Font::getStringWidth(str));
+
+				const Common::U32String u32str(texts[i]);
+				TS_ASSERT_EQUALS(font->getStringWidth(u32str), font->Graphics::Font::getStringWidth(u32str));
+			}
+		}
+
+		// More strings than the cache holds
+		for (int i = 0; i < 3000; i++) {
+			const Common::String str = Common::String::format("Savegame %d", i);
+			TS_ASSERT_EQUALS(font->getStringWidth(str), font->Graphics::Font::getStringWidth(str));
+		}
+		TS_ASSERT_EQUALS(font->getStringWidth("Savegame 7"), font->Graphics::Font::getStringWidth("Savegame 7"));
+
+		const uint32 cjk[] = { 0x65E5, 0x672C, 0x8A9E, 0 };
+		Common::ScopedPtr<Graphics::Font> cjkFont(loadFont("mplus-2c-regular.ttf", 16));
+		if (cjkFont) {
+			const Common::U32String str(cjk);
+			TS_ASSERT(cjkFont->getStringWidth(str) > 0);
+			TS_ASSERT_EQUALS(cjkFont->getStringWidth(str), cjkFont->Graphics::Font::getStringWidth(str));
+		}
+#endif
+	}
+};
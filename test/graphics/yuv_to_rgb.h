@@ -0,0 +1,266 @@
+#include <cxxtest/TestSuite.h>
+
+#include "graphics/yuv_to_rgb.h"
+
+#include "common/array.h"
+#include "common/str.h"
+
+#include "test/benchmark.h"
+
+#ifdef POSIX
+#include <pthread.h>
+#endif
+
+class YUVToRGBTestSuite : public CxxTest::TestSuite
+{
+	public:
+	enum Subsampling {
+		k444, k420, k410
+	};
+
+	static Common::Array<Graphics::PixelFormat> formats() {
+		Common::Array<Graphics::PixelFormat> formats;
+		formats.push_back(Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
+		formats.push_back(Graphics::PixelFormat(2, 5, 5, 5, 1, 10, 5, 0, 15));
+		formats.push_back(Graphics::PixelFormat(4, 8, 8, 8, 8, 16, 8, 0, 24));
+		formats.push_back(Graphics::PixelFormat(4, 8, 8, 8, 8, 24, 16, 8, 0));
+		formats.push_back(Graphics::PixelFormat(4, 8, 8, 8, 0, 0, 8, 16, 0));
+		return formats;
+	}
+
+	/**
+	 * Converts one pixel from the color space definition, rather than the
+	 * tables used by the conversion code.
+	 */
+	static uint32 convertPixel(const Graphics::PixelFormat &format, Graphics::YUVToRGBManager::LuminanceScale scale, byte y, byte u, byte v) {
+		const int16 cr = v - 128, cb = u - 128;
+		int rgb[3] = {
+			y + (int16)((0.419 / 0.299) * cr),
+			y + (int16)(-(0.299 / 0.419) * cr) + (int16)(-(0.114 / 0.331) * cb),
+			y + (int16)((0.587 / 0.331) * cb)
+		};
+
+		for (int i = 0; i < 3; i++) {
+			if (scale == Graphics::YUVToRGBManager::kScaleFull)
+				rgb[i] = CLIP(rgb[i], 0, 255);
+			else
+				rgb[i] = (CLIP(rgb[i], 16, 235) - 16) * 255 / 219;
+		}
+
+		return format.RGBToColor(rgb[0], rgb[1], rgb[2]);
+	}
+
+	struct Image {
+		int width, height;
+		int yPitch, uvPitch;
+		Common::Array<byte> y, u, v;
+
+		byte getU(Subsampling subsampling, int x, int row) const { return getChroma(u, subsampling, x, row); }
+		byte getV(Subsampling subsampling, int x, int row) const { return getChroma(v, subsampling, x, row); }
+
+		byte getChroma(const Common::Array<byte> &plane, Subsampling subsampling, int x, int row) const {
+			switch (subsampling) {
+			case k420:
+				return plane[(row / 2) * uvPitch + x / 2];
+			case k410: {
+				const int index = (row / 4) * uvPitch + x / 4;
+				const int xDiff = x & 3, yDiff = row & 3;
+				return (plane[index] * (4 - xDiff) * (4 - yDiff) + plane[index + 1] * xDiff * (4 - yDiff) +
+				        plane[index + uvPitch] * yDiff * (4 - xDiff) + plane[index + uvPitch + 1] * xDiff * yDiff) >> 4;
+			}
+			default:
+				return plane[row * uvPitch + x];
+			}
+		}
+	};
+
+	/**
+	 * Creates an image which uses every combination of chroma values in
+	 * YUV444, and all luminance values.
+	 */
+	static void createImage(Image &image, Subsampling subsampling, int width, int height) {
+		const int shift = (subsampling == k444) ? 0 : (subsampling == k420) ? 1 : 2;
+
+		image.width = width;
+		image.height = height;
+		image.yPitch = width + 5;
+		image.uvPitch = (width >> shift) + 3;
+		image.y.resize(image.yPitch * height);
+		image.u.resize(image.uvPitch * ((height >> shift) + 1));
+		image.v.resize(image.uvPitch * ((height >> shift) + 1));
+
+		for (uint i = 0; i < image.y.size(); i++)
+			image.y[i] = i * 7 + (i / image.yPitch) * 13;
+		for (uint i = 0; i < image.u.size(); i++) {
+			image.u[i] = i % image.uvPitch;
+			image.v[i] = i / image.uvPitch + (i % image.uvPitch) / 256 * 97;
+		}
+	}
+
+	static void convert(Graphics::Surface &surface, Graphics::YUVToRGBManager::LuminanceScale scale, Subsampling subsampling, const Image &image) {
+		switch (subsampling) {
+		case k444:
+			YUVToRGBMan.convert444(&surface, scale, &image.y[0], &image.u[0], &image.v[0], image.width, image.height, image.yPitch, image.uvPitch);
+			break;
+		case k420:
+			YUVToRGBMan.convert420(&surface, scale, &image.y[0], &image.u[0], &image.v[0], image.width, image.height, image.yPitch, image.uvPitch);
+			break;
+		case k410:
+			YUVToRGBMan.convert410(&surface, scale, &image.y[0], &image.u[0], &image.v[0], image.width, image.height, image.yPitch, image.uvPitch);
+			break;
+		}
+	}
+
+	void checkConversion(Subsampling subsampling, int width, int height) {
+		const Common::Array<Graphics::PixelFormat> pixelFormats = formats();
+
+		Image image;
+		createImage(image, subsampling, width, height);
+
+		for (uint f = 0; f < pixelFormats.size(); f++) {
+			for (int s = 0; s < 2; s++) {
+				const Graphics::PixelFormat &format = pixelFormats[f];
+				const Graphics::YUVToRGBManager::LuminanceScale scale = s ? Graphics::YUVToRGBManager::kScaleITU : Graphics::YUVToRGBManager::kScaleFull;
+
+				Graphics::Surface surface;
+				surface.create(width, height, format);
+				convert(surface, scale, subsampling, image);
+
+				bool failed = false;
+				for (int row = 0; row < height && !failed; row++) {
+					for (int x = 0; x < width && !failed; x++) {
+						const uint32 expected = convertPixel(format, scale, image.y[row * image.yPitch + x],
+						                                     image.getU(subsampling, x, row), image.getV(subsampling, x, row));
+						const uint32 pixel = format.bytesPerPixel == 2 ? *(const uint16 *)surface.getBasePtr(x, row) : *(const uint32 *)surface.getBasePtr(x, row);
+
+						if (pixel != expected) {
+							TS_FAIL(Common::String::format("Subsampling %d, format %s, scale %d: pixel %d,%d is %08x instead of %08x",
+								subsampling, format.toString().c_str(), scale, x, row, pixel, expected).c_str());
+							failed = true;
+						}
+					}
+				}
+
+				surface.free();
+			}
+		}
+	}
+
+	void test_convert444() {
+		checkConversion(k444, 256, 256);
+		checkConversion(k444, 13, 5);
+	}
+
+	void test_convert420() {
+		checkConversion(k420, 514, 512);
+		checkConversion(k420, 22, 6);
+	}
+
+	void test_convert410() {
+		checkConversion(k410, 1028, 40);
+		checkConversion(k410, 20, 8);
+	}
+
+	/** Converts the slices in reverse order, on the calling thread */
+	class ReverseSliceRunner : public Graphics::YUVToRGBManager::SliceRunner {
+	public:
+		ReverseSliceRunner() : slices(0) {}
+
+		virtual void runSlices(const Graphics::YUVToRGBManager::SliceJob &job, uint count) {
+			slices = count;
+			for (uint i = count; i > 0; i--)
+				job.convertSlice(i - 1);
+		}
+
+		uint slices;
+	};
+
+	void checkSlices(Graphics::YUVToRGBManager::SliceRunner &runner) {
+		const Graphics::PixelFormat format(2, 5, 6, 5, 0, 11, 5, 0, 0);
+
+		for (int subsampling = k444; subsampling <= k410; subsampling++) {
+			Image image;
+			createImage(image, (Subsampling)subsampling, 96, 132);
+
+			Graphics::Surface expected, sliced;
+			expected.create(image.width, image.height, format);
+			sliced.create(image.width, image.height, format);
+
+			convert(expected, Graphics::YUVToRGBManager::kScaleFull, (Subsampling)subsampling, image);
+			YUVToRGBMan.setSliceRunner(&runner, 3);
+			convert(sliced, Graphics::YUVToRGBManager::kScaleFull, (Subsampling)subsampling, image);
+			YUVToRGBMan.setSliceRunner(0, 1);
+
+			TS_ASSERT(!memcmp(expected.getPixels(), sliced.getPixels(), expected.pitch * expected.h));
+
+			expected.free();
+			sliced.free();
+		}
+	}
+
+	void test_slices() {
+		ReverseSliceRunner runner;
+		checkSlices(runner);
+		TS_ASSERT_EQUALS(runner.slices, 3U);
+	}
+
+#ifdef POSIX
+	/** Converts each slice on a thread of its own */
+	class ThreadSliceRunner : public Graphics::YUVToRGBManager::SliceRunner {
+	public:
+		struct Slice {
+			const Graphics::YUVToRGBManager::SliceJob *job;
+			uint slice;
+		};
+
+		static void *convertSlice(void *arg) {
+			const Slice *slice = (const Slice *)arg;
+			slice->job->convertSlice(slice->slice);
+			return 0;
+		}
+
+		virtual void runSlices(const Graphics::YUVToRGBManager::SliceJob &job, uint count) {
+			Common::Array<pthread_t> threads(count);
+			Common::Array<Slice> slices(count);
+
+			for (uint i = 0; i < count; i++) {
+				slices[i].job = &job;
+				slices[i].slice = i;
+				pthread_create(&threads[i], 0, convertSlice, &slices[i]);
+			}
+
+			for (uint i = 0; i < count; i++)
+				pthread_join(threads[i], 0);
+		}
+	};
+
+	void test_slices_threads() {
+		ThreadSliceRunner runner;
+		checkSlices(runner);
+	}
+#endif
+
+	void test_benchmark() {
+#ifdef TEST_RUN_BENCHMARKS
+		const Common::Array<Graphics::PixelFormat> pixelFormats = formats();
+
+		Image image;
+		createImage(image, k420, 640, 480);
+
+		const int frames = 20;
+		for (uint f = 0; f < pixelFormats.size(); f += 2) {
+			Graphics::Surface surface;
+			surface.create(image.width, image.height, pixelFormats[f]);
+
+			const double start = getBenchmarkTime();
+			for (int i = 0; i < frames; i++)
+				YUVToRGBMan.convert420(&surface, Graphics::YUVToRGBManager::kScaleITU, &image.y[0], &image.u[0], &image.v[0], image.width, image.height, image.yPitch, image.uvPitch);
+			const double us = getBenchmarkTime() - start;
+
+			TS_TRACE(Common::String::format("640x480 YUV420 to %s: %7.1f us per frame", pixelFormats[f].toString().c_str(), us / frames).c_str());
+
+			surface.free();
+		}
+#endif
+	}
+};
@@ -0,0 +1,223 @@
+#include <cxxtest/TestSuite.h>
+
+#include "video/bink_dsp.h"
+
+#include "common/array.h"
+#include "common/str.h"
+
+#include "test/benchmark.h"
+
+class BinkDSPTestSuite : public CxxTest::TestSuite
+{
+	public:
+	static uint32 nextRandom(uint32 &seed) {
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	}
+
+	/**
+	 * Creates DCT coefficients which are mostly empty, like the decoder
+	 * produces them.
+	 */
+	static void createBlock(int32 *block, uint32 &seed) {
+		memset(block, 0, 64 * sizeof(int32));
+
+		block[0] = (int32)(nextRandom(seed) % 4096) - 2048;
+
+		const int coeffs = nextRandom(seed) % 24;
+		for (int i = 0; i < coeffs; i++)
+			block[nextRandom(seed) % 64] = (int32)(nextRandom(seed) % 2048) - 1024;
+	}
+
+	/** The IDCT as the decoder always did it, one column and row at a time */
+	static void referenceTransform(int32 *dest, const int32 *src, int step, bool round) {
+		const int a0 = src[0 * step] + src[4 * step];
+		const int a1 = src[0 * step] - src[4 * step];
+		const int a2 = src[2 * step] + src[6 * step];
+		const int a3 = (2896 * (src[2 * step] - src[6 * step])) >> 11;
+		const int a4 = src[5 * step] + src[3 * step];
+		const int a5 = src[5 * step] - src[3 * step];
+		const int a6 = src[1 * step] + src[7 * step];
+		const int a7 = src[1 * step] - src[7 * step];
+		const int b0 = a4 + a6;
+		const int b1 = (3784 * (a5 + a7)) >> 11;
+		const int b2 = ((-5352 * a5) >> 11) - b0 + b1;
+		const int b3 = (2896 * (a6 - a4) >> 11) - b2;
+		const int b4 = ((2217 * a7) >> 11) + b3 - b1;
+
+		const int out[8] = {
+			a0 + a2 + b0, a1 + a3 - a2 + b2, a1 - a3 + a2 + b3, a0 - a2 - b4,
+			a0 - a2 + b4, a1 - a3 + a2 - b3, a1 + a3 - a2 - b2, a0 + a2 - b0
+		};
+
+		for (int i = 0; i < 8; i++)
+			dest[i * step] = round ? ((out[i] + 0x7F) >> 8) : out[i];
+	}
+
+	static void referenceIDCT(int32 *block) {
+		int32 temp[64];
+
+		for (int i = 0; i < 8; i++)
+			referenceTransform(&temp[i], &block[i], 8, false);
+		for (int i = 0; i < 8; i++)
+			referenceTransform(&block[8 * i], &temp[8 * i], 1, true);
+	}
+
+	static void createPlane(Common::Array<byte> &plane, uint32 size, uint32 &seed) {
+		plane.resize(size);
+		for (uint32 i = 0; i < size; i++)
+			plane[i] = nextRandom(seed);
+	}
+
+	void test_idct() {
+#ifdef USE_BINK
+		uint32 seed = 1;
+
+		for (int n = 0; n < 1000; n++) {
+			int32 block[64], expected[64];
+			createBlock(block, seed);
+			memcpy(expected, block, sizeof(block));
+
+			referenceIDCT(expected);
+			Video::binkIDCT(block);
+
+			if (memcmp(block, expected, sizeof(block))) {
+				TS_FAIL(Common::String::format("IDCT of block %d differs", n).c_str());
+				return;
+			}
+		}
+#endif
+	}
+
+	void test_idct_put_add() {
+#ifdef USE_BINK
+		const uint32 pitch = 40;
+		uint32 seed = 2;
+
+		for (int n = 0; n < 200; n++) {
+			int32 block[64], transformed[64];
+			createBlock(block, seed);
+			memcpy(transformed, block, sizeof(block));
+			referenceIDCT(transformed);
+
+			Common::Array<byte> plane, expected;
+			createPlane(plane, pitch * 16, seed);
+
+			// Put
+			expected = plane;
+			for (int y = 0; y < 8; y++)
+				for (int x = 0; x < 8; x++)
+					expected[y * pitch + x + 3] = transformed[y * 8 + x];
+
+			Video::binkIDCTPut(&plane[3], pitch, block);
+			TS_ASSERT(plane == expected);
+
+			// Add
+			for (int y = 0; y < 8; y++)
+				for (int x = 0; x < 8; x++)
+					expected[(y + 5) * pitch + x + 17] += transformed[y * 8 + x];
+
+			Video::binkIDCTAdd(&plane[5 * pitch + 17], pitch, block);
+			TS_ASSERT(plane == expected);
+
+			// Put, scaled to 16x16
+			for (int y = 0; y < 16; y++)
+				for (int x = 0; x < 16; x++)
+					expected[y * pitch + x + 20] = transformed[(y / 2) * 8 + x / 2];
+
+			Video::binkIDCTPutScaled(&plane[20], pitch, block);
+			TS_ASSERT(plane == expected);
+		}
+#endif
+	}
+
+	void test_residue_copy() {
+#ifdef USE_BINK
+		const uint32 pitch = 24;
+		uint32 seed = 3;
+
+		Common::Array<byte> plane, expected;
+		createPlane(plane, pitch * 20, seed);
+		expected = plane;
+
+		int16 residue[64];
+		for (int i = 0; i < 64; i++)
+			residue[i] = (int16)(nextRandom(seed) % 1024) - 512;
+
+		for (int y = 0; y < 8; y++)
+			for (int x = 0; x < 8; x++)
+				expected[(y + 1) * pitch + x + 2] += residue[y * 8 + x];
+
+		Video::binkAddResidue(&plane[pitch + 2], pitch, residue);
+		TS_ASSERT(plane == expected);
+
+		for (int y = 0; y < 8; y++)
+			for (int x = 0; x < 8; x++)
+				expected[(y + 11) * pitch + x + 13] = expected[(y + 3) * pitch + x + 5];
+
+		Video::binkCopyBlock(&plane[11 * pitch + 13], &plane[3 * pitch + 5], pitch);
+		TS_ASSERT(plane == expected);
+#endif
+	}
+
+	void test_benchmark() {
+#if defined(USE_BINK) && defined(TEST_RUN_BENCHMARKS)
+		// Decode the blocks of a synthetic 640x480 frame: every plane gets a
+		// mix of intra, inter, residue and motion blocks, in the ratio of a
+		// typical cutscene.
+		const uint32 width = 640, height = 480;
+		uint32 seed = 4;
+
+		Common::Array<int32> blocks(64 * 64);
+		for (uint i = 0; i < 64; i++)
+			createBlock(&blocks[i * 64], seed);
+
+		int16 residue[64];
+		for (int i = 0; i < 64; i++)
+			residue[i] = (int16)(nextRandom(seed) % 64) - 32;
+
+		Common::Array<byte> planes[2];
+		createPlane(planes[0], width * height, seed);
+		createPlane(planes[1], width * height, seed);
+
+		const int frames = 20;
+		const double start = getBenchmarkTime();
+		for (int f = 0; f < frames; f++) {
+			byte *cur = &planes[f & 1][0];
+			const byte *prev = &planes[(f & 1) ^ 1][0];
+
+			for (int p = 0; p < 3; p++) {
+				const uint32 pitch = p ? width / 2 : width;
+				const uint32 rows = p ? height / 2 : height;
+
+				for (uint32 y = 0; y < rows; y += 8) {
+					for (uint32 x = 0; x < pitch; x += 8) {
+						byte *dest = cur + y * pitch + x;
+						const int32 *block = &blocks[((x + y) / 8 % 64) * 64];
+
+						switch ((x / 8 + y / 8 * 3) % 4) {
+						case 0:
+							Video::binkIDCTPut(dest, pitch, block);
+							break;
+						case 1:
+							Video::binkCopyBlock(dest, prev + y * pitch + x, pitch);
+							Video::binkIDCTAdd(dest, pitch, block);
+							break;
+						case 2:
+							Video::binkCopyBlock(dest, prev + y * pitch + x, pitch);
+							Video::binkAddResidue(dest, pitch, residue);
+							break;
+						default:
+							Video::binkCopyBlock(dest, prev + y * pitch + x, pitch);
+							break;
+						}
+					}
+				}
+			}
+		}
+		const double us = getBenchmarkTime() - start;
+
+		TS_TRACE(Common::String::format("640x480 Bink block decoding: %6.1f frames per second", frames * 1e6 / MAX(us, 1.0)).c_str());
+#endif
+	}
+};
@@ -0,0 +1,408 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+// The IDCT is based on the one of the Bink decoder found in FFmpeg.
+
+#include "video/bink_dsp.h"
+
+#ifdef USE_BINK
+
+#if defined(__SSE2__)
+#define BINK_DSP_SSE2
+#define BINK_DSP_VECTOR
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define BINK_DSP_NEON
+#define BINK_DSP_VECTOR
+#include <arm_neon.h>
+#endif
+
+namespace Video {
+
+#define A1  2896 /* (1/sqrt(2))<<12 */
+#define A2  2217
+#define A3  3784
+#define A4 -5352
+
+#ifndef BINK_DSP_VECTOR
+
+#define IDCT_TRANSFORM(dest,s0,s1,s2,s3,s4,s5,s6,s7,d0,d1,d2,d3,d4,d5,d6,d7,munge,src) {\
+    const int a0 = (src)[s0] + (src)[s4]; \
+    const int a1 = (src)[s0] - (src)[s4]; \
+    const int a2 = (src)[s2] + (src)[s6]; \
+    const int a3 = (A1*((src)[s2] - (src)[s6])) >> 11; \
+    const int a4 = (src)[s5] + (src)[s3]; \
+    const int a5 = (src)[s5] - (src)[s3]; \
+    const int a6 = (src)[s1] + (src)[s7]; \
+    const int a7 = (src)[s1] - (src)[s7]; \
+    const int b0 = a4 + a6; \
+    const int b1 = (A3*(a5 + a7)) >> 11; \
+    const int b2 = ((A4*a5) >> 11) - b0 + b1; \
+    const int b3 = (A1*(a6 - a4) >> 11) - b2; \
+    const int b4 = ((A2*a7) >> 11) + b3 - b1; \
+    (dest)[d0] = munge(a0+a2   +b0); \
+    (dest)[d1] = munge(a1+a3-a2+b2); \
+    (dest)[d2] = munge(a1-a3+a2+b3); \
+    (dest)[d3] = munge(a0-a2   -b4); \
+    (dest)[d4] = munge(a0-a2   +b4); \
+    (dest)[d5] = munge(a1-a3+a2-b3); \
+    (dest)[d6] = munge(a1+a3-a2-b2); \
+    (dest)[d7] = munge(a0+a2   -b0); \
+}
+/* end IDCT_TRANSFORM macro */
+
+#define MUNGE_NONE(x) (x)
+#define IDCT_COL(dest,src) IDCT_TRANSFORM(dest,0,8,16,24,32,40,48,56,0,8,16,24,32,40,48,56,MUNGE_NONE,src)
+
+#define MUNGE_ROW(x) (((x) + 0x7F)>>8)
+#define IDCT_ROW(dest,src) IDCT_TRANSFORM(dest,0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7,MUNGE_ROW,src)
+
+static inline void IDCTCol(int32 *dest, const int32 *src) {
+	if ((src[8] | src[16] | src[24] | src[32] | src[40] | src[48] | src[56]) == 0) {
+		dest[ 0] =
+		dest[ 8] =
+		dest[16] =
+		dest[24] =
+		dest[32] =
+		dest[40] =
+		dest[48] =
+		dest[56] = src[0];
+	} else {
+		IDCT_COL(dest, src);
+	}
+}
+
+static inline void IDCTCols(int32 *temp, const int32 *block) {
+	for (int i = 0; i < 8; i++)
+		IDCTCol(&temp[i], &block[i]);
+}
+
+void binkIDCT(int32 *block) {
+	int32 temp[64];
+
+	IDCTCols(temp, block);
+	for (int i = 0; i < 8; i++)
+		IDCT_ROW( (&block[8*i]), (&temp[8*i]) );
+}
+
+void binkIDCTPut(byte *dest, uint32 pitch, const int32 *block) {
+	int32 temp[64];
+
+	IDCTCols(temp, block);
+	for (int i = 0; i < 8; i++)
+		IDCT_ROW( (&dest[i*pitch]), (&temp[8*i]) );
+}
+
+void binkIDCTPutScaled(byte *dest, uint32 pitch, const int32 *block) {
+	int32 temp[64];
+	memcpy(temp, block, sizeof(temp));
+	binkIDCT(temp);
+
+	const int32 *src = temp;
+	for (int j = 0; j < 8; j++, dest += pitch * 2, src += 8) {
+		byte *dest1 = dest;
+		byte *dest2 = dest + pitch;
+
+		for (int i = 0; i < 8; i++, dest1 += 2, dest2 += 2)
+			dest1[0] = dest1[1] = dest2[0] = dest2[1] = src[i];
+	}
+}
+
+void binkIDCTAdd(byte *dest, uint32 pitch, const int32 *block) {
+	int32 temp[64];
+	memcpy(temp, block, sizeof(temp));
+	binkIDCT(temp);
+
+	const int32 *src = temp;
+	for (int i = 0; i < 8; i++, dest += pitch, src += 8)
+		for (int j = 0; j < 8; j++)
+			dest[j] += src[j];
+}
+
+void binkAddResidue(byte *dest, uint32 pitch, const int16 *block) {
+	for (int i = 0; i < 8; i++, dest += pitch, block += 8)
+		for (int j = 0; j < 8; j++)
+			dest[j] += block[j];
+}
+
+void binkCopyBlock(byte *dest, const byte *src, uint32 pitch) {
+	for (int j = 0; j < 8; j++, dest += pitch, src += pitch)
+		memcpy(dest, src, 8);
+}
+
+#else // BINK_DSP_VECTOR
+
+// The vector version transforms four columns, and after transposing four
+// rows, at once. Both passes need every coefficient anyway, so unlike the
+// scalar version it doesn't look for empty columns.
+
+#if defined(BINK_DSP_SSE2)
+
+typedef __m128i IDCTVector;
+
+static inline IDCTVector idctLoad(const int32 *src) { return _mm_loadu_si128((const __m128i *)src); }
+static inline void idctStore(int32 *dst, IDCTVector v) { _mm_storeu_si128((__m128i *)dst, v); }
+static inline IDCTVector idctAdd(IDCTVector a, IDCTVector b) { return _mm_add_epi32(a, b); }
+static inline IDCTVector idctSub(IDCTVector a, IDCTVector b) { return _mm_sub_epi32(a, b); }
+
+/** (c * a) >> 11, with the wrapping 32 bit multiplication of the scalar code */
+static inline IDCTVector idctMul(IDCTVector a, int32 c) {
+	// SSE2 only multiplies two of the four lanes at once, but the low half
+	// of the product is the same for signed and unsigned values
+	const __m128i factor = _mm_set1_epi32(c);
+	const __m128i even = _mm_mul_epu32(a, factor);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), factor);
+	const __m128i product = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                                           _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	return _mm_srai_epi32(product, 11);
+}
+
+static inline IDCTVector idctRound(IDCTVector a) {
+	return _mm_srai_epi32(_mm_add_epi32(a, _mm_set1_epi32(0x7F)), 8);
+}
+
+static inline void idctTranspose(IDCTVector &r0, IDCTVector &r1, IDCTVector &r2, IDCTVector &r3) {
+	const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+	r0 = _mm_unpacklo_epi64(t0, t1);
+	r1 = _mm_unpackhi_epi64(t0, t1);
+	r2 = _mm_unpacklo_epi64(t2, t3);
+	r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/** Packs one row of results into 8 pixels, keeping the low 8 bits like a store to byte does */
+static inline __m128i idctPackRow(IDCTVector lo, IDCTVector hi) {
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const __m128i row = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+	return _mm_packus_epi16(row, row);
+}
+
+static inline void idctPutRow(byte *dest, IDCTVector lo, IDCTVector hi) {
+	_mm_storel_epi64((__m128i *)dest, idctPackRow(lo, hi));
+}
+
+static inline void idctPutRowScaled(byte *dest, uint32 pitch, IDCTVector lo, IDCTVector hi) {
+	const __m128i row = idctPackRow(lo, hi);
+	const __m128i doubled = _mm_unpacklo_epi8(row, row);
+	_mm_storeu_si128((__m128i *)dest, doubled);
+	_mm_storeu_si128((__m128i *)(dest + pitch), doubled);
+}
+
+static inline void idctAddRow(byte *dest, IDCTVector lo, IDCTVector hi) {
+	const __m128i pixels = _mm_loadl_epi64((const __m128i *)dest);
+	_mm_storel_epi64((__m128i *)dest, _mm_add_epi8(pixels, idctPackRow(lo, hi)));
+}
+
+void binkAddResidue(byte *dest, uint32 pitch, const int16 *block) {
+	const __m128i mask = _mm_set1_epi16(0xFF);
+
+	for (int i = 0; i < 8; i++, dest += pitch, block += 8) {
+		const __m128i residue = _mm_and_si128(_mm_loadu_si128((const __m128i *)block), mask);
+		const __m128i pixels = _mm_loadl_epi64((const __m128i *)dest);
+		_mm_storel_epi64((__m128i *)dest, _mm_add_epi8(pixels, _mm_packus_epi16(residue, residue)));
+	}
+}
+
+void binkCopyBlock(byte *dest, const byte *src, uint32 pitch) {
+	for (int j = 0; j < 8; j++, dest += pitch, src += pitch)
+		_mm_storel_epi64((__m128i *)dest, _mm_loadl_epi64((const __m128i *)src));
+}
+
+#elif defined(BINK_DSP_NEON)
+
+typedef int32x4_t IDCTVector;
+
+static inline IDCTVector idctLoad(const int32 *src) { return vld1q_s32(src); }
+static inline void idctStore(int32 *dst, IDCTVector v) { vst1q_s32(dst, v); }
+static inline IDCTVector idctAdd(IDCTVector a, IDCTVector b) { return vaddq_s32(a, b); }
+static inline IDCTVector idctSub(IDCTVector a, IDCTVector b) { return vsubq_s32(a, b); }
+
+/** (c * a) >> 11, with the wrapping 32 bit multiplication of the scalar code */
+static inline IDCTVector idctMul(IDCTVector a, int32 c) {
+	return vshrq_n_s32(vmulq_n_s32(a, c), 11);
+}
+
+static inline IDCTVector idctRound(IDCTVector a) {
+	return vshrq_n_s32(vaddq_s32(a, vdupq_n_s32(0x7F)), 8);
+}
+
+static inline void idctTranspose(IDCTVector &r0, IDCTVector &r1, IDCTVector &r2, IDCTVector &r3) {
+	const int32x4x2_t t0 = vtrnq_s32(r0, r1);
+	const int32x4x2_t t1 = vtrnq_s32(r2, r3);
+	r0 = vcombine_s32(vget_low_s32(t0.val[0]), vget_low_s32(t1.val[0]));
+	r1 = vcombine_s32(vget_low_s32(t0.val[1]), vget_low_s32(t1.val[1]));
+	r2 = vcombine_s32(vget_high_s32(t0.val[0]), vget_high_s32(t1.val[0]));
+	r3 = vcombine_s32(vget_high_s32(t0.val[1]), vget_high_s32(t1.val[1]));
+}
+
+/** Packs one row of results into 8 pixels, keeping the low 8 bits like a store to byte does */
+static inline uint8x8_t idctPackRow(IDCTVector lo, IDCTVector hi) {
+	const int16x8_t row = vcombine_s16(vmovn_s32(lo), vmovn_s32(hi));
+	return vmovn_u16(vreinterpretq_u16_s16(row));
+}
+
+static inline void idctPutRow(byte *dest, IDCTVector lo, IDCTVector hi) {
+	vst1_u8(dest, idctPackRow(lo, hi));
+}
+
+static inline void idctPutRowScaled(byte *dest, uint32 pitch, IDCTVector lo, IDCTVector hi) {
+	const uint8x8_t row = idctPackRow(lo, hi);
+	const uint8x8x2_t doubled = vzip_u8(row, row);
+	const uint8x16_t pixels = vcombine_u8(doubled.val[0], doubled.val[1]);
+	vst1q_u8(dest, pixels);
+	vst1q_u8(dest + pitch, pixels);
+}
+
+static inline void idctAddRow(byte *dest, IDCTVector lo, IDCTVector hi) {
+	vst1_u8(dest, vadd_u8(vld1_u8(dest), idctPackRow(lo, hi)));
+}
+
+void binkAddResidue(byte *dest, uint32 pitch, const int16 *block) {
+	for (int i = 0; i < 8; i++, dest += pitch, block += 8) {
+		const uint8x8_t residue = vmovn_u16(vreinterpretq_u16_s16(vld1q_s16(block)));
+		vst1_u8(dest, vadd_u8(vld1_u8(dest), residue));
+	}
+}
+
+void binkCopyBlock(byte *dest, const byte *src, uint32 pitch) {
+	for (int j = 0; j < 8; j++, dest += pitch, src += pitch)
+		vst1_u8(dest, vld1_u8(src));
+}
+
+#endif
+
+/** One pass of the IDCT over four columns or rows, the same as IDCT_TRANSFORM */
+static inline void idctTransform(IDCTVector *d, const IDCTVector *s) {
+	const IDCTVector a0 = idctAdd(s[0], s[4]);
+	const IDCTVector a1 = idctSub(s[0], s[4]);
+	const IDCTVector a2 = idctAdd(s[2], s[6]);
+	const IDCTVector a3 = idctMul(idctSub(s[2], s[6]), A1);
+	const IDCTVector a4 = idctAdd(s[5], s[3]);
+	const IDCTVector a5 = idctSub(s[5], s[3]);
+	const IDCTVector a6 = idctAdd(s[1], s[7]);
+	const IDCTVector a7 = idctSub(s[1], s[7]);
+	const IDCTVector b0 = idctAdd(a4, a6);
+	const IDCTVector b1 = idctMul(idctAdd(a5, a7), A3);
+	const IDCTVector b2 = idctAdd(idctSub(idctMul(a5, A4), b0), b1);
+	const IDCTVector b3 = idctSub(idctMul(idctSub(a6, a4), A1), b2);
+	const IDCTVector b4 = idctSub(idctAdd(idctMul(a7, A2), b3), b1);
+
+	const IDCTVector c0 = idctAdd(a0, a2);
+	const IDCTVector c1 = idctSub(idctAdd(a1, a3), a2);
+	const IDCTVector c2 = idctAdd(idctSub(a1, a3), a2);
+	const IDCTVector c3 = idctSub(a0, a2);
+
+	d[0] = idctAdd(c0, b0);
+	d[1] = idctAdd(c1, b2);
+	d[2] = idctAdd(c2, b3);
+	d[3] = idctSub(c3, b4);
+	d[4] = idctAdd(c3, b4);
+	d[5] = idctSub(c2, b3);
+	d[6] = idctSub(c1, b2);
+	d[7] = idctSub(c0, b0);
+}
+
+/** Transposes the 8x8 matrix held in the left and right halves of its rows */
+static inline void idctTranspose(IDCTVector *left, IDCTVector *right) {
+	idctTranspose(left[0], left[1], left[2], left[3]);
+	idctTranspose(right[0], right[1], right[2], right[3]);
+	idctTranspose(left[4], left[5], left[6], left[7]);
+	idctTranspose(right[4], right[5], right[6], right[7]);
+
+	for (int i = 0; i < 4; i++) {
+		const IDCTVector t = left[4 + i];
+		left[4 + i] = right[i];
+		right[i] = t;
+	}
+}
+
+/**
+ * Does the whole IDCT, returning the rounded results in the left and right
+ * halves of each row.
+ */
+static inline void idct(const int32 *block, IDCTVector *left, IDCTVector *right) {
+	IDCTVector src[8];
+
+	// Columns, four at a time
+	for (int i = 0; i < 8; i++)
+		src[i] = idctLoad(block + i * 8);
+	idctTransform(left, src);
+
+	for (int i = 0; i < 8; i++)
+		src[i] = idctLoad(block + i * 8 + 4);
+	idctTransform(right, src);
+
+	// Rows, four at a time after transposing
+	idctTranspose(left, right);
+
+	idctTransform(src, left);
+	for (int i = 0; i < 8; i++)
+		left[i] = idctRound(src[i]);
+
+	idctTransform(src, right);
+	for (int i = 0; i < 8; i++)
+		right[i] = idctRound(src[i]);
+
+	idctTranspose(left, right);
+}
+
+void binkIDCT(int32 *block) {
+	IDCTVector left[8], right[8];
+	idct(block, left, right);
+
+	for (int i = 0; i < 8; i++) {
+		idctStore(block + i * 8, left[i]);
+		idctStore(block + i * 8 + 4, right[i]);
+	}
+}
+
+void binkIDCTPut(byte *dest, uint32 pitch, const int32 *block) {
+	IDCTVector left[8], right[8];
+	idct(block, left, right);
+
+	for (int i = 0; i < 8; i++, dest += pitch)
+		idctPutRow(dest, left[i], right[i]);
+}
+
+void binkIDCTPutScaled(byte *dest, uint32 pitch, const int32 *block) {
+	IDCTVector left[8], right[8];
+	idct(block, left, right);
+
+	for (int i = 0; i < 8; i++, dest += pitch * 2)
+		idctPutRowScaled(dest, pitch, left[i], right[i]);
+}
+
+void binkIDCTAdd(byte *dest, uint32 pitch, const int32 *block) {
+	IDCTVector left[8], right[8];
+	idct(block, left, right);
+
+	for (int i = 0; i < 8; i++, dest += pitch)
+		idctAddRow(dest, left[i], right[i]);
+}
+
+#endif // BINK_DSP_VECTOR
+
+} // End of namespace Video
+
+#endif // USE_BINK
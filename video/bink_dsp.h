@@ -0,0 +1,62 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/scummsys.h"
+
+#ifdef USE_BINK
+
+#ifndef VIDEO_BINK_DSP_H
+#define VIDEO_BINK_DSP_H
+
+namespace Video {
+
+/**
+ * Pixel block operations of the Bink video decoder.
+ *
+ * All of them work on 8x8 blocks. Results are stored modulo 256 into the
+ * planes, exactly like the original decoder did. These use SSE2 or NEON
+ * when available and fall back to plain C++ otherwise.
+ */
+
+/** Inverse transforms an 8x8 block of DCT coefficients in place. */
+void binkIDCT(int32 *block);
+
+/** Inverse transforms an 8x8 block and stores it into a plane. */
+void binkIDCTPut(byte *dest, uint32 pitch, const int32 *block);
+
+/** Inverse transforms an 8x8 block and stores it as 16x16 pixels into a plane. */
+void binkIDCTPutScaled(byte *dest, uint32 pitch, const int32 *block);
+
+/** Inverse transforms an 8x8 block and adds it to a plane. */
+void binkIDCTAdd(byte *dest, uint32 pitch, const int32 *block);
+
+/** Adds an 8x8 block of residue values to a plane. */
+void binkAddResidue(byte *dest, uint32 pitch, const int16 *block);
+
+/** Copies an 8x8 block of pixels between two planes with the same pitch. */
+void binkCopyBlock(byte *dest, const byte *src, uint32 pitch);
+
+} // End of namespace Video
+
+#endif // VIDEO_BINK_DSP_H
+
+#endif // USE_BINK